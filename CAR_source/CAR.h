@@ -73,6 +73,7 @@ rcode DTLAPI CAR_exit();
 rcode DTLAPI CAR_set_compat(double w_unc, double v_unc);
 rcode DTLAPI CAR_get_W_ordinal(int n_nodes, cr_col ord_wts);
 rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel);
+rcode DTLAPI CAR_set_W_bases(int n_groups, int n_nodes[], car_vector ord_crit[], car_vector rel[]);
 rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes, car_vector rel);
 rcode DTLAPI CAR_set_V_base(int crit, car_vector ord_alts, car_vector ord_nodes, car_vector rel);
 /*** Weight partial hull (DURENO-II) ***/
@@ -85,3 +86,7 @@ rcode DTLAPI CAR_equal_W_phull(struct user_w_stmt_rec* swp);
 /*** Distance ranking ***/
 rcode DTLAPI CAR_rank_W_base(int n_nodes, car_vector ord_crit, double dist);
 rcode DTLAPI CAR_rank_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes, double dist);
+/*** Transactions ***/
+rcode DTLAPI CAR_begin_trans();
+rcode DTLAPI CAR_commit_trans();
+rcode DTLAPI CAR_abort_trans();
@@ -150,6 +150,24 @@ static double compat_w=COMPAT_W;
 static double compat_v=COMPAT_V;
 static int car_activated=FALSE;
 static int phull_open=FALSE;
+static int car_trans=FALSE;
+static struct user_frame *trans_uf;
+
+/* Rank weight tables kept across frames */
+#define CRC_TABLES 32
+
+struct crc_table {
+	int method;
+	int slots;
+	int offset;
+	double z;
+	double *crc; // [1..slots+offset]
+	};
+
+static struct crc_table crc_tab[CRC_TABLES];
+static int crc_next=0;
+
+static void crc_release();
 
 
  /**********************************************************
@@ -211,6 +229,7 @@ rcode DTLAPI CAR_exit() {
 		cst_log("CAR_exit()\n");
 #endif
 	/* Reset all run parameters */
+	crc_release();
 	crc_method = 0;
 	compat_w_mode = 0;
 	compat_v_mode = 0;
@@ -219,6 +238,7 @@ rcode DTLAPI CAR_exit() {
 	compat_v = COMPAT_V;
 	car_activated = FALSE;
 	phull_open = FALSE;
+	car_trans = FALSE;
 	return CAR_OK;
 	}
 
@@ -395,6 +415,79 @@ static void gen_xr(int slots, int offset, double z) {
 	}
 
 
+ /*********************************************************
+  *
+  *  Rank weight tables
+  *
+  *  The generated weights depend only on (method, slots,
+  *  offset, z) while the same rankings are entered over
+  *  and over when hierarchies are re-ranked. Each vector
+  *  is generated once into crc and a copy is kept in a
+  *  small table shared by all frames, replaced round robin.
+  *  A table hit is a plain copy, bit-identical to the
+  *  generated vector.
+  *
+  *********************************************************/
+
+static rcode gen_crc(int method, int slots, int offset, int n_act) {
+	int i,t,len;
+	double z;
+
+	switch (method) {
+		case 0:  z = 1.0+min((double)n_act/60.0,0.25); break; // adaptive CAR
+		case 3:  z = 1.35; break;
+		case 1:
+		case 2:
+		case 4:
+		case 5:  z = 0.0;  break;
+		default: return CAR_INPUT_ERROR;
+		}
+	len = slots+offset;
+	for (t=0; t<CRC_TABLES; t++)
+		if (crc_tab[t].crc && (crc_tab[t].method == method) && (crc_tab[t].slots == slots) &&
+				(crc_tab[t].offset == offset) && (crc_tab[t].z == z)) {
+			for (i=1; i<=len; i++)
+				crc[i] = crc_tab[t].crc[i];
+			return CAR_OK;
+			}
+	switch (method) {
+		case 0:  gen_rx(slots,offset,z);  break;
+		case 1:  gen_rs(slots,offset);    break;
+		case 2:  gen_rr(slots,offset);    break;
+		case 3:  gen_xr(slots,offset,z);  break;
+		case 4:  gen_sr(slots,offset);    break;
+		case 5:  gen_roc(slots,offset);   break;
+		}
+	/* Keep a copy, no table if out of memory */
+	t = crc_next;
+	crc_next = (crc_next+1)%CRC_TABLES;
+	if (crc_tab[t].crc)
+		mem_free((void *)crc_tab[t].crc);
+	crc_tab[t].crc = (double *)mem_alloc((len+1)*sizeof(double),"double","gen_crc");
+	if (crc_tab[t].crc) {
+		crc_tab[t].method = method;
+		crc_tab[t].slots = slots;
+		crc_tab[t].offset = offset;
+		crc_tab[t].z = z;
+		for (i=1; i<=len; i++)
+			crc_tab[t].crc[i] = crc[i];
+		}
+	return CAR_OK;
+	}
+
+
+static void crc_release() {
+	int t;
+
+	for (t=0; t<CRC_TABLES; t++) {
+		if (crc_tab[t].crc)
+			mem_free((void *)crc_tab[t].crc);
+		crc_tab[t].crc = NULL;
+		}
+	crc_next = 0;
+	}
+
+
  /*********************************************************
   *
   *  Ordinal weight generation
@@ -410,7 +503,7 @@ rcode DTLAPI CAR_get_W_ordinal(int n_nodes, cr_col ord_wts) {
 	if (!frame_loaded)
 		return CAR_FRAME_NOT_LOADED;
 	/* Generate weights from implicit ordinal ranking */
-	gen_rx(n_nodes,0,1.0+min((double)n_nodes/60.0,0.25));
+	gen_crc(0,n_nodes,0,n_nodes);
 	for (i=1; i<=n_nodes; i++)
 		ord_wts[i] = crc[i];
 	return CAR_OK;
@@ -456,33 +549,24 @@ static void rollback_W_base() {
 	}
 
 
-rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
+/* Statements of the sibling groups being entered */
+static struct user_w_stmt_rec w_stmts[MAX_STMTS+1];
+static int n_w_stmts;
+static bool w_mbox;
+
+
+/* Check one sibling group ranking and append its statements to
+ * w_stmts. Its midpoints are left in eloboxw/eupboxw, or the
+ * group is left at -2.0 (unoccupied) if it sets no midpoints. */
+
+static rcode car_W_group(int n_nodes, car_vector ord_crit, car_vector rel, int n_wts, char *fn) {
 	rcode rc;
-	int i,k,n_wts,n_act_nodes,tot,inx;
+	int i,k,n_act_nodes,tot,inx;
 	double rsum;
 
-	/* Check if function can start */
-	_certify_ptr(ord_crit,101);
-	_certify_ptr(rel,102);
-	if (!car_activated)
-		return CAR_NOT_ACTIVATED;
-	if (!frame_loaded) // protecting PS test
-		return CAR_FRAME_NOT_LOADED;
-	if (phull_open)
-		return CAR_NOT_ALLOWED;
-	if (PS)
-		return CAR_WRONG_FRAME_TYPE;
-	if (mark_W_base())
-		return CAR_SYS_CORRUPT;
-	if (car_light && dtl_nbr_W_midpoints())
-		// created previously with !car_light
-		return CAR_NOT_ALLOWED;
 	/* Check input parameters */
 	if ((n_nodes < 1) || (n_nodes > MAX_NODES))
 		return CAR_INPUT_ERROR;
-	n_wts = DTL_nbr_of_weights();
-	if (n_wts < DTL_OK)
-		return n_wts;
 	if (n_nodes > n_wts)
 		return CAR_INPUT_ERROR;
 	for (k=1; k<=n_nodes; k++)
@@ -499,11 +583,8 @@ rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
 		return CAR_INPUT_ERROR;
 	if (n_nodes == 1)
 		return CAR_OK;
-	/* Initialise box vector */
-	for (i=1; i<=n_wts; i++) {
-		eloboxw[i] = -2.0;
-		eupboxw[i] = -2.0;
-		}
+	if (n_w_stmts+n_nodes > MAX_STMTS)
+		return CAR_INPUT_ERROR;
 	/* Convert weights to [0,1] scale */
 	tot = 1;
 	for (k=1; k<n_nodes; k++) {
@@ -517,7 +598,8 @@ rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
 #ifdef LOG_CAR
 	/* CAR log starts after input checks */
 	if (cst_ext) {
-		cst_log("CAR_set_W_base(");
+		sprintf(msg,"%s(",fn);
+		cst_log(msg);
 		for (k=1; k<n_nodes; k++) {
 			sprintf(msg,"W%d",ord_crit[k]);
 			cst_log(msg);
@@ -534,15 +616,8 @@ rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
 		cst_log(msg);
 		}
 #endif
-	switch (crc_method) {
-		case 0:  gen_rx(tot,0,1.0+min((double)n_act_nodes/60.0,0.25)); break; // adaptive CAR
-		case 1:  gen_rs(tot,0);         break;
-		case 2:  gen_rr(tot,0);         break;
-		case 3:  gen_xr(tot,0,1.35);    break;
-		case 4:  gen_sr(tot,0);         break;
-		case 5:  gen_roc(tot,0);        break;
-		default: return CAR_INPUT_ERROR;
-		}
+	if (rc = gen_crc(crc_method,tot,0,n_act_nodes))
+		return rc;
 	inx = 1;
 	rsum = 0.0;
 	for (k=1; k<=n_act_nodes; k++) {
@@ -561,25 +636,21 @@ rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
 		lobox[ord_crit[k]] = 0.0;
 		upbox[ord_crit[k]] = 0.0;
 		}
-	/* Normalise CRC selection and enter */
-	uwstmt.n_terms = 1;
-	uwstmt.sign[1] = 1;
+	/* Normalise CRC selection */
 	for (k=1; k<=n_nodes; k++) {
 		eloboxw[ord_crit[k]] /= rsum;
 		eupboxw[ord_crit[k]] /= rsum;
-		uwstmt.crit[1] = ord_crit[k];
+		n_w_stmts++;
+		w_stmts[n_w_stmts].n_terms = 1;
+		w_stmts[n_w_stmts].sign[1] = 1;
+		w_stmts[n_w_stmts].crit[1] = ord_crit[k];
 		if (compat_w_mode) { // Excel compatibility mode
-			uwstmt.lobo = (1.0-compat_w)*eloboxw[ord_crit[k]];
-			uwstmt.upbo = (1.0+compat_w)*eloboxw[ord_crit[k]];
+			w_stmts[n_w_stmts].lobo = (1.0-compat_w)*eloboxw[ord_crit[k]];
+			w_stmts[n_w_stmts].upbo = (1.0+compat_w)*eloboxw[ord_crit[k]];
 			}
 		else { // default modern mode
-			uwstmt.lobo = lobox[ord_crit[k]]/rsum;
-			uwstmt.upbo = min(upbox[ord_crit[k]]/rsum,1.0); // because of interpolation upwards
-			}
-		rc = DTL_add_W_statement(&uwstmt);
-		if (rc < DTL_OK) {
-			rollback_W_base();
-			return rc;
+			w_stmts[n_w_stmts].lobo = lobox[ord_crit[k]]/rsum;
+			w_stmts[n_w_stmts].upbo = min(upbox[ord_crit[k]]/rsum,1.0); // because of interpolation upwards
 			}
 		}
 	if (!car_light && (n_act_nodes > 1)) {
@@ -588,11 +659,90 @@ rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
 			eloboxw[ord_crit[k]] = max(eloboxw[ord_crit[k]]-CAR_EPS,0.0);
 			eupboxw[ord_crit[k]] = min(eloboxw[ord_crit[k]]+CAR_EPS,1.0);
 			}
+		w_mbox = TRUE;
+		}
+	else
+		for (k=1; k<=n_nodes; k++) {
+			eloboxw[ord_crit[k]] = -2.0;
+			eupboxw[ord_crit[k]] = -2.0;
+			}
+	return CAR_OK;
+	}
+
+
+/* Enter the collected statements and midpoints in one load */
+
+static rcode car_W_enter() {
+	rcode rc;
+
+	rc = DTL_add_W_statements(n_w_stmts,w_stmts);
+	if (rc < DTL_OK) {
+		rollback_W_base();
+		return rc;
+		}
+	if (w_mbox)
 		if (rc = dtl_set_W_mbox_auto(eloboxw,eupboxw)) {
 			rollback_W_base();
 			return rc;
 			}
+	return CAR_OK;
+	}
+
+
+/* Start collecting W statements unless a transaction is open */
+
+static void car_W_open(int n_wts) {
+	int i;
+
+	if (car_trans)
+		return;
+	for (i=1; i<=n_wts; i++) {
+		eloboxw[i] = -2.0;
+		eupboxw[i] = -2.0;
+		}
+	n_w_stmts = 0;
+	w_mbox = FALSE;
+	}
+
+
+rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
+	rcode rc;
+	int n_wts,first;
+
+	/* Check if function can start */
+	_certify_ptr(ord_crit,101);
+	_certify_ptr(rel,102);
+	if (!car_activated)
+		return CAR_NOT_ACTIVATED;
+	if (!frame_loaded) // protecting PS test
+		return CAR_FRAME_NOT_LOADED;
+	if (phull_open)
+		return CAR_NOT_ALLOWED;
+	if (PS)
+		return CAR_WRONG_FRAME_TYPE;
+	if (car_trans && (uf != trans_uf))
+		return CAR_STATE_ERROR;
+	if (mark_W_base())
+		return CAR_SYS_CORRUPT;
+	if (car_light && dtl_nbr_W_midpoints())
+		// created previously with !car_light
+		return CAR_NOT_ALLOWED;
+	n_wts = DTL_nbr_of_weights();
+	if (n_wts < DTL_OK)
+		return n_wts;
+	car_W_open(n_wts);
+	first = n_w_stmts;
+	if (rc = car_W_group(n_nodes,ord_crit,rel,n_wts,"CAR_set_W_base"))
+		return rc;
+	if (n_w_stmts == first)
+		return CAR_OK;
+	if (car_trans) {
+		/* Entered at commit */
+		ord_crit[0] = n_w_stmts-first;
+		return ord_crit[0];
 		}
+	if (rc = car_W_enter())
+		return rc;
 	/* Return number of statements */
 	ord_crit[0] = DTL_nbr_of_W_stmts()-W_mark;
 #ifdef LOG_CAR
@@ -606,6 +756,84 @@ rcode DTLAPI CAR_set_W_base(int n_nodes, car_vector ord_crit, car_vector rel) {
 	}
 
 
+/* Ordinal rankings for many sibling groups at once, typically all
+ * groups of a criteria hierarchy when it is re-ranked. Group g is
+ * n_nodes[g], ord_crit[g] and rel[g] as in CAR_set_W_base, g=1..
+ * n_groups. All statements are entered with one base load and all
+ * midpoints with one mbox. If any group fails, none is entered.
+ * ord_crit[g][0] returns the number of statements of group g. In
+ * a transaction, the groups are entered at commit. */
+
+rcode DTLAPI CAR_set_W_bases(int n_groups, int n_nodes[], car_vector ord_crit[], car_vector rel[]) {
+	rcode rc;
+	int g,k,n_wts,first,mbox;
+
+	/* Check if function can start */
+	_certify_ptr(n_nodes,101);
+	_certify_ptr(ord_crit,102);
+	_certify_ptr(rel,103);
+	if (!car_activated)
+		return CAR_NOT_ACTIVATED;
+	if (!frame_loaded) // protecting PS test
+		return CAR_FRAME_NOT_LOADED;
+	if (phull_open)
+		return CAR_NOT_ALLOWED;
+	if (PS)
+		return CAR_WRONG_FRAME_TYPE;
+	if (car_trans && (uf != trans_uf))
+		return CAR_STATE_ERROR;
+	if (mark_W_base())
+		return CAR_SYS_CORRUPT;
+	if (car_light && dtl_nbr_W_midpoints())
+		// created previously with !car_light
+		return CAR_NOT_ALLOWED;
+	/* Check input parameters */
+	if ((n_groups < 1) || (n_groups > MAX_NODES))
+		return CAR_INPUT_ERROR;
+	n_wts = DTL_nbr_of_weights();
+	if (n_wts < DTL_OK)
+		return n_wts;
+#ifdef LOG_CAR
+	if (cst_ext) {
+		sprintf(msg,"CAR_set_W_bases(%d) -->\n",n_groups);
+		cst_log(msg);
+		}
+#endif
+	car_W_open(n_wts);
+	first = n_w_stmts;
+	mbox = w_mbox;
+	for (g=1; g<=n_groups; g++)
+		if (rc = car_W_group(n_nodes[g],ord_crit[g],rel[g],n_wts," group")) {
+			/* Drop the groups already collected */
+			for (g--; g; g--)
+				for (k=1; k<=n_nodes[g]; k++) {
+					eloboxw[ord_crit[g][k]] = -2.0;
+					eupboxw[ord_crit[g][k]] = -2.0;
+					}
+			n_w_stmts = first;
+			w_mbox = mbox;
+			return rc;
+			}
+	for (g=1; g<=n_groups; g++)
+		ord_crit[g][0] = n_nodes[g]>1?n_nodes[g]:0;
+	if (car_trans)
+		/* Entered at commit */
+		return n_w_stmts-first;
+	if (n_w_stmts)
+		if (rc = car_W_enter())
+			return rc;
+	/* Return number of statements */
+#ifdef LOG_CAR
+	/* Log error-free completion */
+	if (cst_ext) {
+		sprintf(msg,"--> end of CAR_set_W_bases(%d)\n",DTL_nbr_of_W_stmts()-W_mark);
+		cst_log(msg);
+		}
+#endif
+	return DTL_nbr_of_W_stmts()-W_mark;
+	}
+
+
  /**********************************************************
   *
   *  Partial hull weight verification using DURENO-II
@@ -676,7 +904,7 @@ rcode DTLAPI CAR_open_W_phull() {
 		return CAR_FRAME_NOT_LOADED;
 	if (PS)
 		return CAR_WRONG_FRAME_TYPE;
-	if (phull_open)
+	if (phull_open || car_trans)
 		return CAR_NOT_ALLOWED;
 	if (uf->WP_autogen[0]) {
 		for (k=1,i=1; i<=uf->df->n_alts; i++)
@@ -1006,9 +1234,63 @@ static void rollback_P_base(int crit) {
 	}
 
 
+/* Statements of the sibling groups being entered (one criterion) */
+static struct user_stmt_rec p_stmts[MAX_STMTS+1];
+static int n_p_stmts;
+static int p_crit;
+static bool p_mbox;
+
+
+/* Start collecting P statements for crit. In a transaction, all P
+ * statements must belong to the same criterion. */
+
+static rcode car_P_open(int crit) {
+	int i,j,k,n_alts;
+
+	if (car_trans && p_crit)
+		return p_crit==crit?CAR_OK:CAR_NOT_ALLOWED;
+	/* Initialise box matrix */
+	n_alts = DTL_nbr_of_alts();
+	if (n_alts < DTL_OK)
+		return n_alts;
+	for (i=1; i<=n_alts; i++) {
+		k = DTL_nbr_of_nodes(crit,i);
+		if (k < DTL_OK)
+			return k;
+		for (j=1; j<=k; j++) {
+			elobox[i][j] = -2.0;
+			eupbox[i][j] = -2.0;
+			}
+		}
+	n_p_stmts = 0;
+	p_crit = crit;
+	p_mbox = FALSE;
+	return CAR_OK;
+	}
+
+
+/* Enter the collected statements and midpoints in one load */
+
+static rcode car_P_enter() {
+	rcode rc;
+
+	rc = DTL_add_P_statements(p_crit,n_p_stmts,p_stmts);
+	if (rc < DTL_OK) {
+		rollback_P_base(p_crit);
+		return rc;
+		}
+	if (p_mbox)
+		if (rc = dtl_set_P_mbox_auto(p_crit,elobox,eupbox)) {
+			rollback_P_base(p_crit);
+			return rc;
+			}
+	return CAR_OK;
+	}
+
+
 rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes, car_vector rel) {
 	rcode rc;
-	int i,j,k,n_act_nodes,t_nodes,tot,inx;
+	int i,k,n_act_nodes,t_nodes,tot,inx,first;
 	int n_alts;
 	double rsum;
 
@@ -1019,6 +1301,8 @@ rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes
 		return CAR_NOT_ACTIVATED;
 	if (!frame_loaded)
 		return CAR_FRAME_NOT_LOADED;
+	if (car_trans && (uf != trans_uf))
+		return CAR_STATE_ERROR;
 	/* Check input parameters */
 	if ((n_nodes < 1) || (n_nodes > MAX_NODES))
 		return CAR_INPUT_ERROR;
@@ -1048,16 +1332,10 @@ rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes
 		return CAR_INPUT_ERROR;
 	if (n_nodes == 1)
 		return CAR_OK;
-	/* Initialise box matrix */
-	for (i=1; i<=n_alts; i++) {
-		k = DTL_nbr_of_nodes(crit,i);
-		if (k < DTL_OK)
-			return k;
-		for (j=1; j<=k; j++) {
-			elobox[i][j] = -2.0;
-			eupbox[i][j] = -2.0;
-			}
-		}
+	if (rc = car_P_open(crit))
+		return rc;
+	if (n_p_stmts+n_nodes > MAX_STMTS)
+		return CAR_INPUT_ERROR;
 	/* Convert probabilities to [0,1] scale */
 	tot = 1;
 	for (k=1; k<n_nodes; k++) {
@@ -1088,15 +1366,8 @@ rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes
 		cst_log(msg);
 		}
 #endif
-	switch (crc_method) {
-		case 0:  gen_rx(tot,0,1.0+min((double)n_act_nodes/60.0,0.25)); break; // adaptive CAR
-		case 1:  gen_rs(tot,0);         break;
-		case 2:  gen_rr(tot,0);         break;
-		case 3:  gen_xr(tot,0,1.35);    break;
-		case 4:  gen_sr(tot,0);         break;
-		case 5:  gen_roc(tot,0);        break;
-		default: return CAR_INPUT_ERROR;
-		}
+	if (rc = gen_crc(crc_method,tot,0,n_act_nodes))
+		return rc;
 	inx = 1;
 	rsum = 0.0;
 	for (k=1; k<=n_act_nodes; k++) {
@@ -1115,21 +1386,18 @@ rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes
 		lobox[ord_nodes[k]] = 0.0;
 		upbox[ord_nodes[k]] = 0.0;
 		}
-	/* Normalise CRC selection and enter */
-	ustmt.n_terms = 1;
-	ustmt.sign[1] = 1;
-	ustmt.alt[1]  = alt;
+	/* Normalise CRC selection */
+	first = n_p_stmts;
 	for (k=1; k<=n_nodes; k++) {
 		elobox[alt][ord_nodes[k]] /= rsum;
 		eupbox[alt][ord_nodes[k]] /= rsum;
-		ustmt.cons[1] = ord_nodes[k];
-		ustmt.lobo = lobox[ord_nodes[k]]/rsum;
-		ustmt.upbo = min(upbox[ord_nodes[k]]/rsum,1.0); // limit upwards interpolation
-		rc = DTL_add_P_statement(crit,&ustmt);
-		if (rc < DTL_OK) {
-			rollback_P_base(crit);
-			return rc;
-			}
+		n_p_stmts++;
+		p_stmts[n_p_stmts].n_terms = 1;
+		p_stmts[n_p_stmts].sign[1] = 1;
+		p_stmts[n_p_stmts].alt[1] = alt;
+		p_stmts[n_p_stmts].cons[1] = ord_nodes[k];
+		p_stmts[n_p_stmts].lobo = lobox[ord_nodes[k]]/rsum;
+		p_stmts[n_p_stmts].upbo = min(upbox[ord_nodes[k]]/rsum,1.0); // limit upwards interpolation
 		}
 	/* For TCL stability */
 	if (!car_light && (n_act_nodes > 1)) {
@@ -1137,11 +1405,20 @@ rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes
 			eupbox[alt][ord_nodes[k]] = min(elobox[alt][ord_nodes[k]]+CAR_EPS,1.0);
 			elobox[alt][ord_nodes[k]] = max(elobox[alt][ord_nodes[k]]-CAR_EPS,0.0);
 			}
-		if (rc = dtl_set_P_mbox_auto(crit,elobox,eupbox)) {
-			rollback_P_base(crit);
-			return rc;
+		p_mbox = TRUE;
+		}
+	else
+		for (k=1; k<=n_nodes; k++) {
+			elobox[alt][ord_nodes[k]] = -2.0;
+			eupbox[alt][ord_nodes[k]] = -2.0;
 			}
+	if (car_trans) {
+		/* Entered at commit */
+		ord_nodes[0] = n_p_stmts-first;
+		return ord_nodes[0];
 		}
+	if (rc = car_P_enter())
+		return rc;
 	/* Return number of statements */
 	ord_nodes[0] = DTL_nbr_of_P_stmts(crit)-P_mark;
 #ifdef LOG_CAR
@@ -1155,6 +1432,112 @@ rcode DTLAPI CAR_set_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes
 	}
 
 
+ /*********************************************************
+  *
+  *  Transactions
+  *
+  *  Between CAR_begin_trans and CAR_commit_trans, the
+  *  W and P base calls (CAR_set_W_base, CAR_set_W_bases,
+  *  CAR_set_P_base, CAR_rank_W_base and CAR_rank_P_base)
+  *  only collect their statements and midpoints. The
+  *  commit enters them with one base load per base and
+  *  a single rollback point: if any part fails, none of
+  *  the statements are entered. The P calls of a trans-
+  *  action must all concern the same criterion. V bases
+  *  and partial hulls are not part of transactions.
+  *
+  *********************************************************/
+
+rcode DTLAPI CAR_begin_trans() {
+	int n_wts;
+
+	/* Check if function can start */
+	if (!car_activated)
+		return CAR_NOT_ACTIVATED;
+	if (!frame_loaded)
+		return CAR_FRAME_NOT_LOADED;
+	if (car_trans || phull_open)
+		return CAR_NOT_ALLOWED;
+#ifdef LOG_CAR
+	/* Log error-free call */
+	if (cst_ext)
+		cst_log("CAR_begin_trans()\n");
+#endif
+	n_wts = PS?0:DTL_nbr_of_weights();
+	if (n_wts < DTL_OK)
+		return n_wts;
+	car_W_open(n_wts);
+	n_p_stmts = 0;
+	p_crit = 0;
+	p_mbox = FALSE;
+	trans_uf = uf;
+	car_trans = TRUE;
+	return CAR_OK;
+	}
+
+
+rcode DTLAPI CAR_commit_trans() {
+	rcode rc;
+
+	/* Check if function can start */
+	if (!car_activated)
+		return CAR_NOT_ACTIVATED;
+	if (!car_trans)
+		return CAR_STATE_ERROR;
+	car_trans = FALSE;
+	if (!frame_loaded || (uf != trans_uf))
+		return CAR_STATE_ERROR;
+#ifdef LOG_CAR
+	/* Log error-free call */
+	if (cst_ext) {
+		sprintf(msg,"CAR_commit_trans(%d,%d)\n",n_w_stmts,n_p_stmts);
+		cst_log(msg);
+		}
+#endif
+	/* Enter W base */
+	if (n_w_stmts) {
+		if (mark_W_base())
+			return CAR_SYS_CORRUPT;
+		if (rc = car_W_enter())
+			return rc;
+		}
+	/* Enter P base, taking W back if it fails */
+	if (n_p_stmts) {
+		if (mark_P_base(p_crit))
+			rc = CAR_CRIT_UNKNOWN;
+		else
+			rc = car_P_enter();
+		if (rc) {
+			if (n_w_stmts)
+				rollback_W_base();
+			return rc;
+			}
+		}
+	/* Return number of statements */
+	return n_w_stmts+n_p_stmts;
+	}
+
+
+rcode DTLAPI CAR_abort_trans() {
+
+	/* Check if function can start */
+	if (!car_activated)
+		return CAR_NOT_ACTIVATED;
+	if (!car_trans)
+		return CAR_STATE_ERROR;
+#ifdef LOG_CAR
+	/* Log error-free call */
+	if (cst_ext)
+		cst_log("CAR_abort_trans()\n");
+#endif
+	/* Drop collected statements */
+	car_trans = FALSE;
+	n_w_stmts = 0;
+	n_p_stmts = 0;
+	return CAR_OK;
+	}
+
+
  /*********************************************************
   *
   *  Value base
@@ -1194,6 +1577,8 @@ rcode DTLAPI CAR_set_V_base(int crit, car_vector ord_alts, car_vector ord_nodes,
 		return CAR_NOT_ACTIVATED;
 	if (!frame_loaded)
 		return CAR_FRAME_NOT_LOADED;
+	if (car_trans)
+		return CAR_NOT_ALLOWED;
 	/* Check input parameters */
 	if (car_light && dtl_nbr_V_midpoints(crit))
 		// created previously with !car_light
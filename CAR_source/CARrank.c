@@ -51,7 +51,7 @@
 
 rcode DTLAPI CAR_rank_W_base(int n_nodes, car_vector ord_crit, double dist) {
 	rcode rc;
-	int k,n_wts;
+	int k,n_wts,first;
 	double dfact;
 
 	/* Check if function can start */
@@ -72,6 +72,8 @@ rcode DTLAPI CAR_rank_W_base(int n_nodes, car_vector ord_crit, double dist) {
 		return CAR_FRAME_NOT_LOADED;
 	if (PS)
 		return CAR_WRONG_FRAME_TYPE;
+	if (car_trans && (uf != trans_uf))
+		return CAR_STATE_ERROR;
 	if (fabs(dist) > 1.0)
 		return CAR_INPUT_ERROR;
 	if (mark_W_base())
@@ -99,33 +101,33 @@ rcode DTLAPI CAR_rank_W_base(int n_nodes, car_vector ord_crit, double dist) {
 	if (n_nodes == 1)
 		return CAR_OK;
 	/* Build distance ranking statements and enter */
-	switch (crc_method) {
-		case 0:  gen_rx(n_nodes,0,1.0+min((double)n_nodes/60.0,0.25)); break; // adaptive CAR
-		case 1:  gen_rs(n_nodes,0);      break;
-		case 2:  gen_rr(n_nodes,0);      break;
-		case 3:  gen_xr(n_nodes,0,1.35); break;
-		case 4:  gen_sr(n_nodes,0);      break;
-		case 5:  gen_roc(n_nodes,0);     break;
-		default: return CAR_INPUT_ERROR;
-		}
+	if (rc = gen_crc(crc_method,n_nodes,0,n_nodes))
+		return rc;
 	for (k=1; k<=n_nodes; k++) {
 		/* Positive dist = gap, negative dist = overlap */
 		dfact = (dist+1.0)/2.0;
 		lobox[ord_crit[k]] = k<n_nodes?dfact*crc[k]+(1.0-dfact)*crc[k+1]:dfact*crc[k];
 		upbox[ord_crit[k]] = k>1?(1.0-dfact)*crc[k-1]+dfact*crc[k]:n_nodes>1?(1.0-dfact)+dfact*crc[k]:1.0;
 		}
-	uwstmt.n_terms = 1;
-	uwstmt.sign[1] = 1;
+	car_W_open(n_wts);
+	if (n_w_stmts+n_nodes > MAX_STMTS)
+		return CAR_INPUT_ERROR;
+	first = n_w_stmts;
 	for (k=1; k<=n_nodes; k++) {
-		uwstmt.crit[1] = ord_crit[k];
-		uwstmt.lobo = lobox[ord_crit[k]];
-		uwstmt.upbo = min(upbox[ord_crit[k]],1.0); // due to interpolation upwards
-		rc = DTL_add_W_statement(&uwstmt);
-		if (rc < CAR_OK) {
-			rollback_W_base();
-			return rc;
-			}
+		n_w_stmts++;
+		w_stmts[n_w_stmts].n_terms = 1;
+		w_stmts[n_w_stmts].sign[1] = 1;
+		w_stmts[n_w_stmts].crit[1] = ord_crit[k];
+		w_stmts[n_w_stmts].lobo = lobox[ord_crit[k]];
+		w_stmts[n_w_stmts].upbo = min(upbox[ord_crit[k]],1.0); // due to interpolation upwards
+		}
+	if (car_trans) {
+		/* Entered at commit */
+		ord_crit[0] = n_w_stmts-first;
+		return ord_crit[0];
 		}
+	if (rc = car_W_enter())
+		return rc;
 	/* Return number of statements */
 	ord_crit[0] = DTL_nbr_of_W_stmts()-W_mark;
 #ifdef LOG_CAR
@@ -147,7 +149,7 @@ rcode DTLAPI CAR_rank_W_base(int n_nodes, car_vector ord_crit, double dist) {
 
 rcode DTLAPI CAR_rank_P_base(int crit, int alt, int n_nodes, car_vector ord_nodes, double dist) {
 	rcode rc;
-	int k,t_nodes;
+	int k,t_nodes,first;
 	int n_alts;
 	double dfact;
 
@@ -168,6 +170,8 @@ rcode DTLAPI CAR_rank_P_base(int crit, int alt, int n_nodes, car_vector ord_node
 #endif
 	if (!frame_loaded)
 		return CAR_FRAME_NOT_LOADED;
+	if (car_trans && (uf != trans_uf))
+		return CAR_STATE_ERROR;
 	/* Check input parameters */
 	if ((n_nodes < 1) || (n_nodes > MAX_NODES))
 		return CAR_INPUT_ERROR;
@@ -196,15 +200,8 @@ rcode DTLAPI CAR_rank_P_base(int crit, int alt, int n_nodes, car_vector ord_node
 	if (n_nodes == 1)
 		return CAR_OK;
 	/* Build distance ranking statements and enter */
-	switch (crc_method) {
-		case 0:  gen_rx(n_nodes,0,1.0+min((double)n_nodes/60.0,0.25)); break; // adaptive CAR
-		case 1:  gen_rs(n_nodes,0);      break;
-		case 2:  gen_rr(n_nodes,0);      break;
-		case 3:  gen_xr(n_nodes,0,1.35); break;
-		case 4:  gen_sr(n_nodes,0);      break;
-		case 5:  gen_roc(n_nodes,0);     break;
-		default: return CAR_INPUT_ERROR;
-		}
+	if (rc = gen_crc(crc_method,n_nodes,0,n_nodes))
+		return rc;
 	/* Generate statements */
 	for (k=1; k<=n_nodes; k++) {
 		/* Positive dist = gap, negative dist = overlap */
@@ -213,19 +210,27 @@ rcode DTLAPI CAR_rank_P_base(int crit, int alt, int n_nodes, car_vector ord_node
 		upbox[ord_nodes[k]] = k>1?(1.0-dfact)*crc[k-1]+dfact*crc[k]:n_nodes>1?(1.0-dfact)+dfact*crc[k]:1.0;
 		}
 	/* Enter statements */
-	ustmt.n_terms = 1;
-	ustmt.sign[1] = 1;
+	if (rc = car_P_open(crit))
+		return rc;
+	if (n_p_stmts+n_nodes > MAX_STMTS)
+		return CAR_INPUT_ERROR;
+	first = n_p_stmts;
 	for (k=1; k<=n_nodes; k++) {
-		ustmt.alt[1] = alt;
-		ustmt.cons[1] = ord_nodes[k];
-		ustmt.lobo = lobox[ord_nodes[k]];
-		ustmt.upbo = min(upbox[ord_nodes[k]],1.0); // due to interpolation upwards
-		rc = DTL_add_P_statement(crit,&ustmt);
-		if (rc < CAR_OK) {
-			rollback_P_base(crit);
-			return rc;
-			}
+		n_p_stmts++;
+		p_stmts[n_p_stmts].n_terms = 1;
+		p_stmts[n_p_stmts].sign[1] = 1;
+		p_stmts[n_p_stmts].alt[1] = alt;
+		p_stmts[n_p_stmts].cons[1] = ord_nodes[k];
+		p_stmts[n_p_stmts].lobo = lobox[ord_nodes[k]];
+		p_stmts[n_p_stmts].upbo = min(upbox[ord_nodes[k]],1.0); // due to interpolation upwards
+		}
+	if (car_trans) {
+		/* Entered at commit */
+		ord_nodes[0] = n_p_stmts-first;
+		return ord_nodes[0];
 		}
+	if (rc = car_P_enter())
+		return rc;
 	/* Return number of statements */
 	ord_nodes[0] = DTL_nbr_of_P_stmts(crit)-P_mark;
 #ifdef LOG_CAR
@@ -147,7 +147,11 @@
 #include "DTLparameters.h"
 
 #define MAX_CRIT   300
-#define MAX_FRAMES 101 // one for internal use
+#define MAX_FRAMES 101 // initial registry, the last one for internal use
+#define MAX_FRAME_NBR 100000 // the registry grows up to this frame number
+#define MAX_SESSIONS 32 // plus the default session 0
+#define MAX_JOBS 32
+#define MAX_SNAPS 32
 
 #define MAX_RESULTSTEPS 21
 
@@ -281,6 +285,57 @@ typedef struct tt_node {
 typedef ttnode ta_tree[MAX_NOPA+1];
 typedef ta_tree tt_tree[MAX_ALTS+1];
 
+/* Performance counters, see DTL_get_perf_stats */
+struct dtl_perf_stats {
+	unsigned long load_P;     // P-base loads in the kernel
+	double load_P_time;       // seconds in them
+	unsigned long load_V;     // V-base loads
+	double load_V_time;
+	unsigned long load_V_inc; // incremental V-base updates
+	double load_V_inc_time;
+	unsigned long attach;     // frame attachments (PM crit switches)
+	unsigned long eval_P;     // P-base optimisations
+	unsigned long sort_elems; // elements in dominance sorts
+	unsigned long vx_calls;   // vertex mass point adjustments
+	unsigned long vx_paths;   // vertex paths enumerated
+	unsigned long vx_bails;   // adjustments given up
+	unsigned long bn_cdf;     // B-normal cdf points
+	unsigned long memo_hits;  // evaluations from the memo
+	unsigned long memo_misses;
+	unsigned long batch_hits; // evaluations from an evaluation batch
+	};
+
+/* Event trace ring entry, one per API call */
+struct dtl_event {
+	char *func;     // smx name of the call (as in the cst log)
+	int frame;      // frame loaded when called
+	rcode rc;       // DTL_OK or the error code returned
+	verylong start; // monotonic time in ns
+	verylong end;
+	};
+
+/* Job request, see DTL_submit_job. The result pointers point to the
+ * caller's result areas of the call (in the order of its parameters). */
+struct dtl_job_rec {
+	int type;       // JOB_xxx call
+	int crit;
+	int mode;       // mode or method of the call
+	int Ai;
+	int Aj;
+	double param1;  // tolerances or threshold
+	double param2;
+	void *result1;
+	void *result2;
+	void *result3;
+	void *result4;
+	};
+
+/* Called when a job has ended, on the thread that ended it */
+typedef void (*dtl_job_fn)(int jnbr, rcode rc, void *user);
+
+/* Called with each stage of a progressive evaluation, FALSE stops it */
+typedef bool (*dtl_stage_fn)(int stage, e_matrix e_result, void *user);
+
 
  /*****************************************************
   *
@@ -309,6 +364,36 @@ typedef ta_tree tt_tree[MAX_ALTS+1];
 #define DIST_SCALE 3
 #define REVD_SCALE 4
 
+/* Job calls */
+#define JOB_EVAL_FULL   1 // DTL_evaluate_full
+#define JOB_RANK        2 // DTL_rank_alternatives
+#define JOB_DOM_MATRIX  3 // DTL_get_dominance_matrix
+#define JOB_W_TORNADO   4 // DTL_get_W_tornado
+#define JOB_P_TORNADO   5 // DTL_get_P_tornado
+#define JOB_MCP_TORNADO 6 // DTL_get_MCP_tornado
+#define JOB_V_TORNADO   7 // DTL_get_V_tornado
+#define JOB_MCV_TORNADO 8 // DTL_get_MCV_tornado
+
+/* Job states */
+#define JOB_QUEUED  1
+#define JOB_RUNNING 2
+#define JOB_DONE    3
+
+/* Progressive evaluation stages */
+#define STAGE_OMEGA   1 // mass point EV (min = mid = max)
+#define STAGE_RANGE   2 // EV range, mid is the mass point
+#define STAGE_MASS    3 // as DTL_evaluate_frame
+#define STAGE_SUPPORT 4 // as DTL_evaluate_full
+
+/* Shard record fields, SHARD_REC doubles per alternative */
+#define SH_MIN    0 // psi EV range
+#define SH_MID    1
+#define SH_MAX    2
+#define SH_RM1    3 // psi moments
+#define SH_CM2    4
+#define SH_CM3    5
+#define SHARD_REC 6
+
 
  /*****************************************************
   *
@@ -321,6 +406,25 @@ rcode DTLAPI DTL_init();
 rcode DTLAPI DTL_exit();
 void  DTLAPI DTL_abort();
 
+/*** Session commands ***/
+rcode DTLAPI DTL_new_session();
+rcode DTLAPI DTL_use_session(int snbr);
+rcode DTLAPI DTL_dispose_session(int snbr);
+int   DTLAPI DTL_current_session();
+
+/*** Job commands ***/
+rcode DTLAPI DTL_submit_job(struct dtl_job_rec *req, dtl_job_fn done_fn, void *user);
+rcode DTLAPI DTL_get_job_status(int jnbr, int *state, int *done, int *total, rcode *job_rc);
+rcode DTLAPI DTL_cancel_job(int jnbr);
+rcode DTLAPI DTL_wait_job(int jnbr);
+rcode DTLAPI DTL_dispose_job(int jnbr);
+
+/*** Snapshot commands (readers require PAR_EVAL) ***/
+rcode DTLAPI DTL_publish_snapshot();
+rcode DTLAPI DTL_acquire_snapshot(int ufnbr, int *snap);
+rcode DTLAPI DTL_evaluate_snapshot(int snap, int crit, int method, int Ai, int Aj, e_matrix e_result);
+rcode DTLAPI DTL_release_snapshot(int snap);
+
 /*** Structure commands ***/
 rcode DTLAPI DTL_new_PS_flat_frame(int ufnbr, int n_alts, int n_cons[]);
 rcode DTLAPI DTL_new_PS_tree_frame(int ufnbr, int n_alts, int n_nodes[], tt_tree xtree);
@@ -334,6 +438,8 @@ rcode DTLAPI DTL_new_DM_flat_frame(int ufnbr, int n_crit, int n_alts);
 rcode DTLAPI DTL_new_DM_tree_frame(int ufnbr, int n_alts, int n_wtnodes, ta_tree wtree);
 rcode DTLAPI DTL_new_SM_tree_frame(int ufnbr, int mode, int n_alts, int n_sh, int n_wtnodes, ta_tree wtree);
 rcode DTLAPI DTL_dispose_frame(int ufnbr);
+rcode DTLAPI DTL_fork_frame(int ufnbr, int new_ufnbr);
+rcode DTLAPI DTL_snapshot_frame(int new_ufnbr);
 rcode DTLAPI DTL_load_frame(int ufnbr);
 rcode DTLAPI DTL_unload_frame();
 rcode DTLAPI DTL_unload_frame2();
@@ -346,9 +452,14 @@ rcode DTLAPI DTL_PM_crit_exists(int crit, int *exists);
 rcode DTLAPI DTL_read_frame(int ufnbr, char *fn, char *folder, int mode);
 rcode DTLAPI DTL_read_ddt_frame(int ufnbr, char *fn, char *folder, int mode);
 rcode DTLAPI DTL_write_frame(char *fn, char *folder);
+rcode DTLAPI DTL_read_bin_frame(int ufnbr, char *fn, char *folder, int mode);
+rcode DTLAPI DTL_write_bin_frame(char *fn, char *folder);
+rcode DTLAPI DTL_journal_frame(char *fn, char *folder);
+rcode DTLAPI DTL_set_frame_budget(int kbytes, char *folder);
 
 /*** Weight commands ***/
 rcode DTLAPI DTL_add_W_statement(struct user_w_stmt_rec* uwstmtp);
+rcode DTLAPI DTL_add_W_statements(int n_stmts, struct user_w_stmt_rec uwstmts[]);
 rcode DTLAPI DTL_change_W_statement(int stmt_number, double lobo, double upbo);
 rcode DTLAPI DTL_replace_W_statement(int stmt_number, struct user_w_stmt_rec* uwstmtp);
 rcode DTLAPI DTL_delete_W_statement(int stmt_number);
@@ -363,6 +474,7 @@ rcode DTLAPI DTL_reset_W_base();
 
 /*** Probability commands ***/
 rcode DTLAPI DTL_add_P_statement(int crit, struct user_stmt_rec* ustmtp);
+rcode DTLAPI DTL_add_P_statements(int crit, int n_stmts, struct user_stmt_rec ustmts[]);
 rcode DTLAPI DTL_change_P_statement(int crit, int stmt_number, double lobo, double upbo);
 rcode DTLAPI DTL_replace_P_statement(int crit, int stmt_number, struct user_stmt_rec* ustmtp);
 rcode DTLAPI DTL_delete_P_statement(int crit, int stmt_number);
@@ -377,6 +489,7 @@ rcode DTLAPI DTL_reset_P_base(int crit);
 
 /*** Value commands ***/
 rcode DTLAPI DTL_add_V_statement(int crit, struct user_stmt_rec* ustmtp);
+rcode DTLAPI DTL_add_V_statements(int crit, int n_stmts, struct user_stmt_rec ustmts[]);
 rcode DTLAPI DTL_change_V_statement(int crit, int stmt_number, double lobo, double upbo);
 rcode DTLAPI DTL_replace_V_statement(int crit, int stmt_number, struct user_stmt_rec* ustmtp);
 rcode DTLAPI DTL_delete_V_statement(int crit, int stmt_number);
@@ -420,13 +533,28 @@ rcode DTLAPI DTL_check_AV_norm_values(int type, int count, ...);
 
 /*** Evaluation commands ***/
 rcode DTLAPI DTL_evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e_result);
+rcode DTLAPI DTL_begin_eval_batch();
+rcode DTLAPI DTL_end_eval_batch();
+rcode DTLAPI DTL_evaluate_digamma(int crit, int n_sets, int Ai[], ai_vector alts[], 
+		double lo_value[], double mid_value[], double up_value[]);
+rcode DTLAPI DTL_evaluate_V_boxes(int crit, int n_boxes, int n_nodes, double lobox[], double upbox[], 
+		int n_alts, double lo_value[], double mid_value[], double up_value[]);
 rcode DTLAPI DTL_evaluate_full(int crit, int method, int Ai, int Aj, e_matrix e_result);
+rcode DTLAPI DTL_evaluate_full_AV(int crit, int method, int Ai, int Aj, int type, e_matrix e_result);
 rcode DTLAPI DTL_evaluate_omega(int Ai, int mode, cr_col o_result, ci_col o_rank);
 rcode DTLAPI DTL_evaluate_omega1(int Ai, int mode, cr_col o_result, ci_col o_node);
+rcode DTLAPI DTL_evaluate_omega_matrix(int n_alts, int n_crit, double omega_mx[]);
+rcode DTLAPI DTL_evaluate_progressive(int crit, int method, int Ai, int Aj, 
+		dtl_stage_fn stage_fn, void *user, e_matrix e_result);
+rcode DTLAPI DTL_evaluate_sampled(int crit, int method, int Ai, int Aj, int n_samples, e_matrix e_result);
+rcode DTLAPI DTL_get_shard(int crit, int n_alts, double shard[]);
+rcode DTLAPI DTL_evaluate_shards(int method, int Ai, int Aj, int n_alts, double shard[], 
+		e_matrix e_result, double moments[]);
 // belief mass
 rcode DTLAPI DTL_get_mass_range(int crit, double lo_level, double up_level, double *mass);
 rcode DTLAPI DTL_get_mass_above(int crit, double lo_level, double *mass);
 rcode DTLAPI DTL_get_mass_below(int crit, double up_level, double *mass);
+rcode DTLAPI DTL_get_mass_below_n(int crit, int n, double up_level[], double mass[]);
 rcode DTLAPI DTL_get_mass_density(int crit, double ev_level, double *density);
 rcode DTLAPI DTL_get_support_mass(int crit, double belief_level, double *lobo, double *upbo);
 rcode DTLAPI DTL_get_support_lower(int crit, double belief_level, double *lobo, double *upbo);
@@ -445,6 +573,7 @@ rcode DTLAPI DTL_pie_chart(int crit, ar_col pie_value);
 rcode DTLAPI DTL_pie_chart1(int crit, double moderation, ar_col pie_value);
 rcode DTLAPI DTL_pie_chart2(int crit, int mode, double moderation1, double moderation2, ar_col pie_value);
 rcode DTLAPI DTL_sec_level(int crit, double v_min, s_matrix s_result);
+rcode DTLAPI DTL_sec_level_sweep(int crit, int n_levels, double v_min[], s_matrix s_result[]);
 
 /*** Dominance commands ***/
 rcode DTLAPI DTL_get_dominance(int crit, int Ai, int Aj, double *cd_value, int *d_order);
@@ -453,6 +582,10 @@ rcode DTLAPI DTL_get_dominance_nt_matrix(int crit, double threshold, ai_matrix d
 rcode DTLAPI DTL_get_dominance_rank(int crit, int mode, int dmode, double threshold, ai_vector dom_rank);
 rcode DTLAPI DTL_get_cardinal_dominance_matrix(int crit, int dmode, double threshold, ar_matrix cardinal_mx);
 rcode DTLAPI DTL_get_abs_dominance_matrix(int dmode, double threshold, ai_matrix dominance_mx);
+// caller-sized variants: n_alts x n_alts, row-major from index 0
+rcode DTLAPI DTL_get_dominance_matrix_n(int crit, double threshold, int n_alts, int dominance_mx[]);
+rcode DTLAPI DTL_get_dominance_nt_matrix_n(int crit, double threshold, int n_alts, int dominance_mx[]);
+rcode DTLAPI DTL_get_cardinal_dominance_matrix_n(int crit, int dmode, double threshold, int n_alts, double cardinal_mx[]);
 
 /*** Sensitivity commands ***/
 rcode DTLAPI DTL_get_W_tornado(int mode, h_matrix t_lobo, h_matrix t_upbo);
@@ -462,6 +595,13 @@ rcode DTLAPI DTL_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 rcode DTLAPI DTL_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo);
 rcode DTLAPI DTL_get_MCV_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo);
 rcode DTLAPI DTL_get_cons_influence(int crit, int mode, h_matrix result);
+// caller-sized variants: nodes in node order from index 0 (W: n_alts x n_nodes)
+rcode DTLAPI DTL_get_W_tornado_n(int mode, int n_alts, int n_nodes, double t_lobo[], double t_upbo[]);
+rcode DTLAPI DTL_get_P_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]);
+rcode DTLAPI DTL_get_MCP_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]);
+rcode DTLAPI DTL_get_V_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]);
+rcode DTLAPI DTL_get_MCV_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]);
+rcode DTLAPI DTL_get_cons_influence_n(int crit, int mode, int n_nodes, double result[]);
 
 /*** Error commands ***/
 char* DTLAPI DTL_get_errtxt(rcode drc);
@@ -473,7 +613,13 @@ int   DTLAPI DTL_error2(rcode drc);
 bool  DTLAPI DTL_u_error(rcode drc);
 int   DTLAPI DTL_u_error2(rcode drc);
 
+/*** Trace commands ***/
+rcode DTLAPI DTL_trace_ring(int n_events);
+rcode DTLAPI DTL_drain_trace(struct dtl_event events[], int max_events, int *n_events, int *n_lost);
+
 /*** Miscellaneous commands ***/
+rcode DTLAPI DTL_get_perf_stats(struct dtl_perf_stats *stats);
+rcode DTLAPI DTL_reset_perf_stats();
 void DTLAPI DTL_get_release(char *relstrg, unsigned c_size);
 void DTLAPI DTL_get_release_long(char *relstrg, unsigned c_size);
 void DTLAPI DTL_get_capacity(char *capstrg, unsigned c_size);
@@ -62,6 +62,7 @@
  *   DTL_get_AV_norm_value
  *   DTL_get_AV_norm_intervals
  *   DTL_get_AV_norm_interval
+ *   DTL_evaluate_full_AV
  *   DTL_check_AV_user_values
  *   DTL_check_AV_norm_values
  *
@@ -929,6 +930,73 @@ rcode DTLAPI DTL_get_AV_norm_interval(int crit, int type, double av_lobo, double
 	}
 
 
+ /*********************************************************
+  *
+  *  Evaluation on the user scale
+  *
+  *  DTL_evaluate_full followed by DTL_get_AV_user_intervals
+  *  and DTL_get_AV_user_vector, fused into one pass. The
+  *  scale transform is resolved once for the call and then
+  *  applied in place to e_result, so no intermediate result
+  *  matrix is needed. The results equal those of the three
+  *  separate calls, including the range checks.
+  *
+  *********************************************************/
+
+rcode DTLAPI DTL_evaluate_full_AV(int crit, int method, int Ai, int Aj, int type, e_matrix e_result) {
+	rcode rc;
+	int i,s_crit;
+	bool rev;
+	double v_min,v_max,mul,add,n_min,lo,up;
+
+	/* Check if function can start */
+	if (!frame_loaded)
+		return DTL_FRAME_NOT_LOADED;
+	/* Check input parameters */
+	s_crit = max(crit,0); // partial eval crit nbr
+	if (check_df0(s_crit))
+		return DTL_CRIT_UNKNOWN;
+	if ((type < 1) || (type > 4))
+		return DTL_INPUT_ERROR;
+	/* Evaluate on the internal scale */
+	if (rc = DTL_evaluate_full(crit,method,Ai,Aj,e_result))
+		return rc;
+	/* Resolve transform from internal [0,1] to external [a,b] scale */
+	v_min = uf->av_min[s_crit];
+	v_max = uf->av_max[s_crit];
+	mul = type<3?v_max-v_min:_fabs(v_max-v_min);
+	add = type<2?v_min:0.0;
+	n_min = type&1?0.0:-1.0;
+	rev = (v_min > v_max) && (type < 3);
+	/* Convert results in place */
+	for (i=0; i<MAX_RESULTSTEPS; i++) {
+		lo = e_result[E_MIN][i];
+		up = e_result[E_MAX][i];
+		if ((type<2) && (lo==-1.0)) // empty slot maps onto norm=0.0
+			lo = v_min;
+		else if ((lo < n_min) || (lo > 1.0))
+			return DTL_INPUT_ERROR;
+		else
+			lo = lo*mul+add;
+		if ((type<2) && (up==-1.0))
+			up = v_min;
+		else if ((up < n_min) || (up > 1.0))
+			return DTL_INPUT_ERROR;
+		else
+			up = up*mul+add;
+		e_result[E_MIN][i] = rev?up:lo;
+		e_result[E_MAX][i] = rev?lo:up;
+		if ((type<2) && (e_result[E_MID][i]==-1.0))
+			e_result[E_MID][i] = v_min;
+		else if ((e_result[E_MID][i] < n_min) || (e_result[E_MID][i] > 1.0))
+			return DTL_INPUT_ERROR;
+		else
+			e_result[E_MID][i] = e_result[E_MID][i]*mul+add;
+		}
+	return DTL_OK;
+	}
+
+
  /*******************************************************
   *
   *  Scale checking functions (user and norm scales)
@@ -55,7 +55,10 @@
  *   n_cdf
  *   owens_t
  *   bn_cdf
+ *   bn_cdf_n
  *   bn_inv_cdf
+ *   bn_inv_cdf_n
+ *   bn_solve_n
  *   b_delta
  *
  *   Functions internal to module
@@ -63,7 +66,10 @@
  *   f_abs
  *   ra
  *   inv_n_cdf
+ *   owen_init
+ *   owen_eval
  *   inv_bn_cdf
+ *   bn_cdf_z
  *
  */
 
@@ -179,61 +185,79 @@ static double inv_n_cdf(double x) {
 	}
 
 
-/* CDF of Owen's standard T-distribution */
-
-double owens_t(double x, double alpha) {
+/* CDF of Owen's standard T-distribution. The parts depending only on
+ * alpha are prepared once by owen_init, so that a batch of points with
+ * the same alpha does not recalculate them for every point. */
 
+struct owen_par {
+	double alpha;
 	double alphasq;
+	double l1p_alphasq;
+	double at_alpha;
+	double sq_p[5];
+	double sq_m[5];
+	};
+
+static double r[5] = {
+	0.1477621,
+	0.1346334,
+	0.1095432,
+	0.0747257,
+	0.0333357 };
+static double u[5] = {
+	0.0744372,
+	0.2166977,
+	0.3397048,
+	0.4325317,
+	0.4869533 };
+static double tp = 0.159155;
+static double tv1 = 1.0E-35;
+static double tv2 = 15.0;
+static double tv3 = 15.0;
+static double tv4 = 1.0E-05;
+
+static void owen_init(struct owen_par *op, double alpha) {
 	int i;
-	double r[5] = {
-		0.1477621,
-		0.1346334,
-		0.1095432,
-		0.0747257,
-		0.0333357 };
-	double r1;
-	double r2;
-	double rt;
-	double tp = 0.159155;
-	double tv1 = 1.0E-35;
-	double tv2 = 15.0;
-	double tv3 = 15.0;
-	double tv4 = 1.0E-05;
-	double u[5] = {
-		0.0744372,
-		0.2166977,
-		0.3397048,
-		0.4325317,
-		0.4869533 };
-	double value;
-	double x1;
-	double x2;
-	double xs;
+
+	op->alpha = alpha;
+	op->alphasq = alpha*alpha;
+#ifdef LOG1P
+	op->l1p_alphasq = log1p(op->alphasq);
+#else
+	op->l1p_alphasq = log1px(op->alphasq);
+#endif
+	op->at_alpha = tp*atan(alpha);
+	for (i=0; i<5; i++) {
+		op->sq_p[i] = pow(0.5+u[i],2.0);
+		op->sq_m[i] = pow(0.5-u[i],2.0);
+		}
+	}
+
+
+static double owen_eval(struct owen_par *op, double x) {
+	int i;
+	double alphasq,r1,r2,rt,value,x1,x2,xs;
 
 	// Handbook of Mathematical Functions by
 	// Abramowitz and Stegun, reference 26.22
 	if (f_abs(x) < tv1) {
-		value = tp*atan(alpha);
+		value = op->at_alpha;
 		return value;
 		}
 	if (tv2 < f_abs(x)) {
 		value = 0.0;
 		return value;
 		}
-	if (f_abs(alpha) < tv1) {
+	if (f_abs(op->alpha) < tv1) {
 		value = 0.0;
 		return value;
 		}
 	xs = -0.5*x*x;
-	x2 = alpha;
-	alphasq = alpha*alpha;
+	x2 = op->alpha;
+	alphasq = op->alphasq;
 	/* Newton iteration */
-#ifdef LOG1P
-	if (tv3 <= log1p(alphasq) - xs*alphasq) {
-#else
-	if (tv3 <= log1px(alphasq) - xs*alphasq) {
-#endif
-		x1 = 0.5*alpha;
+	if (tv3 <= op->l1p_alphasq - xs*alphasq) {
+		x1 = 0.5*op->alpha;
 		alphasq = 0.25*alphasq;
 		for (;;) {
 			rt = alphasq+1.0;
@@ -247,8 +271,8 @@ double owens_t(double x, double alpha) {
 	/* Gaussian quadrature */
 	rt = 0.0;
 	for (i=0; i<5; i++) {
-		r1 = 1.0 + alphasq*pow(0.5+u[i],2.0);
-		r2 = 1.0 + alphasq*pow(0.5-u[i],2.0);
+		r1 = 1.0 + alphasq*op->sq_p[i];
+		r2 = 1.0 + alphasq*op->sq_m[i];
 		rt = rt + r[i]*(exp(xs*r1)/r1 + exp(xs*r2)/r2);
 		}
 	value = rt*x2*tp;
@@ -256,11 +280,19 @@ double owens_t(double x, double alpha) {
 	}
 
 
+double owens_t(double x, double alpha) {
+	struct owen_par op;
+
+	owen_init(&op,alpha);
+	return owen_eval(&op,x);
+	}
+
+
 /* Inverse CDF of Owen's standard T-distribution */
 
 #define INV_LOOPS 100
 
-static double inv_bn_cdf(double cdf, double alpha) {
+static double inv_bn_cdf(double cdf, struct owen_par *op) {
 	int loop,loop2;
 	double val,new_val,diff,new_cdf;
 
@@ -270,7 +302,7 @@ static double inv_bn_cdf(double cdf, double alpha) {
 	do {
 		val = new_val;
 		do { // seek next cdf test value
-			new_cdf = cdf+2.0*owens_t(val,alpha);
+			new_cdf = cdf+2.0*owen_eval(op,val);
 			if (new_cdf < 0.0) // value is too big
 				val -= 0.1;
 			else if (new_cdf > 1.0) // value is too small
@@ -297,40 +329,152 @@ inv_bn_cdf_error:
    tails. Adapted to the corporate management case of finite business-wide risk handling. */
 
 double bn_cdf(double val, double mean, double var, double alpha) {
-	double owen,cdf;
+	double cdf;
+
+	bn_cdf_n(1,&val,mean,var,alpha,&cdf);
+	return cdf;
+	}
+
+
+/* The cdf at n points of one B-normal distribution. The normal part is
+ * a tight loop over all points, then Owen's T is subtracted. Skipped if
+ * unskewed (it is zero then). Results equal n calls to bn_cdf. */
+
+void bn_cdf_n(int n, double val[], double mean, double var, double alpha, double cdf[]) {
+	int i;
+	double sd;
+	struct owen_par op;
 
+	dtl_perf.bn_cdf += n;
 	/* Catch pointwise mass */
-	if (var < DTL_EPS)
-		if (val < mean-DTL_EPS)
-			return 0.0;
-		else if (val > mean+DTL_EPS)
-			return 1.0;
-		else // at the mean
-			return 0.5;
+	if (var < DTL_EPS) {
+		for (i=0; i<n; i++)
+			if (val[i] < mean-DTL_EPS)
+				cdf[i] = 0.0;
+			else if (val[i] > mean+DTL_EPS)
+				cdf[i] = 1.0;
+			else // at the mean
+				cdf[i] = 0.5;
+		return;
+		}
 	/* Normal interval case */
-	owen = owens_t((val-mean)/sqrt(var),alpha);
-	cdf = n_cdf((val-mean)/sqrt(var))-2.0*owen;
+	sd = sqrt(var);
+	for (i=0; i<n; i++)
+		cdf[i] = n_cdf((val[i]-mean)/sd);
+	if (f_abs(alpha) >= tv1) {
+		owen_init(&op,alpha);
+		for (i=0; i<n; i++)
+			cdf[i] -= 2.0*owen_eval(&op,(val[i]-mean)/sd);
+		}
 	/* Catch round-off errors */
-	if (cdf < 1.0E-6)
-		cdf = 0.0;
-	else if (cdf > 1.0-1.0E-6)
-		cdf = 1.0;
-	return cdf;
+	for (i=0; i<n; i++)
+		if (cdf[i] < 1.0E-6)
+			cdf[i] = 0.0;
+		else if (cdf[i] > 1.0-1.0E-6)
+			cdf[i] = 1.0;
 	}
 
 
 /* Find the inverse of an unskewed or skewed B-normal CDF */
 
 double bn_inv_cdf(double cdf, double mean, double var, double alpha) {
-	double ival;
+	double val;
+
+	bn_inv_cdf_n(1,&cdf,mean,var,alpha,&val);
+	return val;
+	}
+
 
-	if (alpha)
+void bn_inv_cdf_n(int n, double cdf[], double mean, double var, double alpha, double val[]) {
+	int i;
+	double sd;
+	struct owen_par op;
+
+	sd = sqrt(var);
+	if (alpha) {
 		/* Get inverse to skewed CDF */
-		ival = inv_bn_cdf(cdf,alpha);
+		owen_init(&op,alpha);
+		for (i=0; i<n; i++)
+			val[i] = max(min(inv_bn_cdf(cdf[i],&op)*sd+mean,1.0),-1.0);
+		}
 	else
 		/* Get inverse to unskewed CDF */
-		ival = inv_n_cdf(cdf);
-	return max(min(ival*sqrt(var)+mean,1.0),-1.0);
+		for (i=0; i<n; i++)
+			val[i] = max(min(inv_n_cdf(cdf[i])*sd+mean,1.0),-1.0);
+	}
+
+
+/* Find the EV values in [lobo,upbo] where the B-normal cdf reaches each
+ * target. Safeguarded Newton: the density 2*phi(z)*PHI(alpha*z) gives
+ * the step, and a bracket shrinking around the root catches steps that
+ * overshoot and falls back to bisection. Seeded from the unskewed
+ * closed-form inverse. Stops at the same tolerances as plain bisection
+ * (cdf within 1.0E-6 of target or bracket below 1.0E-7) but in a few
+ * steps instead of 20+. */
+
+#define SOLVE_CDF_EPS 1.0E-6
+#define SOLVE_EV_EPS 1.0E-7
+#define SOLVE_LOOPS 60
+
+static double bn_cdf_z(double z, struct owen_par *op) {
+	double cdf;
+
+	cdf = n_cdf(z);
+	if (f_abs(op->alpha) >= tv1)
+		cdf -= 2.0*owen_eval(op,z);
+	/* Catch round-off errors (as bn_cdf_n) */
+	if (cdf < 1.0E-6)
+		return 0.0;
+	if (cdf > 1.0-1.0E-6)
+		return 1.0;
+	return cdf;
+	}
+
+
+void bn_solve_n(int n, double target[], double lobo, double upbo,
+		double mean, double var, double alpha, double val[]) {
+	int i,loop;
+	double sd,lo,up,x,z,cdf,pdf,new_x;
+	struct owen_par op;
+
+	/* Catch pointwise mass */
+	if (var < DTL_EPS) {
+		for (i=0; i<n; i++)
+			val[i] = max(min(mean,upbo),lobo);
+		return;
+		}
+	sd = sqrt(var);
+	owen_init(&op,alpha);
+	for (i=0; i<n; i++) {
+		lo = lobo;
+		up = upbo;
+		x = inv_n_cdf(target[i])*sd+mean;
+		if ((x <= lo) || (x >= up))
+			x = (lo+up)/2.0;
+		for (loop=0; loop<SOLVE_LOOPS; loop++) {
+			z = (x-mean)/sd;
+			cdf = bn_cdf_z(z,&op);
+			if (fabs(cdf-target[i]) <= SOLVE_CDF_EPS)
+				break;
+			/* Shrink bracket */
+			if (cdf > target[i])
+				up = x;
+			else
+				lo = x;
+			if (up-lo <= SOLVE_EV_EPS)
+				break;
+			/* Newton step, bisect if it leaves the bracket */
+			pdf = 2.0*exp(-0.5*z*z)/sqrt(2.0*PI)*n_cdf(alpha*z)/sd;
+			if (pdf > 0.0)
+				new_x = x-(cdf-target[i])/pdf;
+			else
+				new_x = lo;
+			if ((new_x <= lo) || (new_x >= up))
+				new_x = (lo+up)/2.0;
+			x = new_x;
+			}
+		val[i] = x;
+		}
 	}
 
 
@@ -0,0 +1,283 @@
+/*
+ *
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ *
+ *
+ *                   UNEDA Decision Tree Layer (DTL)
+ *                   -------------------------------
+ *
+ *    +----- o o o ------------------------------------------------+
+ *    |    o       o              Prof. Mats Danielson             |
+ *    |   o  STHLM  o             DECIDE Research Group            |
+ *    |   o         o    Dept. of Computer and Systems Sciences    |
+ *    |   o   UNI   o             Stockholm University             |
+ *    |    o       o      PO Box 1203, SE-164 25 Kista, SWEDEN     |
+ *    +----- o o o ------------------------------------------------+
+ *
+ *                Copyright (c) 2012-2025 Mats Danielson
+ *                     Email: mats.danielson@su.se
+ *
+ */
+
+/*
+ *   File: DTLdense.c
+ *
+ *   Purpose: dense matrix evaluation of DM frames
+ *
+ *   A DM frame is a rectangular alternatives x criteria matrix. Once
+ *   created (or split from file) it is a PM frame in which each
+ *   criterion frame has one consequence per alternative. The EV
+ *   ranges and the moments of all cells are kept as dense rows, one
+ *   row per criterion and quantity running over all alternatives. A
+ *   row is refreshed from TCL only when the bases of its criterion
+ *   have changed (the stamps in uf->gen). An MC evaluation then forms
+ *   the results of all criteria from the rows in one sweep, without
+ *   attaching the criterion frames. The rules are applied in the same
+ *   order as in TCL, so the results equal those of the per-criterion
+ *   evaluation in evaluate_frameset.
+ *
+ *   Included from DTLeval.c, shares its evaluation cache.
+ *
+ *
+ *   Functions outside of module, inside DTL
+ *   ---------------------------------------
+ *   dense_ok
+ *   dense_evaluate
+ *   dense_release
+ *
+ *   Functions internal to module
+ *   ----------------------------
+ *   dense_buffer
+ *   dense_load
+ *   dense_rule
+ *
+ */
+
+
+ /*********************************************************
+  *
+  *  Dense rows
+  *
+  *********************************************************/
+
+#define DENSE_ROWS 6 // lo, mid, up, rm1, cm2, cm3
+
+/* Rows of criterion c start at (c-1)*stride, entry 0 is unused */
+
+struct dense_rec {
+	struct user_frame *uf;         // frame the rows belong to
+	int n_alts;
+	int n_crit;
+	int stride;
+	unsigned long gen[MAX_CRIT+1]; // stamp of each criterion's rows (0 = stale)
+	double *lo,*mid,*up;           // EV ranges
+	double *rm1,*cm2,*cm3;         // EV moments
+	int size;
+	double *rows;
+	};
+
+static struct dense_rec dm;
+
+
+/* Make room for the rows of the loaded frame. Rows of another frame,
+ * or of another shape, are marked stale. Returns FALSE if no memory. */
+
+static bool dense_buffer() {
+	int c,n;
+
+	if ((dm.uf == uf) && (dm.n_alts == uf->n_alts) && (dm.n_crit == uf->n_crit))
+		return TRUE;
+	for (c=0; c<=MAX_CRIT; c++)
+		dm.gen[c] = 0;
+	dm.uf = NULL;
+	dm.n_alts = uf->n_alts;
+	dm.n_crit = uf->n_crit;
+	dm.stride = dm.n_alts+1;
+	n = DENSE_ROWS*dm.n_crit*dm.stride;
+	if (dm.size < n) {
+		if (dm.rows)
+			mem_free((void *)dm.rows);
+		dm.rows = (double *)mem_alloc(n*sizeof(double),"double","dense_buffer");
+		dm.size = dm.rows ? n : 0;
+		if (!dm.rows)
+			return FALSE;
+		}
+	n = dm.n_crit*dm.stride;
+	dm.lo = dm.rows;
+	dm.mid = dm.rows+n;
+	dm.up = dm.rows+2*n;
+	dm.rm1 = dm.rows+3*n;
+	dm.cm2 = dm.rows+4*n;
+	dm.cm3 = dm.rows+5*n;
+	dm.uf = uf;
+	return TRUE;
+	}
+
+
+void dense_release() {
+
+	if (dm.rows)
+		mem_free((void *)dm.rows);
+	dm.rows = NULL;
+	dm.size = 0;
+	dm.uf = NULL;
+	}
+
+
+/* Refresh the rows of criterion c if its bases have changed */
+
+static rcode dense_load(int c) {
+	rcode rc;
+	int a,row;
+
+	if (dm.gen[c] && (dm.gen[c] == uf->gen[c]))
+		return DTL_OK;
+	if (rc = load_df1(c))
+		return dtl_error(rc);
+	row = (c-1)*dm.stride;
+	if (call(TCL_evaluate_all(uf->df,eval_result),"TCL_evaluate_all"))
+		return dtl_kernel_error();
+	if (call(TCL_get_moments(uf->df,dm.rm1+row,dm.cm2+row,dm.cm3+row),"TCL_get_moments"))
+		return dtl_kernel_error();
+	for (a=1; a<=dm.n_alts; a++) {
+		dm.lo[row+a] = eval_result[a][E_MIN];
+		dm.mid[row+a] = eval_result[a][E_MID];
+		dm.up[row+a] = eval_result[a][E_MAX];
+		}
+	dm.gen[c] = uf->gen[c];
+	return DTL_OK;
+	}
+
+
+ /*********************************************************
+  *
+  *  Dense evaluation
+  *
+  *********************************************************/
+
+/* Evaluation rule for criterion c over its rows, in the order of
+ * calc_psi/delta/gamma/digamma in TCLevaluate.c */
+
+static void dense_rule(int c, int m_field, int Ai, int Aj) {
+	int j,n_active,n_bits;
+	double *lo,*mid,*up,scale,r_min,r_mid,r_max;
+
+	lo = dm.lo+(c-1)*dm.stride;
+	mid = dm.mid+(c-1)*dm.stride;
+	up = dm.up+(c-1)*dm.stride;
+	r_min = lo[Ai];
+	r_mid = mid[Ai];
+	r_max = up[Ai];
+	switch (m_field) {
+		case E_DELTA:
+			r_min = lo[Ai]-up[Aj];
+			r_mid = mid[Ai]-mid[Aj];
+			r_max = up[Ai]-lo[Aj];
+			break;
+		case E_GAMMA:
+			scale = dm.n_alts - 1.0;
+			for (j=1; j<=dm.n_alts; j++)
+				if (j != Ai) {
+					r_min -= up[j]/scale;
+					r_mid -= mid[j]/scale;
+					r_max -= lo[j]/scale;
+					}
+			break;
+		case E_DIGAMMA:
+			n_bits = min(dm.n_alts,DIGAMMA_BITS);
+			for (n_active=0, j=1; j<=n_bits; j++)
+				if ((j!=Ai) && (Aj&(0x01<<(j-1))))
+					n_active++;
+			scale = n_active;
+			if (n_active)
+				for (j=1; j<=n_bits; j++)
+					if ((j!=Ai) && (Aj&(0x01<<(j-1)))) {
+						r_min -= up[j]/scale;
+						r_mid -= mid[j]/scale;
+						r_max -= lo[j]/scale;
+						}
+			break;
+		}
+	e_cache[c][E_MIN][0] = r_min;
+	e_cache[c][E_MID][0] = r_mid;
+	e_cache[c][E_MAX][0] = r_max;
+	Vc_lobo[c] = r_min;
+	Vc_upbo[c] = r_max;
+	}
+
+
+/* TRUE if the loaded frame has the DM shape with all criteria present
+ * and the call is one that the per-criterion evaluation would accept */
+
+bool dense_ok(int method, int Ai, int Aj) {
+	int c,m_field;
+
+	if (!PM)
+		return FALSE;
+	m_field = method & M_EVAL;
+	if ((m_field != E_DELTA) && (m_field != E_GAMMA) && (m_field != E_PSI) && (m_field != E_DIGAMMA))
+		return FALSE;
+	if ((m_field == E_DELTA) && ((Aj < 1) || (Aj > uf->n_alts) || (Ai == Aj)))
+		return FALSE;
+	if ((m_field == E_DIGAMMA) && (Ai <= DIGAMMA_BITS) && (0x01<<(Ai-1) & Aj))
+		return FALSE;
+	for (c=1; c<=uf->n_crit; c++)
+		if (check_df1(c) || (uf->df_list[c]->tot_cons[0] != uf->n_alts))
+			return FALSE;
+	return TRUE;
+	}
+
+
+/* All criteria of a DM frame for the MC evaluation in evaluate_frameset.
+ * Leaves e_cache, the moments and Vc_lobo/Vc_upbo as the per-criterion
+ * evaluation does. */
+
+rcode dense_evaluate(int method, int Ai, int Aj) {
+	rcode rc;
+	int c,m_field,row;
+
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	if (!dense_buffer())
+		return dtl_error(DTL_MEMORY_LEAK);
+	m_field = method & M_EVAL;
+	if ((m_field == E_GAMMA) || (m_field == E_PSI))
+		Aj = 0;
+	for (c=1; c<=uf->n_crit; c++) {
+		if (shadow_owner(c))
+			continue; // copied in evaluate_frameset
+		if (rc = dense_load(c))
+			return rc;
+		dense_rule(c,m_field,Ai,Aj);
+		row = (c-1)*dm.stride;
+		if (rule_mass(c,method,Ai,Aj,dm.n_alts,dm.rm1+row,dm.cm2+row,dm.cm3+row)) {
+			ec[c].valid = FALSE;
+			return dtl_error(DTL_INTERNAL_ERROR);
+			}
+		ec[c].valid = TRUE;
+		}
+	if (cst_on) {
+		sprintf(msg," dtl_dense_evaluate: %d criteria\n",uf->n_crit);
+		cst_log(msg);
+		}
+	return DTL_OK;
+	}
@@ -48,18 +48,29 @@
  *   ------------------------------
  *   DTL_get_dominance
  *   DTL_get_dominance_matrix
+ *   DTL_get_dominance_matrix_n
  *   DTL_get_dominance_nt_matrix
+ *   DTL_get_dominance_nt_matrix_n
  *   DTL_get_dominance_rank
  *   DTL_get_cardinal_dominance_matrix
+ *   DTL_get_cardinal_dominance_matrix_n
  *   DTL_get_abs_dominance_matrix
  *
  *   Functions outside of module, inside DTL
  *   ---------------------------------------
  *   dtl_get_dominance
+ *   dom_cache_open
+ *   dom_cache_close
+ *   dom_release
  *
  *   Functions internal to module
  *   ----------------------------
  *   add_dom
+ *   psi_curve
+ *   dom_buffer
+ *   get_dominance_matrix
+ *   dtl_get_dominance_nt
+ *   get_cardinal_dominance_matrix
  *   abs_dom
  *
  */
@@ -85,6 +96,32 @@
 
 static e_matrix e_result1,e_result2;
 
+/* Curve cache: while open, the expanded psi result of each alternative
+ * is computed once for the cached criterion and then reused for all
+ * its pairs. It is only open during a single API call, so base changes
+ * between calls are never seen through it. */
+
+static e_matrix dom_curve[MAX_ALTS+1];
+static bool dom_valid[MAX_ALTS+1];
+static int dom_crit;
+static bool dom_open = FALSE;
+
+void dom_cache_open(int crit) {
+	int Ai;
+
+	for (Ai=1; Ai<=MAX_ALTS; Ai++)
+		dom_valid[Ai] = FALSE;
+	dom_crit = crit;
+	dom_open = TRUE;
+	}
+
+
+void dom_cache_close() {
+
+	dom_open = FALSE;
+	}
+
+
 static double add_dom(double diff, double sum, int *dom) {
 
 	sum += diff;
@@ -106,10 +143,33 @@ static double add_dom(double diff, double sum, int *dom) {
  * NOTE: if ever porting to DMC, change to fixed steps of EV.
  * Or, at least, cater for both to be able to compare them. */
 
+/* Expanded psi result (cdf) of Ai, from the cache if open for crit */
+
+static rcode psi_curve(int crit, int Ai, e_matrix *work, e_matrix **curve) {
+	rcode rc;
+
+	if (dom_open && (crit == dom_crit)) {
+		*curve = dom_curve+Ai;
+		if (dom_valid[Ai])
+			return DTL_OK;
+		}
+	else
+		*curve = work;
+	if (rc = evaluate_batched(crit,E_PSI,Ai,0,**curve))
+		return rc;
+	// note: expansion type 1 = towards cdf 50%, not mass point
+	expand_eval_result1(crit,0,**curve);
+	if (*curve != work)
+		dom_valid[Ai] = TRUE;
+	return DTL_OK;
+	}
+
+
 rcode dtl_get_dominance(int crit, int Ai, int Aj, double *cd_value, int *d_order) {
 	rcode rc;
 	int i,dom,cst_global;
 	double sum;
+	e_matrix *cdf1,*cdf2;
 
 	/* Check input parameters */
 	if (load_df00(crit))
@@ -119,26 +179,23 @@ rcode dtl_get_dominance(int crit, int Ai, int Aj, double *cd_value, int *d_order
 	/* Collect both cdfs */
 	cst_global = cst_on;
 	cst_on = FALSE;
-	if (rc = evaluate_frameset(crit,E_PSI,Ai,0,e_result1)) {
+	if (rc = psi_curve(crit,Ai,&e_result1,&cdf1)) {
 		cst_on = cst_global;
 		return dtl_error(rc); // already at level 1?
 		}
-	// note: expansion type 1 = towards cdf 50%, not mass point
-	expand_eval_result1(crit,0,e_result1);
-	if (rc = evaluate_frameset(crit,E_PSI,Aj,0,e_result2)) {
+	if (rc = psi_curve(crit,Aj,&e_result2,&cdf2)) {
 		cst_on = cst_global;
 		return dtl_error(rc); // already at level 1?
 		}
-	expand_eval_result1(crit,0,e_result2);
 	/* dom=0: not determined
 		 dom=1: Ai found superior
 		 dom=2: Aj found superior
 		 dom=3: neither dominates fully (not 1st order) */
 	dom = 0;
-	sum = add_dom(e_result1[E_MID][MAX_RESULTSTEPS-1]-e_result2[E_MID][MAX_RESULTSTEPS-1],0.0,&dom);
+	sum = add_dom((*cdf1)[E_MID][MAX_RESULTSTEPS-1]-(*cdf2)[E_MID][MAX_RESULTSTEPS-1],0.0,&dom);
 	for (i=0; i<MAX_RESULTSTEPS-1; i++) {
-		sum = add_dom(e_result1[E_MIN][i]-e_result2[E_MIN][i],sum,&dom);
-		sum = add_dom(e_result1[E_MAX][i]-e_result2[E_MAX][i],sum,&dom);
+		sum = add_dom((*cdf1)[E_MIN][i]-(*cdf2)[E_MIN][i],sum,&dom);
+		sum = add_dom((*cdf1)[E_MAX][i]-(*cdf2)[E_MAX][i],sum,&dom);
 		}
 	/* Should roughly yield the EV difference between the alternatives (not exactly, we
 	 * sample in only 21 steps + use expand_1=cdf steps, not EV + add max&min, nor mid).
@@ -183,17 +240,50 @@ rcode DTLAPI DTL_get_dominance(int crit, int Ai, int Aj, double *cd_value, int *
 	}
 
 
-rcode DTLAPI DTL_get_dominance_matrix(int crit, double threshold, ai_matrix dominance_mx) {
+/* Dominance matrices: cell Ai,Aj is at D_CELL(mx,stride,Ai,Aj). For the
+ * ai/ar_matrix callers mx points to [1][1] with the MAX_ALTS+1 stride,
+ * for the _n variants (packed) the rows are n_alts apart. */
+
+#define D_CELL(mx,stride,i,j) (mx)[((i)-1)*(stride)+(j)-1]
+
+/* Frame-sized scratch for two n_alts x n_alts dominance matrices */
+
+static int *dom_mx,dom_size;
+
+static bool dom_buffer(int n) {
+
+	if (dom_size < 2*n*n) {
+		if (dom_mx)
+			mem_free((void *)dom_mx);
+		dom_mx = (int *)mem_alloc(2*n*n*sizeof(int),"int","dom_buffer");
+		dom_size = dom_mx ? 2*n*n : 0;
+		if (!dom_mx)
+			return FALSE;
+		}
+	return TRUE;
+	}
+
+
+void dom_release() {
+
+	if (dom_mx)
+		mem_free((void *)dom_mx);
+	dom_mx = NULL;
+	dom_size = 0;
+	}
+
+
+static rcode get_dominance_matrix(int crit, double threshold, bool packed, int stride, int *dominance_mx) {
 	rcode rc;
 	int Ai,Aj,d_order;
 	double cd_value;
 	struct d_frame *df;
 
 	/* Begin single thread semaphore */
-	_smx_begin("GDOMX");
+	_smx_begin(packed?"GDOMXN":"GDOMX");
 	/* Log function call */
 	if (cst_on) {
-		sprintf(msg,"DTL_get_dominance_matrix(%d,%.3lf)\n",crit,threshold);
+		sprintf(msg,"DTL_get_dominance_matrix%s(%d,%.3lf)\n",packed?"_n":"",crit,threshold);
 		cst_log(msg);
 		}
 	/* Check if function can start */
@@ -206,28 +296,37 @@ rcode DTLAPI DTL_get_dominance_matrix(int crit, double threshold, ai_matrix domi
 	if ((threshold < 0.0) || (threshold > 0.1))
 		return dtl_error(DTL_INPUT_ERROR);
 	df = uf->df;
+	if (stride < df->n_alts)
+		return dtl_error(DTL_BUFFER_OVERRUN);
 	/* Collect the belief dominances */
 	dtl_abort_init();
+	dom_cache_open(crit);
 	for (Ai=1; Ai<=df->n_alts; Ai++)
-		dominance_mx[Ai][Ai] = 0; // cannot dominate itself
+		D_CELL(dominance_mx,stride,Ai,Ai) = 0; // cannot dominate itself
 	for (Ai=1; Ai<df->n_alts; Ai++)
 		for (Aj=Ai+1; Aj<=df->n_alts; Aj++) {
+			dtl_progress(Ai-1,df->n_alts-1);
+			if (dtl_abort_request)
+				dom_cache_close();
 			dtl_abort_check();
-			if (rc = dtl_get_dominance(crit,Ai,Aj,&cd_value,&d_order))
+			if (rc = dtl_get_dominance(crit,Ai,Aj,&cd_value,&d_order)) {
+				dom_cache_close();
 				return rc;
+				}
 			if (cd_value > threshold) {
-				dominance_mx[Ai][Aj] = d_order; // Ai dominates
-				dominance_mx[Aj][Ai] = 0;       // Aj dominated
+				D_CELL(dominance_mx,stride,Ai,Aj) = d_order; // Ai dominates
+				D_CELL(dominance_mx,stride,Aj,Ai) = 0;       // Aj dominated
 				}
 			else if (cd_value < -threshold) {
-				dominance_mx[Ai][Aj] = 0;       // Ai dominated
-				dominance_mx[Aj][Ai] = d_order; // Aj dominates
+				D_CELL(dominance_mx,stride,Ai,Aj) = 0;       // Ai dominated
+				D_CELL(dominance_mx,stride,Aj,Ai) = d_order; // Aj dominates
 				}
 			else {
-				dominance_mx[Ai][Aj] = 0; // Ai not dominated
-				dominance_mx[Aj][Ai] = 0; // Aj not dominated
+				D_CELL(dominance_mx,stride,Ai,Aj) = 0; // Ai not dominated
+				D_CELL(dominance_mx,stride,Aj,Ai) = 0; // Aj not dominated
 				}
 			}
+	dom_cache_close();
 	/* Log function result */
 	if (cst_ext) {
 		for (Ai=1; Ai<=df->n_alts; Ai++) {
@@ -235,7 +334,7 @@ rcode DTLAPI DTL_get_dominance_matrix(int crit, double threshold, ai_matrix domi
 				if (Ai==Aj)
 					cst_log("  ");
 				else {
-					sprintf(msg," %1d",dominance_mx[Ai][Aj]);
+					sprintf(msg," %1d",D_CELL(dominance_mx,stride,Ai,Aj));
 					cst_log(msg);
 					}
 			cst_log("\n");
@@ -248,44 +347,76 @@ rcode DTLAPI DTL_get_dominance_matrix(int crit, double threshold, ai_matrix domi
 	}
 
 
-static ai_matrix t_mx,nt_mx;
+rcode DTLAPI DTL_get_dominance_matrix(int crit, double threshold, ai_matrix dominance_mx) {
+
+	return get_dominance_matrix(crit,threshold,FALSE,MAX_ALTS+1,M_BASE(dominance_mx));
+	}
+
+
+/* Caller-sized variant: row Ai-1 of the n_alts x n_alts matrix holds
+ * the dominances of alternative Ai */
+
+rcode DTLAPI DTL_get_dominance_matrix_n(int crit, double threshold, int n_alts, int dominance_mx[]) {
+
+	return get_dominance_matrix(crit,threshold,TRUE,n_alts,dominance_mx);
+	}
+
 
 // DTL layer 0: above DTL proper
 
-rcode DTLAPI DTL_get_dominance_nt_matrix(int crit, double threshold, ai_matrix dominance_mx) {
+static rcode dtl_get_dominance_nt(int crit, double threshold, int stride, int *dominance_mx) {
 	rcode rc;
-	int Ai,Aj,Ak;
+	int Ai,Aj,Ak,n;
+	int *t_mx;
 	struct d_frame *df;
 
-	if (dominance_mx == t_mx) // will not map correctly
-		return DTL_INTERNAL_ERROR;
-	if (rc = DTL_get_dominance_matrix(crit,threshold,t_mx))
+	if (!frame_loaded)
+		return DTL_FRAME_NOT_LOADED;
+	n = uf->n_alts;
+	if (!dom_buffer(n))
+		return DTL_MEMORY_LEAK;
+	t_mx = dom_mx;
+	if (rc = get_dominance_matrix(crit,threshold,FALSE,n,t_mx))
 		return rc;
 	df = uf->df;
+	if (stride < df->n_alts)
+		return DTL_BUFFER_OVERRUN;
 	/* Transform the belief dominances */
 	for (Ai=1; Ai<=df->n_alts; Ai++)
 		for (Aj=1; Aj<=df->n_alts; Aj++)
-			dominance_mx[Ai][Aj] = t_mx[Ai][Aj];
+			D_CELL(dominance_mx,stride,Ai,Aj) = D_CELL(t_mx,n,Ai,Aj);
 	for (Ai=1; Ai<=df->n_alts; Ai++)
 		for (Aj=1; Aj<=df->n_alts; Aj++)
 #ifdef STRICT_DOM
-			if (dominance_mx[Ai][Aj]==1)
+			if (D_CELL(dominance_mx,stride,Ai,Aj)==1)
 				for (Ak=1; Ak<=df->n_alts; Ak++)
-					if ((t_mx[Ai][Ak]==1) && (t_mx[Ak][Aj]==1)) {
+					if ((D_CELL(t_mx,n,Ai,Ak)==1) && (D_CELL(t_mx,n,Ak,Aj)==1)) {
 #else
-			if (dominance_mx[Ai][Aj])
+			if (D_CELL(dominance_mx,stride,Ai,Aj))
 				for (Ak=1; Ak<=df->n_alts; Ak++)
-					if (((dominance_mx[Ai][Aj]==1) && (t_mx[Ai][Ak]==1) && (t_mx[Ak][Aj]==1)) ||
-							((dominance_mx[Ai][Aj]==2) && t_mx[Ai][Ak] && t_mx[Ak][Aj])) {
+					if (((D_CELL(dominance_mx,stride,Ai,Aj)==1) && (D_CELL(t_mx,n,Ai,Ak)==1) && (D_CELL(t_mx,n,Ak,Aj)==1)) ||
+							((D_CELL(dominance_mx,stride,Ai,Aj)==2) && D_CELL(t_mx,n,Ai,Ak) && D_CELL(t_mx,n,Ak,Aj))) {
 #endif
 						/* Redundant by transitivity */
-						dominance_mx[Ai][Aj] = 0;
+						D_CELL(dominance_mx,stride,Ai,Aj) = 0;
 						break;
 						}
 	return DTL_OK;
 	}
 
 
+rcode DTLAPI DTL_get_dominance_nt_matrix(int crit, double threshold, ai_matrix dominance_mx) {
+
+	return dtl_get_dominance_nt(crit,threshold,MAX_ALTS+1,M_BASE(dominance_mx));
+	}
+
+
+rcode DTLAPI DTL_get_dominance_nt_matrix_n(int crit, double threshold, int n_alts, int dominance_mx[]) {
+
+	return dtl_get_dominance_nt(crit,threshold,n_alts,dominance_mx);
+	}
+
+
 static ai_vector active;
 
 /* Dominance ranking
@@ -304,14 +435,21 @@ static ai_vector active;
 
 rcode DTLAPI DTL_get_dominance_rank(int crit, int mode, int dmode, double threshold, ai_vector dom_rank) {
 	rcode rc;
-	int Ai,Aj,loop,level,remaining;
+	int Ai,Aj,loop,level,remaining,n;
+	int *nt_mx;
 	struct d_frame *df;
 
 	if ((mode < 0) || (mode > 2))
 		return DTL_INPUT_ERROR;
 	if ((dmode < 0) || (dmode > 1))
 		return DTL_INPUT_ERROR;
-	if (rc = DTL_get_dominance_nt_matrix(crit,threshold,nt_mx))
+	if (!frame_loaded)
+		return DTL_FRAME_NOT_LOADED;
+	n = uf->n_alts;
+	if (!dom_buffer(n))
+		return DTL_MEMORY_LEAK;
+	nt_mx = dom_mx+n*n; // first half is used for the nt matrix input
+	if (rc = dtl_get_dominance_nt(crit,threshold,n,nt_mx))
 		return rc;
 	df = uf->df;
 	/* Reset all levels */
@@ -327,8 +465,8 @@ rcode DTLAPI DTL_get_dominance_rank(int crit, int mode, int dmode, double thresh
 				// scan all active on this level by column
 				for (Ai=1; Ai<=df->n_alts; Ai++)
 					// if dominated by someone who is active -> not at this level
-					if (active[Ai] && nt_mx[Ai][Aj])
-						if (!dmode || (nt_mx[Ai][Aj]==1))
+					if (active[Ai] && D_CELL(nt_mx,n,Ai,Aj))
+						if (!dmode || (D_CELL(nt_mx,n,Ai,Aj)==1))
 							break;
 				if (Ai > df->n_alts) {
 					// not dominated by anyone active -> belongs to this level
@@ -347,17 +485,17 @@ rcode DTLAPI DTL_get_dominance_rank(int crit, int mode, int dmode, double thresh
 	}
 
 
-rcode DTLAPI DTL_get_cardinal_dominance_matrix(int crit, int dmode, double threshold, ar_matrix cardinal_mx) {
+static rcode get_cardinal_dominance_matrix(int crit, int dmode, double threshold, bool packed, int stride, double *cardinal_mx) {
 	rcode rc;
 	int Ai,Aj,total;
 	double dominance;
 	struct d_frame *df;
 
 	/* Begin single thread semaphore */
-	_smx_begin("GCDOMX");
+	_smx_begin(packed?"GCDOMXN":"GCDOMX");
 	/* Log function call */
 	if (cst_on) {
-		sprintf(msg,"DTL_get_cardinal_dominance_matrix(%d,%d,%.3lf)\n",crit,dmode,threshold);
+		sprintf(msg,"DTL_get_cardinal_dominance_matrix%s(%d,%d,%.3lf)\n",packed?"_n":"",crit,dmode,threshold);
 		cst_log(msg);
 		}
 	/* Check if function can start */
@@ -372,32 +510,38 @@ rcode DTLAPI DTL_get_cardinal_dominance_matrix(int crit, int dmode, double thres
 	if ((threshold < 0.0) || (threshold > 0.1))
 		return dtl_error(DTL_INPUT_ERROR);
 	df = uf->df;
+	if (stride < df->n_alts)
+		return dtl_error(DTL_BUFFER_OVERRUN);
 	/* Collect the belief dominances */
+	dom_cache_open(crit);
 	for (Ai=1; Ai<=df->n_alts; Ai++)
-		cardinal_mx[Ai][Ai] = 0.0; // cannot dominate itself
+		D_CELL(cardinal_mx,stride,Ai,Ai) = 0.0; // cannot dominate itself
 	for (Ai=1; Ai<df->n_alts; Ai++)
 		for (Aj=Ai+1; Aj<=df->n_alts; Aj++) {
-			if (rc = dtl_get_dominance(crit,Ai,Aj,&dominance,&total))
+			if (rc = dtl_get_dominance(crit,Ai,Aj,&dominance,&total)) {
+				dom_cache_close();
 				return rc;
+				}
 			if ((total==1) || (total && !dmode)) {
 				if (dominance > threshold) {
-					cardinal_mx[Ai][Aj] = dominance;  // Ai dominates
-					cardinal_mx[Aj][Ai] = 0.0;        // Aj dominated
+					D_CELL(cardinal_mx,stride,Ai,Aj) = dominance;  // Ai dominates
+					D_CELL(cardinal_mx,stride,Aj,Ai) = 0.0;        // Aj dominated
 					}
 				else if (dominance < -threshold) {
-					cardinal_mx[Ai][Aj] = 0.0;        // Ai dominated
-					cardinal_mx[Aj][Ai] = -dominance; // Aj dominates
+					D_CELL(cardinal_mx,stride,Ai,Aj) = 0.0;        // Ai dominated
+					D_CELL(cardinal_mx,stride,Aj,Ai) = -dominance; // Aj dominates
 					}
 				else {
-					cardinal_mx[Ai][Aj] = 0.0; // Ai not dominated
-					cardinal_mx[Aj][Ai] = 0.0; // Aj not dominated
+					D_CELL(cardinal_mx,stride,Ai,Aj) = 0.0; // Ai not dominated
+					D_CELL(cardinal_mx,stride,Aj,Ai) = 0.0; // Aj not dominated
 					}
 				}
 			else {
-				cardinal_mx[Ai][Aj] = 0.0; // Ai not dominated
-				cardinal_mx[Aj][Ai] = 0.0; // Aj not dominated
+				D_CELL(cardinal_mx,stride,Ai,Aj) = 0.0; // Ai not dominated
+				D_CELL(cardinal_mx,stride,Aj,Ai) = 0.0; // Aj not dominated
 				}
 			}
+	dom_cache_close();
 	/* Log function result */
 	if (cst_ext) {
 		for (Ai=1; Ai<=df->n_alts; Ai++) {
@@ -405,7 +549,7 @@ rcode DTLAPI DTL_get_cardinal_dominance_matrix(int crit, int dmode, double thres
 				if (Ai==Aj)
 					cst_log("      ");
 				else {
-					sprintf(msg," %.3lf",cardinal_mx[Ai][Aj]);
+					sprintf(msg," %.3lf",D_CELL(cardinal_mx,stride,Ai,Aj));
 					cst_log(msg);
 					}
 			cst_log("\n");
@@ -417,6 +561,18 @@ rcode DTLAPI DTL_get_cardinal_dominance_matrix(int crit, int dmode, double thres
 	}
 
 
+rcode DTLAPI DTL_get_cardinal_dominance_matrix(int crit, int dmode, double threshold, ar_matrix cardinal_mx) {
+
+	return get_cardinal_dominance_matrix(crit,dmode,threshold,FALSE,MAX_ALTS+1,M_BASE(cardinal_mx));
+	}
+
+
+rcode DTLAPI DTL_get_cardinal_dominance_matrix_n(int crit, int dmode, double threshold, int n_alts, double cardinal_mx[]) {
+
+	return get_cardinal_dominance_matrix(crit,dmode,threshold,TRUE,n_alts,cardinal_mx);
+	}
+
+
 /* Abs dom: 2-dom overshadows 1-dom
  *          no-dom overshadows both 1 and 2
  *          the state chain is 1 -> 2 -> 0
@@ -487,6 +643,7 @@ static int abs_sum(int old, int cur) {
 rcode DTLAPI DTL_get_abs_dominance_matrix(int dmode, double threshold, ai_matrix dominance_mx) {
 	rcode rc;
 	int Ai,Aj,k,d_order,doms,n_crit;
+	bool shadow;
 	double cd_value;
 	struct d_frame *df;
 
@@ -522,27 +679,36 @@ rcode DTLAPI DTL_get_abs_dominance_matrix(int dmode, double threshold, ai_matrix
 				dominance_mx[Ai][Ai] = 0; // cannot dominate itself
 			else
 				dominance_mx[Ai][Aj] = 1; // posit 1-order dominance
-	/* Check every pair (Ai,Aj) for belief dominance */
-	for (Ai=1; Ai<=df->n_alts; Ai++) {
-		dtl_abort_check();
-		for (Aj=1; Aj<=df->n_alts; Aj++)
-			if (Ai!=Aj) // not self
-				for (k=1; k<=n_crit; k++) { // for each criterion
+	/* Check every pair (Ai,Aj) for belief dominance. The criteria are the
+	 * outer loop so that each criterion's curves are cached for all pairs.
+	 * A pair is final once not dominating (0 is the end state of abs_dom),
+	 * so settled pairs are skipped in the later criteria. */
+	for (k=1; k<=n_crit; k++) { // for each criterion
 #ifdef ABSDOM_ONLY_PM
-					if (dtl_is_shadow_crit(k))
+		shadow = dtl_is_shadow_crit(k);
 #else
-					if ((n_crit>1) && dtl_is_shadow_crit(k))
+		shadow = (n_crit>1) && dtl_is_shadow_crit(k);
 #endif
+		dom_cache_open(k);
+		for (Ai=1; Ai<=df->n_alts; Ai++) {
+			if (dtl_abort_request)
+				dom_cache_close();
+			dtl_abort_check();
+			for (Aj=1; Aj<=df->n_alts; Aj++)
+				if ((Ai!=Aj) && dominance_mx[Ai][Aj]) { // not self, not settled
+					if (shadow)
 						cd_value = 0.0;
-					else if (rc = dtl_get_dominance(k,Ai,Aj,&cd_value,&d_order))
+					else if (rc = dtl_get_dominance(k,Ai,Aj,&cd_value,&d_order)) {
+						dom_cache_close();
 						return dtl_error(rc);
+						}
 					if (cd_value > threshold) // Ai dominates
 						dominance_mx[Ai][Aj] = abs_dom(dominance_mx[Ai][Aj],d_order);
-					else { // Ai not dominating
-						dominance_mx[Ai][Aj] = 0;
-						break; // end value of state machine -> final verdict
-						}
+					else // Ai not dominating
+						dominance_mx[Ai][Aj] = 0; // end value of state machine -> final verdict
 					}
+			}
+		dom_cache_close();
 		}
 	/* Scan every alt col Aj for being dominated (= can be excluded) */
 	doms = 0; // reset dominated
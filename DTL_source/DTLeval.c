@@ -47,11 +47,21 @@
  *   Functions exported outside DTL
  *   ------------------------------
  *   DTL_evaluate_frame
+ *   DTL_begin_eval_batch
+ *   DTL_end_eval_batch
+ *   DTL_evaluate_digamma
+ *   DTL_evaluate_V_boxes
  *   DTL_evaluate_full
  *   DTL_evaluate_omega
  *   DTL_evaluate_omega1
+ *   DTL_evaluate_omega_matrix
+ *   DTL_evaluate_progressive
+ *   DTL_evaluate_sampled (in DTLsample.c)
+ *   DTL_get_shard (in DTLshard.c)
+ *   DTL_evaluate_shards (in DTLshard.c)
  *   DTL_get_mass_above
  *   DTL_get_mass_below
+ *   DTL_get_mass_below_n
  *   DTL_get_mass_range
  *   DTL_get_mass_density
  *   DTL_get_support_mass
@@ -63,6 +73,8 @@
  *   DTL_rank_alternatives
  *   DTL_daisy_chain/1/2
  *   DTL_pie_chart/1/2
+ *   DTL_sec_level
+ *   DTL_sec_level_sweep
  *
  *   Functions outside of module, debug use
  *   --------------------------------------
@@ -77,27 +89,63 @@
  *   Functions outside of module, inside DTL
  *   ---------------------------------------
  *   eval_cache_invalidate
+ *   eval_cache_modified
+ *   eval_cache_stamp
+ *   eval_cache_new
+ *   eval_cache_bind
+ *   eval_cache_release
+ *   eval_cache_free
  *   evaluate_frame
  *   evaluate_frameset
  *   dtl_ev_to_cdf
+ *   dtl_ev_to_cdf_n
  *   dtl_cdf_to_ev
+ *   dtl_cdf_to_ev_n
+ *   dtl_support_ev_n
+ *   get_n_workers (PAR_EVAL)
  *
  *   Functions internal to module
  *   ----------------------------
+ *   bubble_b
+ *   merge_b
  *   sort_b
  *   sq
  *   eval_cache_mass_init
+ *   memo_restore
+ *   memo_fill
+ *   memo_lookup
+ *   memo_store
+ *   batch_find
+ *   batch_grow
+ *   evaluate_batched
+ *   evaluate_memo
+ *   set_mass
+ *   rule_mass
  *   eval_cache_mass
  *   eval_cache_mc_mass
- *   get_cdf_ev
+ *   get_cdf_ev_n
+ *   shadow_owner
+ *   eval_cache_shadows
+ *   standin_eval
+ *   eval_crit
+ *   run_job
+ *   crit_worker
+ *   par_evaluate_crit
  *   expand_eval_result1/3
+ *   expand_eval_result
+ *   evaluate_digamma
  *   dtl_evaluate_omega
+ *   omega_buffer
+ *   dtl_evaluate_omega_mx
+ *   dtl_average_omega
+ *   prog_omega
  *   dtl_mass_validity
  *   dti_cdf_to_ev
  *   bp4corr_lo/up
  *   bn2dtl
  *   bn4dtl
  *   dtl2bn
+ *   bn_refs
  *   dtl4bn
  *   add_dom
  *
@@ -105,6 +153,15 @@
 
 #include "DTL.h"
 #include "DTLinternal.h"
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#endif
 
 
  /*******************************************************
@@ -114,6 +171,8 @@
   *  DOMINANCE   include dominance-based evaluations
   *  DOM_2024    include 2024 dominance extensions
   *  Q_SORT      faster sort for large nbr of alts
+  *  EVAL_MEMO   memo of recent frame evaluations
+ *  DM_DENSE    dense matrix evaluation of DM frames
   *
   *******************************************************/
 
@@ -121,6 +180,10 @@
 
 #define DOMINANCE // include dominance-based evaluations
 
+#define EVAL_MEMO // reuse results of repeated evaluation calls
+
+#define DM_DENSE // evaluate DM frames from dense rows (see DTLdense.c)
+
 #ifdef DOMINANCE
 #define DOM_2024  // include 2024 dominance extension
 #endif
@@ -138,9 +201,57 @@
   *
   *********************************************************/
 
-static e_matrix e_cache[MAX_CRIT+1];
+/* The evaluation cache belongs to the session. The pointers below are
+ * bound to the cache of the current session by eval_cache_bind. */
+
+#define MEMO_SIZE 8
+
+/* One memoised DTL_evaluate_frame call: the key is the call parameters
+ * and the modification stamp of the bases it depends on (stamp 0 is an
+ * empty slot). The cache slot contents are kept for mass queries. */
+
+struct memo_rec {
+	unsigned long stamp;
+	int crit;
+	int method;
+	int Ai;
+	int Aj;
+	rcode rc;
+	e_matrix e_result;
+	e_matrix e_cache;
+	struct bn_rec ec;
+	double rm1;
+	double cm2;
+	double cm3;
+	};
+
+struct eval_cache {
+	e_matrix e_cache[MAX_CRIT+1];
+	struct bn_rec ec[MAX_CRIT+1];
+	cr_col rm1;
+	cr_col cm2;
+	cr_col cm3;
+	int latest_mc_eval;
+	struct memo_rec memo[MEMO_SIZE];
+	int memo_next;
+	struct memo_rec *batch; // evaluation batch (NULL = none open)
+	int batch_size;         // slots, a power of two
+	int batch_n;            // slots in use
+	int smp_slot; // sampled evaluation (see DTLsample.c)
+	int smp_n;    // 0 = none
+	int smp_size;
+	double *smp;
+	};
+
+static struct eval_cache eval_cache0; // default session
+static struct eval_cache *ev_cur = &eval_cache0;
+static e_matrix *e_cache = eval_cache0.e_cache;
 static int dtl_latest_mc_eval;
 static a_result eval_result;
+static bool eval_no_mass = FALSE; // EV ranges only (progressive evaluation)
+
+/* Max number of points in one batched mass calculation */
+#define MAX_LANES 2*MAX_RESULTSTEPS
 
 
  /*********************************************************
@@ -155,28 +266,104 @@ static a_result eval_result;
 
 #else // no Q_SORT
 
-void sort_b(int order[], double maxmin[], int start, int stop, bool max) {
+/* Above B_SORT_MAX entries, sort_b splits the entries into near-tie
+ * groups (entries connected by steps within DTL_EPS in value order) in
+ * O(n log n). The groups come out in the order that the bubble sort
+ * gives them, and the bubble sort then only runs within each group,
+ * with entries in their original order. Groups that are within DTL_EPS
+ * throughout need a single pass, so only chains of near-ties (spread
+ * over more than DTL_EPS) cost more. The order is that of the plain
+ * bubble sort. */
+
+#define B_SORT_MAX 32
+#define B_SORT_SIZE max(MAX_ALTS,MAX_CRIT)
+
+/* TRUE if entry a must come after entry b */
+#define B_AFTER(a,b) (max ? maxmin[a] < maxmin[b]-DTL_EPS : maxmin[a] > maxmin[b]+DTL_EPS)
+#define B_BEHIND(a,b) (max ? maxmin[a] < maxmin[b] : maxmin[a] > maxmin[b])
+
+static int b_tmp[B_SORT_SIZE+1],b_val[B_SORT_SIZE+1];
+static int b_grp[B_SORT_SIZE+1],b_cnt[B_SORT_SIZE+2];
+
+static void bubble_b(int order[], double maxmin[], int start, int stop, bool max) {
 	int i,tmp;
-	bool done,nok;
+	bool done;
 
 	/* Bubble sort, which is fast for few entries. But more importantly, the tolerance for
 	 * equality is DTL_EPS which is the limit/horizon for round-off errors in calculations. */
 	do {
 		done = TRUE;
-		for (i=start; i<=stop-1; i++) {
-			nok = (max ? maxmin[order[i]] < maxmin[order[i+1]]-DTL_EPS :
-									 maxmin[order[i]] > maxmin[order[i+1]]+DTL_EPS);
-			if (nok) {
+		for (i=start; i<=stop-1; i++)
+			if (B_AFTER(order[i],order[i+1])) {
 				/* Switch the two elements */
 				done = FALSE;
 				tmp = order[i];
 				order[i] = order[i+1];
 				order[i+1] = tmp;
 				}
-			}
 		} while (!done);
 	}
 
+
+/* Stable merge sort on the exact values */
+
+static void merge_b(int order[], double maxmin[], int start, int stop, bool max) {
+	int i,j,k,mid;
+
+	if (stop <= start)
+		return;
+	mid = (start+stop)/2;
+	merge_b(order,maxmin,start,mid,max);
+	merge_b(order,maxmin,mid+1,stop,max);
+	for (i=start, j=mid+1, k=start; k<=stop; k++)
+		if ((j > stop) || ((i <= mid) && !B_BEHIND(order[i],order[j])))
+			b_tmp[k] = order[i++];
+		else
+			b_tmp[k] = order[j++];
+	memcpy(order+start,b_tmp+start,(stop-start+1)*sizeof(int));
+	}
+
+
+void sort_b(int order[], double maxmin[], int start, int stop, bool max) {
+	int i,j,n_grp;
+
+	if ((stop-start < B_SORT_MAX) || (stop > B_SORT_SIZE)) {
+		bubble_b(order,maxmin,start,stop,max);
+		return;
+		}
+	for (i=start; i<=stop; i++)
+		if ((order[i] < 0) || (order[i] > B_SORT_SIZE)) {
+			bubble_b(order,maxmin,start,stop,max);
+			return;
+			}
+	/* Near-tie groups from the value order */
+	memcpy(b_val+start,order+start,(stop-start+1)*sizeof(int));
+	merge_b(b_val,maxmin,start,stop,max);
+	n_grp = 0;
+	b_grp[b_val[start]] = 0;
+	for (i=start+1; i<=stop; i++) {
+		if (B_AFTER(b_val[i],b_val[i-1]))
+			n_grp++;
+		b_grp[b_val[i]] = n_grp;
+		}
+	/* Groups in order, each in the original order (counting sort) */
+	for (j=0; j<=n_grp+1; j++)
+		b_cnt[j] = 0;
+	for (i=start; i<=stop; i++)
+		b_cnt[b_grp[order[i]]+1]++;
+	for (j=1; j<=n_grp; j++)
+		b_cnt[j] += b_cnt[j-1];
+	for (i=start; i<=stop; i++)
+		b_val[start+b_cnt[b_grp[order[i]]]++] = order[i];
+	memcpy(order+start,b_val+start,(stop-start+1)*sizeof(int));
+	/* Bubble sort within each group */
+	for (i=start; i<=stop; i=j+1) {
+		for (j=i; (j<stop) && (b_grp[order[j+1]]==b_grp[order[i]]); j++) ;
+		if (j > i)
+			bubble_b(order,maxmin,i,j,max);
+		}
+	}
+
 #endif // Q_SORT
 
 /* Not a macro, to protect against double evaluation
@@ -194,23 +381,122 @@ static double sq(double a) {
   *
   *********************************************************/
 
-static struct bn_rec ec[MAX_CRIT+1];
-static cr_col ecache_rm1;
-static cr_col ecache_cm2;
-static cr_col ecache_cm3;
+static struct bn_rec *ec = eval_cache0.ec;
+static double *ecache_rm1 = eval_cache0.rm1;
+static double *ecache_cm2 = eval_cache0.cm2;
+static double *ecache_cm3 = eval_cache0.cm3;
+
+void *eval_cache_new() {
+	struct eval_cache *evc;
+
+	evc = (struct eval_cache *)mem_alloc(sizeof(struct eval_cache),"struct eval_cache","eval_cache_new");
+	if (evc)
+		memset(evc,0,sizeof(struct eval_cache));
+	return (void *)evc;
+	}
+
+
+/* Switch to another cache (NULL = default session) */
+
+void eval_cache_bind(void *cache) {
+	struct eval_cache *evc;
+
+	evc = cache ? (struct eval_cache *)cache : &eval_cache0;
+	ev_cur->latest_mc_eval = dtl_latest_mc_eval;
+	ev_cur = evc;
+	e_cache = evc->e_cache;
+	ec = evc->ec;
+	ecache_rm1 = evc->rm1;
+	ecache_cm2 = evc->cm2;
+	ecache_cm3 = evc->cm3;
+	dtl_latest_mc_eval = evc->latest_mc_eval;
+	}
+
+
+/* Release the buffers held by a cache (NULL = default session) */
+
+void eval_cache_release(void *cache) {
+	struct eval_cache *evc;
+
+	evc = cache ? (struct eval_cache *)cache : &eval_cache0;
+	if (evc->smp)
+		mem_free((void *)evc->smp);
+	evc->smp = NULL;
+	evc->smp_size = 0;
+	evc->smp_n = 0;
+	if (evc->batch)
+		mem_free((void *)evc->batch);
+	evc->batch = NULL;
+	evc->batch_size = 0;
+	evc->batch_n = 0;
+	}
+
+
+rcode eval_cache_free(void *cache) {
+
+	if (!cache || (cache == (void *)ev_cur))
+		return DTL_INPUT_ERROR;
+	eval_cache_release(cache);
+	return mem_free(cache);
+	}
+
 
 void eval_cache_invalidate() {
 	int j;
 
+	ev_cur->smp_n = 0;
 	if (frame_loaded)
 		for (j=0; j<=uf->n_crit; j++)
 			ec[j].valid = FALSE;
 	}
 
 
+/* Stamps are unique across all frames, so a memo entry can never match
+ * another frame or an older version of the same base */
+
+static unsigned long eval_stamp;
+
+unsigned long eval_cache_stamp() {
+
+	return ++eval_stamp;
+	}
+
+
+/* A base of crit (0 = weight base) has changed. This makes the results
+ * for crit stale, and all MC results since they depend on every base.
+ * Negative crit = all bases may have changed. */
+
+void eval_cache_modified(int crit) {
+	int j;
+
+	if (frame_loaded) {
+		uf->gen[0] = eval_cache_stamp();
+		if (crit > 0) {
+			uf->gen[crit] = uf->gen[0];
+			/* Mirrored stakeholder criteria share the frame */
+			if ((uf->n_sh > 1) && uf->df_list[crit])
+				for (j=1; j<=uf->n_crit; j++)
+					if (uf->df_list[j] == uf->df_list[crit])
+						uf->gen[j] = uf->gen[0];
+			}
+		else if (crit < 0)
+			for (j=1; j<=uf->n_crit; j++)
+				uf->gen[j] = uf->gen[0];
+		/* Bases to journal on next save */
+		if (crit >= 0)
+			uf->jnl_dirty[crit] = TRUE;
+		else
+			for (j=0; j<=uf->n_crit; j++)
+				uf->jnl_dirty[j] = TRUE;
+		}
+	eval_cache_invalidate();
+	}
+
+
 static void eval_cache_mass_init() {
 	int j;
 
+	ev_cur->smp_n = 0;
 	for (j=0; j<=uf->n_crit; j++) {
 		ecache_rm1[j] = 0.0;
 		ecache_cm2[j] = 0.0;
@@ -220,18 +506,195 @@ static void eval_cache_mass_init() {
 	}
 
 
-static rcode eval_cache_mass(int crit, int method, int Ai, int Aj) {
+/* Restore a kept evaluation into e_result and the cache slot as if
+ * just evaluated */
+
+static void memo_restore(struct memo_rec *mp, e_matrix e_result) {
+	int slot;
+
+	slot = max(mp->crit,0);
+	eval_cache_mass_init();
+	memcpy(e_result,mp->e_result,sizeof(e_matrix));
+	memcpy(e_cache[slot],mp->e_cache,sizeof(e_matrix));
+	ec[slot] = mp->ec;
+	ecache_rm1[slot] = mp->rm1;
+	ecache_cm2[slot] = mp->cm2;
+	ecache_cm3[slot] = mp->cm3;
+	if (mp->crit < 1)
+		dtl_latest_mc_eval = mp->crit;
+	}
+
+
+static void memo_fill(struct memo_rec *mp, int crit, int method, int Ai, int Aj, rcode rc, e_matrix e_result) {
+	int slot;
+
+	slot = max(crit,0);
+	mp->stamp = uf->gen[slot];
+	mp->crit = crit;
+	mp->method = method;
+	mp->Ai = Ai;
+	mp->Aj = Aj;
+	mp->rc = rc;
+	memcpy(mp->e_result,e_result,sizeof(e_matrix));
+	memcpy(mp->e_cache,e_cache[slot],sizeof(e_matrix));
+	mp->ec = ec[slot];
+	mp->rm1 = ecache_rm1[slot];
+	mp->cm2 = ecache_cm2[slot];
+	mp->cm3 = ecache_cm3[slot];
+	}
+
+
+/* Returns the memo entry or NULL if none matches */
+
+static struct memo_rec *memo_lookup(int crit, int method, int Ai, int Aj, e_matrix e_result) {
+	int i,slot;
+	struct memo_rec *mp;
+
+	slot = max(crit,0);
+	for (i=0; i<MEMO_SIZE; i++) {
+		mp = ev_cur->memo+i;
+		if (mp->stamp && (mp->stamp == uf->gen[slot]) && (mp->crit == crit) &&
+				(mp->method == method) && (mp->Ai == Ai) && (mp->Aj == Aj)) {
+			memo_restore(mp,e_result);
+			dtl_perf.memo_hits++;
+			return mp;
+			}
+		}
+	dtl_perf.memo_misses++;
+	return NULL;
+	}
+
+
+static void memo_store(int crit, int method, int Ai, int Aj, rcode rc, e_matrix e_result) {
+	struct memo_rec *mp;
+
+	mp = ev_cur->memo+ev_cur->memo_next;
+	ev_cur->memo_next = (ev_cur->memo_next+1)%MEMO_SIZE;
+	memo_fill(mp,crit,method,Ai,Aj,rc,e_result);
+	}
+
+
+/* Evaluation batch: between DTL_begin_eval_batch and DTL_end_eval_batch,
+ * the evaluations made by DTL_evaluate_frame and the compound calls are
+ * kept in an open addressed table with the same key as the memo. Each
+ * distinct (crit,method,Ai,Aj) on unchanged bases is then evaluated once
+ * however many calls ask for it. Entries whose bases have changed since
+ * are dropped when the table grows. */
+
+#define BATCH_MIN 64
+
+/* The matching entry, or else the empty slot where it belongs */
+
+static struct memo_rec *batch_find(struct memo_rec *table, int size,
+		unsigned long stamp, int crit, int method, int Ai, int Aj) {
+	unsigned long h;
+	struct memo_rec *mp;
+
+	h = stamp*31UL + (unsigned long)crit*7919UL + (unsigned long)method*131UL +
+			(unsigned long)Ai*524287UL + (unsigned long)Aj*8191UL;
+	for (mp=table+(h&(size-1)); mp->stamp; mp=table+(++h&(size-1)))
+		if ((mp->stamp == stamp) && (mp->crit == crit) && (mp->method == method) &&
+				(mp->Ai == Ai) && (mp->Aj == Aj))
+			break;
+	return mp;
+	}
+
+
+/* Double the table, keeping the entries that are still current.
+ * Returns FALSE if no memory (the old table is then kept). */
+
+static bool batch_grow() {
+	int i,size;
+	struct memo_rec *table,*mp;
+
+	size = max(2*ev_cur->batch_size,BATCH_MIN);
+	table = (struct memo_rec *)mem_alloc(size*sizeof(struct memo_rec),"struct memo_rec","batch_grow");
+	if (!table)
+		return FALSE;
+	memset(table,0,size*sizeof(struct memo_rec));
+	ev_cur->batch_n = 0;
+	for (i=0; i<ev_cur->batch_size; i++) {
+		mp = ev_cur->batch+i;
+		if (mp->stamp && (mp->stamp == uf->gen[max(mp->crit,0)])) {
+			*batch_find(table,size,mp->stamp,mp->crit,mp->method,mp->Ai,mp->Aj) = *mp;
+			ev_cur->batch_n++;
+			}
+		}
+	if (ev_cur->batch)
+		mem_free((void *)ev_cur->batch);
+	ev_cur->batch = table;
+	ev_cur->batch_size = size;
+	return TRUE;
+	}
+
+
+/* evaluate_frameset through the open batch, if any */
+
+static rcode evaluate_batched(int crit, int method, int Ai, int Aj, e_matrix e_result) {
 	rcode rc;
+	unsigned long stamp;
+	struct memo_rec *mp;
+
+	if (!ev_cur->batch)
+		return evaluate_frameset(crit,method,Ai,Aj,e_result);
+	stamp = uf->gen[max(crit,0)];
+	mp = batch_find(ev_cur->batch,ev_cur->batch_size,stamp,crit,method,Ai,Aj);
+	if (mp->stamp) {
+		memo_restore(mp,e_result);
+		dtl_perf.batch_hits++;
+		return mp->rc;
+		}
+	rc = evaluate_frameset(crit,method,Ai,Aj,e_result);
+	if (rc < 0)
+		return rc;
+	if (4*(ev_cur->batch_n+1) > 3*ev_cur->batch_size) {
+		if (!batch_grow())
+			return rc; // not kept
+		mp = batch_find(ev_cur->batch,ev_cur->batch_size,stamp,crit,method,Ai,Aj);
+		}
+	memo_fill(mp,crit,method,Ai,Aj,rc,e_result);
+	ev_cur->batch_n++;
+	return rc;
+	}
+
+
+/* Digamma moments for Ai against the set alts */
+
+static void set_mass(int Ai, int n_alts, ai_vector alts, a_row rm1, a_row cm2, a_row cm3, 
+		double *m1, double *m2, double *m3) {
+	int j,n_active;
+
+	*m1 = *m2 = *m3 = 0.0;
+	n_active = 0;
+	for (j=1; j<=n_alts; j++)
+		if ((Ai!=j) && alts[j]) {
+			*m1 -= rm1[j];
+			*m2 += cm2[j];
+			*m3 -= cm3[j];
+			n_active++;
+			}
+	if (n_active) {
+		*m1 /= (double)n_active;
+		*m2 /= (double)n_active;
+		*m3 /= (double)n_active;
+		}
+	*m1 += rm1[Ai];
+	*m2 += cm2[Ai];
+	*m3 += cm3[Ai];
+	}
+
+
+/* Moments and B-normal parameters of crit for an evaluation rule, from
+ * the moments of the alternatives. Touches only the cache entries of crit
+ * (worker safe, see PAR_EVAL). */
+
+static rcode rule_mass(int crit, int method, int Ai, int Aj, int n_alts, 
+		double rm1[], double cm2[], double cm3[]) {
 	int m_field;
-	int j,n_alts,n_active;
-	struct d_frame *df;
-	a_row rm1,cm2,cm3;
+	int j;
+	ai_vector e_set;
 	double m1,m2,m3,skew=0.0,delta;
 
-	df = uf->df;
-	n_alts = df->n_alts;
-	if (rc = TCL_get_moments(df,rm1,cm2,cm3))
-		return rc;
 	/* Process current evaluation rule */
 	m_field = method & M_EVAL;
 	switch (m_field) {
@@ -257,23 +720,10 @@ static rcode eval_cache_mass(int crit, int method, int Ai, int Aj) {
 			m3 = cm3[Ai];
 			break;
 		case E_DIGAMMA:
-			m1 = m2 = m3 = 0.0;
-			n_active = 0;
+			/* Bitmap covers alts 1..DIGAMMA_BITS */
 			for (j=1; j<=n_alts; j++)
-				if ((Ai!=j) && (Aj&(0x01<<(j-1)))) {
-					m1 -= rm1[j];
-					m2 += cm2[j];
-					m3 -= cm3[j];
-					n_active++;
-					}
-			if (n_active) {
-				m1 /= (double)n_active;
-				m2 /= (double)n_active;
-				m3 /= (double)n_active;
-				}
-			m1 += rm1[Ai];
-			m2 += cm2[Ai];
-			m3 += cm3[Ai];
+				e_set[j] = (j<=DIGAMMA_BITS) && (Aj&(0x01<<(j-1)));
+			set_mass(Ai,n_alts,e_set,rm1,cm2,cm3,&m1,&m2,&m3);
 			break;
 		default:
 			return DTL_WRONG_METHOD;
@@ -297,6 +747,16 @@ static rcode eval_cache_mass(int crit, int method, int Ai, int Aj) {
 	}
 
 
+static rcode eval_cache_mass(struct d_frame *df, int crit, int method, int Ai, int Aj) {
+	rcode rc;
+	a_row rm1,cm2,cm3;
+
+	if (rc = TCL_get_moments(df,rm1,cm2,cm3))
+		return rc;
+	return rule_mass(crit,method,Ai,Aj,df->n_alts,rm1,cm2,cm3);
+	}
+
+
 static rcode eval_cache_mc_mass(int snode, double V_rm1[], double V_cm2[], double V_cm3[]) {
 	rcode rc;
 	struct d_frame *df;
@@ -337,7 +797,6 @@ static rcode eval_cache_mc_mass(int snode, double V_rm1[], double V_cm2[], doubl
   */
 
 rcode evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e_result) {
-	rcode trc;
 	int m_field,eval_rule;
 	int i;
 	struct d_frame *df;
@@ -385,8 +844,9 @@ rcode evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e_result) {
 	e_cache[crit][E_MIN][0] = eval_result[Ai][E_MIN];
 	e_cache[crit][E_MID][0] = eval_result[Ai][E_MID];
 	e_cache[crit][E_MAX][0] = eval_result[Ai][E_MAX];
-	trc = eval_cache_mass(crit,method,Ai,Aj);
-	if (trc) {
+	if (eval_no_mass)
+		ec[crit].valid = FALSE; // range only
+	else if (eval_cache_mass(df,crit,method,Ai,Aj)) {
 		ec[crit].valid = FALSE;
 		return dtl_error(DTL_INTERNAL_ERROR);
 		}
@@ -413,6 +873,287 @@ rcode evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e_result) {
 
 static d_row Vc_lobo,Vc_upbo,Wc_point,im_Wc_point;
 
+
+/* In an SM frame with mirrored criteria, the criteria of the other
+ * stakeholders share the frames of the first one. Returns the first
+ * stakeholder's criterion if c is such a shadow, else 0. */
+
+static int shadow_owner(int c) {
+	int n_crit1,c1;
+
+	if (uf->n_sh < 2)
+		return 0;
+	n_crit1 = uf->n_crit/uf->n_sh;
+	if (c <= n_crit1)
+		return 0;
+	c1 = (c-1)%n_crit1+1;
+	if (uf->df_list[c] && (uf->df_list[c] == uf->df_list[c1]))
+		return c1;
+	return 0;
+	}
+
+
+/* Shadow criteria copy the results of their owners in one step after
+ * the owners have been evaluated */
+
+static void eval_cache_shadows() {
+	int c,c1;
+
+	if (uf->n_sh < 2)
+		return;
+	for (c=uf->n_crit/uf->n_sh+1; c<=uf->n_crit; c++)
+		if (c1 = shadow_owner(c)) {
+			e_cache[c][E_MIN][0] = e_cache[c1][E_MIN][0];
+			e_cache[c][E_MID][0] = e_cache[c1][E_MID][0];
+			e_cache[c][E_MAX][0] = e_cache[c1][E_MAX][0];
+			ec[c] = ec[c1];
+			ecache_rm1[c] = ecache_rm1[c1];
+			ecache_cm2[c] = ecache_cm2[c1];
+			ecache_cm3[c] = ecache_cm3[c1];
+			Vc_upbo[c] = Vc_upbo[c1];
+			Vc_lobo[c] = Vc_lobo[c1];
+			}
+	}
+
+
+/* Stand-in evaluation for criterion with empty frame */
+
+static void standin_eval(int c, int m_field, int Aj) {
+
+	if ((m_field == E_PSI) || ((m_field == E_DIGAMMA) && !Aj)) {
+		Vc_upbo[c] = 1.0;
+		Vc_lobo[c] = 0.0;
+		ecache_rm1[c] = 0.5;
+		ecache_cm2[c] = 1.0/24.0;
+		}
+	else {
+		Vc_upbo[c] = 1.0;
+		Vc_lobo[c] = -1.0;
+		ecache_rm1[c] = 0.0;
+		ecache_cm2[c] = 1.0/12.0;
+		}
+	if (cst_on)
+		cst_log(" dtl_standin_eval: ok\n");
+	}
+
+
+#ifdef PAR_EVAL
+
+ /*********************************************************
+  *
+  *  Parallel criteria evaluation
+  *
+  *  The criterion frames are attached up front, after which
+  *  each worker evaluates its share of the criteria. Workers
+  *  only call TCL for their own frames (the TCL scratch areas
+  *  are thread-local) and only write the cache entries of
+  *  their own criteria. Shadow criteria share a frame with a
+  *  criterion in the first set and copy its results.
+  *
+  *********************************************************/
+
+#define MAX_WORKERS 16
+#define MIN_PAR_CRIT 4 // fewer criteria -> serial
+
+struct crit_job {
+	int worker;
+	int n_workers;
+	int eval_rule;
+	int method;
+	int Ai;
+	int Aj;
+	rcode tcl_rc; // kernel error
+	rcode rc;     // DTL error
+	};
+
+static struct crit_job job[MAX_WORKERS];
+static a_result job_result[MAX_WORKERS];
+static int job_crit[MAX_CRIT+1];
+static int n_job_crit;
+static int n_workers = 0;
+
+
+static void eval_crit(struct crit_job *jp, int c, a_result result) {
+	struct d_frame *df;
+
+	df = uf->df_list[c];
+	if (jp->tcl_rc = TCL_evaluate(df,jp->Ai,jp->Aj,jp->eval_rule,result))
+		return;
+	e_cache[c][E_MIN][0] = result[jp->Ai][E_MIN];
+	e_cache[c][E_MID][0] = result[jp->Ai][E_MID];
+	e_cache[c][E_MAX][0] = result[jp->Ai][E_MAX];
+	if (eval_no_mass)
+		ec[c].valid = FALSE; // range only
+	else if (eval_cache_mass(df,c,jp->method,jp->Ai,jp->Aj)) {
+		ec[c].valid = FALSE;
+		jp->rc = DTL_INTERNAL_ERROR;
+		return;
+		}
+	else
+		ec[c].valid = TRUE;
+	Vc_upbo[c] = e_cache[c][E_MAX][0];
+	Vc_lobo[c] = e_cache[c][E_MIN][0];
+	}
+
+
+static void run_job(struct crit_job *jp) {
+	int k;
+
+	for (k=jp->worker; k<n_job_crit; k+=jp->n_workers) {
+		eval_crit(jp,job_crit[k],job_result[jp->worker]);
+		if (jp->tcl_rc || jp->rc)
+			break;
+		}
+	}
+
+
+#ifdef _MSC_VER
+static DWORD WINAPI crit_worker(LPVOID arg) {
+
+	run_job((struct crit_job *)arg);
+	return 0;
+	}
+#else
+static void *crit_worker(void *arg) {
+
+	run_job((struct crit_job *)arg);
+	return NULL;
+	}
+#endif
+
+
+int get_n_workers() {
+	int n;
+
+	if (!n_workers) {
+#ifdef _MSC_VER
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		n = (int)si.dwNumberOfProcessors;
+#else
+		n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		n_workers = min(max(n,1),MAX_WORKERS);
+		}
+	return n_workers;
+	}
+
+
+static rcode par_evaluate_crit(int method, int Ai, int Aj) {
+	rcode rc;
+	int c,c1,w,n_w=0,m_field,eval_rule;
+	bool attached_here[MAX_CRIT+1];
+#ifdef _MSC_VER
+	HANDLE tid[MAX_WORKERS];
+#else
+	pthread_t tid[MAX_WORKERS];
+#endif
+
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	/* Process eval rule */
+	m_field = method & M_EVAL;
+	switch (m_field) {
+		case E_DELTA:
+			eval_rule = DELTA;   break;
+		case E_GAMMA:
+			eval_rule = GAMMA;   break;
+		case E_PSI:
+			eval_rule = PSI;     break;
+		case E_DIGAMMA:
+			eval_rule = DIGAMMA; break;
+		default:
+			return dtl_error(DTL_WRONG_METHOD);
+		}
+	if (eval_rule < DIGAMMA && eval_rule != DELTA)
+		Aj = 0;
+	/* Attach the criterion frames and collect the work */
+	rc = DTL_OK;
+	n_job_crit = 0;
+	for (c=1; c<=uf->n_crit; c++) {
+		attached_here[c] = FALSE;
+		rc = check_df1(c);
+		if (rc == DTL_CRIT_UNKNOWN) {
+			/* Handled here, not an error */
+			standin_eval(c,m_field,Aj);
+			rc = DTL_OK;
+			}
+		else if (rc)
+			return dtl_error(rc);
+		else if (shadow_owner(c))
+			; // shadow, copied below
+		else {
+			if (!uf->df_list[c]->attached) {
+				if (call(TCL_attach_frame(uf->df_list[c]),"TCL_attach_frame"))
+					rc = DTL_FRAME_CORRUPT;
+				attached_here[c] = !rc;
+				}
+			if (rc)
+				break;
+			job_crit[n_job_crit++] = c;
+			}
+		}
+	/* Fan out, the calling thread is worker 0 */
+	if (!rc) {
+		n_w = min(get_n_workers(),n_job_crit);
+		for (w=0; w<n_w; w++) {
+			job[w].worker = w;
+			job[w].n_workers = n_w;
+			job[w].eval_rule = eval_rule;
+			job[w].method = method;
+			job[w].Ai = Ai;
+			job[w].Aj = Aj;
+			job[w].tcl_rc = TCL_OK;
+			job[w].rc = DTL_OK;
+			}
+		for (w=1; w<n_w; w++)
+#ifdef _MSC_VER
+			if (!(tid[w] = CreateThread(NULL,0,crit_worker,&job[w],0,NULL)))
+#else
+			if (pthread_create(&tid[w],NULL,crit_worker,&job[w]))
+#endif
+				job[w].n_workers = -1; // not started
+		run_job(&job[0]);
+		for (w=1; w<n_w; w++)
+			if (job[w].n_workers < 0) {
+				/* Could not start the thread, do its share here */
+				job[w].n_workers = n_w;
+				run_job(&job[w]);
+				}
+			else {
+#ifdef _MSC_VER
+				WaitForSingleObject(tid[w],INFINITE);
+				CloseHandle(tid[w]);
+#else
+				pthread_join(tid[w],NULL);
+#endif
+				}
+		}
+	/* Detach the frames attached here */
+	for (c1=1; c1<c && c1<=uf->n_crit; c1++)
+		if (attached_here[c1])
+			if (call(TCL_detach_frame(uf->df_list[c1]),"TCL_detach_frame"))
+				rc = DTL_FRAME_CORRUPT;
+	if (rc)
+		return dtl_error(rc);
+	/* Collect errors */
+	for (w=0; w<n_w; w++) {
+		if (job[w].tcl_rc) {
+			call(job[w].tcl_rc,"TCL_evaluate");
+			return dtl_kernel_error();
+			}
+		if (job[w].rc)
+			return dtl_error(job[w].rc);
+		}
+	if (cst_on) {
+		sprintf(msg," dtl_par_evaluate: %d criteria on %d workers\n",n_job_crit,n_w);
+		cst_log(msg);
+		}
+	return DTL_OK;
+	}
+
+#endif // PAR_EVAL
+
 // DTL layer 1: at DTL API level
 
 rcode evaluate_frameset(int crit, int method, int Ai, int Aj, e_matrix e_result) {
@@ -438,25 +1179,28 @@ rcode evaluate_frameset(int crit, int method, int Ai, int Aj, e_matrix e_result)
 				return dtl_error(DTL_INPUT_ERROR);
 			}
 		m_field = method & M_EVAL;
+#ifdef DM_DENSE
+		if (dense_ok(method,Ai,Aj)) {
+			if (rc = dense_evaluate(method,Ai,Aj))
+				return rc;
+			dtl_abort_check();
+			}
+		else
+#endif
+#ifdef PAR_EVAL
+		if ((uf->n_crit >= MIN_PAR_CRIT) && (get_n_workers() > 1)) {
+			if (rc = par_evaluate_crit(method,Ai,Aj))
+				return rc;
+			dtl_abort_check();
+			}
+		else
+#endif
 		for (c=1; c<=uf->n_crit; c++) {
+			if (shadow_owner(c))
+				continue; // copied below
 			rc = load_df1(c);
-			if (rc == DTL_CRIT_UNKNOWN) {
-				/* Stand-in evaluation for criterion with empty frame */
-				if ((m_field == E_PSI) || ((m_field == E_DIGAMMA) && !Aj)) {
-					Vc_upbo[c] = 1.0;
-					Vc_lobo[c] = 0.0;
-					ecache_rm1[c] = 0.5;
-					ecache_cm2[c] = 1.0/24.0;
-					}
-				else {
-					Vc_upbo[c] = 1.0;
-					Vc_lobo[c] = -1.0;
-					ecache_rm1[c] = 0.0;
-					ecache_cm2[c] = 1.0/12.0;
-					}
-				if (cst_on)
-					cst_log(" dtl_standin_eval: ok\n");
-				}
+			if (rc == DTL_CRIT_UNKNOWN)
+				standin_eval(c,m_field,Aj);
 			else if (rc)
 				return dtl_error(rc);
 			else {
@@ -467,6 +1211,8 @@ rcode evaluate_frameset(int crit, int method, int Ai, int Aj, e_matrix e_result)
 				dtl_abort_check();
 				}
 			}
+		/* Shadow criteria */
+		eval_cache_shadows();
 		/* Find MC result */
 		if (load_df0(0))
 			return dtl_error(DTL_SYS_CORRUPT);
@@ -479,12 +1225,17 @@ rcode evaluate_frameset(int crit, int method, int Ai, int Aj, e_matrix e_result)
 			return dtl_error(DTL_KERNEL_ERROR+drc);
 		e_result[E_MIN][0] = e_cache[0][E_MIN][0] = -minval;
 		e_result[E_MAX][0] = e_cache[0][E_MAX][0] =  maxval;
-		trc = eval_cache_mc_mass(-crit,ecache_rm1,ecache_cm2,ecache_cm3);
+		trc = eval_no_mass ? DTL_OK : eval_cache_mc_mass(-crit,ecache_rm1,ecache_cm2,ecache_cm3);
 		if (trc) {
 			ec[0].valid = FALSE;
 			e_result[E_MID][0] = e_cache[0][E_MID][0] = (maxval-minval)/2.0;
 			return dtl_error(DTL_INTERNAL_ERROR); // mass not ok
 			}
+		else if (eval_no_mass) {
+			ec[0].valid = FALSE;
+			e_result[E_MID][0] = e_cache[0][E_MID][0] = (maxval-minval)/2.0;
+			rc = DTL_OK; // range only
+			}
 		else {
 			ec[0].valid = TRUE;
 			e_result[E_MID][0] = e_cache[0][E_MID][0] = ecache_rm1[0];
@@ -518,24 +1269,24 @@ rcode evaluate_frameset(int crit, int method, int Ai, int Aj, e_matrix e_result)
   * functions below and expand_eval_result3 is used by DTL_evaluate_rpf. */
 
 static void expand_eval_result1(int crit, int swap, e_matrix e_result) {
-	rcode rc;
 	int i;
-	double level,lobo,upbo;
+	double level[MAX_RESULTSTEPS],lobo[MAX_RESULTSTEPS],upbo[MAX_RESULTSTEPS];
 
-	for (i=1; i<MAX_RESULTSTEPS; i++) {
-		level = 1.0-(double)i/(double)(MAX_RESULTSTEPS-1);
-		rc = dtl_cdf_to_ev(crit,max(level,1.0E-5),&lobo,&upbo);
-		if (!rc) {
-			e_result[E_MIN][i] = lobo;
-			e_result[E_MID][i] = (lobo+upbo)/2.0;
-			e_result[E_MAX][i] = upbo;
-			}
-		else {
+	/* All support levels in one batch */
+	for (i=1; i<MAX_RESULTSTEPS; i++)
+		level[i-1] = max(1.0-(double)i/(double)(MAX_RESULTSTEPS-1),1.0E-5);
+	if (dtl_cdf_to_ev_n(crit,MAX_RESULTSTEPS-1,level,lobo,upbo))
+		for (i=1; i<MAX_RESULTSTEPS; i++) {
 			e_result[E_MIN][i] = -1.0;
 			e_result[E_MID][i] = -1.0;
 			e_result[E_MAX][i] = -1.0;
 			}
-		}
+	else
+		for (i=1; i<MAX_RESULTSTEPS; i++) {
+			e_result[E_MIN][i] = lobo[i-1];
+			e_result[E_MID][i] = (lobo[i-1]+upbo[i-1])/2.0;
+			e_result[E_MAX][i] = upbo[i-1];
+			}
 	if (swap) {
 		/* Swap midpoints */
 		e_result[E_MIN][MAX_RESULTSTEPS-1] = e_result[E_MID][0];
@@ -546,33 +1297,42 @@ static void expand_eval_result1(int crit, int swap, e_matrix e_result) {
 	}
 
 
-static rcode get_cdf_ev(int crit, double cdf, double *ev) {
-	double ev2;
+/* EV at each of n cdf values, at most MAX_LANES */
 
-	if (cdf < 0.5)
-		return dtl_cdf_to_ev(crit,min(max(1.0-2.0*cdf,1.0E-5),0.999),ev,&ev2);
-	else
-		return dtl_cdf_to_ev(crit,min(max(2.0*cdf-1.0,1.0E-5),0.999),&ev2,ev);
+static rcode get_cdf_ev_n(int crit, int n, double cdf[], double ev[]) {
+	int i;
+	bool upper[MAX_LANES];
+	double level[MAX_LANES];
+
+	for (i=0; i<n; i++)
+		if (upper[i] = (cdf[i] >= 0.5))
+			level[i] = min(max(2.0*cdf[i]-1.0,1.0E-5),0.999);
+		else
+			level[i] = min(max(1.0-2.0*cdf[i],1.0E-5),0.999);
+	return dtl_support_ev_n(crit,n,level,upper,ev);
 	}
 
 
 static rcode expand_eval_result3(int crit, int ip, e_matrix e_result) {
 	int i;
-	double level,lobo,upbo,mid_pdf,shift,step;
+	double level,mid_pdf,shift,step,cdf[MAX_LANES],ev[MAX_LANES];
 
 	if (dtl_ev_to_cdf(crit,e_result[E_MID][0],&mid_pdf))
 		return DTL_INTERNAL_ERROR;
 	e_result[E_MID][0] = (e_result[E_MIN][0]+e_result[E_MAX][0])/2.0;
+	/* All lower and upper cdf values in one batch */
 	for (i=1; i<MAX_RESULTSTEPS; i++) {
 		level = 1.0-(double)i/(double)(MAX_RESULTSTEPS-1);
 		shift = (1.0-level)*(mid_pdf-0.5);
-		if (get_cdf_ev(crit,(1.0-level)/2.0-shift,&lobo))
-			return DTL_INTERNAL_ERROR;
-		e_result[E_MIN][i] = lobo;
-		if (get_cdf_ev(crit,(1.0+level)/2.0-shift,&upbo))
-			return DTL_INTERNAL_ERROR;
-		e_result[E_MAX][i] = upbo;
-		e_result[E_MID][i] = (lobo+upbo)/2.0;
+		cdf[2*i-2] = (1.0-level)/2.0-shift;
+		cdf[2*i-1] = (1.0+level)/2.0-shift;
+		}
+	if (get_cdf_ev_n(crit,2*(MAX_RESULTSTEPS-1),cdf,ev))
+		return DTL_INTERNAL_ERROR;
+	for (i=1; i<MAX_RESULTSTEPS; i++) {
+		e_result[E_MIN][i] = ev[2*i-2];
+		e_result[E_MAX][i] = ev[2*i-1];
+		e_result[E_MID][i] = (ev[2*i-2]+ev[2*i-1])/2.0;
 		}
 	if (ip) { // interpolate first (base) entry to constant derivative
 		step = sq(e_result[E_MIN][2]-e_result[E_MIN][1])/(e_result[E_MIN][3]-e_result[E_MIN][2]);
@@ -585,6 +1345,49 @@ static rcode expand_eval_result3(int crit, int ip, e_matrix e_result) {
 	}
 
 
+/* Expansion modes 1-4 as above */
+
+static rcode expand_eval_result(int crit, int exp_mode, e_matrix e_result) {
+
+	switch (exp_mode) {
+		case 1:
+		case 2:
+			expand_eval_result1(crit,exp_mode-1,e_result);
+			return DTL_OK;
+		case 3:
+		case 4:
+			return expand_eval_result3(crit,exp_mode-3,e_result);
+		default:
+			return DTL_WRONG_METHOD;
+		}
+	}
+
+
+/* Evaluation through the memo and the open batch. The criterion
+ * is loaded. Errors have already been reported. */
+
+static rcode evaluate_memo(int crit, int method, int Ai, int Aj, e_matrix e_result) {
+	rcode rc;
+#ifdef EVAL_MEMO
+	struct memo_rec *mp;
+
+	/* Same call on unchanged bases -> reuse */
+	if (mp = memo_lookup(crit,method,Ai,Aj,e_result)) {
+		if (cst_ext)
+			cst_log(" evaluate_frame: memo\n");
+		return mp->rc;
+		}
+#endif
+	/* Evaluate */
+	rc = evaluate_batched(crit,method,Ai,Aj,e_result);
+#ifdef EVAL_MEMO
+	if (rc >= 0)
+		memo_store(crit,method,Ai,Aj,rc,e_result);
+#endif
+	return rc;
+	}
+
+
 rcode DTLAPI DTL_evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e_result) {
 	rcode rc;
 
@@ -603,7 +1406,7 @@ rcode DTLAPI DTL_evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e
 	if (load_df00(crit)) // must validate input here
 		return dtl_error(DTL_CRIT_UNKNOWN);
 	/* Evaluate */
-	rc = evaluate_frameset(crit,method,Ai,Aj,e_result);
+	rc = evaluate_memo(crit,method,Ai,Aj,e_result);
 	/* End single thread semaphore */
 	if (!rc)
 		_smx_end();
@@ -611,6 +1414,224 @@ rcode DTLAPI DTL_evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e
 	}
 
 
+/* A dashboard refresh typically makes several compound calls (ranking,
+ * delta mass, daisy chain, pie chart, comparison, dominance) on the same
+ * frame, which ask for many of the same evaluations. Enclosing them in a
+ * batch evaluates each distinct one once. The batch ends explicitly and
+ * survives base changes, whose results are simply not reused. */
+
+rcode DTLAPI DTL_begin_eval_batch() {
+
+	/* Begin single thread semaphore */
+	_smx_begin("BBATCH");
+	/* Log function call */
+	if (cst_on)
+		cst_log("DTL_begin_eval_batch()\n");
+	/* Check if function can start */
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (ev_cur->batch)
+		return dtl_error(DTL_STATE_ERROR);
+	if (!batch_grow())
+		return dtl_error(DTL_MEMORY_LEAK);
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+rcode DTLAPI DTL_end_eval_batch() {
+
+	/* Begin single thread semaphore */
+	_smx_begin("EBATCH");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_end_eval_batch(): %d evaluations\n",ev_cur->batch_n);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	if (!ev_cur->batch)
+		return dtl_error(DTL_STATE_ERROR);
+	mem_free((void *)ev_cur->batch);
+	ev_cur->batch = NULL;
+	ev_cur->batch_size = 0;
+	ev_cur->batch_n = 0;
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+/* Digamma for n_sets pairs of Ai[k] and alternative set alts[k]
+ * (k=1..n_sets, alts[k][j] != 0 if alt j is in the set) in one call.
+ * For a criterion, all sets share one evaluation of the frame. For
+ * the PM tree, the MC moments are formed per set from the criteria. */
+
+static a_row s_rm1,s_cm2,s_cm3;
+
+static rcode evaluate_digamma(int crit, int n_sets, int Ai[], ai_vector alts[], 
+		double lo_value[], double mid_value[], double up_value[]) {
+	rcode rc,drc;
+	int j,k,c;
+	double minval,maxval,m1,m2,m3;
+
+	/* Check input parameters */
+	if (n_sets < 1)
+		return dtl_error(DTL_INPUT_ERROR);
+	for (k=1; k<=n_sets; k++) {
+		if ((Ai[k] < 1) || (Ai[k] > uf->n_alts))
+			return dtl_error(DTL_ALT_UNKNOWN);
+		if (alts[k][Ai[k]])
+			return dtl_error(DTL_INPUT_ERROR);
+		}
+	eval_cache_mass_init();
+	if (crit > 0) {
+		if (call(TCL_evaluate_digamma(uf->df,n_sets,Ai,alts,lo_value,mid_value,up_value),
+				"TCL_evaluate_digamma"))
+			return dtl_kernel_error();
+		return DTL_OK;
+		}
+	/* PM-0 MC evaluation */
+	dtl_abort_init();
+	for (k=1; k<=n_sets; k++) {
+		for (c=1; c<=uf->n_crit; c++) {
+			rc = load_df1(c);
+			if (rc == DTL_CRIT_UNKNOWN) {
+				/* Stand-in evaluation for criterion with empty frame */
+				for (j=1; j<=uf->n_alts; j++)
+					if (alts[k][j])
+						break;
+				if (j > uf->n_alts) {
+					Vc_upbo[c] = 1.0;
+					Vc_lobo[c] = 0.0;
+					ecache_rm1[c] = 0.5;
+					ecache_cm2[c] = 1.0/24.0;
+					}
+				else {
+					Vc_upbo[c] = 1.0;
+					Vc_lobo[c] = -1.0;
+					ecache_rm1[c] = 0.0;
+					ecache_cm2[c] = 1.0/12.0;
+					}
+				ecache_cm3[c] = 0.0;
+				}
+			else if (rc)
+				return dtl_error(rc);
+			else {
+				if (call(TCL_evaluate_digamma(uf->df,1,Ai+k-1,alts+k-1,
+						lo_value+k-1,mid_value+k-1,up_value+k-1),"TCL_evaluate_digamma"))
+					return dtl_kernel_error();
+				if (call(TCL_get_moments(uf->df,s_rm1,s_cm2,s_cm3),"TCL_get_moments"))
+					return dtl_kernel_error();
+				set_mass(Ai[k],uf->n_alts,alts[k],s_rm1,s_cm2,s_cm3,&m1,&m2,&m3);
+				Vc_upbo[c] = up_value[k];
+				Vc_lobo[c] = lo_value[k];
+				ecache_rm1[c] = m1;
+				ecache_cm2[c] = m2;
+				ecache_cm3[c] = m3;
+				dtl_abort_check();
+				}
+			}
+		/* Find MC result */
+		if (load_df0(0))
+			return dtl_error(DTL_SYS_CORRUPT);
+		if (drc = call(TCL_get_P_min(uf->df,1,-crit,
+				Vc_lobo,Wc_point,im_Wc_point,FALSE,&minval),"TCL_get_TP_min"))
+			return dtl_error(DTL_KERNEL_ERROR+drc);
+		if (drc = call(TCL_get_P_max(uf->df,1,-crit,
+				Vc_upbo,Wc_point,im_Wc_point,TRUE,&maxval),"TCL_get_TP_max"))
+			return dtl_error(DTL_KERNEL_ERROR+drc);
+		if (drc = call(TCL_get_mc_moments(uf->df,-crit,ecache_rm1,ecache_cm2,ecache_cm3,
+				&m1,&m2,&m3),"TCL_get_mc_moments"))
+			return dtl_error(DTL_KERNEL_ERROR+drc);
+		lo_value[k] = -minval;
+		mid_value[k] = m1;
+		up_value[k] = maxval;
+		}
+	if (cst_on)
+		cst_log(" dtl_evaluate_mc: ok\n");
+	return DTL_OK;
+	}
+
+
+rcode DTLAPI DTL_evaluate_digamma(int crit, int n_sets, int Ai[], ai_vector alts[], 
+		double lo_value[], double mid_value[], double up_value[]) {
+	rcode rc;
+
+	/* Begin single thread semaphore */
+	_smx_begin("DIGAM");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_evaluate_digamma(%d,%d)\n",crit,n_sets);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(Ai,1);
+	_certify_ptr(alts,2);
+	_certify_ptr(lo_value,3);
+	_certify_ptr(mid_value,4);
+	_certify_ptr(up_value,5);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	/* Check input parameters */
+	if (load_df00(crit)) // must validate input here
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	/* Evaluate */
+	rc = evaluate_digamma(crit,n_sets,Ai,alts,lo_value,mid_value,up_value);
+	/* End single thread semaphore */
+	if (!rc)
+		_smx_end();
+	return rc;
+	}
+
+
+/* EV ranges of all alternatives in criterion crit under n_boxes V-boxes
+ * in one call, a sweep over box scenarios without setting each box. Box
+ * k (from 0) of node n (in node order, from 0) is at lobox/upbox
+ * [k*n_nodes+n], the result of Ai at [k*n_alts+Ai-1]. The frame and its
+ * own box are not changed. */
+
+rcode DTLAPI DTL_evaluate_V_boxes(int crit, int n_boxes, int n_nodes, double lobox[], double upbox[], 
+		int n_alts, double lo_value[], double mid_value[], double up_value[]) {
+
+	/* Begin single thread semaphore */
+	_smx_begin("EVVB");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_evaluate_V_boxes(%d,%d)\n",crit,n_boxes);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(lobox,1);
+	_certify_ptr(upbox,2);
+	_certify_ptr(lo_value,3);
+	_certify_ptr(mid_value,4);
+	_certify_ptr(up_value,5);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	/* Check input parameters */
+	if (load_df1(crit))
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	if (n_boxes < 1)
+		return dtl_error(DTL_INPUT_ERROR);
+	if ((n_nodes < uf->df->tot_cons[0]) || (n_alts < uf->df->n_alts))
+		return dtl_error(DTL_BUFFER_OVERRUN);
+	/* Evaluate all boxes */
+	if (call(TCL_evaluate_V_boxes(uf->df,n_boxes,n_nodes,lobox,upbox,n_alts,lo_value,mid_value,up_value),
+			"TCL_evaluate_V_boxes"))
+		return dtl_kernel_error();
+	if (cst_on)
+		cst_log(" DTL_evaluate_V_boxes: ok\n");
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
 // DTL layer 0: above DTL proper
 
 rcode DTLAPI DTL_evaluate_full(int crit, int method, int Ai, int Aj, e_matrix e_result) {
@@ -625,20 +1646,9 @@ rcode DTLAPI DTL_evaluate_full(int crit, int method, int Ai, int Aj, e_matrix e_
 	if (rc = DTL_evaluate_frame(crit,eval_method,Ai,Aj,e_result))
 		return rc;
 	/* Expand to many support levels */
-	switch (exp_mode) {
-		case 1:
-		case 2:
-			expand_eval_result1(crit,exp_mode-1,e_result);
-			break;
-		case 0: // mode 3 is the default
-			exp_mode = 3;
-		case 3:
-		case 4:
-			rc = expand_eval_result3(crit,exp_mode-3,e_result);
-			break;
-		default:
-			rc = DTL_WRONG_METHOD;
-		}
+	if (!exp_mode) // mode 3 is the default
+		exp_mode = 3;
+	rc = expand_eval_result(crit,exp_mode,e_result);
 	/* Log function result */
 	if (cst_ext) {
 		sprintf(msg," expand_eval_result%d: %s\n",exp_mode,rc<0?DTL_get_errtxt(rc):"ok");
@@ -709,18 +1719,120 @@ static rcode dtl_evaluate_omega(int Ai, cr_col o_result) {
 	}
 
 
+/* Frame-sized scratch for the omega matrix. Row Ai-1 is o_result of
+ * dtl_evaluate_omega(Ai), i.e. n_crit+1 entries with the total first. */
+
+static double *om_mx;
+static int om_size;
+static a_row a_omega;
+
+static bool omega_buffer(int n) {
+
+	if (om_size < n) {
+		if (om_mx)
+			mem_free((void *)om_mx);
+		om_mx = (double *)mem_alloc(n*sizeof(double),"double","omega_buffer");
+		om_size = om_mx ? n : 0;
+		if (!om_mx)
+			return FALSE;
+		}
+	return TRUE;
+	}
+
+
+void omega_release() {
+
+	if (om_mx)
+		mem_free((void *)om_mx);
+	om_mx = NULL;
+	om_size = 0;
+	}
+
+
+/* All alternatives at once into om_mx. Each criterion frame is loaded
+ * once and its mass points are shared by all alternatives, instead of
+ * n_alts loads per criterion. Same results as dtl_evaluate_omega. */
+
+static rcode dtl_evaluate_omega_mx() {
+	rcode rc;
+	int Ai,c,stride;
+	double *o_row;
+
+	if (load_df0(0))
+		return dtl_error(DTL_SYS_CORRUPT);
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	stride = uf->n_crit+1;
+	if (!omega_buffer(uf->n_alts*stride))
+		return dtl_error(DTL_MEMORY_LEAK);
+	/* Get MC weights */
+	if (call(TCL_get_P_masspoint(uf->df,W_mid,LW_mid),"TCL_get_P_masspoint"))
+		return dtl_kernel_error();
+	/* Collect index type A2 from A1 */
+	for (c=1; c<=uf->n_crit; c++)
+		if (!(t_inx[c] = TCL_get_tot_index(1,c)))
+			return dtl_error(DTL_INTERNAL_ERROR);
+	for (Ai=1; Ai<=uf->n_alts; Ai++)
+		om_mx[(Ai-1)*stride] = 0.0;
+	/* Get omega of all alternatives from each criterion */
+	for (c=1; c<=uf->n_crit; c++) {
+		rc = load_df1(c);
+		if (rc == DTL_CRIT_UNKNOWN)
+			/* Stand-in evaluation for empty frame */
+			for (Ai=1; Ai<=uf->n_alts; Ai++)
+				a_omega[Ai] = 0.5;
+		else if (rc)
+			return dtl_error(rc);
+		else
+			if (call(TCL_evaluate_omega_all(uf->df,a_omega),"TCL_evaluate_omega_all"))
+				return dtl_kernel_error();
+		for (Ai=1; Ai<=uf->n_alts; Ai++) {
+			o_row = om_mx+(Ai-1)*stride;
+			o_row[c] = W_mid[t_inx[c]] * a_omega[Ai];
+			o_row[0] += o_row[c];
+			}
+		}
+	/* Log function result */
+	if (cst_ext) {
+		sprintf(msg," omega matrix %d x %d\n",uf->n_alts,uf->n_crit);
+		cst_log(msg);
+		}
+	return DTL_OK;
+	}
+
+
+/* Average over all alternatives, as for Ai=0 */
+
+static rcode dtl_average_omega(cr_col o_result) {
+	rcode rc;
+	int i,j,stride;
+
+	if (rc = dtl_evaluate_omega_mx())
+		return rc;
+	stride = uf->n_crit+1;
+	for (j=0; j<=uf->n_crit; j++)
+		o_result[j] = om_mx[j];
+	for (i=2; i<=uf->n_alts; i++)
+		for (j=0; j<=uf->n_crit; j++)
+			o_result[j] += om_mx[(i-1)*stride+j];
+	for (j=0; j<=uf->n_crit; j++)
+		o_result[j] /= (double)uf->n_alts;
+	return DTL_OK;
+	}
+
+
 /* Output mode: 0=order
  *              1=olympic rank
  *              2=strict rank
  *              3=group rank
  *             +4=percent of omega EV (default: percent of entire scale) */
 
-static cr_col o2_result,o3_result;
+static cr_col o2_result;
 static ci_col o_order;
 
 rcode DTLAPI DTL_evaluate_omega(int Ai, int mode, cr_col o_result, ci_col o_rank) {
 	rcode rc;
-	int i,j,level,renorm,cst_global;
+	int j,level,renorm,cst_global;
 
 	/* Begin single thread semaphore */
 	_smx_begin("OMEGA");
@@ -748,17 +1860,7 @@ rcode DTLAPI DTL_evaluate_omega(int Ai, int mode, cr_col o_result, ci_col o_rank
 	else {
 		cst_global = cst_on;
 		cst_on = FALSE;
-		rc = dtl_evaluate_omega(1,o_result);
-		if (!rc) {
-			for (i=2; i<=uf->n_alts; i++) {
-				if (rc = dtl_evaluate_omega(i,o2_result))
-					break;
-				for (j=0; j<=uf->n_crit; j++)
-					o_result[j] += o2_result[j];
-				}
-			for (j=0; j<=uf->n_crit; j++)
-				o_result[j] /= (double)uf->n_alts;
-			}
+		rc = dtl_average_omega(o_result);
 		cst_on = cst_global;
 		}
 	if (rc) // catch eval error
@@ -817,7 +1919,7 @@ rcode DTLAPI DTL_evaluate_omega(int Ai, int mode, cr_col o_result, ci_col o_rank
 
 rcode DTLAPI DTL_evaluate_omega1(int Ai, int mode, cr_col o_result, ci_col o_node) {
 	rcode rc;
-	int i,j,k,cst_global;
+	int j,k,cst_global;
 	int pos,wnode,wnode1,state;
 	double ev_sum;
 
@@ -844,17 +1946,7 @@ rcode DTLAPI DTL_evaluate_omega1(int Ai, int mode, cr_col o_result, ci_col o_nod
 	else {
 		cst_global = cst_on;
 		cst_on = FALSE;
-		rc = dtl_evaluate_omega(1,o2_result);
-		if (!rc) {
-			for (i=2; i<=uf->n_alts; i++) {
-				if (rc = dtl_evaluate_omega(i,o3_result))
-					break;
-				for (j=0; j<=uf->n_crit; j++)
-					o2_result[j] += o3_result[j];
-				}
-			for (j=0; j<=uf->n_crit; j++)
-				o2_result[j] /= (double)uf->n_alts;
-			}
+		rc = dtl_average_omega(o2_result);
 		cst_on = cst_global;
 		}
 	if (rc) // catch eval error
@@ -918,6 +2010,228 @@ rcode DTLAPI DTL_evaluate_omega1(int Ai, int mode, cr_col o_result, ci_col o_nod
 	}
 
 
+/* Omega of all alternatives in all criteria in one call, the score
+ * table behind DTL_evaluate_omega. The weighted omega of Ai in crit c
+ * is at omega_mx[(Ai-1)*n_crit+c-1], so that each row sums to the
+ * total of DTL_evaluate_omega(Ai). Each criterion is visited once. */
+
+rcode DTLAPI DTL_evaluate_omega_matrix(int n_alts, int n_crit, double omega_mx[]) {
+	rcode rc;
+	int Ai,c,stride;
+
+	/* Begin single thread semaphore */
+	_smx_begin("OMMX");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_evaluate_omega_matrix(%d,%d)\n",n_alts,n_crit);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(omega_mx,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (PS)
+		return dtl_error(DTL_WRONG_FRAME_TYPE);
+	/* Check input parameters */
+	if ((n_alts < uf->n_alts) || (n_crit < uf->n_crit))
+		return dtl_error(DTL_BUFFER_OVERRUN);
+	/* Evaluate all alternatives */
+	if (rc = dtl_evaluate_omega_mx())
+		return rc;
+	stride = uf->n_crit+1;
+	for (Ai=1; Ai<=uf->n_alts; Ai++)
+		for (c=1; c<=uf->n_crit; c++)
+			omega_mx[(Ai-1)*n_crit+c-1] = om_mx[(Ai-1)*stride+c];
+	if (cst_on)
+		cst_log(" DTL_evaluate_omega_matrix: ok\n");
+	eval_cache_invalidate();
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+ /*********************************************************
+  *
+  *  Progressive evaluation
+  *
+  *  The result is handed to the caller in stages of rising
+  *  accuracy, each as soon as it is known:
+  *
+  *  STAGE_OMEGA    mass point EV only (min = mid = max)
+  *  STAGE_RANGE    EV range, mid is still the mass point
+  *  STAGE_MASS     as DTL_evaluate_frame
+  *  STAGE_SUPPORT  as DTL_evaluate_full
+  *
+  *  The range and mass stages evaluate the same frames and
+  *  TCL keeps their tables between the two, so the whole
+  *  sequence costs little more than DTL_evaluate_full. An
+  *  MC evaluation of a subtree (crit < 0) has no mass point
+  *  and starts with the range.
+  *
+  *********************************************************/
+
+static a_row prog_o;
+
+/* Mass point EV of the rule, from the omega of each alternative
+ * (weighted over the criteria in an MC evaluation) */
+
+static rcode prog_omega(int crit, int method, int Ai, int Aj, double *omega) {
+	rcode rc;
+	int a,c,j,n_alts,n_bits,n_active,m_field;
+	double o;
+
+	n_alts = crit ? uf->df->n_alts : uf->n_alts;
+	/* Check input parameters as evaluate_frame */
+	m_field = method & M_EVAL;
+	if ((m_field != E_DELTA) && (m_field != E_GAMMA) && (m_field != E_PSI) && (m_field != E_DIGAMMA))
+		return DTL_WRONG_METHOD;
+	if ((Ai < 1) || (Ai > n_alts))
+		return DTL_ALT_UNKNOWN;
+	if (m_field == E_DELTA) {
+		if ((Aj < 1) || (Aj > n_alts))
+			return DTL_ALT_UNKNOWN;
+		if (Ai == Aj)
+			return DTL_INPUT_ERROR;
+		}
+	for (a=1; a<=n_alts; a++)
+		prog_o[a] = 0.0;
+	if (crit) {
+		/* Criterion is loaded */
+		for (a=1; a<=n_alts; a++)
+			if ((m_field != E_PSI) || (a == Ai))
+				if (call(TCL_evaluate_omega(uf->df,a,&prog_o[a]),"TCL_evaluate_omega"))
+					return DTL_KERNEL_ERROR;
+		}
+	else {
+		/* Get MC weights */
+		if (call(TCL_get_P_masspoint(uf->df,W_mid,LW_mid),"TCL_get_P_masspoint"))
+			return DTL_KERNEL_ERROR;
+		for (c=1; c<=uf->n_crit; c++)
+			if (!(t_inx[c] = TCL_get_tot_index(1,c)))
+				return DTL_INTERNAL_ERROR;
+		for (c=1; c<=uf->n_crit; c++) {
+			rc = load_df1(c);
+			if (rc && (rc != DTL_CRIT_UNKNOWN))
+				return rc;
+			for (a=1; a<=n_alts; a++)
+				if ((m_field != E_PSI) || (a == Ai)) {
+					if (rc)
+						/* Stand-in evaluation for empty frame */
+						o = 0.5;
+					else if (call(TCL_evaluate_omega(uf->df,a,&o),"TCL_evaluate_omega"))
+						return DTL_KERNEL_ERROR;
+					prog_o[a] += W_mid[t_inx[c]] * o;
+					}
+			}
+		if (load_df0(0))
+			return DTL_SYS_CORRUPT;
+		}
+	/* Apply the rule */
+	*omega = prog_o[Ai];
+	switch (m_field) {
+		case E_DELTA:
+			*omega -= prog_o[Aj];
+			break;
+		case E_GAMMA:
+			for (j=1; j<=n_alts; j++)
+				if (j != Ai)
+					*omega -= prog_o[j]/(n_alts-1.0);
+			break;
+		case E_DIGAMMA:
+			n_bits = min(n_alts,DIGAMMA_BITS);
+			for (n_active=0, j=1; j<=n_bits; j++)
+				if ((j!=Ai) && (Aj&(0x01<<(j-1))))
+					n_active++;
+			for (j=1; j<=n_bits; j++)
+				if ((j!=Ai) && (Aj&(0x01<<(j-1))))
+					*omega -= prog_o[j]/n_active;
+			break;
+		}
+	return DTL_OK;
+	}
+
+
+/* The stage function is called inside this call and must not call
+ * DTL. It returns FALSE to stop refining, leaving the latest stage
+ * in e_result. The method carries the expansion bits of
+ * DTL_evaluate_full for the support stage. */
+
+rcode DTLAPI DTL_evaluate_progressive(int crit, int method, int Ai, int Aj, 
+		dtl_stage_fn stage_fn, void *user, e_matrix e_result) {
+	rcode rc;
+	int i,eval_method,exp_mode;
+	double o;
+	volatile double omega=0.0; // kept across the assert jump
+
+	/* Begin single thread semaphore */
+	_smx_begin("PROG");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_evaluate_progressive(%d,%d,%d,%d)\n",crit,method,Ai,Aj);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(e_result,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	/* Check input parameters */
+	if (load_df00(crit))
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	eval_method = method & M_EVAL;
+	exp_mode = (method-eval_method)>>6;
+	if (!exp_mode) // mode 3 is the default
+		exp_mode = 3;
+	if (exp_mode > 4)
+		return dtl_error(DTL_WRONG_METHOD);
+	/* Stage 1: mass point */
+	if (crit >= 0) {
+		if (rc = prog_omega(crit,eval_method,Ai,Aj,&o))
+			return dtl_error(rc);
+		omega = o;
+		for (i=E_MIN; i<=E_MAX; i++)
+			e_result[i][0] = omega;
+		if (stage_fn && !stage_fn(STAGE_OMEGA,e_result,user)) {
+			_smx_end();
+			return DTL_OK;
+			}
+		}
+	/* Stage 2: EV range */
+	eval_no_mass = TRUE;
+	rc = evaluate_frameset(crit,eval_method,Ai,Aj,e_result);
+	eval_no_mass = FALSE;
+	if (rc)
+		return rc;
+	if (crit >= 0)
+		e_result[E_MID][0] = omega;
+	if (stage_fn && !stage_fn(STAGE_RANGE,e_result,user)) {
+		_smx_end();
+		return DTL_OK;
+		}
+	/* Stage 3: belief mass */
+	if (load_df00(crit))
+		return dtl_error(DTL_SYS_CORRUPT);
+	if (rc = evaluate_memo(crit,eval_method,Ai,Aj,e_result))
+		return rc;
+	if (stage_fn && !stage_fn(STAGE_MASS,e_result,user)) {
+		_smx_end();
+		return DTL_OK;
+		}
+	/* Stage 4: support levels */
+	if (rc = expand_eval_result(crit,exp_mode,e_result))
+		return dtl_error(rc);
+	if (stage_fn)
+		stage_fn(STAGE_SUPPORT,e_result,user);
+	if (cst_ext)
+		cst_log(" evaluate_progressive: ok\n");
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
  /*************************************************************************
   *
   *  Mass calculation functions are of two different types:
@@ -961,6 +2275,19 @@ static double dtl2bn(double ref_lo, double ref_up, double dtl) {
 	}
 
 
+/* B-normal cdf at the truncation points (EV min and max) of crit */
+
+static void bn_refs(int crit, double *ref_lo, double *ref_up) {
+	double val[2],cdf[2];
+
+	val[0] = e_cache[crit][E_MIN][0];
+	val[1] = e_cache[crit][E_MAX][0];
+	bn_cdf_n(2,val,ec[crit].location,ec[crit].scale2,ec[crit].alpha,cdf);
+	*ref_lo = cdf[0];
+	*ref_up = cdf[1];
+	}
+
+
  /**********************************************************************
   *
   *  Internal mass distribution validity and verification
@@ -972,9 +2299,10 @@ static rcode dtl_mass_validity(int crit) {
 
 	if (e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] < DTL_EPS)
 		return DTL_INFINITE_MASS; // almost infinite mass
+	if (smp_active(crit))
+		return DTL_OK; // empirical distribution, no interpolation
 	/* "Valid" if skew does not make interpolation do too much to the function */
-	ref_lo = bn_cdf(e_cache[crit][E_MIN][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-	ref_up = bn_cdf(e_cache[crit][E_MAX][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
+	bn_refs(crit,&ref_lo,&ref_up);
 	if (ref_up-ref_lo < 0.9)
 		return DTL_WEAK_MASS_DISTR; // spans less than 90%
 	return DTL_OK;
@@ -1013,8 +2341,7 @@ rcode DTLAPI DTI_bn_to_dtl_cdf(int crit, double cdf_bn, double *cdf_dtl) {
 	if ((cdf_bn < 0.0) || (cdf_bn > 1.0))
 		return dtl_error(DTL_INPUT_ERROR);
 	/* Calculate DTL cdf for given b-normal cdf */
-	ref_lo = bn_cdf(e_cache[crit][E_MIN][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-	ref_up = bn_cdf(e_cache[crit][E_MAX][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
+	bn_refs(crit,&ref_lo,&ref_up);
 	if (cdf_bn < ref_lo)
 		*cdf_dtl = 0.0;
 	else if (cdf_bn > ref_up)
@@ -1049,8 +2376,15 @@ rcode DTLAPI DTI_bn_to_dtl_cdf(int crit, double cdf_bn, double *cdf_dtl) {
 #define DIRAC_SPLIT
 #define DENS_EPS 1.0E-6
 
-rcode dtl_ev_to_cdf(int crit, double ev_level, double *mass) {
-	double ref_lo,ref_up,cur;
+/* Mass above n levels. All the b-normal cdf points needed, including the
+ * truncation points, are evaluated in one batch. At most MAX_RESULTSTEPS
+ * levels per call. */
+
+rcode dtl_ev_to_cdf_n(int crit, int n, double ev_level[], double mass[]) {
+	int i,m;
+	double val[MAX_RESULTSTEPS+2],cdf[MAX_RESULTSTEPS+2];
+	double ref_lo=0.0,ref_up=0.0,cur;
+	bool spread,sampled;
 
 	/* Check input parameters */
 	if (load_df00(crit))
@@ -1060,44 +2394,67 @@ rcode dtl_ev_to_cdf(int crit, double ev_level, double *mass) {
 	crit = max(crit,0); // partial/subcrit trees in slot 0
 	if (!ec[crit].valid)
 		return DTL_OUTPUT_ERROR;
-	if ((ev_level < -1.0) || (ev_level > 1.0))
+	if ((n < 1) || (n > MAX_RESULTSTEPS))
 		return DTL_INPUT_ERROR;
-	/* Calculate mass above the given level */
-	if (ev_level < e_cache[crit][E_MIN][0]-DTL_EPS)
-		*mass = 1.0;
-	else if (ev_level > e_cache[crit][E_MAX][0]+DTL_EPS)
-		*mass = 0.0;
-	else if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR)) {
-		ref_lo = bn_cdf(e_cache[crit][E_MIN][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		ref_up = bn_cdf(e_cache[crit][E_MAX][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		cur = bn_cdf(ev_level,ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		/* Catch roundoff errors */
-		cur = min(max(cur,ref_lo),ref_up);
-		/* Convert from b-normal cdf scale to DTL cdf scale */
-		*mass = max(1.0-bn2dtl(ref_lo,ref_up,cur),0.0);
-		}
-	/* If the total area is (close to) zero, return position relative to mass point instead */
-	else if (ev_level < ecache_rm1[crit]-DTL_EPS)
-		*mass = 1.0;
-	else if (ev_level > ecache_rm1[crit]+DTL_EPS)
-		*mass = 0.0;
+	for (i=0; i<n; i++)
+		if ((ev_level[i] < -1.0) || (ev_level[i] > 1.0))
+			return DTL_INPUT_ERROR;
+	/* Collect the b-normal cdf of all levels within the range */
+	spread = (e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR);
+	sampled = smp_active(crit);
+	if (spread && !sampled) {
+		val[0] = e_cache[crit][E_MIN][0];
+		val[1] = e_cache[crit][E_MAX][0];
+		for (m=2,i=0; i<n; i++)
+			if ((ev_level[i] >= e_cache[crit][E_MIN][0]-DTL_EPS) && (ev_level[i] <= e_cache[crit][E_MAX][0]+DTL_EPS))
+				val[m++] = ev_level[i];
+		bn_cdf_n(m,val,ec[crit].location,ec[crit].scale2,ec[crit].alpha,cdf);
+		ref_lo = cdf[0];
+		ref_up = cdf[1];
+		}
+	/* Calculate mass above the given levels */
+	for (m=2,i=0; i<n; i++)
+		if (ev_level[i] < e_cache[crit][E_MIN][0]-DTL_EPS)
+			mass[i] = 1.0;
+		else if (ev_level[i] > e_cache[crit][E_MAX][0]+DTL_EPS)
+			mass[i] = 0.0;
+		else if (spread && sampled)
+			mass[i] = 1.0-smp_cdf(ev_level[i]);
+		else if (spread) {
+			cur = cdf[m++];
+			/* Catch roundoff errors */
+			cur = min(max(cur,ref_lo),ref_up);
+			/* Convert from b-normal cdf scale to DTL cdf scale */
+			mass[i] = max(1.0-bn2dtl(ref_lo,ref_up,cur),0.0);
+			}
+		/* If the total area is (close to) zero, return position relative to mass point instead */
+		else if (ev_level[i] < ecache_rm1[crit]-DTL_EPS)
+			mass[i] = 1.0;
+		else if (ev_level[i] > ecache_rm1[crit]+DTL_EPS)
+			mass[i] = 0.0;
 #ifdef DIRAC_SPLIT
-	else { // (almost) at mass point, split above and below
-		if (ev_level < -1.0+DTL_EPS)
-			*mass = 1.0;
-		else if (ev_level > 1.0-DTL_EPS)
-			*mass = 0.0;
-		else
-			*mass = 0.5;
-		}
+		else { // (almost) at mass point, split above and below
+			if (ev_level[i] < -1.0+DTL_EPS)
+				mass[i] = 1.0;
+			else if (ev_level[i] > 1.0-DTL_EPS)
+				mass[i] = 0.0;
+			else
+				mass[i] = 0.5;
+			}
 #else
-	else // at or above is always full mass, no split
-		*mass = 1.0;
+		else // at or above is always full mass, no split
+			mass[i] = 1.0;
 #endif
 	return DTL_OK; // dtl_mass_validity at next level up
 	}
 
 
+rcode dtl_ev_to_cdf(int crit, double ev_level, double *mass) {
+
+	return dtl_ev_to_cdf_n(crit,1,&ev_level,mass);
+	}
+
+
 rcode DTLAPI DTL_get_mass_above(int crit, double lo_level, double *mass) {
 	rcode rc;
 
@@ -1156,9 +2513,45 @@ rcode DTLAPI DTL_get_mass_below(int crit, double up_level, double *mass) {
 	}
 
 
+/* Mass below each of n levels (a cdf curve) from one evaluation. The
+ * levels are run through the b-normal in batches of MAX_RESULTSTEPS. */
+
+rcode DTLAPI DTL_get_mass_below_n(int crit, int n, double up_level[], double mass[]) {
+	rcode rc;
+	int i,k;
+
+	/* Begin single thread semaphore */
+	_smx_begin("NMASS");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_get_mass_below_n(%d,%d)\n",crit,n);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(up_level,1);
+	_certify_ptr(mass,2);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (n < 1)
+		return dtl_error(DTL_INPUT_ERROR);
+	/* Fetch the "reverse cdf" of the evaluation */
+	for (i=0; i<n; i+=k) {
+		k = min(n-i,MAX_RESULTSTEPS);
+		if (rc = dtl_ev_to_cdf_n(crit,k,up_level+i,mass+i))
+			return dtl_error(rc);
+		}
+	/* Revert to "true cdf" = mass below (up to) specified levels */
+	for (i=0; i<n; i++)
+		mass[i] = 1.0-mass[i];
+	/* End single thread semaphore */
+	_smx_end();
+	return dtl_mass_validity(crit);
+	}
+
+
 rcode DTLAPI DTL_get_mass_range(int crit, double lo_level, double up_level, double *mass) {
 	rcode rc;
-	double lo_mass,up_mass;
+	double level[2],lu_mass[2];
 
 	/* Begin single thread semaphore */
 	_smx_begin("RMASS");
@@ -1176,11 +2569,11 @@ rcode DTLAPI DTL_get_mass_range(int crit, double lo_level, double up_level, doub
 	if (lo_level > up_level)
 		return dtl_error(DTL_INPUT_ERROR);
 	/* Fetch the lower and upper "cdf" of the evaluation */
-	if (rc = dtl_ev_to_cdf(crit,max(lo_level-2.0*DTL_EPS,-1.0),&lo_mass))
+	level[0] = max(lo_level-2.0*DTL_EPS,-1.0);
+	level[1] = min(up_level+2.0*DTL_EPS,1.0);
+	if (rc = dtl_ev_to_cdf_n(crit,2,level,lu_mass))
 		return dtl_error(rc);
-	if (rc = dtl_ev_to_cdf(crit,min(up_level+2.0*DTL_EPS,1.0),&up_mass))
-		return dtl_error(rc);
-	*mass = lo_mass-up_mass;
+	*mass = lu_mass[0]-lu_mass[1];
 	/* Log function result */
 	if (cst_ext) {
 		sprintf(msg," range mass = %6.3lf\n",*mass);
@@ -1195,7 +2588,7 @@ rcode DTLAPI DTL_get_mass_range(int crit, double lo_level, double up_level, doub
 rcode DTLAPI DTL_get_mass_density(int crit, double ev_level, double *density) {
 	rcode rc;
 	int crit0;
-	double level1,level2,mass1,mass2;
+	double level1,level2,mass1,mass2,level[2],mass[2];
 
 	/* Begin single thread semaphore */
 	_smx_begin("MDENS");
@@ -1219,12 +2612,12 @@ rcode DTLAPI DTL_get_mass_density(int crit, double ev_level, double *density) {
 	if ((ev_level < -1.0) || (ev_level > 1.0))
 		return dtl_error(DTL_INPUT_ERROR);
 	/* Fetch the "pdf" of the evaluation */
-	level1 = min(ev_level+DENS_EPS,1.0);
-	if (rc = dtl_ev_to_cdf(crit,level1,&mass1))
-		return dtl_error(rc);
-	level2 = max(ev_level-DENS_EPS,-1.0);
-	if (rc = dtl_ev_to_cdf(crit,level2,&mass2))
+	level[0] = level1 = min(ev_level+DENS_EPS,1.0);
+	level[1] = level2 = max(ev_level-DENS_EPS,-1.0);
+	if (rc = dtl_ev_to_cdf_n(crit,2,level,mass))
 		return dtl_error(rc);
+	mass1 = mass[0];
+	mass2 = mass[1];
 	if ((level2 > e_cache[crit0][E_MIN][0]) && 
 			(level1 < e_cache[crit0][E_MAX][0]) && 
 			(level1 > level2)) {
@@ -1258,7 +2651,7 @@ rcode DTLAPI DTL_get_mass_density(int crit, double ev_level, double *density) {
   *
   *  Type 2: have support (mass) in %, want to know interval (EV range).
   *  The interval covering the central 'belief_level' % on the EV axis.
-  *  bn_cdf is a one-way function, loop through EV values ever closer.
+  *  bn_cdf is a one-way function, bn_solve_n homes in on the EV value.
   *
   *  Unfortunately, there exist no closed analytical PDF expression.
   *  In DTLbnormal.c, there is an analytical inverse to the normal
@@ -1270,8 +2663,12 @@ rcode DTLAPI DTL_get_mass_density(int crit, double ev_level, double *density) {
   *
   *********************************************************************/
 
-rcode dtl_cdf_to_ev(int crit, double belief_level, double *lobo, double *upbo) {
-	double cdf,ref_lo,ref_up,step,val,new_val,lo_target,up_target;
+/* The lower (upper[i] = FALSE) or upper bound of the central support
+ * interval for each of n belief levels, at most MAX_LANES of them */
+
+rcode dtl_support_ev_n(int crit, int n, double belief_level[], bool upper[], double ev[]) {
+	int i;
+	double ref_lo,ref_up,target[MAX_LANES];
 
 	/* Check input parameters */
 	if (load_df00(crit))
@@ -1281,51 +2678,62 @@ rcode dtl_cdf_to_ev(int crit, double belief_level, double *lobo, double *upbo) {
 	crit = max(crit,0); // subcrit trees in slot 0
 	if (!ec[crit].valid)
 		return DTL_OUTPUT_ERROR;
-	if ((belief_level < MIN_SUPPORT_LEVEL) || (belief_level > MAX_SUPPORT_LEVEL))
-		return DTL_INPUT_ERROR; // out-of-range, round-off errors will start interfering
+	for (i=0; i<n; i++)
+		if ((belief_level[i] < MIN_SUPPORT_LEVEL) || (belief_level[i] > MAX_SUPPORT_LEVEL))
+			return DTL_INPUT_ERROR; // out-of-range, round-off errors will start interfering
 	/* Calculate support mass */
-	if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR)) {
-		ref_lo = bn_cdf(e_cache[crit][E_MIN][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		ref_up = bn_cdf(e_cache[crit][E_MAX][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		/* Lower bound */
-		step = (e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0])/2.0;
-		new_val = (e_cache[crit][E_MAX][0]+e_cache[crit][E_MIN][0])/2.0;
-		/* Convert from DTL cdf scale to b-normal cdf scale */
-		lo_target = dtl2bn(ref_lo,ref_up,(1.0-belief_level)/2.0);
-		do {
-			val = new_val;
-			cdf = bn_cdf(val,ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-			step /= 2.0;
-			if (cdf > lo_target)
-				new_val = val-step;
-			else
-				new_val = val+step;
-			} while ((fabs(cdf-lo_target) > 0.000001) && (step > 1.0E-7));
-		*lobo = val;
-		/* Upper bound */
-		step = (e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0])/2.0;
-		new_val = (e_cache[crit][E_MAX][0]+e_cache[crit][E_MIN][0])/2.0;
+	if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR) && smp_active(crit))
+		for (i=0; i<n; i++)
+			ev[i] = smp_quantile(upper[i] ? (1.0+belief_level[i])/2.0 : (1.0-belief_level[i])/2.0);
+	else if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR)) {
+		bn_refs(crit,&ref_lo,&ref_up);
 		/* Convert from DTL cdf scale to b-normal cdf scale */
-		up_target = dtl2bn(ref_lo,ref_up,(1.0+belief_level)/2.0);
-		do {
-			val = new_val;
-			cdf = bn_cdf(val,ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-			step /= 2.0;
-			if (cdf > up_target)
-				new_val = val-step;
+		for (i=0; i<n; i++)
+			if (upper[i])
+				target[i] = dtl2bn(ref_lo,ref_up,(1.0+belief_level[i])/2.0);
 			else
-				new_val = val+step;
-			} while ((fabs(cdf-up_target) > 0.000001) && (step > 1.0E-7));
-		*upbo = val;
+				target[i] = dtl2bn(ref_lo,ref_up,(1.0-belief_level[i])/2.0);
+		bn_solve_n(n,target,e_cache[crit][E_MIN][0],e_cache[crit][E_MAX][0],
+				ec[crit].location,ec[crit].scale2,ec[crit].alpha,ev);
 		}
-	else {
-		*lobo = ecache_rm1[crit];
-		*upbo = ecache_rm1[crit];
+	else
+		for (i=0; i<n; i++)
+			ev[i] = ecache_rm1[crit];
+	return DTL_OK;
+	}
+
+
+/* Support intervals for n belief levels, at most MAX_RESULTSTEPS */
+
+rcode dtl_cdf_to_ev_n(int crit, int n, double belief_level[], double lobo[], double upbo[]) {
+	rcode rc;
+	int i;
+	bool upper[MAX_LANES];
+	double level[MAX_LANES],ev[MAX_LANES];
+
+	if ((n < 1) || (n > MAX_RESULTSTEPS))
+		return DTL_INPUT_ERROR;
+	for (i=0; i<n; i++) {
+		level[2*i] = level[2*i+1] = belief_level[i];
+		upper[2*i] = FALSE;
+		upper[2*i+1] = TRUE;
+		}
+	if (rc = dtl_support_ev_n(crit,2*n,level,upper,ev))
+		return rc;
+	for (i=0; i<n; i++) {
+		lobo[i] = ev[2*i];
+		upbo[i] = ev[2*i+1];
 		}
 	return DTL_OK;
 	}
 
 
+rcode dtl_cdf_to_ev(int crit, double belief_level, double *lobo, double *upbo) {
+
+	return dtl_cdf_to_ev_n(crit,1,&belief_level,lobo,upbo);
+	}
+
+
 /* Collector functions: collect the mass from a previous evaluation.
  * Valid belief levels are [50%,99.9%]. (100% is the entire EV range) */
 
@@ -1443,7 +2851,7 @@ rcode DTLAPI DTL_get_support_upper(int crit, double belief_level, double *lobo,
  * Get the location of the cdf 50% midpoint */
 
 rcode DTLAPI DTI_get_support_mid(int crit, double *cdf) {
-	double ref_lo,ref_up,step,val,new_val,target;
+	double ref_lo,ref_up,target;
 
 	/* Begin single thread semaphore */
 	_smx_begin("SMASM");
@@ -1465,24 +2873,14 @@ rcode DTLAPI DTI_get_support_mid(int crit, double *cdf) {
 	if (!ec[crit].valid)
 		return dtl_error(DTL_OUTPUT_ERROR);
 	/* Calculate support mass */
-	if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR)) {
-		ref_lo = bn_cdf(e_cache[crit][E_MIN][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		ref_up = bn_cdf(e_cache[crit][E_MAX][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		/* Lower bound */
-		step = (e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0])/2.0;
-		new_val = (e_cache[crit][E_MAX][0]+e_cache[crit][E_MIN][0])/2.0;
+	if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR) && smp_active(crit))
+		*cdf = smp_quantile(0.5);
+	else if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR)) {
+		bn_refs(crit,&ref_lo,&ref_up);
 		/* Convert from DTL cdf scale to b-normal cdf scale */
 		target = dtl2bn(ref_lo,ref_up,0.5);
-		do {
-			val = new_val;
-			*cdf = bn_cdf(val,ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-			step /= 2.0;
-			if (*cdf > target)
-				new_val = val-step;
-			else
-				new_val = val+step;
-			} while ((fabs(*cdf-target) > 0.000001) && (step > 1.0E-7));
-		*cdf = val;
+		bn_solve_n(1,&target,e_cache[crit][E_MIN][0],e_cache[crit][E_MAX][0],
+				ec[crit].location,ec[crit].scale2,ec[crit].alpha,cdf);
 		}
 	else
 		*cdf = ecache_rm1[crit];
@@ -1500,7 +2898,7 @@ rcode DTLAPI DTI_get_support_mid(int crit, double *cdf) {
 /* Obtain EV range by way of the DTLbnormal.c function for the CDF inverse */
 
 static rcode dti_cdf_to_ev(int crit, double belief_level, double *lobo, double *upbo) {
-	double ref_lo,ref_up,lo_target,up_target;
+	double ref_lo,ref_up,target[2],bound[2];
 
 	/* Check input parameters */
 	if (load_df00(crit))
@@ -1514,14 +2912,13 @@ static rcode dti_cdf_to_ev(int crit, double belief_level, double *lobo, double *
 		return DTL_INPUT_ERROR; // out-of-range, round-off errors will start interfering
 	/* Calculate support mass */
 	if ((e_cache[crit][E_MAX][0]-e_cache[crit][E_MIN][0] > DTL_EPS) && (ecache_cm2[crit] > INF_MASS_VAR)) {
-		ref_lo = bn_cdf(e_cache[crit][E_MIN][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		ref_up = bn_cdf(e_cache[crit][E_MAX][0],ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		/* Lower bound  - convert from DTL cdf scale to b-normal cdf scale */
-		lo_target = dtl2bn(ref_lo,ref_up,(1.0-belief_level)/2.0);
-		*lobo = bn_inv_cdf(lo_target,ec[crit].location,ec[crit].scale2,ec[crit].alpha);
-		/* Upper bound  - convert from DTL cdf scale to b-normal cdf scale */
-		up_target = dtl2bn(ref_lo,ref_up,(1.0+belief_level)/2.0);
-		*upbo = bn_inv_cdf(up_target,ec[crit].location,ec[crit].scale2,ec[crit].alpha);
+		bn_refs(crit,&ref_lo,&ref_up);
+		/* Lower and upper bound - convert from DTL cdf scale to b-normal cdf scale */
+		target[0] = dtl2bn(ref_lo,ref_up,(1.0-belief_level)/2.0);
+		target[1] = dtl2bn(ref_lo,ref_up,(1.0+belief_level)/2.0);
+		bn_inv_cdf_n(2,target,ec[crit].location,ec[crit].scale2,ec[crit].alpha,bound);
+		*lobo = bound[0];
+		*upbo = bound[1];
 		}
 	else { // Dirac point
 		*lobo = ecache_rm1[crit];
@@ -1784,7 +3181,7 @@ rcode DTLAPI DTL_compare_alternatives(int crit, int method, double belief_level,
 	dtl_abort_init();
 	for (Ai=1; Ai<=df->n_alts; Ai++) {
 		dtl_abort_check();
-		if (rc = evaluate_frameset(crit,method,Ai,0,rank_result)) {
+		if (rc = evaluate_batched(crit,method,Ai,0,rank_result)) {
 			cst_on = cst_global;
 			return dtl_error(rc);
 			}
@@ -1878,7 +3275,7 @@ rcode DTLAPI DTL_delta_mass(int crit, int mode, ar_matrix delta_value, ar_matrix
 		delta_value[Ai][Ai] = delta_mass[Ai][Ai] = 0.0;
 		for (Aj=Ai+1; Aj<=df->n_alts; Aj++) {
 			dtl_abort_check();
-			if (rc = evaluate_frameset(crit,E_DELTA,Ai,Aj,rank_result)) {
+			if (rc = evaluate_batched(crit,E_DELTA,Ai,Aj,rank_result)) {
 				cst_on = cst_global;
 				return dtl_error(rc);
 				}
@@ -1900,7 +3297,7 @@ rcode DTLAPI DTL_delta_mass(int crit, int mode, ar_matrix delta_value, ar_matrix
 		/* Fetch omega EV */
 		for (Ai=1; Ai<=df->n_alts; Ai++) {
 			dtl_abort_check();
-			if (rc = evaluate_frameset(crit,E_PSI,Ai,0,rank_result)) {
+			if (rc = evaluate_batched(crit,E_PSI,Ai,0,rank_result)) {
 				cst_on = cst_global;
 				return dtl_error(rc);
 				}
@@ -2092,8 +3489,9 @@ rcode DTLAPI DTL_rank_alternatives(int crit, int mode, double gamma_tolerance, d
 	cst_on = FALSE;
 	dtl_abort_init();
 	for (Ai=1; Ai<=df->n_alts; Ai++) {
+		dtl_progress(Ai-1,df->n_alts);
 		dtl_abort_check();
-		if (rc = evaluate_frameset(crit,E_PSI,Ai,0,rank_result)) {
+		if (rc = evaluate_batched(crit,E_PSI,Ai,0,rank_result)) {
 			cst_on = cst_global;
 			return dtl_error(rc);
 			}
@@ -2115,7 +3513,7 @@ rcode DTLAPI DTL_rank_alternatives(int crit, int mode, double gamma_tolerance, d
 				rc = dtl_cdf_to_ev(crit,1.0-2.0*gamma_tolerance,gamma_value+Ai,&pos_gamma);
 			}
 		else { // rank gamma
-			if (rc = evaluate_frameset(crit,E_GAMMA,Ai,0,rank_result)) {
+			if (rc = evaluate_batched(crit,E_GAMMA,Ai,0,rank_result)) {
 				cst_on = cst_global;
 				return dtl_error(rc);
 				}
@@ -2178,16 +3576,21 @@ rcode DTLAPI DTL_rank_alternatives(int crit, int mode, double gamma_tolerance, d
 		}
 #if defined(DOM_2024) && !defined(C_SML)
 	if (mode == -3) {
-		/* Dominance evaluation -> replace gamma */
+		/* Dominance evaluation -> replace gamma (each alt is in two pairs) */
+		dom_cache_open(crit);
 		for (i=1; i<df->n_alts; i++) {
+			if (dtl_abort_request)
+				dom_cache_close();
 			dtl_abort_check();
 			Ai = omega_order[i];
 			Aj = omega_order[i+1];
 			if (rc = dtl_get_dominance(crit,Ai,Aj,gamma_value+Ai,gamma_rank+Ai)) {
+				dom_cache_close();
 				cst_on = cst_global;
 				return dtl_error(rc);
 				}
 			}
+		dom_cache_close();
 		gamma_rank[omega_order[df->n_alts]] = -1; // unused
 		gamma_value[omega_order[df->n_alts]] = -1.0; // unused
 		}
@@ -2261,7 +3664,7 @@ rcode DTLAPI DTL_daisy_chain2(int crit, int mode, double radius,
 	dtl_abort_init();
 	for (Ai=1; Ai<=df->n_alts; Ai++) {
 		dtl_abort_check();
-		if (rc = evaluate_frameset(crit,E_PSI,Ai,0,rank_result)) {
+		if (rc = evaluate_batched(crit,E_PSI,Ai,0,rank_result)) {
 			cst_on = cst_global;
 			return dtl_error(rc);
 			}
@@ -2274,7 +3677,7 @@ rcode DTLAPI DTL_daisy_chain2(int crit, int mode, double radius,
 	/* Evaluate daisy chain */
 	for (i=1; i<df->n_alts; i++) {
 		dtl_abort_check();
-		if (rc = evaluate_frameset(crit,E_DELTA,omega_order[i],omega_order[i+1],rank_result)) {
+		if (rc = evaluate_batched(crit,E_DELTA,omega_order[i],omega_order[i+1],rank_result)) {
 			cst_on = cst_global;
 			return dtl_error(rc);
 			}
@@ -2481,16 +3884,16 @@ static int dtl_sec_level(int crit, double v_min, s_matrix s_result) {
 		return dtl_kernel_error();
 	/* Transfer result to caller */
 	for (Ai=1; Ai<=df->n_alts; Ai++) {
-			s_result[Ai][E_MIN] = strong[Ai];
-			s_result[Ai][E_MID] = marked[Ai];
-			s_result[Ai][E_MAX] = weak[Ai];
+			s_result[E_MIN][Ai] = strong[Ai];
+			s_result[E_MID][Ai] = marked[Ai];
+			s_result[E_MAX][Ai] = weak[Ai];
 			}
 	if (cst_ext) {
 		for (Ai=1; Ai<=df->n_alts; Ai++) {
 			sprintf(msg," A%d:",Ai);
 			cst_log(msg);
 			for (j=E_MAX; j>=E_MIN; j--) {
-				sprintf(msg," %6.3lf",s_result[Ai][j]);
+				sprintf(msg," %6.3lf",s_result[j][Ai]);
 				cst_log(msg);
 				}
 			cst_log("\n");
@@ -2518,9 +3921,91 @@ rcode DTLAPI DTL_sec_level(int crit, double v_min, s_matrix s_result) {
 	}
 
 
+ /*
+  * Call semantics: The security levels for an ascending sequence of
+  * thresholds v_min[1..n_levels] are delivered in s_result[1..n_levels],
+  * each in the same form as from DTL_sec_level. A sweep is much faster
+  * than calling DTL_sec_level once per threshold.
+  */
+
+static int dtl_sec_level_sweep(int crit, int n_levels, double v_min[], s_matrix s_result[]) {
+	int Ai,j,k;
+	struct d_frame *df;
+	a_vector *sweep;
+
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	if (n_levels < 1)
+		return dtl_error(DTL_INPUT_ERROR);
+	for (k=1; k<=n_levels; k++) {
+		if ((v_min[k] < 0.0) || (v_min[k] > 1.0))
+			return dtl_error(DTL_INPUT_ERROR);
+		if ((k > 1) && (v_min[k] < v_min[k-1]))
+			return dtl_error(DTL_INPUT_ERROR);
+		}
+	if (load_df1(crit))
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	df = uf->df;
+	/* Get TCL results into strong|marked|weak blocks */
+	sweep = (a_vector *)mem_alloc(3*(n_levels+1)*sizeof(a_vector),"a_vector","dtl_sec_level_sweep");
+	if (!sweep)
+		return dtl_error(DTL_MEMORY_LEAK);
+	if (call(TCL_security_sweep(df,n_levels,v_min,sweep,sweep+n_levels+1,sweep+2*(n_levels+1)),
+			"TCL_security_sweep")) {
+		mem_free((void *)sweep);
+		return dtl_kernel_error();
+		}
+	/* Transfer result to caller */
+	for (k=1; k<=n_levels; k++)
+		for (Ai=1; Ai<=df->n_alts; Ai++) {
+			s_result[k][E_MIN][Ai] = sweep[k][Ai];
+			s_result[k][E_MID][Ai] = sweep[n_levels+1+k][Ai];
+			s_result[k][E_MAX][Ai] = sweep[2*(n_levels+1)+k][Ai];
+			}
+	mem_free((void *)sweep);
+	if (cst_ext) {
+		for (k=1; k<=n_levels; k++) {
+			sprintf(msg," L%.3lf\n",v_min[k]);
+			cst_log(msg);
+			for (Ai=1; Ai<=df->n_alts; Ai++) {
+				sprintf(msg," A%d:",Ai);
+				cst_log(msg);
+				for (j=E_MAX; j>=E_MIN; j--) {
+					sprintf(msg," %6.3lf",s_result[k][j][Ai]);
+					cst_log(msg);
+					}
+				cst_log("\n");
+				}
+			}
+		}
+	return DTL_OK;
+	}
+
+
+rcode DTLAPI DTL_sec_level_sweep(int crit, int n_levels, double v_min[], s_matrix s_result[]) {
+	int rc;
+
+	_smx_begin("SELS");
+	_certify_ptr(v_min,1);
+	_certify_ptr(s_result,2);
+	if (cst_on) {
+		sprintf(msg,"DTL_sec_level_sweep(%d,%d)\n",crit,n_levels);
+		cst_log(msg);
+		}
+	if (rc = dtl_sec_level_sweep(crit,n_levels,v_min,s_result)) {
+		_smx_end();
+		return dtl_error(rc);
+		}
+	_smx_end();
+	return DTL_OK;
+	}
+
+
  /*************************************************************
   *
-  *  Three add-on packages are defined at the end of DTLeval.c
+  *  The add-on packages are defined at the end of DTLeval.c
   *  in order to have access to internal eval data structures.
   *
   *************************************************************/
@@ -2546,3 +4031,30 @@ rcode DTLAPI DTL_sec_level(int crit, double v_min, s_matrix s_result) {
 
 #include "DTLdominance.c" // develop and finish in 2024
 #endif
+
+
+ /*************************************************************
+  *
+  *  Monte Carlo sampled evaluations
+  *
+  *************************************************************/
+
+#include "DTLsample.c"
+
+
+ /*************************************************************
+  *
+  *  Dense matrix evaluation of DM frames
+  *
+  *************************************************************/
+
+#include "DTLdense.c"
+
+
+ /*************************************************************
+  *
+  *  Sharded evaluation of large alternative sets
+  *
+  *************************************************************/
+
+#include "DTLshard.c"
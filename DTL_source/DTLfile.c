@@ -51,23 +51,37 @@
  *
  *   Functions outside of module, inside DTL
  *   ---------------------------------------
- *   NONE
+ *   dtl_write_file
  *
  *   Functions internal to module
  *   ----------------------------
  *   read_ufile
+ *   room_stmts
+ *   free_stmts
+ *   parse_dfile
+ *   load_dfile
  *   read_dfile
+ *   run_load_job
+ *   load_worker
+ *   par_read_dfiles
  *   dtl_read_file
  *   backup_ufile
  *   nospace
  *   write_ufile
  *   write_dfile
- *   dtl_write_file
  *
  */
 
 #include "DTL.h"
 #include "DTLinternal.h"
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
 
 
  /********************************************************
@@ -92,6 +106,11 @@
 
 #define FOSIZE 256 // folder name size
 
+#ifdef PAR_EVAL
+#define MAX_LOAD_WORKERS 16
+#define MIN_PAR_LOAD 4 // fewer criteria -> serial
+#endif
+
 
  /********************************************************
   *
@@ -100,6 +119,9 @@
   ********************************************************/
 
 static t_matrix tnext,tdown;
+static struct stmt_rec *P_stmts,*V_stmts; // grow with the bases read, see room_stmts
+static int max_P_stmts,max_V_stmts;
+static struct stmt_rec P_mids[MAX_NODES+1],V_mids[MAX_NODES+1];
 static int uf_dtl_main,uf_dtl_func;
 static int links_skipped;
 
@@ -161,9 +183,15 @@ static int links_skipped;
   *********************************************************/
 
 static struct d_frame *read_dfile(FILE *fp, int crit);
+#ifdef PAR_EVAL
+static rcode par_read_dfiles(FILE *fp, int n_crit, int crit_map[], struct user_frame *uframe);
+#endif
 
 static rcode read_ufile(char *fn, char *folder, struct user_frame *uframe) {
 	int i,i2;
+#ifdef PAR_EVAL
+	rcode rc;
+#endif
 	int crit_map[MAX_CRIT+1];
 	FILE *fp;
 	char fn_dmc[FOSIZE+FNSIZE+6];
@@ -204,6 +232,16 @@ static rcode read_ufile(char *fn, char *folder, struct user_frame *uframe) {
 			fclose(fp);
 			return DTL_FRAME_CORRUPT;
 			}
+#ifdef PAR_EVAL
+		for (i2=0,i=0; i<=uframe->n_crit; i++)
+			if (crit_map[i])
+				i2++;
+		if ((i2 >= MIN_PAR_LOAD) && (get_n_workers() > 1)) {
+			rc = par_read_dfiles(fp,uframe->n_crit,crit_map,uframe);
+			fclose(fp);
+			return rc;
+			}
+#endif
 		for (i=0; i<=uframe->n_crit; i++)
 			if (crit_map[i]) {
 				if (!(uframe->df_list[i] = read_dfile(fp,i))) {
@@ -229,12 +267,69 @@ static rcode read_ufile(char *fn, char *folder, struct user_frame *uframe) {
 	}
 
 
-static struct d_frame *read_dfile(FILE *fp, int crit) {
-	int i,j,n_alts,n_stmts;
+/* Reading a dfile is done in two steps. The file is parsed and the
+ * frame created, collecting all statements in a dfile record. Then the
+ * frame is loaded from the record: the P- and V-statements (incl. box
+ * entries) are added in one call per base, so that each base is loaded
+ * once, followed by the midpoints. Only the second step does any real
+ * work and it touches nothing but its own frame, so the criteria of a
+ * PM frame can be loaded in parallel (PAR_EVAL). */
+
+struct dfile_rec {
+	struct d_frame *df;
+	int n_P_stmts;
+	int n_V_stmts;
+	int n_P_mids;
+	int n_V_mids;
+	/* P, V, P-mid and V-mid rows after each other, [0] unused */
+	struct stmt_rec stmt[1];
+	};
+
+
+/* Make room for n statements in a read buffer (P or V, up to limit).
+ * The buffers are kept while a file is read and released at the end. */
+
+static bool room_stmts(struct stmt_rec **stmts, int *room, int n, int limit) {
+	int size;
+	struct stmt_rec *buf;
+
+	if (n <= *room)
+		return TRUE;
+	if (n > limit)
+		return FALSE;
+	for (size=max(2*(*room),MAX_STMTS); size<n; size*=2) ;
+	size = min(size,limit);
+	buf = (struct stmt_rec *)mem_alloc((size+1)*sizeof(struct stmt_rec),"struct stmt_rec","room_stmts");
+	if (!buf)
+		return FALSE;
+	if (*stmts) {
+		memcpy(buf+1,*stmts+1,(*room)*sizeof(struct stmt_rec));
+		mem_free((void *)*stmts);
+		}
+	*stmts = buf;
+	*room = size;
+	return TRUE;
+	}
+
+
+static void free_stmts() {
+
+	if (P_stmts)
+		mem_free((void *)P_stmts);
+	if (V_stmts)
+		mem_free((void *)V_stmts);
+	P_stmts = V_stmts = NULL;
+	max_P_stmts = max_V_stmts = 0;
+	}
+
+
+static struct dfile_rec *parse_dfile(FILE *fp, int crit) {
+	int i,j,n_alts,n_stmts,n_P_stmts,n_V_stmts,n_P_mids,n_V_mids;
 	int n_nodes[MAX_ALTS+1];
 	int multilevel;
 	struct stmt_rec stmt;
 	struct d_frame *df;
+	struct dfile_rec *dr;
 	char df_name[FNSIZE+4];
 
 	/* Frame header */
@@ -273,12 +368,8 @@ static struct d_frame *read_dfile(FILE *fp, int crit) {
 			}
 		}
 	strcpy(df->name,df_name);
-	/* Start using frame */
-	if (TCL_attach_frame(df)) {
-		TCL_dispose_frame(df);
-		return NULL;
-		}
 	/* Probability base */
+	n_P_stmts = n_V_stmts = 0;
 	fscanf(fp,"%d ",&n_stmts);
 	if (n_stmts < 0) {
 		TCL_dispose_frame(df);
@@ -297,10 +388,11 @@ static struct d_frame *read_dfile(FILE *fp, int crit) {
 					printf("Warning: MC weight statement using alt %d as carrier - ineffectual\n",stmt.alt[j]);
 #endif
 		if (stmt.n_terms == 1) {
-			if (TCL_add_P_constraint(df,&stmt)) {
+			if (!room_stmts(&P_stmts,&max_P_stmts,n_P_stmts+1,MAX_P_STMTS)) {
 				TCL_dispose_frame(df);
 				return NULL;
 				}
+			memcpy(P_stmts+(++n_P_stmts),&stmt,sizeof(struct stmt_rec));
 			}
 		else {
 #ifdef WARN_LINK
@@ -337,10 +429,11 @@ static struct d_frame *read_dfile(FILE *fp, int crit) {
 		fscanf(fp,"%lf ",&(stmt.lobo));
 		fscanf(fp,"%lf ",&(stmt.upbo));
 		if (stmt.n_terms == 1) {
-			if (TCL_add_V_constraint(df,&stmt)) {
+			if (!room_stmts(&V_stmts,&max_V_stmts,n_V_stmts+1,MAX_V_STMTS)) {
 				TCL_dispose_frame(df);
 				return NULL;
 				}
+			memcpy(V_stmts+(++n_V_stmts),&stmt,sizeof(struct stmt_rec));
 			}
 		else {
 #ifdef WARN_LINK
@@ -375,10 +468,11 @@ static struct d_frame *read_dfile(FILE *fp, int crit) {
 			if (stmt.alt[1] != 1)
 				printf("Warning: MC weight box using alt %d as carrier - ineffectual\n",stmt.alt[1]);
 #endif
-		if (TCL_add_P_constraint(df,&stmt)) {
+		if (!room_stmts(&P_stmts,&max_P_stmts,n_P_stmts+1,MAX_P_STMTS)) {
 			TCL_dispose_frame(df);
 			return NULL;
 			}
+		memcpy(P_stmts+(++n_P_stmts),&stmt,sizeof(struct stmt_rec));
 		}
 	/* Value box */
 	fscanf(fp,"%d ",&n_stmts);
@@ -400,15 +494,16 @@ static struct d_frame *read_dfile(FILE *fp, int crit) {
 		fscanf(fp,"%lf ",&(stmt.upbo));
 		stmt.n_terms = 1;
 		stmt.sign[1] = 1;
-		if (TCL_add_V_constraint(df,&stmt)) {
+		if (!room_stmts(&V_stmts,&max_V_stmts,n_V_stmts+1,MAX_V_STMTS)) {
 			TCL_dispose_frame(df);
 			return NULL;
 			}
+		memcpy(V_stmts+(++n_V_stmts),&stmt,sizeof(struct stmt_rec));
 		}
 no_box:
 	/* Probability midpoints */
 	fscanf(fp,"%d ",&n_stmts);
-	if (n_stmts < 0) {
+	if ((n_stmts < 0) || (n_stmts > MAX_NODES)) {
 		TCL_dispose_frame(df);
 		return NULL;
 		}
@@ -429,10 +524,7 @@ no_box:
 			}
 		stmt.n_terms = 1;
 		stmt.sign[1] = 1;
-		if (TCL_add_P_mstatement(df,&stmt)) {
-			TCL_dispose_frame(df);
-			return NULL;
-			}
+		memcpy(P_mids+i,&stmt,sizeof(struct stmt_rec));
 #ifdef WARN_MIDPT
 		if (stmt.upbo-stmt.lobo > DTL_EPS)
 			if (crit)
@@ -448,9 +540,10 @@ no_box:
 #endif
 #endif
 		}
+	n_P_mids = n_stmts;
 	/* Value midpoints */
 	fscanf(fp,"%d ",&n_stmts);
-	if (n_stmts < 0) {
+	if ((n_stmts < 0) || (n_stmts > MAX_NODES)) {
 		TCL_dispose_frame(df);
 		return NULL;
 		}
@@ -475,10 +568,7 @@ no_box:
 			}
 		stmt.n_terms = 1;
 		stmt.sign[1] = 1;
-		if (TCL_add_V_mstatement(df,&stmt)) {
-			TCL_dispose_frame(df);
-			return NULL;
-			}
+		memcpy(V_mids+i,&stmt,sizeof(struct stmt_rec));
 #ifdef WARN_MIDPT
 		if (stmt.upbo-stmt.lobo > DTL_EPS)
 			printf("V%d.%d.%d = [%.3lf %.3lf]  <- INTERVAL\n",crit,stmt.alt[1],stmt.cons[1],stmt.lobo,stmt.upbo);
@@ -488,14 +578,197 @@ no_box:
 #endif
 #endif
 		}
-	if (TCL_detach_frame(df)) {
+	n_V_mids = n_stmts;
+	/* Collect the statements in the dfile record */
+	dr = (struct dfile_rec *)mem_alloc(sizeof(struct dfile_rec)+
+			(n_P_stmts+n_V_stmts+n_P_mids+n_V_mids)*sizeof(struct stmt_rec),"struct dfile_rec","parse_dfile");
+	if (!dr) {
 		TCL_dispose_frame(df);
 		return NULL;
 		}
+	dr->df = df;
+	dr->n_P_stmts = n_P_stmts;
+	dr->n_V_stmts = n_V_stmts;
+	dr->n_P_mids = n_P_mids;
+	dr->n_V_mids = n_V_mids;
+	if (n_P_stmts)
+		memcpy(dr->stmt+1,P_stmts+1,n_P_stmts*sizeof(struct stmt_rec));
+	if (n_V_stmts)
+		memcpy(dr->stmt+n_P_stmts+1,V_stmts+1,n_V_stmts*sizeof(struct stmt_rec));
+	memcpy(dr->stmt+n_P_stmts+n_V_stmts+1,P_mids+1,n_P_mids*sizeof(struct stmt_rec));
+	memcpy(dr->stmt+n_P_stmts+n_V_stmts+n_P_mids+1,V_mids+1,n_V_mids*sizeof(struct stmt_rec));
+	return dr;
+	}
+
+
+/* Load the frame from the record. On failure the frame is disposed
+ * of and dr->df is NULL. Worker safe, see PAR_EVAL. */
+
+static void load_dfile(struct dfile_rec *dr) {
+	int i;
+	struct stmt_rec *stmt;
+
+	/* Start using frame */
+	if (TCL_attach_frame(dr->df))
+		goto failed;
+	/* Load the statements collected */
+	stmt = dr->stmt;
+	if (TCL_add_P_constraints(dr->df,dr->n_P_stmts,stmt))
+		goto failed;
+	stmt += dr->n_P_stmts;
+	if (TCL_add_V_constraints(dr->df,dr->n_V_stmts,stmt))
+		goto failed;
+	stmt += dr->n_V_stmts;
+	for (i=1; i<=dr->n_P_mids; i++)
+		if (TCL_add_P_mstatement(dr->df,stmt+i))
+			goto failed;
+	stmt += dr->n_P_mids;
+	for (i=1; i<=dr->n_V_mids; i++)
+		if (TCL_add_V_mstatement(dr->df,stmt+i))
+			goto failed;
+	if (TCL_detach_frame(dr->df))
+		goto failed;
+	return;
+failed:
+	TCL_dispose_frame(dr->df);
+	dr->df = NULL;
+	}
+
+
+static struct d_frame *read_dfile(FILE *fp, int crit) {
+	struct dfile_rec *dr;
+	struct d_frame *df;
+
+	if (!(dr = parse_dfile(fp,crit)))
+		return NULL;
+	load_dfile(dr);
+	df = dr->df;
+	mem_free((void *)dr);
 	return df;
 	}
 
 
+#ifdef PAR_EVAL
+
+ /*********************************************************
+  *
+  *  Parallel criteria loading
+  *
+  *  The file is parsed in order and all criterion frames are
+  *  created up front, since neither the file nor the memory
+  *  allocation can be shared. Then each worker loads its share
+  *  of the frames (the TCL scratch areas are thread-local).
+  *
+  *********************************************************/
+
+struct load_job {
+	int worker;
+	int n_workers;
+	};
+
+static struct load_job ljob[MAX_LOAD_WORKERS];
+static struct dfile_rec *load_rec[MAX_CRIT+1];
+static int n_load_rec;
+
+
+static void run_load_job(struct load_job *jp) {
+	int k;
+
+	for (k=jp->worker; k<n_load_rec; k+=jp->n_workers)
+		load_dfile(load_rec[k]);
+	}
+
+
+#ifdef _MSC_VER
+static DWORD WINAPI load_worker(LPVOID arg) {
+
+	run_load_job((struct load_job *)arg);
+	return 0;
+	}
+#else
+static void *load_worker(void *arg) {
+
+	run_load_job((struct load_job *)arg);
+	return NULL;
+	}
+#endif
+
+
+static rcode par_read_dfiles(FILE *fp, int n_crit, int crit_map[], struct user_frame *uframe) {
+	rcode rc;
+	int i,k,w,n_w;
+#ifdef _MSC_VER
+	HANDLE tid[MAX_LOAD_WORKERS];
+#else
+	pthread_t tid[MAX_LOAD_WORKERS];
+#endif
+
+	/* Parse all criteria and create their frames */
+	rc = DTL_OK;
+	n_load_rec = 0;
+	for (i=0; i<=n_crit; i++) {
+		uframe->df_list[i] = NULL;
+		if (crit_map[i])
+			if (!(load_rec[n_load_rec++] = parse_dfile(fp,i))) {
+				n_load_rec--;
+				rc = DTL_FRAME_CORRUPT;
+				break;
+				}
+		}
+	/* Fan out, the calling thread is worker 0 */
+	if (!rc) {
+		n_w = min(min(get_n_workers(),MAX_LOAD_WORKERS),n_load_rec);
+		for (w=0; w<n_w; w++) {
+			ljob[w].worker = w;
+			ljob[w].n_workers = n_w;
+			}
+		for (w=1; w<n_w; w++)
+#ifdef _MSC_VER
+			if (!(tid[w] = CreateThread(NULL,0,load_worker,&ljob[w],0,NULL)))
+#else
+			if (pthread_create(&tid[w],NULL,load_worker,&ljob[w]))
+#endif
+				ljob[w].n_workers = -1; // not started
+		run_load_job(&ljob[0]);
+		for (w=1; w<n_w; w++)
+			if (ljob[w].n_workers < 0) {
+				/* Could not start the thread, do its share here */
+				ljob[w].n_workers = n_w;
+				run_load_job(&ljob[w]);
+				}
+			else {
+#ifdef _MSC_VER
+				WaitForSingleObject(tid[w],INFINITE);
+				CloseHandle(tid[w]);
+#else
+				pthread_join(tid[w],NULL);
+#endif
+				}
+		for (k=0; k<n_load_rec; k++)
+			if (!load_rec[k]->df)
+				rc = DTL_FRAME_CORRUPT;
+		}
+	/* Link the frames in criteria order or release them all */
+	for (k=0,i=0; i<=n_crit; i++)
+		if (crit_map[i] && (k < n_load_rec)) {
+			if (rc) {
+				if (load_rec[k]->df)
+					TCL_dispose_frame(load_rec[k]->df);
+				}
+			else
+				uframe->df_list[i] = load_rec[k]->df;
+			mem_free((void *)load_rec[k++]);
+			}
+	if (cst_ext) {
+		sprintf(msg," par_read_dfiles: %d criteria, rc %d\n",n_load_rec,rc);
+		cst_log(msg);
+		}
+	return rc;
+	}
+
+#endif // PAR_EVAL
+
+
 // DTL layer 1: DTL API level
 
 static rcode dtl_read_file(int ufnbr, char *fn, char *folder, int mode) {
@@ -503,7 +776,7 @@ static rcode dtl_read_file(int ufnbr, char *fn, char *folder, int mode) {
 	struct user_frame *tmp_uf = NULL;
 
 	/* Check input parameters */
-	if ((ufnbr < 1) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 1) || !room_uf(ufnbr))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	if (!fn || !fn[0])
 		return dtl_error(DTL_NAME_MISSING);
@@ -517,7 +790,14 @@ static rcode dtl_read_file(int ufnbr, char *fn, char *folder, int mode) {
 	if (!(tmp_uf = new_uf(ufnbr))) {
 		return dtl_error(DTL_FRAME_EXISTS);
 		}
-	if (rc = read_ufile(fn,folder,tmp_uf)) {
+	rc = read_ufile(fn,folder,tmp_uf);
+	free_stmts();
+	if (rc) {
+		dispose_uf(ufnbr);
+		return dtl_error(rc);
+		}
+	/* Bring the frame up to date with its journal */
+	if (rc = dtl_replay_journal(fn,folder,tmp_uf)) {
 		dispose_uf(ufnbr);
 		return dtl_error(rc);
 		}
@@ -821,7 +1101,7 @@ static rcode write_dfile(FILE *fp, struct d_frame *df) {
 	}
 
 
-static rcode dtl_write_file(char *fn, char *folder) {
+rcode dtl_write_file(char *fn, char *folder) {
 	rcode rc;
 
 	/* Check input parameters */
@@ -839,6 +1119,8 @@ static rcode dtl_write_file(char *fn, char *folder) {
 		rollback_ufile(fn,folder);
 		return DTL_KERNEL_ERROR+rc; // context switch from TCL to DTL
 		}
+	/* The file now holds all changes */
+	dtl_reset_journal(fn,folder,uf);
 	return DTL_OK;
 	}
 
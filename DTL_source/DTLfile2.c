@@ -419,7 +419,7 @@ static rcode dtl_read_ddt_file(int ufnbr, char *fn, char *folder, int mode) {
 	struct user_frame *tmp_uf = NULL;
 
 	/* Check input parameters */
-	if ((ufnbr < 1) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 1) || !room_uf(ufnbr))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	if (!fn || !fn[0])
 		return dtl_error(DTL_NAME_MISSING);
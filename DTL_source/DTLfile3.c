@@ -0,0 +1,1310 @@
+/*
+ *
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/ 
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/  
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/          
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/          
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/   
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ *
+ *
+ *                   UNEDA Decision Tree Layer (DTL)
+ *                   -------------------------------
+ *
+ *    +----- o o o ------------------------------------------------+
+ *    |    o       o              Prof. Mats Danielson             |
+ *    |   o  STHLM  o             DECIDE Research Group            |
+ *    |   o         o    Dept. of Computer and Systems Sciences    |
+ *    |   o   UNI   o             Stockholm University             |
+ *    |    o       o      PO Box 1203, SE-164 25 Kista, SWEDEN     |
+ *    +----- o o o ------------------------------------------------+
+ *
+ *                Copyright (c) 2012-2025 Mats Danielson
+ *                     Email: mats.danielson@su.se
+ *
+ */
+
+/*
+ *   File: DTLfile3.c
+ *
+ *   Purpose: reading and writing binary .dmb frame files, the
+ *            .djl journals of .dmc frame files and spilled frames
+ *
+ *
+ *   Functions exported outside DTL
+ *   ------------------------------
+ *   DTL_read_bin_frame
+ *   DTL_write_bin_frame
+ *   DTL_journal_frame
+ *   DTL_set_frame_budget
+ *
+ *   Functions outside of module, inside DTL
+ *   ---------------------------------------
+ *   dtl_replay_journal
+ *   dtl_reset_journal
+ *   dtl_spill_frames
+ *   dtl_restore_frame
+ *   dtl_drop_spill
+ *
+ *   Functions internal to module
+ *   ----------------------------
+ *   map_file
+ *   unmap_file
+ *   sect_layout
+ *   read_bin_dfile
+ *   read_bin_ufile
+ *   dtl_read_bin_file
+ *   backup_bin_ufile
+ *   rollback_bin_ufile
+ *   write_pad
+ *   write_bin_dfile
+ *   write_bin_ufile
+ *   dtl_write_bin_file
+ *   file_name
+ *   dmc_stamp
+ *   journal_header_ok
+ *   scan_journal
+ *   open_journal
+ *   append_journal
+ *   dtl_journal_file
+ *   spill_name
+ *   uf_bytes
+ *   spill_frame
+ *
+ */
+
+#include "DTL.h"
+#include "DTLinternal.h"
+
+
+ /********************************************************
+  *
+  *  Configuration parameters
+  *
+  ********************************************************/
+
+// Map the file into memory instead of reading it into a buffer
+#define MMAP_FILE
+#ifdef _MSC_VER
+#undef MMAP_FILE
+#endif
+
+#define FOSIZE 256 // folder name size
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef MMAP_FILE
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+ /*********************************************************
+  *
+  *  File format
+  *
+  *********************************************************/
+
+ /*
+  * .dmb file format for PM, PS, DM file types
+  *
+  * The binary format holds the same frames as the .dmc text format
+  * but stores the bases as images, i.e. the statements and the box
+  * and midbox rows exactly as they are kept in the frame. Nothing is
+  * parsed on read: each section is moved into its frame in one copy
+  * and the frame is then checked for consistency when attached once.
+  * The file is native to the platform (byte order, int and double
+  * sizes, statement layout), which the header records and checks.
+  *
+  * ufile structure
+  * ---------------
+  * header (struct dmb_header)
+  * {section offset} (n_sect ints, 0=crit not present, PM: n_crit+1, else 2)
+  * {dfile section} (one per crit present incl. crit0/wt, PS/DM: one at [1])
+  *
+  * dfile section (starts at 8-byte boundary)
+  * -------------
+  * section header (struct dmb_section)
+  * {nodes} (n_alts+1 ints, [0]=total)
+  * if (multilevel)
+  *   {tnext} {tdown} (one row per alt, one number per node)
+  * <pad to 8 bytes>
+  * {p_base-stmt} (struct stmt_rec, n_P_stmts of them)
+  * {v_base-stmt} (struct stmt_rec, n_V_stmts of them)
+  * {p_base rows} (P_rows doubles: midbox, im-midbox, box, im-box)
+  * {v_base rows} (V_rows doubles: midbox, box)
+  *
+  */
+
+#define DMB_MAGIC "UNEDADMB"
+#define DMB_VERSION 1
+#define DMB_ORDER 0x01020304
+#define DMB_ALIGN(size) (((size)+7) & ~7)
+
+struct dmb_header {
+	char magic[8];
+	int version;
+	int order;
+	int layout[4]; // header, section, statement, double sizes
+	int dtl_main;
+	int dtl_func;
+	int frame_type;
+	int n_alts;
+	int n_crit;
+	int file_size;
+	char frame_name[FNSIZE+1];
+	};
+
+struct dmb_section {
+	char name[FNSIZE+6];
+	int n_alts;
+	int tree;
+	int n_nodes;
+	int n_P_stmts;
+	int n_V_stmts;
+	int P_box;
+	int V_box;
+	int P_rows;
+	int V_rows;
+	int size;
+	};
+
+/* Byte offsets within a section, derived from the counts only */
+struct dmb_layout {
+	int nodes;
+	int tree;
+	int P_stmts;
+	int V_stmts;
+	int P_rows;
+	int V_rows;
+	int size;
+	};
+
+static void sect_layout(struct dmb_section *sp, struct dmb_layout *lp) {
+
+	lp->nodes = DMB_ALIGN(sizeof(struct dmb_section));
+	lp->tree = lp->nodes+(sp->n_alts+1)*sizeof(int);
+	lp->P_stmts = DMB_ALIGN(lp->tree+(sp->tree?2*sp->n_nodes*sizeof(int):0));
+	lp->V_stmts = lp->P_stmts+sp->n_P_stmts*sizeof(struct stmt_rec);
+	lp->P_rows = DMB_ALIGN(lp->V_stmts+sp->n_V_stmts*sizeof(struct stmt_rec));
+	lp->V_rows = lp->P_rows+sp->P_rows*sizeof(double);
+	lp->size = DMB_ALIGN(lp->V_rows+sp->V_rows*sizeof(double));
+	}
+
+
+static void set_layout(int layout[]) {
+
+	layout[0] = sizeof(struct dmb_header);
+	layout[1] = sizeof(struct dmb_section);
+	layout[2] = sizeof(struct stmt_rec);
+	layout[3] = sizeof(double);
+	}
+
+
+ /********************************************************
+  *
+  *  Internal data
+  *
+  ********************************************************/
+
+static t_matrix tnext,tdown;
+
+
+ /*********************************************************
+  *
+  *  File image in memory
+  *
+  *********************************************************/
+
+/* Make the whole file addressable, either mapped or read in one go */
+
+static char *map_file(char *fn, size_t min_size, size_t *size) {
+	char *image;
+#ifdef MMAP_FILE
+	int fd;
+	struct stat st;
+
+	fd = open(fn,O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd,&st) || (st.st_size < (off_t)min_size)) {
+		close(fd);
+		return NULL;
+		}
+	*size = (size_t)st.st_size;
+	image = (char *)mmap(NULL,*size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if (image == (char *)MAP_FAILED)
+		return NULL;
+#else
+	long fsize;
+	FILE *fp;
+
+	fp = fopen(fn,"rb");
+	if (!fp)
+		return NULL;
+	fseek(fp,0L,SEEK_END);
+	fsize = ftell(fp);
+	fseek(fp,0L,SEEK_SET);
+	if (fsize < (long)min_size) {
+		fclose(fp);
+		return NULL;
+		}
+	*size = (size_t)fsize;
+	image = (char *)mem_alloc(*size,"char","map_file");
+	if (image)
+		if (fread(image,1,*size,fp) != *size) {
+			mem_free((void *)image);
+			image = NULL;
+			}
+	fclose(fp);
+#endif
+	return image;
+	}
+
+
+static void unmap_file(char *image, size_t size) {
+
+#ifdef MMAP_FILE
+	munmap(image,size);
+#else
+	mem_free((void *)image);
+#endif
+	}
+
+
+ /*********************************************************
+  *
+  *  Read user frame from binary file
+  *
+  *********************************************************/
+
+static struct d_frame *read_bin_dfile(char *image, size_t size, int offset, int n_alts, int crit) {
+	int i,j,k;
+	int n_nodes[MAX_ALTS+1],*nodes,*tree;
+	struct dmb_section *sp;
+	struct dmb_layout lay;
+	struct d_frame *df;
+
+	/* Section header */
+	if ((offset < 0) || (offset & 7))
+		return NULL;
+	if ((size_t)offset+sizeof(struct dmb_section) > size)
+		return NULL;
+	sp = (struct dmb_section *)(image+offset);
+	if ((sp->n_alts < 2) || (sp->n_alts > n_alts))
+		return NULL;
+	if ((sp->n_P_stmts < 0) || (sp->n_P_stmts > MAX_P_STMTS) || 
+			(sp->n_V_stmts < 0) || (sp->n_V_stmts > MAX_V_STMTS))
+		return NULL;
+	if ((sp->n_nodes < 1) || (sp->n_nodes > MAX_CONS))
+		return NULL;
+	if ((sp->P_rows != 8*(sp->n_nodes+1)) || (sp->V_rows != 4*(sp->n_nodes+1)))
+		return NULL;
+	if (sp->name[FNSIZE+5])
+		return NULL;
+	sect_layout(sp,&lay);
+	if ((sp->size != lay.size) || ((size_t)offset+lay.size > size))
+		return NULL;
+	/* Check node counts */
+	nodes = (int *)(image+offset+lay.nodes);
+	for (k=0,i=1; i<=sp->n_alts; i++) {
+		n_nodes[i] = nodes[i];
+		if (n_nodes[i] < 1)
+			return NULL;
+		if (sp->tree && (n_nodes[i] > MAX_NOPA))
+			return NULL;
+		k += n_nodes[i];
+		}
+	if (k != sp->n_nodes)
+		return NULL;
+	/* Check correct node count for MC */
+	if (!crit)
+		for (i=2; i<=sp->n_alts; i++)
+			if (n_nodes[i] != 1)
+				return NULL;
+	/* Create frame */
+	if (sp->tree) {
+		tree = (int *)(image+offset+lay.tree);
+		for (i=1; i<=sp->n_alts; i++) {
+			for (j=1; j<=n_nodes[i]; j++)
+				tnext[i][j] = *tree++;
+			for (j=1; j<=n_nodes[i]; j++)
+				tdown[i][j] = *tree++;
+			}
+		if (TCL_create_tree_frame(&df,sp->n_alts,n_nodes,tnext,tdown))
+			return NULL;
+		}
+	else {
+		if (TCL_create_flat_frame(&df,sp->n_alts,n_nodes))
+			return NULL;
+		}
+	strcpy(df->name,sp->name);
+	/* Move the base images into the frame */
+	if (TCL_set_base_image(df,FALSE,sp->n_P_stmts,(struct stmt_rec *)(image+offset+lay.P_stmts),
+			sp->P_box,(double *)(image+offset+lay.P_rows),sp->P_rows)) {
+		TCL_dispose_frame(df);
+		return NULL;
+		}
+	if (TCL_set_base_image(df,TRUE,sp->n_V_stmts,(struct stmt_rec *)(image+offset+lay.V_stmts),
+			sp->V_box,(double *)(image+offset+lay.V_rows),sp->V_rows)) {
+		TCL_dispose_frame(df);
+		return NULL;
+		}
+	/* Load once for consistency, the frame stays warm */
+	if (TCL_attach_frame(df)) {
+		TCL_dispose_frame(df);
+		return NULL;
+		}
+	if (TCL_detach_frame(df)) {
+		TCL_dispose_frame(df);
+		return NULL;
+		}
+	return df;
+	}
+
+
+static rcode read_bin_ufile(char *fn, char *folder, struct user_frame *uframe) {
+	rcode rc;
+	int i,i2,n_sect,first,*offset,layout[4];
+	size_t size;
+	char *image;
+	struct dmb_header *hp;
+	char fn_dmb[FOSIZE+FNSIZE+6];
+
+	/* Check input parameters */
+	strcpy(fn_dmb,folder);
+	strcat(fn_dmb,fn);
+	strcat(fn_dmb,".dmb");
+	if (!(image = map_file(fn_dmb,sizeof(struct dmb_header),&size)))
+		return DTL_FILE_UNKNOWN;
+	/* User frame header */
+	rc = DTL_FRAME_CORRUPT;
+	hp = (struct dmb_header *)image;
+	set_layout(layout);
+	if (memcmp(hp->magic,DMB_MAGIC,8) || (hp->version != DMB_VERSION) || (hp->order != DMB_ORDER))
+		goto done;
+	if (memcmp(hp->layout,layout,sizeof(layout)) || ((size_t)hp->file_size != size))
+		goto done;
+	if (hp->frame_name[FNSIZE])
+		goto done;
+	if ((hp->frame_type != PS_FRAME) && (hp->frame_type != DM_FRAME) && (hp->frame_type != PM_FRAME))
+		goto done;
+	if ((hp->n_alts < 2) || (hp->n_alts > MAX_ALTS)) {
+		rc = DTL_ALT_OVERFLOW;
+		goto done;
+		}
+	if ((hp->n_crit < 1) || (hp->n_crit > MAX_CRIT)) {
+		rc = DTL_CRIT_OVERFLOW;
+		goto done;
+		}
+	if ((hp->frame_type == PS_FRAME) && (hp->n_crit != 1))
+		goto done;
+	n_sect = (hp->frame_type == PM_FRAME)?hp->n_crit+1:2;
+	if (sizeof(struct dmb_header)+n_sect*sizeof(int) > size)
+		goto done;
+	offset = (int *)(image+sizeof(struct dmb_header));
+	first = DMB_ALIGN(sizeof(struct dmb_header)+n_sect*sizeof(int));
+	for (i=0; i<n_sect; i++)
+		if (offset[i] && (offset[i] < first))
+			goto done;
+	strcpy(uframe->frame_name,hp->frame_name);
+	uframe->frame_type = hp->frame_type;
+	uframe->n_alts = hp->n_alts;
+	uframe->n_crit = hp->n_crit;
+	uframe->n_sh = 1;
+	if (hp->frame_type == PM_FRAME) {
+		if (!offset[0]) // must have MC frame
+			goto done;
+		for (i=0; i<=hp->n_crit; i++)
+			if (offset[i]) {
+				if (!(uframe->df_list[i] = read_bin_dfile(image,size,offset[i],hp->n_alts,i))) {
+					// Release what's been collected
+					for (i2=0; i2<i; i2++)
+						if (offset[i2])
+							TCL_dispose_frame(uframe->df_list[i2]);
+					goto done;
+					}
+				}
+			else
+				uframe->df_list[i] = NULL;
+		}
+	else { // PS,DM
+		if (!offset[1])
+			goto done;
+		if (!(uframe->df = read_bin_dfile(image,size,offset[1],hp->n_alts,1)))
+			goto done;
+		}
+	rc = DTL_OK;
+done:
+	unmap_file(image,size);
+	return rc;
+	}
+
+
+// DTL layer 1: DTL API level
+
+static rcode dtl_read_bin_file(int ufnbr, char *fn, char *folder, int mode) {
+	rcode rc;
+	struct user_frame *tmp_uf = NULL;
+
+	/* Check input parameters */
+	if ((ufnbr < 1) || !room_uf(ufnbr))
+		return dtl_error(DTL_FRAME_UNKNOWN);
+	if (!fn || !fn[0])
+		return dtl_error(DTL_NAME_MISSING);
+	if (!folder) // empty folder allowed
+		return dtl_error(DTL_NAME_MISSING);
+	if (strlen(fn) > FNSIZE)
+		return dtl_error(DTL_NAME_TOO_LONG);
+	if (strlen(folder) > FOSIZE)
+		return dtl_error(DTL_NAME_TOO_LONG);
+	/* Allocate new user frame */
+	if (!(tmp_uf = new_uf(ufnbr))) {
+		return dtl_error(DTL_FRAME_EXISTS);
+		}
+	if (rc = read_bin_ufile(fn,folder,tmp_uf)) {
+		dispose_uf(ufnbr);
+		return dtl_error(rc);
+		}
+	if (mode)
+		strcpy(tmp_uf->frame_name,fn);
+	tmp_uf->frame_nbr = ufnbr;
+	return DTL_OK;
+	}
+
+
+rcode DTLAPI DTL_read_bin_frame(int ufnbr, char *fn, char *folder, int mode) {
+	rcode rc;
+
+	/* Begin single thread semaphore */
+	_smx_begin("FRBIN");
+	/* Log function call */
+	if (cst_on) {
+		if (fn && fn[0]) // does not log folder name
+			sprintf(msg,"DTL_read_bin_frame(%d,%.40s.dmb,%d)\n",ufnbr,fn,mode);
+		else
+			sprintf(msg,"DTL_read_bin_frame(%d,_,%d)\n",ufnbr,mode);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(fn,1);
+	_certify_ptr(folder,2);
+	if (!dtl_is_init())
+		return dtl_error(DTL_STATE_ERROR);
+	if (frame_loaded)
+		return dtl_error(DTL_FRAME_IN_USE);
+	/* Read file */
+	rc = dtl_read_bin_file(ufnbr,fn,folder,mode);
+	/* End single thread semaphore */
+	_smx_end();
+	return rc;
+	}
+
+
+ /*********************************************************
+  *
+  *  Write user frame to binary file
+  *
+  *********************************************************/
+
+/* Backup a user file if it does exist */
+
+static rcode backup_bin_ufile(char *fn, char *folder) {
+	char fn_dmb[FOSIZE+FNSIZE+6],fn_bkp[FOSIZE+FNSIZE+6];
+
+	strcpy(fn_dmb,folder);
+	strcat(fn_dmb,fn);
+	strcat(fn_dmb,".dmb");
+	strcpy(fn_bkp,folder);
+	strcat(fn_bkp,fn);
+	strcat(fn_bkp,".dbb");
+	remove(fn_bkp);
+	if (rename(fn_dmb,fn_bkp))
+		return DTL_FILE_UNKNOWN;
+	return DTL_OK;
+	}
+
+
+static void rollback_bin_ufile(char *fn, char *folder) {
+	char fn_dmb[FOSIZE+FNSIZE+6];
+
+	strcpy(fn_dmb,folder);
+	strcat(fn_dmb,fn);
+	strcat(fn_dmb,".dmb");
+	remove(fn_dmb);
+	}
+
+
+static rcode write_pad(FILE *fp, long pos) {
+	static char zero[8];
+
+	if (DMB_ALIGN(pos) > pos)
+		if (fwrite(zero,1,DMB_ALIGN(pos)-pos,fp) != (size_t)(DMB_ALIGN(pos)-pos))
+			return DTL_FILE_UNKNOWN;
+	return DTL_OK;
+	}
+
+
+/* Fill in the section header, and if fp is set write the section */
+
+static rcode write_bin_dfile(FILE *fp, struct d_frame *df, struct dmb_section *sp) {
+	rcode rc;
+	int i;
+	struct base *P,*V;
+	double *P_rows,*V_rows;
+	struct dmb_layout lay;
+
+	if (rc = TCL_get_base_image(df,FALSE,&P,&P_rows,&(sp->P_rows)))
+		return DTL_KERNEL_ERROR+rc;
+	if (rc = TCL_get_base_image(df,TRUE,&V,&V_rows,&(sp->V_rows)))
+		return DTL_KERNEL_ERROR+rc;
+	memset(sp->name,0,sizeof(sp->name));
+	strcpy(sp->name,df->name);
+	sp->n_alts = df->n_alts;
+	sp->tree = df->tree;
+	sp->n_nodes = df->tot_cons[0];
+	sp->n_P_stmts = P->n_stmts;
+	sp->n_V_stmts = V->n_stmts;
+	sp->P_box = P->box;
+	sp->V_box = V->box;
+	sect_layout(sp,&lay);
+	sp->size = lay.size;
+	if (!fp)
+		return DTL_OK;
+
+	/* Section header and nodes */
+	if (fwrite(sp,sizeof(struct dmb_section),1,fp) != 1)
+		return DTL_FILE_UNKNOWN;
+	if (rc = write_pad(fp,sizeof(struct dmb_section)))
+		return rc;
+	if (fwrite(df->tot_cons,sizeof(int),df->n_alts+1,fp) != (size_t)df->n_alts+1)
+		return DTL_FILE_UNKNOWN;
+	/* Tree description */
+	if (df->tree)
+		for (i=1; i<=df->n_alts; i++) {
+			if (fwrite(df->next[i]+1,sizeof(int),df->tot_cons[i],fp) != (size_t)df->tot_cons[i])
+				return DTL_FILE_UNKNOWN;
+			if (fwrite(df->down[i]+1,sizeof(int),df->tot_cons[i],fp) != (size_t)df->tot_cons[i])
+				return DTL_FILE_UNKNOWN;
+			}
+	if (rc = write_pad(fp,lay.tree+(df->tree?2*sp->n_nodes*sizeof(int):0)))
+		return rc;
+	/* Base images */
+	if (fwrite(P->stmt+1,sizeof(struct stmt_rec),P->n_stmts,fp) != (size_t)P->n_stmts)
+		return DTL_FILE_UNKNOWN;
+	if (fwrite(V->stmt+1,sizeof(struct stmt_rec),V->n_stmts,fp) != (size_t)V->n_stmts)
+		return DTL_FILE_UNKNOWN;
+	if (rc = write_pad(fp,lay.V_stmts+V->n_stmts*sizeof(struct stmt_rec)))
+		return rc;
+	if (fwrite(P_rows,sizeof(double),sp->P_rows,fp) != (size_t)sp->P_rows)
+		return DTL_FILE_UNKNOWN;
+	if (fwrite(V_rows,sizeof(double),sp->V_rows,fp) != (size_t)sp->V_rows)
+		return DTL_FILE_UNKNOWN;
+	return DTL_OK;
+	}
+
+
+static rcode write_bin_ufile(char *fn, char *folder) {
+	rcode rc;
+	int i,n_sect,pos;
+	int offset[MAX_CRIT+1];
+	FILE *fp;
+	struct d_frame *df;
+	struct dmb_header hdr;
+	struct dmb_section sect;
+	char fn_dmb[FOSIZE+FNSIZE+6];
+
+	/* Lay out the file before writing it */
+	memset(&hdr,0,sizeof(hdr));
+	memcpy(hdr.magic,DMB_MAGIC,8);
+	hdr.version = DMB_VERSION;
+	hdr.order = DMB_ORDER;
+	set_layout(hdr.layout);
+	hdr.dtl_main = DTL_MAIN;
+	hdr.dtl_func = DTL_FUNC;
+	hdr.frame_type = uf->frame_type;
+	hdr.n_alts = uf->n_alts;
+	hdr.n_crit = uf->n_crit;
+	strcpy(hdr.frame_name,uf->frame_name);
+	n_sect = PM?uf->n_crit+1:2;
+	pos = DMB_ALIGN(sizeof(struct dmb_header)+n_sect*sizeof(int));
+	for (i=0; i<n_sect; i++) {
+		df = PM?uf->df_list[i]:(i?uf->df:NULL);
+		offset[i] = 0;
+		if (df) {
+			if (rc = write_bin_dfile(NULL,df,&sect))
+				return rc;
+			offset[i] = pos;
+			pos += sect.size;
+			}
+		}
+	hdr.file_size = pos;
+
+	backup_bin_ufile(fn,folder);
+	strcpy(fn_dmb,folder);
+	strcat(fn_dmb,fn);
+	strcat(fn_dmb,".dmb");
+	fp = fopen(fn_dmb,"wb");
+	if (!fp)
+		return DTL_FILE_UNKNOWN;
+	/* User frame header */
+	rc = DTL_FILE_UNKNOWN;
+	if (fwrite(&hdr,sizeof(hdr),1,fp) != 1)
+		goto done;
+	if (fwrite(offset,sizeof(int),n_sect,fp) != (size_t)n_sect)
+		goto done;
+	if (rc = write_pad(fp,sizeof(hdr)+n_sect*sizeof(int)))
+		goto done;
+	/* Sections in offset order */
+	for (i=0; i<n_sect; i++)
+		if (offset[i]) {
+			df = PM?uf->df_list[i]:uf->df;
+			if (cst_ext) {
+				sprintf(msg," writing section %d...\n",i);
+				cst_log(msg);
+				}
+			if (rc = write_bin_dfile(fp,df,&sect))
+				goto done;
+			}
+	rc = DTL_OK;
+done:
+	if (fclose(fp) && !rc)
+		rc = DTL_FILE_UNKNOWN;
+	return rc;
+	}
+
+
+static rcode dtl_write_bin_file(char *fn, char *folder) {
+	rcode rc;
+
+	/* Check input parameters */
+	if (!fn || !fn[0])
+		return DTL_NAME_MISSING;
+	if (!folder || !folder[0])
+		return DTL_NAME_MISSING;
+	if (strlen(fn) > FNSIZE)
+		return DTL_NAME_TOO_LONG;
+	if (strlen(folder) > FOSIZE)
+		return DTL_NAME_TOO_LONG;
+	/* Write file */
+	if (rc = write_bin_ufile(fn,folder)) {
+		/* Not a proper file created */
+		rollback_bin_ufile(fn,folder);
+		return rc;
+		}
+	return DTL_OK;
+	}
+
+
+/* Same frame types and contents as DTL_write_frame, see there */
+
+rcode DTLAPI DTL_write_bin_frame(char *fn, char *folder) {
+	rcode rc;
+
+	/* Begin single thread semaphore */
+	_smx_begin("FWBIN");
+	/* Log function call */
+	if (cst_on) {
+		if (fn && fn[0] && folder && folder[0])
+			sprintf(msg,"DTL_write_bin_frame(%.40s,%.20s)\n",fn,folder);
+		else
+			sprintf(msg,"DTL_write_bin_frame(_,_)\n");
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(fn,1);
+	_certify_ptr(folder,2);
+	if (!dtl_is_init())
+		return dtl_error(DTL_STATE_ERROR);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	/* Write file */
+	rc = dtl_write_bin_file(fn,folder);
+	/* End single thread semaphore */
+	_smx_end();
+	return rc;
+	}
+
+
+ /*********************************************************
+  *
+  *  Journal of a .dmc file
+  *
+  *********************************************************/
+
+ /*
+  * .djl journal format for PM, PS, DM file types
+  *
+  * The journal holds the changes made to a frame since its .dmc file
+  * was last read or written, so that saving a few changes does not
+  * rewrite the whole text file. The unit of change is the base: the
+  * statement and box calls mark the criterion they modify and a save
+  * appends the image of each marked criterion as a .dmb section, or
+  * an empty record for a criterion that has been removed. Each save
+  * is one batch closed by a commit record, and a batch without its
+  * commit (an interrupted save) is ignored. Reading the .dmc file
+  * replays the journal by replacing each criterion with its latest
+  * committed image. The journal belongs to the .dmc file with the
+  * size and time in its header and is dropped each time the .dmc
+  * file is written in full, which is also how it is compacted once
+  * it has grown larger than the .dmc file itself.
+  *
+  * journal structure
+  * -----------------
+  * header (struct djl_header)
+  * <pad to 8 bytes>
+  * {record} (struct djl_record, then a dfile section of size bytes)
+  *
+  */
+
+#define DJL_MAGIC "UNEDADJL"
+#define DJL_VERSION 1
+#define DJL_MARK 0x4A524543
+#define DJL_COMMIT -1
+#define DJL_START DMB_ALIGN(sizeof(struct djl_header))
+
+struct djl_header {
+	char magic[8];
+	int version;
+	int order;
+	int layout[4]; // as for .dmb
+	int frame_type;
+	int n_alts;
+	int n_crit;
+	long dmc_size;
+	long dmc_time;
+	};
+
+struct djl_record {
+	int mark;
+	int crit; // section index as for .dmb, DJL_COMMIT ends batch
+	int size; // 0=crit removed
+	int pad;
+	};
+
+
+static void file_name(char *path, char *fn, char *folder, char *ext) {
+
+	strcpy(path,folder);
+	strcat(path,fn);
+	strcat(path,ext);
+	}
+
+
+/* Identity of the .dmc file that a journal belongs to */
+
+static bool dmc_stamp(char *fn, char *folder, long *dmc_size, long *dmc_time) {
+	struct stat st;
+	char fn_dmc[FOSIZE+FNSIZE+6];
+
+	file_name(fn_dmc,fn,folder,".dmc");
+	if (stat(fn_dmc,&st))
+		return FALSE;
+	*dmc_size = (long)st.st_size;
+	*dmc_time = (long)st.st_mtime;
+	return TRUE;
+	}
+
+
+static bool journal_header_ok(struct djl_header *hp, struct user_frame *uframe) {
+	int layout[4];
+
+	set_layout(layout);
+	if (memcmp(hp->magic,DJL_MAGIC,8) || (hp->version != DJL_VERSION) || (hp->order != DMB_ORDER))
+		return FALSE;
+	if (memcmp(hp->layout,layout,sizeof(layout)))
+		return FALSE;
+	if ((hp->frame_type != uframe->frame_type) || (hp->n_alts != uframe->n_alts) || 
+			(hp->n_crit != uframe->n_crit))
+		return FALSE;
+	if ((hp->dmc_size != uframe->jnl_size) || (hp->dmc_time != uframe->jnl_time))
+		return FALSE;
+	return TRUE;
+	}
+
+
+/* Find the latest committed image of each section (-1=none, 0=removed)
+ * and return the end of the last committed batch */
+
+static int scan_journal(char *image, size_t size, int n_sect, int last[]) {
+	int i,pos,end;
+	int batch[MAX_CRIT+1];
+	struct djl_record *rp;
+
+	for (i=0; i<n_sect; i++) {
+		last[i] = -1;
+		batch[i] = -1;
+		}
+	pos = end = DJL_START;
+	while ((size_t)pos+sizeof(struct djl_record) <= size) {
+		rp = (struct djl_record *)(image+pos);
+		if (rp->mark != DJL_MARK)
+			break;
+		pos += sizeof(struct djl_record);
+		if (rp->crit == DJL_COMMIT) {
+			for (i=0; i<n_sect; i++)
+				if (batch[i] >= 0) {
+					last[i] = batch[i];
+					batch[i] = -1;
+					}
+			end = pos;
+			continue;
+			}
+		if ((rp->crit < 0) || (rp->crit >= n_sect) || (rp->size < 0) || (rp->size & 7))
+			break;
+		if ((size_t)pos+rp->size > size)
+			break;
+		batch[rp->crit] = rp->size?pos:0;
+		pos += rp->size;
+		}
+	return end;
+	}
+
+
+/* Replace the crits just read from the .dmc file by their journal
+ * images. A journal written for another version of the file is not
+ * applied. */
+
+rcode dtl_replay_journal(char *fn, char *folder, struct user_frame *uframe) {
+	int i,i2,n_sect,end,n_replayed;
+	int last[MAX_CRIT+1];
+	bool pm;
+	size_t size;
+	char *image;
+	struct d_frame *df_new[MAX_CRIT+1];
+	char fn_djl[FOSIZE+FNSIZE+6];
+
+	for (i=0; i<=MAX_CRIT; i++)
+		uframe->jnl_dirty[i] = FALSE;
+	if (!dmc_stamp(fn,folder,&(uframe->jnl_size),&(uframe->jnl_time))) {
+		uframe->jnl_size = -1L;
+		return DTL_OK;
+		}
+	file_name(fn_djl,fn,folder,".djl");
+	if (!(image = map_file(fn_djl,DJL_START,&size)))
+		return DTL_OK; // no journal
+	if (!journal_header_ok((struct djl_header *)image,uframe)) {
+		if (cst_ext)
+			cst_log(" journal ignored - stale\n");
+		unmap_file(image,size);
+		return DTL_OK;
+		}
+	pm = (uframe->frame_type == PM_FRAME);
+	n_sect = pm?uframe->n_crit+1:2;
+	end = scan_journal(image,size,n_sect,last);
+	/* MC frame must remain, PS and DM have only one section */
+	if ((pm && !last[0]) || (!pm && ((last[0] >= 0) || !last[1]))) {
+		unmap_file(image,size);
+		return DTL_FRAME_CORRUPT;
+		}
+	/* Create all frames before replacing any */
+	for (i=0; i<n_sect; i++) {
+		df_new[i] = NULL;
+		if (last[i] > 0)
+			if (!(df_new[i] = read_bin_dfile(image,size,last[i],uframe->n_alts,pm?i:1))) {
+				// Release what's been collected
+				for (i2=0; i2<i; i2++)
+					if (df_new[i2])
+						TCL_dispose_frame(df_new[i2]);
+				unmap_file(image,size);
+				return DTL_FRAME_CORRUPT;
+				}
+		}
+	unmap_file(image,size);
+	for (n_replayed=0,i=0; i<n_sect; i++)
+		if (last[i] >= 0) {
+			if (pm) {
+				if (uframe->df_list[i])
+					TCL_dispose_frame(uframe->df_list[i]);
+				uframe->df_list[i] = df_new[i];
+				}
+			else {
+				TCL_dispose_frame(uframe->df);
+				uframe->df = df_new[i];
+				}
+			n_replayed++;
+			}
+	/* An interrupted batch cannot be appended to, next save in full */
+	if ((size_t)end < size)
+		uframe->jnl_size = -1L;
+	if (cst_ext) {
+		sprintf(msg," journal replayed: %d crit%s\n",n_replayed,n_replayed==1?"":"s");
+		cst_log(msg);
+		}
+	return DTL_OK;
+	}
+
+
+/* The .dmc file has been written in full, start over without journal */
+
+void dtl_reset_journal(char *fn, char *folder, struct user_frame *uframe) {
+	int i;
+	char fn_djl[FOSIZE+FNSIZE+6];
+
+	file_name(fn_djl,fn,folder,".djl");
+	remove(fn_djl);
+	if (!dmc_stamp(fn,folder,&(uframe->jnl_size),&(uframe->jnl_time)))
+		uframe->jnl_size = -1L;
+	for (i=0; i<=MAX_CRIT; i++)
+		uframe->jnl_dirty[i] = FALSE;
+	}
+
+
+/* Open the journal for a new batch, replacing a stale journal */
+
+static FILE *open_journal(char *fn, char *folder) {
+	FILE *fp;
+	struct djl_header hdr;
+	char fn_djl[FOSIZE+FNSIZE+6];
+
+	file_name(fn_djl,fn,folder,".djl");
+	if (fp = fopen(fn_djl,"rb")) {
+		if ((fread(&hdr,sizeof(hdr),1,fp) == 1) && journal_header_ok(&hdr,uf)) {
+			fclose(fp);
+			return fopen(fn_djl,"ab");
+			}
+		fclose(fp);
+		}
+	if (!(fp = fopen(fn_djl,"wb")))
+		return NULL;
+	memset(&hdr,0,sizeof(hdr));
+	memcpy(hdr.magic,DJL_MAGIC,8);
+	hdr.version = DJL_VERSION;
+	hdr.order = DMB_ORDER;
+	set_layout(hdr.layout);
+	hdr.frame_type = uf->frame_type;
+	hdr.n_alts = uf->n_alts;
+	hdr.n_crit = uf->n_crit;
+	hdr.dmc_size = uf->jnl_size;
+	hdr.dmc_time = uf->jnl_time;
+	if ((fwrite(&hdr,sizeof(hdr),1,fp) != 1) || write_pad(fp,sizeof(hdr))) {
+		fclose(fp);
+		return NULL;
+		}
+	return fp;
+	}
+
+
+/* Append one batch with the modified crits, returns journal size */
+
+static rcode append_journal(char *fn, char *folder, long *jnl_end) {
+	rcode rc;
+	int i,n_sect;
+	bool dirty,any;
+	FILE *fp;
+	struct d_frame *df;
+	struct djl_record rec;
+	struct dmb_section sect;
+
+	if (!(fp = open_journal(fn,folder)))
+		return DTL_FILE_UNKNOWN;
+	memset(&rec,0,sizeof(rec));
+	rec.mark = DJL_MARK;
+	n_sect = PM?uf->n_crit+1:2;
+	for (any=FALSE,i=0; i<=uf->n_crit; i++)
+		any |= uf->jnl_dirty[i];
+	for (i=0; i<n_sect; i++) {
+		// PS,DM: any crit marks the frame
+		dirty = PM?uf->jnl_dirty[i]:(i && any);
+		if (!dirty)
+			continue;
+		df = PM?uf->df_list[i]:uf->df;
+		rec.crit = i;
+		rec.size = 0;
+		if (df) {
+			if (rc = write_bin_dfile(NULL,df,&sect))
+				goto done;
+			rec.size = sect.size;
+			}
+		if (cst_ext) {
+			sprintf(msg," journaling section %d...\n",i);
+			cst_log(msg);
+			}
+		rc = DTL_FILE_UNKNOWN;
+		if (fwrite(&rec,sizeof(rec),1,fp) != 1)
+			goto done;
+		if (df)
+			if (rc = write_bin_dfile(fp,df,&sect))
+				goto done;
+		}
+	/* Close the batch */
+	rc = DTL_FILE_UNKNOWN;
+	rec.crit = DJL_COMMIT;
+	rec.size = 0;
+	if (fwrite(&rec,sizeof(rec),1,fp) != 1)
+		goto done;
+	if (fflush(fp))
+		goto done;
+	*jnl_end = ftell(fp);
+	rc = DTL_OK;
+done:
+	if (fclose(fp) && !rc)
+		rc = DTL_FILE_UNKNOWN;
+	return rc;
+	}
+
+
+static rcode dtl_journal_file(char *fn, char *folder) {
+	int i;
+	bool dirty;
+	long dmc_size,dmc_time,jnl_end;
+
+	/* Check input parameters */
+	if (!fn || !fn[0])
+		return DTL_NAME_MISSING;
+	if (!folder || !folder[0])
+		return DTL_NAME_MISSING;
+	if (strlen(fn) > FNSIZE)
+		return DTL_NAME_TOO_LONG;
+	if (strlen(folder) > FOSIZE)
+		return DTL_NAME_TOO_LONG;
+	/* Journal only onto the .dmc file last read or written */
+	if (!dmc_stamp(fn,folder,&dmc_size,&dmc_time) || 
+			(dmc_size != uf->jnl_size) || (dmc_time != uf->jnl_time))
+		return dtl_write_file(fn,folder);
+	for (dirty=FALSE,i=0; i<=uf->n_crit; i++)
+		dirty |= uf->jnl_dirty[i];
+	if (!dirty)
+		return DTL_OK;
+	/* An unfinished batch must not be followed by others */
+	if (append_journal(fn,folder,&jnl_end))
+		return dtl_write_file(fn,folder);
+	for (i=0; i<=uf->n_crit; i++)
+		uf->jnl_dirty[i] = FALSE;
+	/* Compact when the journal outgrows the file */
+	if (jnl_end > dmc_size)
+		return dtl_write_file(fn,folder);
+	return DTL_OK;
+	}
+
+
+/* Saves the changes since the frame was last read from or written to
+ * the .dmc file fn by appending them to its journal. Any other file
+ * or a journal larger than the file is written in full instead, see
+ * DTL_write_frame. DTL_read_frame applies the journal. */
+
+rcode DTLAPI DTL_journal_frame(char *fn, char *folder) {
+	rcode rc;
+
+	/* Begin single thread semaphore */
+	_smx_begin("FJNL");
+	/* Log function call */
+	if (cst_on) {
+		if (fn && fn[0] && folder && folder[0])
+			sprintf(msg,"DTL_journal_frame(%.40s,%.20s)\n",fn,folder);
+		else
+			sprintf(msg,"DTL_journal_frame(_,_)\n");
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(fn,1);
+	_certify_ptr(folder,2);
+	if (!dtl_is_init())
+		return dtl_error(DTL_STATE_ERROR);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	/* Write journal */
+	rc = dtl_journal_file(fn,folder);
+	/* End single thread semaphore */
+	_smx_end();
+	return rc;
+	}
+
+
+ /*********************************************************
+  *
+  *  Spilling of cold frames
+  *
+  *********************************************************/
+
+ /*
+  * The resident frames can be kept within a memory budget. When they
+  * exceed it, the least recently used frames are written in the binary
+  * format to the spill folder and their TCL frames are released. The
+  * user frame stays registered under its number and a spilled frame is
+  * read back as soon as it is used again, e.g. by DTL_load_frame. The
+  * loaded frames (in any session), SM frames with shared criteria and
+  * frames sharing bases with a fork are never spilled.
+  */
+
+static long spill_budget = 0L; // bytes, 0 = no spilling
+static char spill_folder[FOSIZE+1] = "";
+
+
+static void spill_name(char *fn, int ufnbr) {
+
+	sprintf(fn,"uf%03d",ufnbr);
+	}
+
+
+/* Bytes held by the TCL frames of a user frame. Cold if they
+ * can be released by spilling, i.e. nothing else refers to them. */
+
+static long uf_bytes(struct user_frame *uframe, bool *cold) {
+	int i,n_df;
+	long bytes;
+	struct d_frame *df;
+
+	bytes = 0L;
+	*cold = (uframe->n_sh == 1) && (uframe->frame_type != ANY_FRAME);
+	n_df = (uframe->frame_type == PM_FRAME)?uframe->n_crit/uframe->n_sh:0;
+	for (i=0; i<=n_df; i++) {
+		df = (uframe->frame_type == PM_FRAME)?uframe->df_list[i]:uframe->df;
+		if (df) {
+			bytes += (long)(df->arena_end-(char *)df);
+			if ((df->P_base->n_users > 1) || (df->V_base->n_users > 1))
+				*cold = FALSE;
+			}
+		}
+	if (!bytes)
+		*cold = FALSE;
+	return bytes;
+	}
+
+
+static rcode spill_frame(int ufnbr) {
+	rcode rc;
+	int i,n_df;
+	struct user_frame *save_uf;
+	char fn[FNSIZE+1];
+
+	/* The writer works on the current frame */
+	save_uf = uf;
+	uf = uf_list[ufnbr];
+	spill_name(fn,ufnbr);
+	if (rc = dtl_write_bin_file(fn,spill_folder)) {
+		uf = save_uf;
+		return rc;
+		}
+	/* Release the TCL frames */
+	n_df = PM?uf->n_crit:0;
+	for (i=0; i<=n_df; i++)
+		if (PM) {
+			if (uf->df_list[i])
+				TCL_dispose_frame(uf->df_list[i]);
+			uf->df_list[i] = NULL;
+			}
+		else {
+			TCL_dispose_frame(uf->df);
+			uf->df = NULL;
+			}
+	uf->spilled = TRUE;
+	uf = save_uf;
+	if (cst_ext) {
+		sprintf(msg," frame %d spilled\n",ufnbr);
+		cst_log(msg);
+		}
+	return DTL_OK;
+	}
+
+
+/* Spill the least recently used frames until the rest fit the budget */
+
+void dtl_spill_frames() {
+	int i,victim;
+	long resident;
+	bool cold;
+
+	if (!spill_budget)
+		return;
+	for (;;) {
+		resident = 0L;
+		victim = 0;
+		for (i=1; i<=uf_max; i++)
+			if (uf_list[i] && !uf_list[i]->spilled) {
+				resident += uf_bytes(uf_list[i],&cold);
+				if (cold && (i != frame_loaded) && !dtl_frame_in_session(i))
+					if (!victim || (uf_list[i]->used < uf_list[victim]->used))
+						victim = i;
+				}
+		if ((resident <= spill_budget) || !victim)
+			return;
+		/* A frame that cannot be written stays, as do the rest */
+		if (spill_frame(victim))
+			return;
+		}
+	}
+
+
+rcode dtl_restore_frame(int ufnbr) {
+	rcode rc;
+	char fn[FNSIZE+1];
+
+	spill_name(fn,ufnbr);
+	if (rc = read_bin_ufile(fn,spill_folder,uf_list[ufnbr]))
+		return rc;
+	uf_list[ufnbr]->spilled = FALSE;
+	dtl_drop_spill(ufnbr);
+	if (cst_ext) {
+		sprintf(msg," frame %d restored\n",ufnbr);
+		cst_log(msg);
+		}
+	return DTL_OK;
+	}
+
+
+void dtl_drop_spill(int ufnbr) {
+	char fn[FNSIZE+1],path[FOSIZE+FNSIZE+6];
+
+	spill_name(fn,ufnbr);
+	file_name(path,fn,spill_folder,".dmb");
+	remove(path);
+	file_name(path,fn,spill_folder,".dbb");
+	remove(path);
+	}
+
+
+/* Keep the resident frames within kbytes, spilling the cold ones
+ * to folder. 0 stops spilling, spilled frames are still restored. */
+
+rcode DTLAPI DTL_set_frame_budget(int kbytes, char *folder) {
+	int i;
+
+	/* Begin single thread semaphore */
+	_smx_begin("FBUD");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_set_frame_budget(%d)\n",kbytes); // does not log folder name
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(folder,1);
+	if (!dtl_is_init())
+		return dtl_error(DTL_STATE_ERROR);
+	/* Check input parameters */
+	if (kbytes < 0)
+		return dtl_error(DTL_INPUT_ERROR);
+	if (kbytes) {
+		if (!folder[0])
+			return dtl_error(DTL_NAME_MISSING);
+		if (strlen(folder) > FOSIZE)
+			return dtl_error(DTL_NAME_TOO_LONG);
+		/* Spilled frames are restored from where they were spilled */
+		if (strcmp(folder,spill_folder))
+			for (i=1; i<=uf_max; i++)
+				if (uf_list[i] && uf_list[i]->spilled)
+					return dtl_error(DTL_STATE_ERROR);
+		strcpy(spill_folder,folder);
+		}
+	spill_budget = 1024L*kbytes;
+	dtl_spill_frames();
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
@@ -60,6 +60,8 @@
  *   DTL_load_frame
  *   DTL_unload_frame
  *   DTL_dispose_frame
+ *   DTL_fork_frame
+ *   DTL_snapshot_frame
  *   DTL_frame_name
  *   DTL_frame_type
  *   DTL_load_status
@@ -78,6 +80,7 @@
  *   ----------------------------
  *   dtl2tcl_tree
  *   dtl2tcl_dlevel
+ *   dtl_fork_frame
  *
  */
 
@@ -201,7 +204,7 @@ rcode DTLAPI DTL_new_PS_flat_frame(int ufnbr, int n_alts, int n_cons[]) {
 	if (!dtl_is_init())
 		return dtl_error(DTL_STATE_ERROR);
 	/* Check input parameters */
-	if ((ufnbr < 1) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 1) || !room_uf(ufnbr))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	if (n_alts > MAX_ALTS)
 		return dtl_error(DTL_ALT_OVERFLOW);
@@ -264,7 +267,7 @@ rcode DTLAPI DTL_new_PS_tree_frame(int ufnbr, int n_alts, int n_nodes[], tt_tree
 	if (!dtl_is_init())
 		return dtl_error(DTL_STATE_ERROR);
 	/* Check input parameters */
-	if ((ufnbr < 1) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 1) || !room_uf(ufnbr))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	if (n_alts > MAX_ALTS)
 		return dtl_error(DTL_ALT_OVERFLOW);
@@ -338,7 +341,7 @@ rcode DTLAPI DTL_new_PM_flat_frame(int ufnbr, int n_crit, int n_alts) {
 	if (!dtl_is_init())
 		return dtl_error(DTL_STATE_ERROR);
 	/* Check input parameters */
-	if ((ufnbr < 1) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 1) || !room_uf(ufnbr))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	if (n_alts > MAX_ALTS)
 		return dtl_error(DTL_ALT_OVERFLOW);
@@ -400,7 +403,7 @@ rcode DTLAPI DTL_new_PM_tree_frame(int ufnbr, int n_alts, int n_wtnodes, ta_tree
 	if (!dtl_is_init())
 		return dtl_error(DTL_STATE_ERROR);
 	/* Check input parameters */
-	if ((ufnbr < 1) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 1) || !room_uf(ufnbr))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	if (n_alts < 2)
 		return dtl_error(DTL_TOO_FEW_ALTS);
@@ -537,6 +540,7 @@ rcode DTLAPI DTL_new_PM_crit_tree(int crit, int n_nodes[], tt_tree xtree) {
 		}
 	/* Set df name */
 	sprintf(uf->df_list[crit]->name,"%s-%03dT",uf->frame_name,crit%1000); // exactly 2 digits
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -589,7 +593,7 @@ rcode DTLAPI DTL_load_PM_crit(int crit, int ufnbr) {
 		sprintf(uf->df_list[crit]->name,"%s-%03dT",uf->frame_name,crit%1000);
 	else
 		sprintf(uf->df_list[crit]->name,"%s-%03dF",uf->frame_name,crit%1000);
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -613,7 +617,7 @@ rcode DTLAPI DTL_unload_PM_crit(int crit, int new_ufnbr) {
 	if (!PM)
 		return dtl_error(DTL_WRONG_FRAME_TYPE);
 	/* Check input parameters */
-	if ((new_ufnbr < 1) || (new_ufnbr > MAX_FRAMES))
+	if ((new_ufnbr < 1) || !room_uf(new_ufnbr))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	if ((crit < 1) || (crit > uf->n_crit))
 		return dtl_error(DTL_CRIT_UNKNOWN);
@@ -639,7 +643,7 @@ rcode DTLAPI DTL_unload_PM_crit(int crit, int new_ufnbr) {
 	ps_uf->n_crit = 1;
 	ps_uf->n_sh = 1;
 	uf->df_list[crit] = NULL;
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -672,7 +676,7 @@ rcode DTLAPI DTL_delete_PM_crit(int crit) {
 		return dtl_kernel_error();
 		}
 	uf->df_list[crit] = NULL;
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -985,6 +989,9 @@ rcode DTLAPI DTL_load_frame(int ufnbr) {
 		return dtl_error(DTL_STATE_ERROR);
 	if (frame_loaded)
 		return dtl_error(DTL_FRAME_IN_USE);
+	/* Loaded by another session */
+	if (dtl_frame_in_session(ufnbr))
+		return dtl_error(DTL_FRAME_IN_USE);
 	/* Check input parameters */
 	if ((uf = get_uf(ufnbr)) == NULL) {
 		return dtl_error(DTL_FRAME_UNKNOWN);
@@ -1022,6 +1029,8 @@ rcode DTLAPI DTL_load_frame(int ufnbr) {
 	dtl_error_count = 0;
 	frame_loaded = ufnbr;
 	eval_cache_invalidate();
+	/* Keep the other frames within the memory budget */
+	dtl_spill_frames();
 	/* End single thread semaphore */
 	_smx_end();
 	return nbr_p_frames;
@@ -1059,6 +1068,7 @@ rcode DTLAPI DTL_unload_frame() {
 			return dtl_kernel_error();
 	uf = NULL;
 	frame_loaded = 0;
+	dtl_spill_frames();
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -1091,12 +1101,20 @@ rcode dtl_dispose_frame(int ufnbr) {
 	/* Check if function can start */
 	if (ufnbr && (ufnbr == frame_loaded))
 		return dtl_error(DTL_FRAME_IN_USE);
-	/* Check input parameters */
-	if ((tmp_uf=get_uf(ufnbr)) == NULL) {
+	if (dtl_frame_in_session(ufnbr))
+		return dtl_error(DTL_FRAME_IN_USE);
+	/* Check input parameters, a spilled frame is not restored */
+	if ((ufnbr < 1) || (ufnbr > uf_max))
+		return dtl_error(DTL_FRAME_UNKNOWN);
+	if ((tmp_uf=uf_list[ufnbr]) == NULL) {
 		return dtl_error(DTL_FRAME_UNKNOWN);
 		}
+	/* Readers holding its snapshot keep it */
+	snap_withdraw(ufnbr);
 	/* Release resources */
-	if (tmp_uf->frame_type == PM_FRAME) {
+	if (tmp_uf->spilled)
+		; // only the file, see dispose_uf
+	else if (tmp_uf->frame_type == PM_FRAME) {
 		n_crit = tmp_uf->n_crit/tmp_uf->n_sh;
 		for (i=0; i<=n_crit; i++)
 			if (tmp_uf->df_list[i])
@@ -1137,6 +1155,133 @@ rcode DTLAPI DTL_dispose_frame(int ufnbr) {
 	}
 
 
+ /*****************************************************
+  *
+  *  Fork frames
+  *
+  *****************************************************/
+
+ /*
+  * A fork is a new user frame with the same contents as an existing
+  * one. The TCL frames of the fork share their bases copy-on-write with
+  * those of the origin, so a fork costs little more than its frame
+  * headers until a base is modified in either of them. Thereafter the
+  * two frames are independent, for evaluation as well as for changes.
+  */
+
+// DTL layer 1: DTL API level
+
+static rcode dtl_fork_frame(struct user_frame *from, int new_ufnbr) {
+	int i,j,n_crit;
+	struct user_frame *tmp_uf;
+
+	/* Check input parameters */
+	if ((new_ufnbr < 1) || !room_uf(new_ufnbr))
+		return dtl_error(DTL_FRAME_UNKNOWN);
+	if (from->frame_type == ANY_FRAME)
+		return dtl_error(DTL_WRONG_FRAME_TYPE);
+	/* Allocate new user frame */
+	if (!(tmp_uf = new_uf(new_ufnbr))) {
+		return dtl_error(DTL_FRAME_EXISTS);
+		}
+	strcpy(tmp_uf->frame_name,from->frame_name);
+	tmp_uf->frame_type = from->frame_type;
+	tmp_uf->frame_nbr = new_ufnbr;
+	tmp_uf->n_alts = from->n_alts;
+	tmp_uf->n_crit = from->n_crit;
+	tmp_uf->n_sh = from->n_sh;
+	for (i=0; i<=MAX_CRIT; i++) {
+		tmp_uf->WP_autogen[i] = from->WP_autogen[i];
+		tmp_uf->V_n_rels[i] = from->V_n_rels[i];
+		tmp_uf->av_min[i] = from->av_min[i];
+		tmp_uf->av_max[i] = from->av_max[i];
+		}
+	/* Fork the TCL frames */
+	if (from->frame_type == PM_FRAME) {
+		n_crit = from->n_crit/from->n_sh;
+		for (i=0; i<=n_crit; i++)
+			if (from->df_list[i])
+				if (call(TCL_fork_frame(from->df_list[i],&(tmp_uf->df_list[i])),"TCL_fork_frame")) {
+					for (j=0; j<i; j++)
+						if (tmp_uf->df_list[j])
+							TCL_dispose_frame(tmp_uf->df_list[j]);
+					dispose_uf(new_ufnbr);
+					return dtl_kernel_error();
+					}
+		/* Other sh: copy singleton frame pointer from 1st sh */
+		for (; i<=from->n_crit; i++) {
+			j = (i-1)%n_crit+1;
+			if (from->df_list[i] && (from->df_list[i] == from->df_list[j]))
+				tmp_uf->df_list[i] = tmp_uf->df_list[j];
+			}
+		}
+	else {
+		if (call(TCL_fork_frame(from->df,&(tmp_uf->df)),"TCL_fork_frame")) {
+			dispose_uf(new_ufnbr);
+			return dtl_kernel_error();
+			}
+		}
+	return DTL_OK;
+	}
+
+
+/* Fork the stored or loaded frame ufnbr into new_ufnbr */
+
+rcode DTLAPI DTL_fork_frame(int ufnbr, int new_ufnbr) {
+	rcode rc;
+	struct user_frame *from;
+
+	/* Begin single thread semaphore */
+	_smx_begin("FORK");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_fork_frame(%d,%d)\n",ufnbr,new_ufnbr);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	if (!dtl_is_init())
+		return dtl_error(DTL_STATE_ERROR);
+	/* Check input parameters */
+	if ((from = get_uf(ufnbr)) == NULL) {
+		return dtl_error(DTL_FRAME_UNKNOWN);
+		}
+	/* Fork */
+	if (rc = dtl_fork_frame(from,new_ufnbr))
+		return rc;
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+/* Snapshot the loaded frame into new_ufnbr. The snapshot keeps the
+ * current state while the loaded frame is changed further, and can be
+ * loaded later to evaluate or to continue from that state. */
+
+rcode DTLAPI DTL_snapshot_frame(int new_ufnbr) {
+	rcode rc;
+
+	/* Begin single thread semaphore */
+	_smx_begin("SNAP");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_snapshot_frame(%d)\n",new_ufnbr);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	if (!dtl_is_init())
+		return dtl_error(DTL_STATE_ERROR);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	/* Fork */
+	if (rc = dtl_fork_frame(uf,new_ufnbr))
+		return rc;
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
  /*****************************************************
   *
   *  Frame information services
@@ -1200,7 +1345,7 @@ rcode DTLAPI DTL_frame_type(int ufnr, int *type) {
 	if (!frame_loaded)
 		return dtl_error(DTL_FRAME_NOT_LOADED);
 	/* Check index bounds */
-	if ((ufnr < 0) || (ufnr > MAX_FRAMES))
+	if ((ufnr < 0) || (ufnr > uf_max))
 		return dtl_error(DTL_FRAME_UNKNOWN);
 	else if (!ufnr) // 0 = currently loaded
 		*type = uf->frame_type;
@@ -53,6 +53,8 @@
  *   DTI_set_folder/16
  *   DTI_reset_folder
  *   DTI_get_folder/16
+ *   DTL_trace_ring
+ *   DTL_drain_trace
  *
  *   Functions outside module, inside DTL
  *   ------------------------------------
@@ -69,8 +71,13 @@
  *   cst_close
  *   cst_log
  *   cst_trace
+ *   trc_begin
+ *   trc_end
+ *   trc_close
  *   load_PV_stmt
  *   load_W_stmt
+ *   room_uf
+ *   free_uf_list
  *   new_uf
  *   get_uf
  *   dispose_uf
@@ -83,6 +90,7 @@
  *   Functions internal to module
  *   ----------------------------
  *   get_date
+ *   trc_now
  *   check_bounds
  *   load_df
  *
@@ -121,14 +129,21 @@
 
 int dtl_abort_request;
 int dtl_abort_cst;
+int dtl_job_cancel;
+int dtl_prog_done;
+int dtl_prog_total;
 char *dtl_func = "NULL";
 struct user_frame *uf = NULL;
-struct user_frame *uf_list[MAX_FRAMES+1];
+struct user_frame **uf_list = NULL;
+int uf_max = 0; // uf_list has entries 0..uf_max
+struct dtl_perf_rec dtl_perf;
 char strg[64],msg[200]; // oversized to prevent 64-bit %d & %p buffer overruns
 int frame_loaded = 0;
 int dtl_error_count;
 int dtl_trace_count;
 int smx_busy = FALSE;
+int dtl_job_hold = FALSE;
+TCL_TLS int dtl_job_thread = FALSE;
 jmp_buf assert_envir;
 int a_tag;
 char dtl_folder[DTLF_SIZE] = "";
@@ -146,6 +161,9 @@ char dtl_buffer[1000];
 /* General load status */
 static rcode latest_kernel_rc = TCL_OK;
 
+/* Use clock for the user frames, orders spilling */
+static unsigned long uf_clock = 0UL;
+
 
  /*********************************************************
   *
@@ -318,7 +336,8 @@ rcode call(rcode rc, char *proc) {
 
 rcode dtl_kernel_error() {
 
-	eval_cache_invalidate();
+	eval_cache_modified(-1); // a base may be half-changed
+	trc_rc = DTL_KERNEL_ERROR+latest_kernel_rc;
 	_smx_end();
 	return DTL_KERNEL_ERROR+latest_kernel_rc;
 	}
@@ -344,6 +363,7 @@ rcode dtl_error(rcode drc) {
 		dtl_error_count++;
 		cst_trace(msg);
 		}
+	trc_rc = drc;
 	_smx_end();
 	return drc;
 	}
@@ -813,6 +833,146 @@ void DTLAPI DTI_raw_trace(char *msg) {
 	}
 
 
+ /*********************************************************
+  *
+  *  Event trace ring
+  *
+  *********************************************************/
+
+ /*
+  * The event trace records each API call as a binary event in a ring
+  * held in memory: the smx name of the call, the frame loaded when it
+  * was made, its result code and its start and end times. Recording
+  * costs two clock reads and one store per call and nothing is
+  * formatted or written. Events are drained on demand by the caller,
+  * who may do so from another thread while API calls run since the
+  * ring has one writer (the smx holder) and one reader. A full ring
+  * drops new events and counts them as lost.
+  */
+
+struct dtl_event *trc_ring = NULL;
+static unsigned trc_size = 0;
+static volatile unsigned trc_head = 0; // written by API calls
+static volatile unsigned trc_tail = 0; // written by the drain
+static volatile unsigned trc_lost = 0;
+static verylong trc_start = 0;
+static int trc_frame = 0;
+rcode trc_rc = DTL_OK;
+
+
+static verylong trc_now() {
+#ifdef _MSC_VER
+	return (verylong)clock()*(1000000000/CLOCKS_PER_SEC);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (verylong)ts.tv_sec*1000000000+ts.tv_nsec;
+#endif
+	}
+
+
+void trc_begin() {
+
+	trc_frame = frame_loaded;
+	trc_rc = DTL_OK;
+	trc_start = trc_now();
+	}
+
+
+void trc_end() {
+	unsigned head;
+	struct dtl_event *ev;
+
+	/* Only once per call, not for clean-up after an error */
+	if (!trc_start || !smx_busy)
+		return;
+	head = trc_head;
+	if (head-trc_tail >= trc_size)
+		trc_lost++;
+	else {
+		ev = trc_ring+head%trc_size;
+		ev->func = dtl_func;
+		ev->frame = trc_frame;
+		ev->rc = trc_rc;
+		ev->start = trc_start;
+		ev->end = trc_now();
+		trc_head = head+1;
+		}
+	trc_start = 0;
+	}
+
+
+void trc_close() {
+
+	if (trc_ring)
+		mem_free((void *)trc_ring);
+	trc_ring = NULL;
+	trc_size = 0;
+	trc_head = trc_tail = trc_lost = 0;
+	trc_start = 0;
+	}
+
+
+/* Record the API calls in a ring of n_events, 0 stops recording and
+ * drops the events not yet drained. Stop draining before this call. */
+
+rcode DTLAPI DTL_trace_ring(int n_events) {
+
+	/* Begin single thread semaphore */
+	_smx_begin("TRING");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_trace_ring(%d)\n",n_events);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	if (!dtl_is_init())
+		return dtl_error(DTL_STATE_ERROR);
+	/* Check input parameters */
+	if (n_events < 0)
+		return dtl_error(DTL_INPUT_ERROR);
+	/* Replace the ring */
+	trc_close();
+	if (n_events) {
+		trc_ring = (struct dtl_event *)mem_alloc(n_events*sizeof(struct dtl_event),
+				"struct dtl_event","DTL_trace_ring");
+		if (!trc_ring)
+			return dtl_error(DTL_MEMORY_LEAK);
+		trc_size = (unsigned)n_events;
+		}
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+/* Move up to max_events of the oldest events to events. Not an API
+ * call in the smx sense: it may run concurrently with other calls. */
+
+rcode DTLAPI DTL_drain_trace(struct dtl_event events[], int max_events, int *n_events, int *n_lost) {
+	unsigned tail,head;
+	int i;
+
+	/* Check if function can start */
+	_certify_ptr(events,1);
+	_certify_ptr(n_events,2);
+	_certify_ptr(n_lost,3);
+	if (!trc_ring)
+		return DTL_STATE_ERROR;
+	/* Copy out, then release the slots */
+	tail = trc_tail;
+	head = trc_head;
+	for (i=0; (i<max_events) && (tail+i != head); i++)
+		events[i] = trc_ring[(tail+i)%trc_size];
+	trc_tail = tail+i;
+	*n_events = i;
+	*n_lost = trc_lost;
+	trc_lost = 0;
+	return DTL_OK;
+	}
+
+
  /*********************************************************
   *
   *  User statement handling
@@ -948,6 +1108,49 @@ rcode load_W_stmt(struct user_w_stmt_rec *ustmt, struct stmt_rec *stmt) {
   *
   *********************************************************/
 
+ /*
+  * room_uf: make room in uf_list for frame number index. The list
+  * starts at MAX_FRAMES and doubles as needed up to MAX_FRAME_NBR.
+  * Returns TRUE if there is room.
+  */
+
+bool room_uf(int index) {
+	int i,size;
+	struct user_frame **list;
+
+	if (index <= uf_max)
+		return TRUE;
+	if (index > MAX_FRAME_NBR)
+		return FALSE;
+	for (size=max(2*uf_max,MAX_FRAMES); size<index; size*=2) ;
+	size = min(size,MAX_FRAME_NBR);
+	list = (struct user_frame **)mem_alloc((size+1)*sizeof(struct user_frame *),
+			"struct user_frame *","room_uf");
+	if (!list)
+		return FALSE;
+	for (i=0; i<=size; i++)
+		list[i] = (i <= uf_max) && uf_list ? uf_list[i] : NULL;
+	if (uf_list)
+		mem_free((void *)uf_list);
+	uf_list = list;
+	uf_max = size;
+	return TRUE;
+	}
+
+
+ /*
+  * free_uf_list: release uf_list (at exit, when all frames are gone)
+  */
+
+void free_uf_list() {
+
+	if (uf_list)
+		mem_free((void *)uf_list);
+	uf_list = NULL;
+	uf_max = 0;
+	}
+
+
  /*
   * new_uf: create new user frame and enter into uf_list.
   * Returns pointer (NULL on failure).
@@ -956,7 +1159,7 @@ rcode load_W_stmt(struct user_w_stmt_rec *ustmt, struct stmt_rec *stmt) {
 struct user_frame *new_uf(int ufnr) {
 	int j;
 
-	if (uf_list[ufnr])
+	if (!room_uf(ufnr) || uf_list[ufnr])
 		return NULL;
 	/* Create a new user frame */
 	uf_list[ufnr] = (struct user_frame *)mem_alloc(sizeof(struct user_frame),
@@ -969,28 +1172,40 @@ struct user_frame *new_uf(int ufnr) {
 	uf_list[ufnr]->n_crit = 0;
 	uf_list[ufnr]->load_crit = -1;
 	uf_list[ufnr]->df = NULL;
+	uf_list[ufnr]->gen[0] = eval_cache_stamp();
 	for (j=0; j<=MAX_CRIT; j++) {
 		uf_list[ufnr]->df_list[j] = NULL;
 		uf_list[ufnr]->WP_autogen[j] = FALSE;
 		uf_list[ufnr]->V_n_rels[j] = 0;
 		uf_list[ufnr]->av_min[j] = 0.0;
 		uf_list[ufnr]->av_max[j] = 1.0;
+		uf_list[ufnr]->gen[j] = uf_list[ufnr]->gen[0];
+		uf_list[ufnr]->jnl_dirty[j] = FALSE;
 		}
+	uf_list[ufnr]->jnl_size = -1L;
+	uf_list[ufnr]->jnl_time = 0L;
+	uf_list[ufnr]->used = ++uf_clock;
+	uf_list[ufnr]->spilled = FALSE;
 	return uf_list[ufnr];
 	}
 
 
  /*
-  * get_uf: fetch user frame pointer.
+  * get_uf: fetch user frame pointer, restoring a spilled frame.
   * Returns pointer or NULL on failure.
   */
 
 struct user_frame *get_uf(int index) {
 
-	if ((index < 1) || (index > MAX_FRAMES))
+	if ((index < 1) || (index > uf_max))
 		return NULL;
-	else
-		return uf_list[index];
+	if (uf_list[index] == NULL)
+		return NULL;
+	if (uf_list[index]->spilled)
+		if (dtl_restore_frame(index))
+			return NULL;
+	uf_list[index]->used = ++uf_clock;
+	return uf_list[index];
 	}
 
 
@@ -1002,11 +1217,13 @@ struct user_frame *get_uf(int index) {
 int dispose_uf(int index) {
 
 	/* Check index bounds */
-	if ((index < 1) || (index > MAX_FRAMES))
+	if ((index < 1) || (index > uf_max))
 		return 0;
 	/* Check if frame exists */
 	if (uf_list[index] == NULL)
 		return 0;
+	if (uf_list[index]->spilled)
+		dtl_drop_spill(index);
 	mem_free((void *)uf_list[index]);
 	uf_list[index] = NULL;
 	return index;
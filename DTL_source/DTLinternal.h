@@ -155,6 +155,9 @@
 /* Enable internal test of error paths */
 #define noINTERNAL_TEST
 
+/* Enable the event trace ring (recording is switched on at run time) */
+#define EVENT_TRACE
+
 /* trunc() is in C99 but not in MS VC++ 6.0 */
 #define _no_trunc
 
@@ -189,6 +192,10 @@
 #define DM (uf->frame_type == DM_FRAME)
 #define PM (uf->frame_type == PM_FRAME)
 
+/* Cell [1][1] of a MAX-dimensioned API matrix, from where the rows are
+ * addressed with its stride in code shared with the caller-sized variants */
+#define M_BASE(m) ((m)?&(m)[1][1]:NULL)
+
 /* Constants for B-normal calculations */
 #define PI 3.1415926535897932384626433832795028841
 #define DELTAPI 1.13799131882385 // 2.0*((4.0-PI)/2.0)^(2.0/3.0)
@@ -218,6 +225,26 @@ struct user_frame {
 	int V_n_rels[MAX_CRIT+1];   // CAR
 	double av_min[MAX_CRIT+1];  // AS
 	double av_max[MAX_CRIT+1];  // AS
+	/* Dynamic - modification stamps for the evaluation memo,
+	 * [0] changes with every base, [crit] with that crit */
+	unsigned long gen[MAX_CRIT+1];
+	/* Dynamic - journal state: identity of the .dmc file last
+	 * read or written and the bases modified since then */
+	long jnl_size;
+	long jnl_time;
+	bool jnl_dirty[MAX_CRIT+1];
+	/* Dynamic - residency: last use, and whether the TCL frames
+	 * have been spilled to disk to keep within the memory budget */
+	unsigned long used;
+	bool spilled;
+	};
+
+/* Performance counters kept by DTL, see DTL_get_perf_stats */
+struct dtl_perf_rec {
+	unsigned long bn_cdf;      // B-normal cdf points
+	unsigned long memo_hits;   // evaluations from the memo
+	unsigned long memo_misses;
+	unsigned long batch_hits;  // evaluations from an evaluation batch
 	};
 
 struct bn_rec {
@@ -242,7 +269,9 @@ extern int dtl_error_count;
 extern int dtl_trace_count;
 
 extern struct user_frame *uf;
-extern struct user_frame *uf_list[];
+extern struct user_frame **uf_list;
+extern int uf_max;
+extern struct dtl_perf_rec dtl_perf;
 
 extern int cst_on;
 extern int cst_ext;
@@ -275,8 +304,13 @@ rcode cst_open();
 void cst_close();
 void cst_log(char *msg);
 void cst_trace(char *msg);
+void trc_begin();
+void trc_end();
+void trc_close();
 rcode load_PV_stmt(int crit, struct user_stmt_rec *ustmt, struct stmt_rec *stmt, char type);
 rcode load_W_stmt(struct user_w_stmt_rec *ustmt, struct stmt_rec *stmt);
+bool room_uf(int index);
+void free_uf_list();
 struct user_frame *new_uf();
 struct user_frame *get_uf(int index);
 int dispose_uf(int index);
@@ -294,24 +328,60 @@ double sgn(double x);
 double n_cdf(double x);
 double owens_t(double x, double alpha);
 double bn_cdf(double val, double mean, double var, double alpha);
+void bn_cdf_n(int n, double val[], double mean, double var, double alpha, double cdf[]);
 double bn_inv_cdf(double cdf, double mean, double var, double alpha);
+void bn_inv_cdf_n(int n, double cdf[], double mean, double var, double alpha, double val[]);
+void bn_solve_n(int n, double target[], double lobo, double upbo, double mean, double var, double alpha, double val[]);
 double b_delta(double skew);
 
 // DTLframe.c
 rcode dtl_dispose_frame(int ufnbr);
 
+// DTLfile.c
+rcode dtl_write_file(char *fn, char *folder);
+
+// DTLfile3.c
+rcode dtl_replay_journal(char *fn, char *folder, struct user_frame *uframe);
+void dtl_reset_journal(char *fn, char *folder, struct user_frame *uframe);
+void dtl_spill_frames();
+rcode dtl_restore_frame(int ufnbr);
+void dtl_drop_spill(int ufnbr);
+
 // DTLmisc.c
+bool dtl_frame_in_session(int ufnbr);
 int dtl_node2crit(int node);
 int dtl_crit2node(int crit);
 rcode dtl_is_shadow_crit(int crit);
 
+// DTLjob.c
+void job_init();
+bool job_pending();
+
+// DTLsnap.c
+void snap_withdraw(int ufnbr);
+bool snap_in_use();
+void snap_release();
+
 // DTLeval.c
 void sort_b(int order[], double maxmin[], int start, int stop, bool max);
 void eval_cache_invalidate();
+void eval_cache_modified(int crit);
+unsigned long eval_cache_stamp();
+void *eval_cache_new();
+void eval_cache_bind(void *cache);
+void eval_cache_release(void *cache);
+rcode eval_cache_free(void *cache);
 rcode evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e_result);
 rcode evaluate_frameset(int crit, int method, int Ai, int Aj, e_matrix e_result);
 rcode dtl_ev_to_cdf(int crit, double ev_level, double *mass);
+rcode dtl_ev_to_cdf_n(int crit, int n, double ev_level[], double mass[]);
+void omega_release();
 rcode dtl_cdf_to_ev(int crit, double belief_level, double *lobo, double *upbo);
+rcode dtl_cdf_to_ev_n(int crit, int n, double belief_level[], double lobo[], double upbo[]);
+rcode dtl_support_ev_n(int crit, int n, double belief_level[], bool upper[], double ev[]);
+#ifdef PAR_EVAL
+int get_n_workers();
+#endif
 
 // DTLwbase.c
 rcode dtl_set_W_check(h_vector lobox, h_vector mbox, h_vector upbox);
@@ -336,16 +406,33 @@ int dtl_nbr_V_midpoints(int crit);
 double dtl_mid_to_modal(double lobo, double mid, double upbo, int oor);
 #define dtl_real_V_node DTI_real_V_node
 rcode dtl_check_V_modality(int crit, int Ai, int Aj);
+void vmod_release();
 
 // DTLautoscale.c
 rcode dtl_copy_AV_crit_scale(int cr_from, int cr_to);
 
 // DTLdominance.c
 rcode dtl_get_dominance(int crit, int Ai, int Aj, double *cd_value, int *d_order);
+void dom_cache_open(int crit);
+void dom_cache_close();
+void dom_release();
+
+// DTLtornado.c
+void tornado_release();
+
+// DTLsample.c
+bool smp_active(int slot);
+double smp_cdf(double level);
+double smp_quantile(double cdf);
+
+// DTLdense.c
+bool dense_ok(int method, int Ai, int Aj);
+rcode dense_evaluate(int method, int Ai, int Aj);
+void dense_release();
 
 // TCL.h
-extern t_matrix t2f,t2r,t2i,r2t,i2t;
-extern tn_row f2r,f2i,r2f,i2f,i2end;
+extern TCL_TLS int **t2f,**t2r,**t2i,**r2t,**i2t;
+extern TCL_TLS int *f2r,*f2i,*r2f,*i2f,*i2end;
 
 // SML.h
 int sml_is_open();
@@ -359,10 +446,13 @@ int sml_is_open();
 
 extern int dtl_abort_request;
 extern int dtl_abort_cst;
+extern int dtl_job_cancel;
+
+/* A cancelled job stays aborted through the calls it makes */
 
 #define dtl_abort_init() \
 	dtl_abort_cst = cst_on; \
-	dtl_abort_request = FALSE
+	dtl_abort_request = dtl_job_cancel
 
 #define dtl_abort_check() \
 	if (dtl_abort_request) { \
@@ -375,6 +465,15 @@ extern int dtl_abort_cst;
 		return DTL_USER_ABORT; \
 		}
 
+/* Progress of the running call, read by DTL_get_job_status */
+
+extern int dtl_prog_done;
+extern int dtl_prog_total;
+
+#define dtl_progress(done,total) \
+{	dtl_prog_done = done; \
+	dtl_prog_total = total; }
+
 
  /*****************************************************
   *
@@ -405,17 +504,39 @@ extern int dtl_abort_cst;
 extern int smx_busy;
 extern char *dtl_func;
 
+/* While a job runs (see DTLjob.c), calls from other threads are busy */
+extern int dtl_job_hold;
+extern TCL_TLS int dtl_job_thread;
+
+/* The event trace ring records each call between begin and end */
+extern struct dtl_event *trc_ring;
+extern rcode trc_rc;
+
+#ifdef EVENT_TRACE
+#define _trc_begin() \
+	if (trc_ring) \
+		trc_begin()
+#define _trc_end() \
+	if (trc_ring) \
+		trc_end()
+#else
+#define _trc_begin()
+#define _trc_end()
+#endif
+
 #define _smx_begin(fn) \
-{	if (smx_busy) \
+{	if (smx_busy || (dtl_job_hold && !dtl_job_thread)) \
 		return DTL_BUSY; \
 	dtl_func = fn; \
+	_trc_begin(); \
 	_init_assert(); \
 	smx_busy = TRUE; }
 
 #define _smx_continue _smx_begin
 
 #define _smx_end() \
-{	dtl_func = "NULL"; \
+{	_trc_end(); \
+	dtl_func = "NULL"; \
 	smx_busy = FALSE; }
 
 #define _smx_name(fn) \
@@ -0,0 +1,497 @@
+/*
+ *
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ *
+ *
+ *                   UNEDA Decision Tree Layer (DTL)
+ *                   -------------------------------
+ *
+ *    +----- o o o ------------------------------------------------+
+ *    |    o       o              Prof. Mats Danielson             |
+ *    |   o  STHLM  o             DECIDE Research Group            |
+ *    |   o         o    Dept. of Computer and Systems Sciences    |
+ *    |   o   UNI   o             Stockholm University             |
+ *    |    o       o      PO Box 1203, SE-164 25 Kista, SWEDEN     |
+ *    +----- o o o ------------------------------------------------+
+ *
+ *                Copyright (c) 2012-2025 Mats Danielson
+ *                     Email: mats.danielson@su.se
+ *
+ */
+
+/*
+ *   File: DTLjob.c
+ *
+ *   Purpose: asynchronous jobs for long-running calls
+ *
+ *   A job is one long-running API call (full evaluation, ranking,
+ *   dominance matrix, tornado) submitted with its parameters and
+ *   result areas. Jobs run one at a time in submission order on a
+ *   job thread, each in the session that was current when it was
+ *   submitted. While a job runs, calls from other threads return
+ *   DTL_BUSY as they would during any other call, but the job calls
+ *   below can be made at any time. Progress is the number of items
+ *   (most often alternatives) done out of the total, as reported by
+ *   the call. Cancelling a job only aborts that job: a queued job
+ *   never starts, a running one ends with DTL_USER_ABORT.
+ *
+ *   Threads are used when built with PAR_EVAL. Otherwise a job runs
+ *   to its end in DTL_submit_job and is then done when it returns.
+ *
+ *   Included from DTLmisc.c, shares its session records.
+ *
+ *
+ *   Functions exported outside DTL
+ *   ------------------------------
+ *   DTL_submit_job
+ *   DTL_get_job_status
+ *   DTL_cancel_job
+ *   DTL_wait_job
+ *   DTL_dispose_job
+ *
+ *   Functions outside of module, inside DTL
+ *   ---------------------------------------
+ *   job_init
+ *   job_pending
+ *
+ *   Functions internal to module
+ *   ----------------------------
+ *   job_call
+ *   job_run
+ *   job_next
+ *   job_runner
+ *   job_worker
+ *
+ */
+
+
+ /*********************************************************
+  *
+  *  Job table
+  *
+  *********************************************************/
+
+struct job_slot {
+	int state;            // 0 = free, else JOB_xxx state
+	unsigned long seq;    // submission order
+	int session;          // session to run in
+	struct dtl_job_rec req;
+	dtl_job_fn done_fn;   // NULL = no callback
+	void *user;
+	rcode rc;
+	int done;             // progress when ended
+	int total;
+	};
+
+static struct job_slot jobs[MAX_JOBS+1];
+static unsigned long job_seq;
+static int job_active;    // the job thread is running
+
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+static CRITICAL_SECTION job_mx;
+#define job_lock() EnterCriticalSection(&job_mx)
+#define job_unlock() LeaveCriticalSection(&job_mx)
+#define job_sleep() Sleep(1)
+#else
+static pthread_mutex_t job_mx = PTHREAD_MUTEX_INITIALIZER;
+#define job_lock() pthread_mutex_lock(&job_mx)
+#define job_unlock() pthread_mutex_unlock(&job_mx)
+#define job_sleep() usleep(1000)
+#endif
+#else
+#define job_lock()
+#define job_unlock()
+#define job_sleep()
+#endif
+
+
+void job_init() {
+	int j;
+
+#if defined(PAR_EVAL) && defined(_MSC_VER)
+	static int mx_ready = FALSE;
+
+	if (!mx_ready)
+		InitializeCriticalSection(&job_mx);
+	mx_ready = TRUE;
+#endif
+	for (j=1; j<=MAX_JOBS; j++)
+		jobs[j].state = 0;
+	job_seq = 0;
+	}
+
+
+/* TRUE if a job is queued or running */
+
+bool job_pending() {
+	int j;
+	bool pending;
+
+	job_lock();
+	for (pending=FALSE, j=1; j<=MAX_JOBS; j++)
+		if ((jobs[j].state == JOB_QUEUED) || (jobs[j].state == JOB_RUNNING))
+			pending = TRUE;
+	job_unlock();
+	return pending;
+	}
+
+
+ /*********************************************************
+  *
+  *  Job execution
+  *
+  *********************************************************/
+
+static rcode job_call(struct dtl_job_rec *jr) {
+
+	switch (jr->type) {
+		case JOB_EVAL_FULL:
+			return DTL_evaluate_full(jr->crit,jr->mode,jr->Ai,jr->Aj,*(e_matrix *)jr->result1);
+		case JOB_RANK:
+			return DTL_rank_alternatives(jr->crit,jr->mode,jr->param1,jr->param2,
+					*(ai_col *)jr->result1,*(ai_col *)jr->result2,
+					*(ar_col *)jr->result3,*(ar_col *)jr->result4);
+		case JOB_DOM_MATRIX:
+			return DTL_get_dominance_matrix(jr->crit,jr->param1,*(ai_matrix *)jr->result1);
+		case JOB_W_TORNADO:
+			return DTL_get_W_tornado(jr->mode,*(h_matrix *)jr->result1,*(h_matrix *)jr->result2);
+		case JOB_P_TORNADO:
+			return DTL_get_P_tornado(jr->crit,jr->mode,*(h_matrix *)jr->result1,*(h_matrix *)jr->result2);
+		case JOB_MCP_TORNADO:
+			return DTL_get_MCP_tornado(jr->crit,jr->mode,*(h_matrix *)jr->result1,*(h_matrix *)jr->result2);
+		case JOB_V_TORNADO:
+			return DTL_get_V_tornado(jr->crit,jr->mode,*(h_matrix *)jr->result1,*(h_matrix *)jr->result2);
+		case JOB_MCV_TORNADO:
+			return DTL_get_MCV_tornado(jr->crit,jr->mode,*(h_matrix *)jr->result1,*(h_matrix *)jr->result2);
+		default:
+			return DTL_INPUT_ERROR;
+		}
+	}
+
+
+/* Run job j in its session. Other threads are held off from the
+ * moment the call in progress (if any) has ended until the session
+ * of the caller is back. */
+
+static rcode job_run(int j) {
+	rcode rc;
+	int old_session;
+
+	dtl_job_thread = TRUE;
+	dtl_job_hold = TRUE;
+	while (smx_busy)
+		job_sleep();
+	old_session = cur_session;
+	if (!session[jobs[j].session])
+		rc = DTL_STATE_ERROR; // disposed of after submission
+	else {
+		if (jobs[j].session != old_session) {
+			save_session(session[old_session]);
+			restore_session(session[jobs[j].session]);
+			cur_session = jobs[j].session;
+			}
+		rc = job_call(&jobs[j].req);
+		if (cur_session != old_session) {
+			save_session(session[cur_session]);
+			restore_session(session[old_session]);
+			cur_session = old_session;
+			}
+		}
+	dtl_job_hold = FALSE;
+	dtl_job_thread = FALSE;
+	return rc;
+	}
+
+
+/* The queued job submitted first, 0 = none */
+
+static int job_next() {
+	int j,next;
+
+	for (next=0, j=1; j<=MAX_JOBS; j++)
+		if ((jobs[j].state == JOB_QUEUED) && (!next || (jobs[j].seq < jobs[next].seq)))
+			next = j;
+	return next;
+	}
+
+
+/* Run the queued jobs until there are none left */
+
+static void job_runner() {
+	rcode rc;
+	int j;
+
+	for (;;) {
+		job_lock();
+		if (!(j = job_next())) {
+			job_active = FALSE;
+			job_unlock();
+			return;
+			}
+		jobs[j].state = JOB_RUNNING;
+		dtl_job_cancel = FALSE;
+		dtl_prog_done = 0;
+		dtl_prog_total = 0;
+		job_unlock();
+		rc = job_run(j);
+		job_lock();
+		dtl_job_cancel = FALSE;
+		jobs[j].rc = rc;
+		jobs[j].total = max(dtl_prog_total,1);
+		jobs[j].done = rc ? min(dtl_prog_done,jobs[j].total) : jobs[j].total;
+		jobs[j].state = JOB_DONE;
+		job_unlock();
+		if (jobs[j].done_fn)
+			jobs[j].done_fn(j,rc,jobs[j].user);
+		}
+	}
+
+
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+static DWORD WINAPI job_worker(LPVOID arg) {
+
+	job_runner();
+	return 0;
+	}
+#else
+static void *job_worker(void *arg) {
+
+	job_runner();
+	return NULL;
+	}
+#endif
+#endif
+
+
+ /*********************************************************
+  *
+  *  Job commands
+  *
+  *********************************************************/
+
+ /*
+  * Call semantics: Queue a job for the call in req, which is copied.
+  * The result areas in req must stay valid until the job is done. The
+  * callback (if any) is made on the job thread when the job has ended.
+  * Returns the job number.
+  */
+
+rcode DTLAPI DTL_submit_job(struct dtl_job_rec *req, dtl_job_fn done_fn, void *user) {
+	int j;
+	bool start;
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+	HANDLE tid;
+#else
+	pthread_t tid;
+#endif
+#endif
+
+	/* Begin single thread semaphore */
+	_smx_begin("SUBJ");
+	/* Check if function can start */
+	_certify_ptr(req,1);
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_submit_job(%d,%d,%d)\n",req->type,req->crit,req->mode);
+		cst_log(msg);
+		}
+	if (!dtl_init)
+		return dtl_error(DTL_STATE_ERROR);
+	/* Check input parameters */
+	if ((req->type < JOB_EVAL_FULL) || (req->type > JOB_MCV_TORNADO))
+		return dtl_error(DTL_INPUT_ERROR);
+	if (!req->result1 || (!req->result2 && (req->type >= JOB_RANK) && (req->type != JOB_DOM_MATRIX)))
+		return dtl_error(DTL_INPUT_ERROR);
+	if ((req->type == JOB_RANK) && (!req->result3 || !req->result4))
+		return dtl_error(DTL_INPUT_ERROR);
+	/* Find free slot */
+	job_lock();
+	for (j=1; j<=MAX_JOBS; j++)
+		if (!jobs[j].state)
+			break;
+	if (j > MAX_JOBS) {
+		job_unlock();
+		return dtl_error(DTL_BUFFER_OVERRUN);
+		}
+	jobs[j].req = *req;
+	jobs[j].done_fn = done_fn;
+	jobs[j].user = user;
+	jobs[j].session = cur_session;
+	jobs[j].seq = ++job_seq;
+	jobs[j].rc = DTL_OK;
+	jobs[j].done = 0;
+	jobs[j].total = 0;
+	jobs[j].state = JOB_QUEUED;
+	start = !job_active;
+	job_active = TRUE;
+	job_unlock();
+	/* End single thread semaphore */
+	_smx_end();
+	if (start) {
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+		if (tid = CreateThread(NULL,0,job_worker,NULL,0,NULL))
+			CloseHandle(tid);
+		else
+#else
+		if (!pthread_create(&tid,NULL,job_worker,NULL))
+			pthread_detach(tid);
+		else
+#endif
+#endif
+		/* No job thread, run here */
+		job_runner();
+		}
+	return j;
+	}
+
+
+ /*
+  * Call semantics: State (JOB_QUEUED, JOB_RUNNING or JOB_DONE) and
+  * progress of job jnbr, and its return code once done. Can be
+  * called while a job is running.
+  */
+
+rcode DTLAPI DTL_get_job_status(int jnbr, int *state, int *done, int *total, rcode *job_rc) {
+
+	/* Log function call */
+	if (cst_ext) {
+		sprintf(msg,"DTL_get_job_status(%d)\n",jnbr);
+		cst_log(msg);
+		}
+	/* Check input parameters */
+	if ((jnbr < 1) || (jnbr > MAX_JOBS))
+		return DTL_INPUT_ERROR;
+	job_lock();
+	if (!jobs[jnbr].state) {
+		job_unlock();
+		return DTL_INPUT_ERROR;
+		}
+	*state = jobs[jnbr].state;
+	if (jobs[jnbr].state == JOB_RUNNING) {
+		*done = dtl_prog_done;
+		*total = dtl_prog_total;
+		}
+	else {
+		*done = jobs[jnbr].done;
+		*total = jobs[jnbr].total;
+		}
+	*job_rc = jobs[jnbr].rc;
+	job_unlock();
+	return DTL_OK;
+	}
+
+
+ /*
+  * Call semantics: Cancel job jnbr. A queued job is done at once with
+  * DTL_USER_ABORT, a running job ends with it at the next abort check.
+  * Other jobs are not affected. Can be called while a job is running.
+  */
+
+rcode DTLAPI DTL_cancel_job(int jnbr) {
+	bool dequeued;
+
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_cancel_job(%d)\n",jnbr);
+		cst_log(msg);
+		}
+	/* Check input parameters */
+	if ((jnbr < 1) || (jnbr > MAX_JOBS))
+		return DTL_INPUT_ERROR;
+	job_lock();
+	dequeued = FALSE;
+	switch (jobs[jnbr].state) {
+		case JOB_QUEUED:
+			jobs[jnbr].rc = DTL_USER_ABORT;
+			jobs[jnbr].state = JOB_DONE;
+			dequeued = TRUE;
+			break;
+		case JOB_RUNNING:
+			dtl_job_cancel = TRUE;
+			dtl_abort_request = TRUE;
+			break;
+		case JOB_DONE:
+			break;
+		default:
+			job_unlock();
+			return DTL_INPUT_ERROR;
+		}
+	job_unlock();
+	if (dequeued && jobs[jnbr].done_fn)
+		jobs[jnbr].done_fn(jnbr,DTL_USER_ABORT,jobs[jnbr].user);
+	return DTL_OK;
+	}
+
+
+ /*
+  * Call semantics: Wait until job jnbr is done. Returns its return
+  * code. Must not be called from a job callback.
+  */
+
+rcode DTLAPI DTL_wait_job(int jnbr) {
+	int state;
+	rcode rc;
+
+	/* Check input parameters */
+	if ((jnbr < 1) || (jnbr > MAX_JOBS))
+		return DTL_INPUT_ERROR;
+	for (;;) {
+		job_lock();
+		state = jobs[jnbr].state;
+		rc = jobs[jnbr].rc;
+		job_unlock();
+		if (!state)
+			return DTL_INPUT_ERROR;
+		if (state == JOB_DONE)
+			return rc;
+		job_sleep();
+		}
+	}
+
+
+ /*
+  * Call semantics: Free the slot of job jnbr, which must be done
+  */
+
+rcode DTLAPI DTL_dispose_job(int jnbr) {
+
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_dispose_job(%d)\n",jnbr);
+		cst_log(msg);
+		}
+	/* Check input parameters */
+	if ((jnbr < 1) || (jnbr > MAX_JOBS))
+		return DTL_INPUT_ERROR;
+	job_lock();
+	if (jobs[jnbr].state != JOB_DONE) {
+		job_unlock();
+		return jobs[jnbr].state ? DTL_STATE_ERROR : DTL_INPUT_ERROR;
+		}
+	jobs[jnbr].state = 0;
+	job_unlock();
+	return DTL_OK;
+	}
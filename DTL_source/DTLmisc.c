@@ -49,6 +49,12 @@
  *   DTL_abort
  *   DTL_init
  *   DTL_exit
+ *   DTL_new_session
+ *   DTL_use_session
+ *   DTL_dispose_session
+ *   DTL_current_session
+ *   DTL_submit_job etc. (in DTLjob.c)
+ *   DTL_publish_snapshot etc. (in DTLsnap.c)
  *   DTL_get_release
  *   DTL_get_release_long
  *   DTL_get_capacity
@@ -65,6 +71,8 @@
  *   DTL_nbr_of_nodes
  *   DTL_error/2
  *   DTL_u_error/2
+ *   DTL_get_perf_stats
+ *   DTL_reset_perf_stats
  *
  *   Functions outside module, debug use
  *   -----------------------------------
@@ -78,12 +86,15 @@
  *
  *   Functions outside module, inside DTL
  *   ------------------------------------
+ *   dtl_frame_in_session
  *   dtl_node2crit
  *
  *   Functions internal to module
  *   ----------------------------
  *   user_abort
  *   invalid_ptr
+ *   save_session
+ *   restore_session
  *   draw_tree/2/3
  *
  */
@@ -95,6 +106,16 @@
 #include <float.h>
 #else // Unix/Mac
 #include <fenv.h>
+#endif
+// job thread
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #endif
 
  /********************************************************
@@ -105,6 +126,24 @@
 
 static int dtl_init = FALSE;
 
+/* A session owns a loaded frame, its evaluation cache, error state and
+ * log switches. The current session lives in the DTL globals, the others
+ * are parked in their records until they are switched in again. Session
+ * 0 is the default session, which always exists. */
+
+struct dtl_session {
+	struct user_frame *uf;
+	int frame_loaded;
+	int error_count;
+	int cst_on;
+	int cst_ext;
+	void *eval; // NULL for the default session
+	};
+
+static struct dtl_session session0;
+static struct dtl_session *session[MAX_SESSIONS+1];
+static int cur_session = 0;
+
 
  /*********************************************************
   *
@@ -112,7 +151,7 @@ static int dtl_init = FALSE;
   *
   *********************************************************/
 
-#define JPROP_NBR 11
+#define JPROP_NBR 13
 
 static struct J_entry {
   char* name; // identifier (label)
@@ -124,14 +163,16 @@ static const struct J_entry J_props[JPROP_NBR] = {
   {"rel main",  DTL_MAIN},
   {"rel func",  DTL_FUNC},
   {"rel tech",  DTL_TECH},
-  {"max frames",MAX_FRAMES-1}, // 1 reserved for internal use
+  {"max frames",MAX_FRAME_NBR-1}, // 1 reserved for internal use
   {"max crit",  MAX_CRIT},
   {"max alts",  MAX_ALTS},
   {"max cons",  MAX_CONS},
   {"max copa",  MAX_COPA},
   {"max nodes", MAX_NODES},
   {"max nopa",  MAX_NOPA},
-  {"max stmts", MAX_STMTS-1} // 1 reserved for internal use
+  {"max stmts", MAX_STMTS-1}, // 1 reserved for internal use
+  {"max pstmts",MAX_P_STMTS-1},
+  {"max vstmts",MAX_V_STMTS-1}
 	};
 
 static const char *LIB_CONF =
@@ -252,9 +293,18 @@ rcode DTLAPI DTL_init() {
 	fedisableexcept(FE_UNDERFLOW|FE_INEXACT);
 #endif
 	signal(SIGFPE,calc_bug);
-	/* Initialise frame pointers (only auto in debug mode) */
-	for (i=0; i<=MAX_FRAMES; i++)
-		uf_list[i] = NULL;
+	/* Initialise frame registry (grows on demand) */
+	if (!room_uf(MAX_FRAMES))
+		return dtl_error(DTL_SYS_CORRUPT);
+	/* Start counting afresh */
+	TCL_reset_perf();
+	memset(&dtl_perf,0,sizeof(dtl_perf));
+	/* Only the default session */
+	session[0] = &session0;
+	for (i=1; i<=MAX_SESSIONS; i++)
+		session[i] = NULL;
+	cur_session = 0;
+	job_init();
 	/* Now ready to fly */
 	dtl_error_count = 0;
 	dtl_trace_count = 0;
@@ -277,15 +327,40 @@ rcode DTLAPI DTL_exit() {
 	/* Check if function can start */
 	if (!dtl_init)
 		return dtl_error(DTL_STATE_ERROR);
+	if (job_pending())
+		return dtl_error(DTL_BUSY);
+	if (snap_in_use())
+		return dtl_error(DTL_BUSY);
 	if (frame_loaded)
 		return dtl_error(DTL_FRAME_IN_USE);
+	for (i=0; i<=MAX_SESSIONS; i++)
+		if (session[i] && (i != cur_session) && session[i]->frame_loaded)
+			return dtl_error(DTL_FRAME_IN_USE);
+	/* Release sessions (back to the default) */
+	eval_cache_bind(NULL);
+	eval_cache_release(NULL);
+	dense_release();
+	vmod_release();
+	dom_release();
+	tornado_release();
+	omega_release();
+	for (i=1; i<=MAX_SESSIONS; i++)
+		if (session[i]) {
+			eval_cache_free(session[i]->eval);
+			mem_free((void *)session[i]);
+			session[i] = NULL;
+			}
+	cur_session = 0;
 	/* Release resources */
-	for (i=1; i<=MAX_FRAMES; i++) {
+	snap_release();
+	for (i=1; i<=uf_max; i++) {
 		if (uf_list[i])
 			if (dtl_dispose_frame(i)) {
 				_smx_continue("EXT2");
 				}
 		}
+	free_uf_list();
+	trc_close();
 	rc = mem_exit();
 	/* Log function result */
 	if (rc)
@@ -304,6 +379,166 @@ rcode DTLAPI DTL_exit() {
 	}
 
 
+ /*********************************************************
+  *
+  *  Session commands
+  *
+  *********************************************************/
+
+static void save_session(struct dtl_session *sp) {
+
+	sp->uf = uf;
+	sp->frame_loaded = frame_loaded;
+	sp->error_count = dtl_error_count;
+	sp->cst_on = cst_on;
+	sp->cst_ext = cst_ext;
+	}
+
+
+static void restore_session(struct dtl_session *sp) {
+
+	uf = sp->uf;
+	frame_loaded = sp->frame_loaded;
+	dtl_error_count = sp->error_count;
+	cst_on = sp->cst_on;
+	cst_ext = sp->cst_ext;
+	eval_cache_bind(sp->eval);
+	}
+
+
+ /*
+  * Call semantics: Create a new session without a loaded frame. The
+  * session inherits the log switches of the current session. Returns
+  * the session number. The current session is not changed.
+  */
+
+rcode DTLAPI DTL_new_session() {
+	int i;
+	struct dtl_session *sp;
+
+	/* Begin single thread semaphore */
+	_smx_begin("NEWS");
+	/* Log function call */
+	if (cst_on)
+		cst_log("DTL_new_session()\n");
+	/* Check if function can start */
+	if (!dtl_init)
+		return dtl_error(DTL_STATE_ERROR);
+	/* Find free slot */
+	for (i=1; i<=MAX_SESSIONS; i++)
+		if (!session[i])
+			break;
+	if (i > MAX_SESSIONS)
+		return dtl_error(DTL_BUFFER_OVERRUN);
+	sp = (struct dtl_session *)mem_alloc(sizeof(struct dtl_session),"struct dtl_session","DTL_new_session");
+	if (!sp)
+		return dtl_error(DTL_MEMORY_LEAK);
+	if (!(sp->eval = eval_cache_new())) {
+		mem_free((void *)sp);
+		return dtl_error(DTL_MEMORY_LEAK);
+		}
+	sp->uf = NULL;
+	sp->frame_loaded = 0;
+	sp->error_count = 0;
+	sp->cst_on = cst_on;
+	sp->cst_ext = cst_ext;
+	session[i] = sp;
+	/* End single thread semaphore */
+	_smx_end();
+	return i;
+	}
+
+
+ /*
+  * Call semantics: Switch to session snbr. The frame, evaluation results
+  * and error state of the current session are kept in its record and
+  * are found as they were left when the session is used again. The
+  * TCL frame of the session is bound again. Sessions separate state,
+  * not threads: all DTL calls still pass the one semaphore.
+  */
+
+rcode DTLAPI DTL_use_session(int snbr) {
+
+	/* Begin single thread semaphore */
+	_smx_begin("USES");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_use_session(%d)\n",snbr);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	if (!dtl_init)
+		return dtl_error(DTL_STATE_ERROR);
+	/* Check input parameters */
+	if ((snbr < 0) || (snbr > MAX_SESSIONS) || !session[snbr])
+		return dtl_error(DTL_INPUT_ERROR);
+	if (snbr != cur_session) {
+		save_session(session[cur_session]);
+		restore_session(session[snbr]);
+		cur_session = snbr;
+		/* Rebind the kernel to the frame of this session */
+		if (frame_loaded && uf->df)
+			if (call(TCL_bind_frame(uf->df),"TCL_bind_frame"))
+				return dtl_error(DTL_FRAME_CORRUPT);
+		}
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+ /*
+  * Call semantics: Dispose of a session. It cannot be the current or
+  * the default session and must not have a frame loaded.
+  */
+
+rcode DTLAPI DTL_dispose_session(int snbr) {
+
+	/* Begin single thread semaphore */
+	_smx_begin("DISS");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_dispose_session(%d)\n",snbr);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	if (!dtl_init)
+		return dtl_error(DTL_STATE_ERROR);
+	/* Check input parameters */
+	if ((snbr < 1) || (snbr > MAX_SESSIONS) || !session[snbr])
+		return dtl_error(DTL_INPUT_ERROR);
+	if (snbr == cur_session)
+		return dtl_error(DTL_STATE_ERROR);
+	if (session[snbr]->frame_loaded)
+		return dtl_error(DTL_FRAME_IN_USE);
+	eval_cache_free(session[snbr]->eval);
+	mem_free((void *)session[snbr]);
+	session[snbr] = NULL;
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+int DTLAPI DTL_current_session() {
+
+	return cur_session;
+	}
+
+
+/* Frame loaded in a session other than the current one */
+
+bool dtl_frame_in_session(int ufnbr) {
+	int i;
+
+	if (ufnbr)
+		for (i=0; i<=MAX_SESSIONS; i++)
+			if (session[i] && (i != cur_session) && (session[i]->frame_loaded == ufnbr))
+				return TRUE;
+	return FALSE;
+	}
+
+
  /*********************************************************
   *
   *  Structure commands
@@ -381,7 +616,7 @@ void DTLAPI DTL_get_capacity(char *capstrg, unsigned c_size) {
 	_certify_ptr(capstrg,1);
 	/* Collect requested information */
 	len = sprintf(dtl_buffer,"%d %d %d %d %d %d %d %d",
-			MAX_FRAMES,MAX_CRIT,MAX_ALTS,MAX_NODES,MAX_NOPA,MAX_CONS,MAX_COPA,MAX_STMTS);
+			MAX_FRAME_NBR,MAX_CRIT,MAX_ALTS,MAX_NODES,MAX_NOPA,MAX_CONS,MAX_COPA,MAX_STMTS);
 	if (len >= c_size) { // buffer overrun
 		capstrg[0] = '\0';
 		sprintf(msg," DTL_get_capacity(strg[%u]) buffer too short (min %u)\n",c_size,len+1);
@@ -466,7 +701,7 @@ void DTLAPI DTI_list_all_frames() {
 	int i,j,hit=0;
 
 	/* Also runs unloaded - list all frames to choose from */
-	for (i=1; i<=MAX_FRAMES; i++)
+	for (i=1; i<=uf_max; i++)
 		if (uf_list[i]) {
 			hit++;
 			printf("%s-frame %d: %s %s\n",uf_list[i]->frame_type==PM_FRAME?"PM":uf_list[i]->frame_type==PS_FRAME?"PS":"DM",
@@ -890,6 +1125,62 @@ int DTLAPI DTL_nbr_of_nodes(int crit, int alt) {
 	}
 
 
+ /*********************************************************
+  *
+  *  Performance counters
+  *
+  *  Counted since DTL_init or the latest reset, both by DTL
+  *  and TCL, and left compiled in since a count is cheap.
+  *  Not protected by smx mechanism
+  *
+  *********************************************************/
+
+rcode DTLAPI DTL_get_perf_stats(struct dtl_perf_stats *stats) {
+	struct tcl_perf tp;
+
+	/* Log function call */
+	if (cst_ext)
+		cst_log("DTL_get_perf_stats()\n");
+	/* Check if function can start */
+	_certify_ptr(stats,1);
+	if (!dtl_is_init())
+		return DTL_STATE_ERROR;
+	/* Deliver result */
+	TCL_get_perf(&tp);
+	stats->load_P = tp.load_P;
+	stats->load_P_time = tp.load_P_time;
+	stats->load_V = tp.load_V;
+	stats->load_V_time = tp.load_V_time;
+	stats->load_V_inc = tp.load_V_inc;
+	stats->load_V_inc_time = tp.load_V_inc_time;
+	stats->attach = tp.attach;
+	stats->eval_P = tp.eval_P;
+	stats->sort_elems = tp.sort_elems;
+	stats->vx_calls = tp.vx_calls;
+	stats->vx_paths = tp.vx_paths;
+	stats->vx_bails = tp.vx_bails;
+	stats->bn_cdf = dtl_perf.bn_cdf;
+	stats->memo_hits = dtl_perf.memo_hits;
+	stats->memo_misses = dtl_perf.memo_misses;
+	stats->batch_hits = dtl_perf.batch_hits;
+	return DTL_OK;
+	}
+
+
+rcode DTLAPI DTL_reset_perf_stats() {
+
+	/* Log function call */
+	if (cst_ext)
+		cst_log("DTL_reset_perf_stats()\n");
+	/* Check if function can start */
+	if (!dtl_is_init())
+		return DTL_STATE_ERROR;
+	TCL_reset_perf();
+	memset(&dtl_perf,0,sizeof(dtl_perf));
+	return DTL_OK;
+	}
+
+
 int dtl_node2crit(int node) {
 
 	/* Check if function can start */
@@ -1011,3 +1302,21 @@ bool DTLAPI DTL_u_error(rcode drc) {
 	   TRUE =  drc contains an error */
 	return DTL_u_error2(drc)>1;
 	}
+
+
+ /*************************************************************
+  *
+  *  Asynchronous jobs
+  *
+  *************************************************************/
+
+#include "DTLjob.c"
+
+
+ /*************************************************************
+  *
+  *  Evaluation snapshots
+  *
+  *************************************************************/
+
+#include "DTLsnap.c"
@@ -47,6 +47,7 @@
  *   Functions exported outside DTL
  *   ------------------------------
  *   DTL_add_P_statement
+ *   DTL_add_P_statements
  *   DTL_change_P_statement
  *   DTL_replace_P_statement
  *   DTL_delete_P_statement
@@ -92,6 +93,9 @@
 static d_row phlobo,phupbo,pllobo,plupbo;
 static d_row P_mid,LP_mid;
 
+/* Statement set buffer */
+static struct stmt_rec stmts[MAX_STMTS+1];
+
 
  /*********************************************************
   *
@@ -128,7 +132,46 @@ rcode DTLAPI DTL_add_P_statement(int crit, struct user_stmt_rec* ustmtp) {
 	/* Add statement */
 	if (call(TCL_add_P_constraint(uf->df,&stmt),"TCL_add_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
+	/* End single thread semaphore */
+	_smx_end();
+	return uf->df->P_base->n_stmts;
+	}
+
+
+ /*
+  * Call semantics: Add the user probability statements ustmts[1..n_stmts]
+  * to the probability base in one operation. The base is loaded and checked
+  * for consistency once for the whole set. In case of inconsistency,
+  * none of the statements are added to the base.
+  */
+
+rcode DTLAPI DTL_add_P_statements(int crit, int n_stmts, struct user_stmt_rec ustmts[]) {
+	int i;
+
+	/* Begin single thread semaphore */
+	_smx_begin("APSS");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_add_P_statements(%d,%d)\n",crit,n_stmts);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(ustmts,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	/* Check input parameters */
+	if (load_df1(crit))
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	if ((n_stmts < 1) || (n_stmts > MAX_STMTS))
+		return dtl_error(DTL_INPUT_ERROR);
+	for (i=1; i<=n_stmts; i++)
+		if (load_PV_stmt(crit,ustmts+i,stmts+i,'P'))
+			return dtl_error(DTL_STMT_ERROR);
+	/* Add statements */
+	if (call(TCL_add_P_constraints(uf->df,n_stmts,stmts),"TCL_add_P_constraints"))
+		return dtl_kernel_error();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return uf->df->P_base->n_stmts;
@@ -162,7 +205,7 @@ rcode DTLAPI DTL_change_P_statement(int crit, int stmt_number, double lobo, doub
 	/* Change statement */
 	if (call(TCL_change_P_constraint(uf->df,stmt_number,lobo,upbo),"TCL_change_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -199,7 +242,7 @@ rcode DTLAPI DTL_replace_P_statement(int crit, int stmt_number, struct user_stmt
 	/* Replace statement */
 	if (call(TCL_replace_P_constraint(uf->df,stmt_number,&stmt),"TCL_replace_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -231,7 +274,7 @@ rcode DTLAPI DTL_delete_P_statement(int crit, int stmt_number) {
 	/* Delete statement */
 	if (call(TCL_delete_P_constraint(uf->df,stmt_number),"TCL_delete_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return uf->df->P_base->n_stmts;
@@ -270,7 +313,7 @@ rcode DTLAPI DTL_add_P_mid_statement(int crit, struct user_stmt_rec* ustmtp) {
 	/* Set midpoint */
 	if (call(TCL_add_P_mstatement(uf->df,&stmt),"TCL_add_P_mstatement"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -306,7 +349,7 @@ rcode DTLAPI DTL_delete_P_mid_statement(int crit, struct user_stmt_rec* ustmtp)
 	/* Remove midpoint */
 	if (call(TCL_delete_P_mstatement(uf->df,&stmt),"TCL_delete_P_mstatement"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -349,7 +392,7 @@ rcode DTLAPI DTL_set_P_box(int crit, h_matrix lobox, h_matrix upbox) {
 			}
 	if (call(TCL_set_P_box(df,box_lobo,box_upbo),"TCL_set_P_box"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -428,7 +471,7 @@ rcode DTLAPI DTL_set_P_mbox(int crit, h_matrix lobox, h_matrix upbox) {
 	if (call(TCL_set_P_mbox(df,mbox_lobo,mbox_upbo),"TCL_set_P_mbox"))
 		return dtl_kernel_error();
 	uf->WP_autogen[crit] = FALSE;
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -481,7 +524,7 @@ rcode DTLAPI DTL_remove_P_mbox(int crit) {
 			}
 	if (call(TCL_set_P_mbox(df,mbox_lobo,mbox_upbo),"TCL_set_P_mbox"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -565,7 +608,7 @@ rcode DTLAPI DTL_reset_P_base(int crit) {
 	/* Reset information */
 	if (call(TCL_reset_P_base(uf->df),"TCL_reset_P_base"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
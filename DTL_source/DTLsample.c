@@ -0,0 +1,492 @@
+/*
+ *
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/ 
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/  
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/          
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/          
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/   
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ *
+ *
+ *                   UNEDA Decision Tree Layer (DTL)
+ *                   -------------------------------
+ *
+ *    +----- o o o ------------------------------------------------+
+ *    |    o       o              Prof. Mats Danielson             |
+ *    |   o  STHLM  o             DECIDE Research Group            |
+ *    |   o         o    Dept. of Computer and Systems Sciences    |
+ *    |   o   UNI   o             Stockholm University             |
+ *    |    o       o      PO Box 1203, SE-164 25 Kista, SWEDEN     |
+ *    +----- o o o ------------------------------------------------+
+ *
+ *                Copyright (c) 2012-2025 Mats Danielson
+ *                     Email: mats.danielson@su.se
+ *
+ */
+
+/*
+ *   File: DTLsample.c
+ *
+ *   Purpose: Monte Carlo sampled evaluation of alternatives
+ *
+ *   The b-normal belief distribution from the moments is replaced
+ *   by the empirical distribution of sampled EVs. The per-node draws
+ *   are made in TCL from the same distributions as the moments (see
+ *   TCLsample.c). Afterwards, the mass and support functions read the
+ *   sorted samples until the next evaluation. Sampling is seeded per
+ *   block of samples so the results do not depend on the number of
+ *   workers.
+ *
+ *   Included from DTLeval.c, shares its evaluation cache.
+ *
+ *
+ *   Functions exported outside DTL
+ *   ------------------------------
+ *   DTL_evaluate_sampled
+ *
+ *   Functions outside of module, inside DTL
+ *   ---------------------------------------
+ *   smp_active
+ *   smp_cdf
+ *   smp_quantile
+ *
+ *   Functions internal to module
+ *   ----------------------------
+ *   smp_coeff
+ *   smp_buffer
+ *   smp_compare
+ *   run_smp_job
+ *   smp_worker
+ *   smp_draw_crit
+ *   smp_weighted
+ *   smp_draw_mc
+ *
+ */
+
+
+ /*********************************************************
+  *
+  *  Configuration parameters
+  *
+  *********************************************************/
+
+#define MIN_SAMPLES 100
+#define MAX_SAMPLES 1000000
+#define SMP_BLOCK 1024         // samples per seed (and per MC chunk)
+#define SMP_SEED 20250101UL    // base seed, block b uses SMP_SEED+b
+
+
+ /*********************************************************
+  *
+  *  Sample buffer
+  *
+  *********************************************************/
+
+/* Linear combination of alternative EVs for an evaluation rule,
+ * same weights as in eval_cache_mass */
+
+static void smp_coeff(int method, int Ai, int Aj, int n_alts, a_row coeff) {
+	int j,n_active;
+
+	for (j=1; j<=n_alts; j++)
+		coeff[j] = 0.0;
+	switch (method & M_EVAL) {
+		case E_DELTA:
+			coeff[Aj] = -1.0;
+			break;
+		case E_GAMMA:
+			for (j=1; j<=n_alts; j++)
+				coeff[j] = -1.0/(double)(n_alts-1);
+			break;
+		case E_DIGAMMA:
+			/* Bitmap covers alts 1..DIGAMMA_BITS */
+			n_active = 0;
+			for (j=1; j<=n_alts; j++)
+				if ((Ai!=j) && (j<=DIGAMMA_BITS) && (Aj&(0x01<<(j-1))))
+					n_active++;
+			for (j=1; j<=n_alts; j++)
+				if ((Ai!=j) && (j<=DIGAMMA_BITS) && (Aj&(0x01<<(j-1))))
+					coeff[j] = -1.0/(double)n_active;
+			break;
+		}
+	coeff[Ai] = 1.0;
+	}
+
+
+/* Make room for n samples in the cache of the current session */
+
+static bool smp_buffer(int n) {
+
+	ev_cur->smp_n = 0;
+	if (ev_cur->smp_size >= n)
+		return TRUE;
+	if (ev_cur->smp)
+		mem_free((void *)ev_cur->smp);
+	ev_cur->smp = (double *)mem_alloc(n*sizeof(double),"double","smp_buffer");
+	ev_cur->smp_size = ev_cur->smp ? n : 0;
+	return ev_cur->smp != NULL;
+	}
+
+
+static int smp_compare(const void *a, const void *b) {
+
+	if (*(double *)a < *(double *)b)
+		return -1;
+	if (*(double *)a > *(double *)b)
+		return 1;
+	return 0;
+	}
+
+
+/* TRUE if the latest evaluation in slot was sampled */
+
+bool smp_active(int slot) {
+
+	return ev_cur->smp_n && (ev_cur->smp_slot == slot);
+	}
+
+
+/* Empirical cdf of the active samples, piecewise linear through the
+ * sample points (x_i,(i+0.5)/n) and anchored at the EV range ends */
+
+double smp_cdf(double level) {
+	int lo,hi,k,n;
+	double *x,x_lo,x_up,c_lo,c_up;
+
+	n = ev_cur->smp_n;
+	x = ev_cur->smp;
+	if (level <= e_cache[ev_cur->smp_slot][E_MIN][0])
+		return 0.0;
+	if (level >= e_cache[ev_cur->smp_slot][E_MAX][0])
+		return 1.0;
+	/* Number of samples at or below level */
+	for (lo=0,hi=n; lo<hi; ) {
+		k = (lo+hi)/2;
+		if (x[k] <= level)
+			lo = k+1;
+		else
+			hi = k;
+		}
+	k = lo;
+	if (k == 0) {
+		x_lo = e_cache[ev_cur->smp_slot][E_MIN][0];
+		c_lo = 0.0;
+		}
+	else {
+		x_lo = x[k-1];
+		c_lo = ((double)k-0.5)/(double)n;
+		}
+	if (k == n) {
+		x_up = e_cache[ev_cur->smp_slot][E_MAX][0];
+		c_up = 1.0;
+		}
+	else {
+		x_up = x[k];
+		c_up = ((double)k+0.5)/(double)n;
+		}
+	if (x_up-x_lo < DTL_EPS*DTL_EPS)
+		return c_lo;
+	return c_lo+(c_up-c_lo)*(level-x_lo)/(x_up-x_lo);
+	}
+
+
+/* Inverse of smp_cdf */
+
+double smp_quantile(double cdf) {
+	int i,n;
+	double *x,t;
+
+	n = ev_cur->smp_n;
+	x = ev_cur->smp;
+	t = cdf*(double)n-0.5;
+	if (t <= 0.0)
+		return e_cache[ev_cur->smp_slot][E_MIN][0]+
+				(x[0]-e_cache[ev_cur->smp_slot][E_MIN][0])*max(cdf,0.0)*2.0*(double)n;
+	if (t >= (double)(n-1))
+		return x[n-1]+(e_cache[ev_cur->smp_slot][E_MAX][0]-x[n-1])*
+				min(t-(double)(n-1),1.0)*2.0;
+	i = (int)t;
+	return x[i]+(t-(double)i)*(x[i+1]-x[i]);
+	}
+
+
+ /*********************************************************
+  *
+  *  Criterion sampling
+  *
+  *  Blocks of SMP_BLOCK samples are drawn by the workers
+  *  in turn (PAR_EVAL), all for the same frame. The TCL
+  *  scratch areas and random generators are thread-local
+  *  and the frame is only read.
+  *
+  *********************************************************/
+
+struct smp_job {
+	int worker;
+	int n_workers;
+	int n_samples;
+	struct d_frame *df;
+	double *coeff;
+	double *sample;
+	rcode tcl_rc;
+	};
+
+
+static void run_smp_job(struct smp_job *jp) {
+	int b,first;
+
+	for (b=jp->worker; (first=b*SMP_BLOCK)<jp->n_samples; b+=jp->n_workers) {
+		TCL_sample_seed(SMP_SEED+(unsigned long)b);
+		if (jp->tcl_rc = TCL_get_EV_samples(jp->df,min(SMP_BLOCK,jp->n_samples-first),
+				jp->coeff,jp->sample+first))
+			return;
+		}
+	}
+
+
+#ifdef PAR_EVAL
+
+static struct smp_job s_job[MAX_WORKERS];
+
+#ifdef _MSC_VER
+static DWORD WINAPI smp_worker(LPVOID arg) {
+
+	run_smp_job((struct smp_job *)arg);
+	return 0;
+	}
+#else
+static void *smp_worker(void *arg) {
+
+	run_smp_job((struct smp_job *)arg);
+	return NULL;
+	}
+#endif
+
+#endif // PAR_EVAL
+
+
+static rcode smp_draw_crit(int method, int Ai, int Aj, int n_samples, double sample[]) {
+	int w,n_w;
+	a_row coeff;
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+	HANDLE tid[MAX_WORKERS];
+#else
+	pthread_t tid[MAX_WORKERS];
+#endif
+#else
+	struct smp_job s_job[1];
+#endif
+
+	smp_coeff(method,Ai,Aj,uf->df->n_alts,coeff);
+#ifdef PAR_EVAL
+	n_w = min(get_n_workers(),(n_samples+SMP_BLOCK-1)/SMP_BLOCK);
+#else
+	n_w = 1;
+#endif
+	for (w=0; w<n_w; w++) {
+		s_job[w].worker = w;
+		s_job[w].n_workers = n_w;
+		s_job[w].n_samples = n_samples;
+		s_job[w].df = uf->df;
+		s_job[w].coeff = coeff;
+		s_job[w].sample = sample;
+		s_job[w].tcl_rc = TCL_OK;
+		}
+#ifdef PAR_EVAL
+	/* Fan out, the calling thread is worker 0 */
+	for (w=1; w<n_w; w++)
+#ifdef _MSC_VER
+		if (!(tid[w] = CreateThread(NULL,0,smp_worker,&s_job[w],0,NULL)))
+#else
+		if (pthread_create(&tid[w],NULL,smp_worker,&s_job[w]))
+#endif
+			s_job[w].n_workers = -1; // not started
+#endif
+	run_smp_job(&s_job[0]);
+#ifdef PAR_EVAL
+	for (w=1; w<n_w; w++)
+		if (s_job[w].n_workers < 0) {
+			/* Could not start the thread, do its share here */
+			s_job[w].n_workers = n_w;
+			run_smp_job(&s_job[w]);
+			}
+		else {
+#ifdef _MSC_VER
+			WaitForSingleObject(tid[w],INFINITE);
+			CloseHandle(tid[w]);
+#else
+			pthread_join(tid[w],NULL);
+#endif
+			}
+#endif
+	/* Collect errors */
+	for (w=0; w<n_w; w++)
+		if (s_job[w].tcl_rc) {
+			call(s_job[w].tcl_rc,"TCL_get_EV_samples");
+			return dtl_kernel_error();
+			}
+	return DTL_OK;
+	}
+
+
+ /*********************************************************
+  *
+  *  MC sampling
+  *
+  *  Per chunk of samples, the weights are drawn from the
+  *  PM tree and then each criterion adds its weighted EV
+  *  samples. Criteria are drawn independently of each
+  *  other, as in the MC moments.
+  *
+  *********************************************************/
+
+/* TRUE if crit has any weight in the drawn chunk (i.e. is below snode) */
+
+static bool smp_weighted(int crit, int n, int stride, double w[]) {
+	int s;
+
+	for (s=0; s<n; s++)
+		if (w[s*stride+crit] > 0.0)
+			return TRUE;
+	return FALSE;
+	}
+
+
+static rcode smp_draw_mc(int crit, int method, int Ai, int Aj, int n_samples, double sample[]) {
+	rcode rc,drc;
+	int b,c,s,n,first,stride;
+	double *w,*v;
+	a_row coeff;
+
+	stride = uf->n_crit+1;
+	w = (double *)mem_alloc(SMP_BLOCK*(stride+1)*sizeof(double),"double","smp_draw_mc");
+	if (!w)
+		return dtl_error(DTL_MEMORY_LEAK);
+	v = w+SMP_BLOCK*stride;
+	for (s=0; s<n_samples; s++)
+		sample[s] = 0.0;
+	rc = DTL_OK;
+	for (b=0; !rc && ((first=b*SMP_BLOCK) < n_samples); b++) {
+		n = min(SMP_BLOCK,n_samples-first);
+		TCL_sample_seed(SMP_SEED+(unsigned long)b);
+		/* Weights from the PM tree */
+		if (load_df0(0)) {
+			rc = DTL_SYS_CORRUPT;
+			break;
+			}
+		if (drc = call(TCL_get_W_samples(uf->df,-crit,n,stride,w),"TCL_get_W_samples")) {
+			rc = DTL_KERNEL_ERROR+drc;
+			break;
+			}
+		/* Weighted criteria values */
+		for (c=1; c<=uf->n_crit; c++) {
+			if (!smp_weighted(c,n,stride,w))
+				continue;
+			rc = load_df1(c);
+			if (rc == DTL_CRIT_UNKNOWN) {
+				/* Stand-in, same range as standin_eval */
+				for (s=0; s<n; s++)
+					v[s] = TCL_sample_td(Vc_lobo[c],(Vc_lobo[c]+Vc_upbo[c])/2.0,Vc_upbo[c]);
+				rc = DTL_OK;
+				}
+			else if (rc)
+				break;
+			else {
+				smp_coeff(method,Ai,Aj,uf->df->n_alts,coeff);
+				if (drc = call(TCL_get_EV_samples(uf->df,n,coeff,v),"TCL_get_EV_samples")) {
+					rc = DTL_KERNEL_ERROR+drc;
+					break;
+					}
+				}
+			for (s=0; s<n; s++)
+				sample[first+s] += w[s*stride+c]*v[s];
+			}
+		if (dtl_abort_request)
+			break;
+		}
+	mem_free((void *)w);
+	/* Leave the PM tree loaded as after evaluate_frameset */
+	if (load_df0(0) && !rc)
+		rc = DTL_SYS_CORRUPT;
+	dtl_abort_check();
+	if (rc)
+		return dtl_error(rc);
+	return DTL_OK;
+	}
+
+
+ /*********************************************************
+  *
+  *  Sampled evaluation
+  *
+  *  Call semantics as DTL_evaluate_frame. The e_result is
+  *  the same, while the subsequent belief mass and support
+  *  calls use the n_samples sampled EVs instead of the
+  *  b-normal approximation.
+  *
+  *********************************************************/
+
+rcode DTLAPI DTL_evaluate_sampled(int crit, int method, int Ai, int Aj, int n_samples, e_matrix e_result) {
+	rcode rc;
+	int s,slot;
+	double *x;
+
+	/* Begin single thread semaphore */
+	_smx_begin("ESAMP");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_evaluate_sampled(%d,%d,%d,%d,%d)\n",crit,method,Ai,Aj,n_samples);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(e_result,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	/* Check input parameters */
+	if (load_df00(crit))
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	if ((n_samples < MIN_SAMPLES) || (n_samples > MAX_SAMPLES))
+		return dtl_error(DTL_INPUT_ERROR);
+	/* Evaluate, which also validates the call and leaves the hulls to sample from */
+	if (rc = evaluate_frameset(crit,method,Ai,Aj,e_result))
+		return rc;
+	if (!smp_buffer(n_samples))
+		return dtl_error(DTL_MEMORY_LEAK);
+	x = ev_cur->smp;
+	if (crit > 0)
+		rc = smp_draw_crit(method,Ai,Aj,n_samples,x);
+	else
+		rc = smp_draw_mc(crit,method,Ai,Aj,n_samples,x);
+	if (rc)
+		return rc;
+	/* Sort into the empirical distribution, within the EV range */
+	slot = max(crit,0);
+	for (s=0; s<n_samples; s++)
+		x[s] = min(max(x[s],e_cache[slot][E_MIN][0]),e_cache[slot][E_MAX][0]);
+	qsort(x,n_samples,sizeof(double),smp_compare);
+	ev_cur->smp_slot = slot;
+	ev_cur->smp_n = n_samples;
+	/* Log function result */
+	if (cst_ext) {
+		sprintf(msg," samples %d: %6.3lf %6.3lf %6.3lf\n",n_samples,x[0],smp_quantile(0.5),x[n_samples-1]);
+		cst_log(msg);
+		}
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
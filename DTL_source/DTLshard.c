@@ -0,0 +1,265 @@
+/*
+ *
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ *
+ *
+ *                   UNEDA Decision Tree Layer (DTL)
+ *                   -------------------------------
+ *
+ *    +----- o o o ------------------------------------------------+
+ *    |    o       o              Prof. Mats Danielson             |
+ *    |   o  STHLM  o             DECIDE Research Group            |
+ *    |   o         o    Dept. of Computer and Systems Sciences    |
+ *    |   o   UNI   o             Stockholm University             |
+ *    |    o       o      PO Box 1203, SE-164 25 Kista, SWEDEN     |
+ *    +----- o o o ------------------------------------------------+
+ *
+ *                Copyright (c) 2012-2025 Mats Danielson
+ *                     Email: mats.danielson@su.se
+ *
+ */
+
+
+/*
+ *   File: DTLshard.c
+ *
+ *   Purpose: sharded evaluation of alternatives
+ *
+ *   Alternative sets too large for one process can be screened by
+ *   sharding. A coordinator partitions the alternatives into slices
+ *   and each worker (process or node) creates a frame holding only
+ *   its slice of the P- and V-bases. The psi results of different
+ *   alternatives are independent as long as no statement relates
+ *   alternatives in different slices. A worker reads the shard of
+ *   its frame, one record of SHARD_REC doubles per alternative: the
+ *   EV range and the moments. The coordinator concatenates the shards
+ *   in alternative order and evaluates delta, gamma, psi and digamma
+ *   for any alternative from them. The number of alternatives is not
+ *   bounded by MAX_ALTS on the coordinator side. The rules are applied
+ *   in the same order as in TCL and rule_mass, so the results equal
+ *   those of DTL_evaluate_frame on a frame holding all the slices.
+ *
+ *   Included from DTLeval.c, shares its evaluation result area.
+ *
+ *
+ *   Functions exported outside DTL
+ *   ------------------------------
+ *   DTL_get_shard
+ *   DTL_evaluate_shards
+ *
+ *   Functions outside of module, inside DTL
+ *   ---------------------------------------
+ *   NONE
+ *
+ *   Functions internal to module
+ *   ----------------------------
+ *   shard_rule
+ *
+ */
+
+
+ /*********************************************************
+  *
+  *  Worker side
+  *
+  *********************************************************/
+
+/* Field f of the record of alternative a */
+#define SH(shard,a,f) (shard)[((a)-1)*SHARD_REC+(f)]
+
+static a_row sh_rm1,sh_cm2,sh_cm3;
+
+rcode DTLAPI DTL_get_shard(int crit, int n_alts, double shard[]) {
+	int a;
+	struct d_frame *df;
+
+	/* Begin single thread semaphore */
+	_smx_begin("SHARD");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_get_shard(%d,%d)\n",crit,n_alts);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(shard,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	/* Check input parameters */
+	if (load_df1(crit))
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	df = uf->df;
+	if (n_alts < df->n_alts)
+		return dtl_error(DTL_BUFFER_OVERRUN);
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	/* Psi results and moments of all alternatives */
+	if (call(TCL_evaluate_all(df,eval_result),"TCL_evaluate_all"))
+		return dtl_kernel_error();
+	if (call(TCL_get_moments(df,sh_rm1,sh_cm2,sh_cm3),"TCL_get_moments"))
+		return dtl_kernel_error();
+	for (a=1; a<=df->n_alts; a++) {
+		SH(shard,a,SH_MIN) = eval_result[a][E_MIN];
+		SH(shard,a,SH_MID) = eval_result[a][E_MID];
+		SH(shard,a,SH_MAX) = eval_result[a][E_MAX];
+		SH(shard,a,SH_RM1) = sh_rm1[a];
+		SH(shard,a,SH_CM2) = sh_cm2[a];
+		SH(shard,a,SH_CM3) = sh_cm3[a];
+		}
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+ /*********************************************************
+  *
+  *  Coordinator side
+  *
+  *********************************************************/
+
+/* Range (r_result[E_MIN..E_MAX]) and moments of the rule for Ai, in
+ * the order of calc_psi/delta/gamma/digamma and rule_mass */
+
+static void shard_rule(int m_field, int Ai, int Aj, int n_alts, double shard[], 
+		double r_result[], double moments[]) {
+	int j,n_active,n_bits;
+	double scale,m1,m2,m3;
+
+	r_result[E_MIN] = SH(shard,Ai,SH_MIN);
+	r_result[E_MID] = SH(shard,Ai,SH_MID);
+	r_result[E_MAX] = SH(shard,Ai,SH_MAX);
+	m1 = SH(shard,Ai,SH_RM1);
+	m2 = SH(shard,Ai,SH_CM2);
+	m3 = SH(shard,Ai,SH_CM3);
+	switch (m_field) {
+		case E_DELTA:
+			r_result[E_MIN] = SH(shard,Ai,SH_MIN)-SH(shard,Aj,SH_MAX);
+			r_result[E_MID] = SH(shard,Ai,SH_MID)-SH(shard,Aj,SH_MID);
+			r_result[E_MAX] = SH(shard,Ai,SH_MAX)-SH(shard,Aj,SH_MIN);
+			m1 = SH(shard,Ai,SH_RM1)-SH(shard,Aj,SH_RM1);
+			m2 = SH(shard,Ai,SH_CM2)+SH(shard,Aj,SH_CM2);
+			m3 = SH(shard,Ai,SH_CM3)-SH(shard,Aj,SH_CM3);
+			break;
+		case E_GAMMA:
+			scale = n_alts - 1.0;
+			for (j=1; j<=n_alts; j++)
+				if (j != Ai) {
+					r_result[E_MIN] -= SH(shard,j,SH_MAX)/scale;
+					r_result[E_MID] -= SH(shard,j,SH_MID)/scale;
+					r_result[E_MAX] -= SH(shard,j,SH_MIN)/scale;
+					m1 -= SH(shard,j,SH_RM1)/(double)(n_alts-1);
+					m2 += SH(shard,j,SH_CM2)/(double)(n_alts-1);
+					m3 -= SH(shard,j,SH_CM3)/(double)(n_alts-1);
+					}
+			break;
+		case E_DIGAMMA:
+			n_bits = min(n_alts,DIGAMMA_BITS);
+			m1 = m2 = m3 = 0.0;
+			for (n_active=0, j=1; j<=n_bits; j++)
+				if ((j!=Ai) && (Aj&(0x01<<(j-1)))) {
+					m1 -= SH(shard,j,SH_RM1);
+					m2 += SH(shard,j,SH_CM2);
+					m3 -= SH(shard,j,SH_CM3);
+					n_active++;
+					}
+			scale = n_active;
+			if (n_active) {
+				for (j=1; j<=n_bits; j++)
+					if ((j!=Ai) && (Aj&(0x01<<(j-1)))) {
+						r_result[E_MIN] -= SH(shard,j,SH_MAX)/scale;
+						r_result[E_MID] -= SH(shard,j,SH_MID)/scale;
+						r_result[E_MAX] -= SH(shard,j,SH_MIN)/scale;
+						}
+				m1 /= (double)n_active;
+				m2 /= (double)n_active;
+				m3 /= (double)n_active;
+				}
+			m1 += SH(shard,Ai,SH_RM1);
+			m2 += SH(shard,Ai,SH_CM2);
+			m3 += SH(shard,Ai,SH_CM3);
+			break;
+		}
+	moments[0] = m1;
+	moments[1] = m2;
+	moments[2] = m3;
+	}
+
+
+/* The shard holds the records of n_alts alternatives in alternative
+ * order. Does not need a loaded frame. The result is e_result as from
+ * DTL_evaluate_frame and the rule moments (mean, variance, third central
+ * moment) as from DTI_get_mass_moments. */
+
+rcode DTLAPI DTL_evaluate_shards(int method, int Ai, int Aj, int n_alts, double shard[], 
+		e_matrix e_result, double moments[]) {
+	int m_field;
+	double r_result[MAX_ERESULT+1];
+
+	/* Begin single thread semaphore */
+	_smx_begin("EVSH");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_evaluate_shards(%d,%d,%d,%d)\n",method,Ai,Aj,n_alts);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(shard,1);
+	_certify_ptr(e_result,2);
+	_certify_ptr(moments,3);
+	/* Check input parameters */
+	m_field = method & M_EVAL;
+	if ((Ai < 1) || (Ai > n_alts))
+		return dtl_error(DTL_ALT_UNKNOWN);
+	switch (m_field) {
+		case E_DELTA:
+			if ((Aj < 1) || (Aj > n_alts))
+				return dtl_error(DTL_ALT_UNKNOWN);
+			if (Ai == Aj)
+				return dtl_error(DTL_INPUT_ERROR);
+			break;
+		case E_GAMMA:
+			if (n_alts < 2)
+				return dtl_error(DTL_TOO_FEW_ALTS);
+			break;
+		case E_PSI:
+			break;
+		case E_DIGAMMA:
+			if ((Ai <= DIGAMMA_BITS) && (0x01<<(Ai-1) & Aj))
+				return dtl_error(DTL_INPUT_ERROR);
+			break;
+		default:
+			return dtl_error(DTL_WRONG_METHOD);
+		}
+	/* Combine the records */
+	shard_rule(m_field,Ai,Aj,n_alts,shard,r_result,moments);
+	e_result[E_MIN][0] = r_result[E_MIN];
+	e_result[E_MID][0] = r_result[E_MID];
+	e_result[E_MAX][0] = r_result[E_MAX];
+	/* Log function result */
+	if (cst_ext) {
+		sprintf(msg," %6.3lf %6.3lf %6.3lf\n",e_result[E_MIN][0],e_result[E_MID][0],e_result[E_MAX][0]);
+		cst_log(msg);
+		}
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
@@ -0,0 +1,553 @@
+/*
+ *
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ *
+ *
+ *                   UNEDA Decision Tree Layer (DTL)
+ *                   -------------------------------
+ *
+ *    +----- o o o ------------------------------------------------+
+ *    |    o       o              Prof. Mats Danielson             |
+ *    |   o  STHLM  o             DECIDE Research Group            |
+ *    |   o         o    Dept. of Computer and Systems Sciences    |
+ *    |   o   UNI   o             Stockholm University             |
+ *    |    o       o      PO Box 1203, SE-164 25 Kista, SWEDEN     |
+ *    +----- o o o ------------------------------------------------+
+ *
+ *                Copyright (c) 2012-2025 Mats Danielson
+ *                     Email: mats.danielson@su.se
+ *
+ */
+
+/*
+ *   File: DTLsnap.c
+ *
+ *   Purpose: evaluation snapshots for concurrent readers
+ *
+ *   A snapshot is an immutable image of the evaluation state of the
+ *   loaded frame. Its TCL frames are forks of those of the frame,
+ *   sharing the bases copy-on-write, and are attached and evaluated
+ *   once when the snapshot is built, so that the hulls, mass points
+ *   and EV tables are in place before it is published under the frame
+ *   number. Nothing in a published snapshot is written to thereafter.
+ *
+ *   Any number of threads can acquire the current snapshot of a frame,
+ *   evaluate against it and release it. These reader calls neither
+ *   enter the single thread semaphore nor take locks, so they run
+ *   alongside each other and alongside an editor changing the frame.
+ *   The editor publishes the next snapshot when it has reached a
+ *   consistent state, which swaps it in atomically (RCU style). The
+ *   snapshot it replaces is retired and is reclaimed by a later DTL
+ *   call once its last reader has released it. A reader that holds a
+ *   snapshot keeps evaluating against the same state throughout.
+ *
+ *   Reader calls do not log and do not count errors, they only return
+ *   them. They require PAR_EVAL, which makes the TCL working state
+ *   (frame bindings, scratch rows, evaluation tables) thread-local and
+ *   the counters atomic. Without it, the reader calls return
+ *   DTL_STATE_ERROR since a reader would evaluate in the editor's state.
+ *
+ *   Included from DTLmisc.c.
+ *
+ *
+ *   Functions exported outside DTL
+ *   ------------------------------
+ *   DTL_publish_snapshot
+ *   DTL_acquire_snapshot
+ *   DTL_evaluate_snapshot
+ *   DTL_release_snapshot
+ *
+ *   Functions outside of module, inside DTL
+ *   ---------------------------------------
+ *   snap_withdraw
+ *   snap_in_use
+ *   snap_release
+ *
+ *   Functions internal to module
+ *   ----------------------------
+ *   snap_slot
+ *   snap_dispose
+ *   snap_reclaim
+ *   snap_fork
+ *   snap_build
+ *   snap_crit
+ *
+ */
+
+
+ /*********************************************************
+  *
+  *  Snapshot table
+  *
+  *********************************************************/
+
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+#define snap_get(x) InterlockedCompareExchange(&(x),0,0)
+#define snap_set(x,v) InterlockedExchange(&(x),v)
+#define snap_inc(x) InterlockedIncrement(&(x))
+#define snap_dec(x) InterlockedDecrement(&(x))
+#define snap_get_ptr(x) InterlockedCompareExchangePointer((PVOID volatile *)&(x),NULL,NULL)
+#define snap_set_ptr(x,v) InterlockedExchangePointer((PVOID volatile *)&(x),(PVOID)(v))
+#else
+#define snap_get(x) __atomic_load_n(&(x),__ATOMIC_SEQ_CST)
+#define snap_set(x,v) __atomic_store_n(&(x),v,__ATOMIC_SEQ_CST)
+#define snap_inc(x) __atomic_add_fetch(&(x),1,__ATOMIC_SEQ_CST)
+#define snap_dec(x) __atomic_sub_fetch(&(x),1,__ATOMIC_SEQ_CST)
+#define snap_get_ptr(x) __atomic_load_n(&(x),__ATOMIC_SEQ_CST)
+#define snap_set_ptr(x,v) __atomic_store_n(&(x),v,__ATOMIC_SEQ_CST)
+#endif
+#else
+#define snap_get(x) (x)
+#define snap_set(x,v) ((x) = (v))
+#define snap_inc(x) (++(x))
+#define snap_dec(x) (--(x))
+#define snap_get_ptr(x) (x)
+#define snap_set_ptr(x,v) ((x) = (v))
+#endif
+
+/* Snapshot states */
+#define SNAP_LIVE    1 // published
+#define SNAP_RETIRED 2 // replaced, waiting for its readers
+
+/* The state is only changed by the editor (inside the semaphore). The
+ * reader count is never reset, so that a reader that has just let go
+ * of a reused slot leaves it balanced. */
+
+struct snap_rec {
+	int state;             // 0 = free, else SNAP_xxx
+	volatile long readers;
+	int frame_type;
+	int n_alts;
+	int n_crit;            // PS: 1
+	int n_crit1;           // criteria of the first stakeholder
+	struct d_frame *df_list[MAX_CRIT+1]; // PM: 0 = weights, PS: 1 = the frame
+	cr_col W_mid;          // PM: weight mass point of each criterion
+	};
+
+static struct snap_rec snaps[MAX_SNAPS+1];
+
+/* The snapshot published per frame (0 = none) is kept in chunks that
+ * are made when first published to and stay put, since readers look
+ * them up without locks while the frame registry may grow. */
+
+#define SNAP_CHUNK 1024
+
+static volatile long *volatile snap_dir[MAX_FRAME_NBR/SNAP_CHUNK+1];
+
+/* Editor scratch */
+static a_result snap_result;
+static d_row snap_W,snap_LW;
+
+#ifdef PAR_EVAL
+/* Reader scratch, one set per thread */
+static TCL_TLS a_result sn_result;
+static TCL_TLS d_row sn_lobo,sn_upbo,sn_point,im_sn_point;
+#endif
+
+
+/* Publication entry of frame ufnbr, NULL if none is made (and make
+ * is FALSE) or if out of memory */
+
+static volatile long *snap_slot(int ufnbr, bool make) {
+	int i;
+	volatile long *chunk;
+
+	chunk = snap_get_ptr(snap_dir[ufnbr/SNAP_CHUNK]);
+	if (!chunk && make) {
+		chunk = (volatile long *)mem_alloc(SNAP_CHUNK*sizeof(long),"long","snap_slot");
+		if (!chunk)
+			return NULL;
+		for (i=0; i<SNAP_CHUNK; i++)
+			chunk[i] = 0;
+		snap_set_ptr(snap_dir[ufnbr/SNAP_CHUNK],chunk);
+		}
+	return chunk ? chunk+ufnbr%SNAP_CHUNK : NULL;
+	}
+
+
+/* Dispose of the TCL frames of a snapshot, a shadow criterion
+ * shares the frame of its first stakeholder's criterion */
+
+static void snap_dispose(struct snap_rec *sp) {
+	int c;
+
+	for (c=0; c<=sp->n_crit; c++)
+		if (sp->df_list[c])
+			if ((c <= sp->n_crit1) || (sp->df_list[c] != sp->df_list[(c-1)%sp->n_crit1+1]))
+				call(TCL_dispose_frame(sp->df_list[c]),"TCL_dispose_frame");
+	for (c=0; c<=sp->n_crit; c++)
+		sp->df_list[c] = NULL;
+	sp->state = 0;
+	}
+
+
+/* Reclaim the retired snapshots that no reader holds any longer. A
+ * reader that has picked up the slot number but not yet counted itself
+ * in will find that the slot is no longer published and back off. */
+
+static void snap_reclaim() {
+	int s;
+
+	for (s=1; s<=MAX_SNAPS; s++)
+		if ((snaps[s].state == SNAP_RETIRED) && !snap_get(snaps[s].readers))
+			snap_dispose(snaps+s);
+	}
+
+
+/* Withdraw the published snapshot of frame ufnbr, if any */
+
+void snap_withdraw(int ufnbr) {
+	int s;
+	volatile long *pub;
+
+	if ((pub = snap_slot(ufnbr,FALSE)) && (s = snap_get(*pub))) {
+		snap_set(*pub,0);
+		snaps[s].state = SNAP_RETIRED;
+		}
+	snap_reclaim();
+	}
+
+
+/* TRUE if a reader holds a snapshot */
+
+bool snap_in_use() {
+	int s;
+
+	for (s=1; s<=MAX_SNAPS; s++)
+		if (snaps[s].state && snap_get(snaps[s].readers))
+			return TRUE;
+	return FALSE;
+	}
+
+
+/* Release all snapshots (at exit, when no reader holds any) */
+
+void snap_release() {
+	int s;
+
+	for (s=0; s<=MAX_FRAME_NBR/SNAP_CHUNK; s++)
+		if (snap_dir[s]) {
+			mem_free((void *)snap_dir[s]);
+			snap_set_ptr(snap_dir[s],NULL);
+			}
+	for (s=1; s<=MAX_SNAPS; s++)
+		if (snaps[s].state)
+			snap_dispose(snaps+s);
+	}
+
+
+ /*********************************************************
+  *
+  *  Building snapshots
+  *
+  *********************************************************/
+
+/* Fork df into *dfp and load it. Criterion frames are also evaluated
+ * once, which forms their EV tables, so that readers never write. */
+
+static rcode snap_fork(struct d_frame *df, struct d_frame **dfp, bool warm) {
+
+	if (call(TCL_fork_frame(df,dfp),"TCL_fork_frame")) {
+		*dfp = NULL;
+		return DTL_KERNEL_ERROR;
+		}
+	if (call(TCL_attach_frame(*dfp),"TCL_attach_frame"))
+		return DTL_KERNEL_ERROR;
+	if (warm)
+		if (call(TCL_evaluate_all(*dfp,snap_result),"TCL_evaluate_all"))
+			return DTL_KERNEL_ERROR;
+	return DTL_OK;
+	}
+
+
+/* Build a snapshot of the loaded frame in sp */
+
+static rcode snap_build(struct snap_rec *sp) {
+	int c,c1,t_inx;
+
+	for (c=0; c<=MAX_CRIT; c++)
+		sp->df_list[c] = NULL;
+	sp->frame_type = uf->frame_type;
+	sp->n_alts = uf->n_alts;
+	if (!PM) {
+		sp->n_crit = sp->n_crit1 = 1;
+		return snap_fork(uf->df,&(sp->df_list[1]),TRUE);
+		}
+	sp->n_crit = uf->n_crit;
+	sp->n_crit1 = uf->n_crit/uf->n_sh;
+	for (c=0; c<=uf->n_crit; c++) {
+		if (!uf->df_list[c])
+			continue;
+		c1 = (c-1)%sp->n_crit1+1;
+		if ((c > sp->n_crit1) && (uf->df_list[c] == uf->df_list[c1]))
+			sp->df_list[c] = sp->df_list[c1]; // shadow
+		else if (snap_fork(uf->df_list[c],&(sp->df_list[c]),c>0))
+			return DTL_KERNEL_ERROR;
+		}
+	/* Weight of each criterion at the mass point */
+	if (call(TCL_get_P_masspoint(sp->df_list[0],snap_W,snap_LW),"TCL_get_P_masspoint"))
+		return DTL_KERNEL_ERROR;
+	for (c=1; c<=uf->n_crit; c++) {
+		if (!(t_inx = TCL_get_tot_index(1,c)))
+			return DTL_INTERNAL_ERROR;
+		sp->W_mid[c] = snap_W[t_inx];
+		}
+	return DTL_OK;
+	}
+
+
+ /*
+  * Call semantics: Build a snapshot of the current state of the loaded
+  * frame and publish it under the frame number, replacing the one
+  * published before (if any). Readers that hold the old one keep it
+  * until they release it. Called by the editor, typically after a
+  * group of changes that belong together.
+  */
+
+rcode DTLAPI DTL_publish_snapshot() {
+	rcode rc;
+	int s,old;
+	volatile long *pub;
+
+	/* Begin single thread semaphore */
+	_smx_begin("PUBS");
+	/* Log function call */
+	if (cst_on)
+		cst_log("DTL_publish_snapshot()\n");
+	/* Check if function can start */
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (dtl_error_count)
+		return dtl_error(DTL_OUTPUT_ERROR);
+	if (!(pub = snap_slot(frame_loaded,TRUE)))
+		return dtl_error(DTL_BUFFER_OVERRUN);
+	/* Find free slot */
+	snap_reclaim();
+	for (s=1; s<=MAX_SNAPS; s++)
+		if (!snaps[s].state)
+			break;
+	if (s > MAX_SNAPS)
+		return dtl_error(DTL_BUFFER_OVERRUN);
+	/* Build it in full before it can be seen */
+	if (rc = snap_build(snaps+s)) {
+		snap_dispose(snaps+s);
+		return rc==DTL_KERNEL_ERROR ? dtl_kernel_error() : dtl_error(rc);
+		}
+	snaps[s].state = SNAP_LIVE;
+	/* Swap it in */
+	old = snap_get(*pub);
+	snap_set(*pub,s);
+	if (old)
+		snaps[old].state = SNAP_RETIRED;
+	snap_reclaim();
+	if (cst_on) {
+		sprintf(msg," DTL_publish_snapshot: %d\n",s);
+		cst_log(msg);
+		}
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
+ /*********************************************************
+  *
+  *  Reading snapshots
+  *
+  *********************************************************/
+
+#ifdef PAR_EVAL
+
+ /*
+  * Call semantics: Acquire the snapshot currently published for frame
+  * ufnbr. It stays the same until released, regardless of later
+  * publishing. Can be called from any thread at any time.
+  */
+
+rcode DTLAPI DTL_acquire_snapshot(int ufnbr, int *snap) {
+	int s;
+	volatile long *pub;
+
+	/* Check if function can start */
+	_certify_ptr(snap,1);
+	if (!dtl_init)
+		return DTL_STATE_ERROR;
+	/* Check input parameters */
+	if ((ufnbr < 1) || (ufnbr > MAX_FRAME_NBR))
+		return DTL_FRAME_UNKNOWN;
+	if (!(pub = snap_slot(ufnbr,FALSE)))
+		return DTL_STATE_ERROR; // none published
+	for (;;) {
+		if (!(s = snap_get(*pub)))
+			return DTL_STATE_ERROR; // none published
+		snap_inc(snaps[s].readers);
+		if (snap_get(*pub) == s)
+			break;
+		/* Replaced in between, try the new one */
+		snap_dec(snaps[s].readers);
+		}
+	*snap = s;
+	return DTL_OK;
+	}
+
+
+ /*
+  * Call semantics: Release snapshot snap, acquired by the caller
+  */
+
+rcode DTLAPI DTL_release_snapshot(int snap) {
+
+	/* Check input parameters */
+	if ((snap < 1) || (snap > MAX_SNAPS))
+		return DTL_INPUT_ERROR;
+	if (snap_get(snaps[snap].readers) < 1)
+		return DTL_STATE_ERROR;
+	/* The frames may be disposed of by the editor from now on
+	 * (the binding is thread-local, the editor's is kept) */
+	TCL_unbind_frame();
+	snap_dec(snaps[snap].readers);
+	return DTL_OK;
+	}
+
+
+/* Evaluate one frame of a snapshot into sn_result */
+
+static rcode snap_crit(struct d_frame *df, int eval_rule, int Ai, int Aj) {
+	rcode rc;
+
+	if (rc = TCL_evaluate(df,Ai,Aj,eval_rule,sn_result))
+		return DTL_KERNEL_ERROR+rc;
+	return DTL_OK;
+	}
+
+
+ /*
+  * Call semantics: Evaluate Ai (and Aj) in criterion crit of snapshot
+  * snap as DTL_evaluate_frame does, into the EV range and mid entries
+  * e_result[E_MIN..E_MAX][0]. For crit 0 in a PM frame, the MC range
+  * is found over the weight tree and the mid is the mass point EV.
+  * Can be called from any thread while the snapshot is held.
+  */
+
+rcode DTLAPI DTL_evaluate_snapshot(int snap, int crit, int method, int Ai, int Aj, e_matrix e_result) {
+	rcode rc;
+	int c,m_field,eval_rule;
+	double mid,minval,maxval;
+	struct snap_rec *sp;
+
+	/* Check if function can start */
+	_certify_ptr(e_result,1);
+	if ((snap < 1) || (snap > MAX_SNAPS))
+		return DTL_INPUT_ERROR;
+	sp = snaps+snap;
+	if (snap_get(sp->readers) < 1)
+		return DTL_STATE_ERROR; // not acquired
+	/* Process eval rule */
+	m_field = method & M_EVAL;
+	switch (m_field) {
+		case E_DELTA:
+			eval_rule = DELTA;   break;
+		case E_GAMMA:
+			eval_rule = GAMMA;   break;
+		case E_PSI:
+			eval_rule = PSI;     break;
+		case E_DIGAMMA:
+			eval_rule = DIGAMMA; break;
+		default:
+			return DTL_WRONG_METHOD;
+		}
+	/* Process alternatives */
+	if ((Ai < 1) || (Ai > sp->n_alts))
+		return DTL_ALT_UNKNOWN;
+	if (eval_rule == DELTA) {
+		/* Check Aj also */
+		if ((Aj < 1) || (Aj > sp->n_alts))
+			return DTL_ALT_UNKNOWN;
+		if (Ai == Aj)
+			return DTL_INPUT_ERROR;
+		}
+	else if (eval_rule < DIGAMMA)
+		Aj = 0;
+	/* One criterion */
+	if (crit || (sp->frame_type != PM_FRAME)) {
+		if ((crit < 1) || (crit > sp->n_crit) || !sp->df_list[crit])
+			return DTL_CRIT_UNKNOWN;
+		if (rc = snap_crit(sp->df_list[crit],eval_rule,Ai,Aj))
+			return rc;
+		e_result[E_MIN][0] = sn_result[Ai][E_MIN];
+		e_result[E_MID][0] = sn_result[Ai][E_MID];
+		e_result[E_MAX][0] = sn_result[Ai][E_MAX];
+		return DTL_OK;
+		}
+	/* MC over all criteria, stand-in evaluation for empty ones */
+	mid = 0.0;
+	for (c=1; c<=sp->n_crit; c++) {
+		if (!sp->df_list[c]) {
+			sn_upbo[c] = 1.0;
+			if ((m_field == E_PSI) || ((m_field == E_DIGAMMA) && !Aj)) {
+				sn_lobo[c] = 0.0;
+				mid += sp->W_mid[c] * 0.5;
+				}
+			else
+				sn_lobo[c] = -1.0;
+			}
+		else {
+			if (rc = snap_crit(sp->df_list[c],eval_rule,Ai,Aj))
+				return rc;
+			sn_lobo[c] = sn_result[Ai][E_MIN];
+			sn_upbo[c] = sn_result[Ai][E_MAX];
+			mid += sp->W_mid[c] * sn_result[Ai][E_MID];
+			}
+		}
+	if (rc = TCL_get_P_min(sp->df_list[0],1,0,sn_lobo,sn_point,im_sn_point,FALSE,&minval))
+		return DTL_KERNEL_ERROR+rc;
+	if (rc = TCL_get_P_max(sp->df_list[0],1,0,sn_upbo,sn_point,im_sn_point,TRUE,&maxval))
+		return DTL_KERNEL_ERROR+rc;
+	e_result[E_MIN][0] = -minval;
+	e_result[E_MID][0] = mid;
+	e_result[E_MAX][0] = maxval;
+	return DTL_OK;
+	}
+
+#else
+
+/* The TCL working state is shared between threads, no readers */
+
+rcode DTLAPI DTL_acquire_snapshot(int ufnbr, int *snap) {
+
+	return DTL_STATE_ERROR;
+	}
+
+
+rcode DTLAPI DTL_release_snapshot(int snap) {
+
+	return DTL_STATE_ERROR;
+	}
+
+
+rcode DTLAPI DTL_evaluate_snapshot(int snap, int crit, int method, int Ai, int Aj, e_matrix e_result) {
+
+	return DTL_STATE_ERROR;
+	}
+
+#endif
@@ -47,29 +47,49 @@
  *   Functions exported outside DTL
  *   ------------------------------
  *   DTL_get_P_tornado
+ *   DTL_get_P_tornado_n
  *   DTL_get_MCP_tornado
+ *   DTL_get_MCP_tornado_n
  *   DTL_get_V_tornado
+ *   DTL_get_V_tornado_n
  *   DTL_get_MCV_tornado
+ *   DTL_get_MCV_tornado_n
  *   DTL_get_W_tornado
+ *   DTL_get_W_tornado_n
  *   DTL_get_W_tornado_alt
  *   DTL_get_cons_influence
+ *   DTL_get_cons_influence_n
  *
  *   Functions outside of module, inside DTL
  *   ---------------------------------------
- *   NONE
+ *   tornado_release
  *
  *   Functions internal to module
  *   ----------------------------
+ *   set_t_rows
+ *   check_t_size
+ *   log_tornado
  *   rollback_PW_base
  *   dtl_mass_PW_tornado
  *   dtl_get_PW_tornado
+ *   get_P_tornado
  *   dtl_get_MCP_tornado
+ *   get_MCP_tornado
  *   rollback_V_base
  *   dtl_mass_V_tornado
  *   dtl_get_V_tornado
+ *   get_V_tornado
  *   dtl_get_MCV_tornado
+ *   get_MCV_tornado
+ *   w_buffer
  *   dtl_get_W_tornado
+ *   wa_buffer
+ *   wa_node
+ *   run_wa_job
+ *   wa_worker (PAR_EVAL)
+ *   dtl_get_W_tornado_all
  *   dtl_get_cons_influence
+ *   get_cons_influence
  *
  */
 
@@ -103,6 +123,14 @@
 
 #include "DTL.h"
 #include "DTLinternal.h"
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
 
 
  /********************************************************
@@ -113,6 +141,12 @@
 
 #define T_EPS 4.0E-6 // must be larger than 2*CAR_EPS
 
+#ifdef PAR_EVAL
+#define MAX_WA_WORKERS 16 // as MAX_WORKERS in DTLeval.c
+#else
+#define MAX_WA_WORKERS 1
+#endif
+
 
  /*********************************************************
   *
@@ -124,6 +158,47 @@ static e_matrix t_result;
 static d_row h_lobo,h_upbo,m_lobo,m_upbo,ms_lobo,ms_upbo;
 static d_row W_mid,LW_mid,V_mid;
 
+/* Tornado output: cons j of alt i is at T_CELL(t,i,j). For h_matrix
+ * callers t points to [1][1] and the rows have the h_vector stride,
+ * for the _n variants the rows are tightly packed in node order. */
+
+static int t_rows[MAX_ALTS+1];
+#define T_CELL(t,i,j) (t)[t_rows[i]+(j)-1]
+
+static void set_t_rows(struct d_frame *df, int stride) {
+	int i,k;
+
+	for (k=0,i=1; i<=df->n_alts; i++) {
+		t_rows[i] = stride?(i-1)*stride:k;
+		k += df->tot_cons[i];
+		}
+	}
+
+
+/* A packed buffer must hold all nodes of the criterion */
+
+static rcode check_t_size(int crit, int stride, int n_nodes) {
+
+	if (stride)
+		return DTL_OK;
+	if (load_df1(crit))
+		return DTL_CRIT_UNKNOWN;
+	if (n_nodes < uf->df->tot_cons[0])
+		return DTL_BUFFER_OVERRUN;
+	return DTL_OK;
+	}
+
+
+static void log_tornado(char *var, int crit, double *t_lobo, double *t_upbo) {
+	int i,j;
+
+	for (i=1; i<=uf->df->n_alts; i++)
+		for (j=1; j<=uf->df->tot_cons[i]; j++) {
+			sprintf(msg,"    %s%d.%d.%-2d [%.3lf %.3lf]\n",var,crit,i,j,T_CELL(t_lobo,i,j),T_CELL(t_upbo,i,j));
+			cst_log(msg);
+			}
+	}
+
 
  /*********************************************************
   *
@@ -140,7 +215,7 @@ static void rollback_PW_base(int pstmt, d_row lobo, d_row upbo) {
 	}
 
 
-static rcode dtl_mass_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode dtl_mass_PW_tornado(int crit, int mode, double *t_lobo, double *t_upbo) {
 	rcode rc;
 	int i,j,k,alt,sym,global_cst;
 	double baseline_ev,baseline_mass;
@@ -185,33 +260,33 @@ static rcode dtl_mass_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 			}
 		for (j=1; j<=df->tot_cons[i]; j++,k++) {
 			/* Convert EV into mass in situ */
-			sym = fabs(t_upbo[i][j]+t_lobo[i][j]) < 2.0E-4;
-			if (t_lobo[i][j] < -DTL_EPS) {
-				if (rc = dtl_ev_to_cdf(crit,max(baseline_ev+t_lobo[i][j],0.0),t_lobo[i]+j)) {
+			sym = fabs(T_CELL(t_upbo,i,j)+T_CELL(t_lobo,i,j)) < 2.0E-4;
+			if (T_CELL(t_lobo,i,j) < -DTL_EPS) {
+				if (rc = dtl_ev_to_cdf(crit,max(baseline_ev+T_CELL(t_lobo,i,j),0.0),&T_CELL(t_lobo,i,j))) {
 					if (!mode)
 						rollback_PW_base(0,ms_lobo,ms_upbo); // restore
 					cst_on = global_cst;
 					return rc;
 					}
-				t_lobo[i][j] = baseline_mass-t_lobo[i][j];
+				T_CELL(t_lobo,i,j) = baseline_mass-T_CELL(t_lobo,i,j);
 				}
 			else
-				t_lobo[i][j] = 0.0;
-			if (t_upbo[i][j] > DTL_EPS) {
-				if (rc = dtl_ev_to_cdf(crit,min(baseline_ev+t_upbo[i][j],1.0),t_upbo[i]+j)) {
+				T_CELL(t_lobo,i,j) = 0.0;
+			if (T_CELL(t_upbo,i,j) > DTL_EPS) {
+				if (rc = dtl_ev_to_cdf(crit,min(baseline_ev+T_CELL(t_upbo,i,j),1.0),&T_CELL(t_upbo,i,j))) {
 					if (!mode)
 						rollback_PW_base(0,ms_lobo,ms_upbo); // restore
 					cst_on = global_cst;
 					return rc;
 					}
-				t_upbo[i][j] = baseline_mass-t_upbo[i][j];
+				T_CELL(t_upbo,i,j) = baseline_mass-T_CELL(t_upbo,i,j);
 				}
 			else
-				t_upbo[i][j] = 0.0;
+				T_CELL(t_upbo,i,j) = 0.0;
 			/* Rebalance to counter the Ericsson effect */
 			if (sym) {
-				t_upbo[i][j] = (t_upbo[i][j]-t_lobo[i][j])/2.0;
-				t_lobo[i][j] = -t_upbo[i][j];
+				T_CELL(t_upbo,i,j) = (T_CELL(t_upbo,i,j)-T_CELL(t_lobo,i,j))/2.0;
+				T_CELL(t_lobo,i,j) = -T_CELL(t_upbo,i,j);
 				}
 			}
 		}
@@ -223,9 +298,9 @@ static rcode dtl_mass_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 	}
 
 
-static rcode dtl_get_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode dtl_get_PW_tornado(int crit, int mode, int stride, double *t_lobo, double *t_upbo) {
 	rcode rc;
-	int i,j,k,jj,kk,ts_nbr,global_cst;
+	int i,j,k,jj,kk,global_cst;
 	int h_start;
 	double bound1,bound2,baseline_ev,h_sum,th_lo_bound,th_up_bound;
 	struct stmt_rec stmt;
@@ -235,6 +310,7 @@ static rcode dtl_get_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_
 	if (load_df0(crit))
 		return DTL_CRIT_UNKNOWN;
 	df = uf->df;
+	set_t_rows(df,stride);
 	/* Clean mode field */
 	mode &= 0x01;
 	if (uf->WP_autogen[crit])
@@ -263,24 +339,20 @@ static rcode dtl_get_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_
 			return dtl_kernel_error();
 			}
 		}
-	/* Insert dummy P-statement */
+	/* Probe statement (what-if, never entered into the base) */
 	stmt.n_terms = 1;
-	stmt.alt[1] = 1;
-	stmt.cons[1] = 1;
 	stmt.sign[1] = 1;
-	stmt.lobo = 0.0;
-	stmt.upbo = 1.0;
-	if (call(TCL_add_P_constraint(df,&stmt),"TCL_add_P_constraint")) {
-		rollback_PW_base(0,ms_lobo,ms_upbo);
-		cst_on = global_cst;
-		return dtl_kernel_error();
-		}
-	ts_nbr = df->P_base->n_stmts;
 	for (k=1,i=1; i<=df->n_alts; i++) {
+		if (crit) // W tornado reports per alternative itself
+			dtl_progress(i-1,df->n_alts);
+		if (dtl_abort_request) {
+			rollback_PW_base(0,ms_lobo,ms_upbo);
+			cst_on = global_cst;
+			}
 		dtl_abort_check();
 		h_start = k;
 		if (rc = evaluate_frame(crit,E_PSI,i,0,t_result)) {
-			rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
+			rollback_PW_base(0,ms_lobo,ms_upbo);
 			cst_on = global_cst;
 			return rc;
 			}
@@ -330,96 +402,48 @@ static rcode dtl_get_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_
 			else
 				/* Mode 0: midpoint removed */
 				th_up_bound = min(h_upbo[k],1.0);
-			/* Remove midpoint for this consequence */
-			if (mode) {
-				m_lobo[j] = -1.0;
-				m_upbo[j] = -1.0;
-				/* Set mhull */
-				if (call(TCL_set_P_mbox(df,m_lobo,m_upbo),"TCL_set_P_mbox")) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
-					cst_on = global_cst;
-					return dtl_kernel_error();
-					}
-				}
 			/* Find movement in mass point */
 			if (th_up_bound-th_lo_bound < 5.0*T_EPS)
 				/* Narrow trap */
-				t_lobo[i][j] = t_upbo[i][j] = 0.0;
+				T_CELL(t_lobo,i,j) = T_CELL(t_upbo,i,j) = 0.0;
 			else {
-				/* Prepare statement */
+				/* Mode 1: the probes remove the midpoint for this consequence */
 				stmt.alt[1] = i;
 				stmt.cons[1] = j;
+				/* Explore lower boundary */
 				stmt.lobo = max(th_lo_bound,0.0);
 				stmt.upbo = min(th_lo_bound+T_EPS,1.0);
-				/* Explore lower boundary */
-				if (call(TCL_replace_P_constraint(df,ts_nbr,&stmt),"TCL_replace_P_constraint")) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
+				if (call(TCL_probe_P(df,&stmt,mode,&bound1),"TCL_probe_P")) {
+					rollback_PW_base(0,ms_lobo,ms_upbo);
 					cst_on = global_cst;
 					return dtl_kernel_error();
 					}
-				if (dtl_abort_request) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
-					cst_on = global_cst;
-					}
-				dtl_abort_check();
-				if (rc = evaluate_frame(crit,E_PSI,i,0,t_result)) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
-					cst_on = global_cst;
-					return rc;
-					}
-				bound1 = t_result[E_MID][0];
 				/* Explore upper boundary */
-				if (call(TCL_change_P_constraint(df,ts_nbr,max(th_up_bound-T_EPS,0.0),
-						min(th_up_bound,1.0)),"TCL_change_P_constraint")) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
+				stmt.lobo = max(th_up_bound-T_EPS,0.0);
+				stmt.upbo = min(th_up_bound,1.0);
+				if (call(TCL_probe_P(df,&stmt,mode,&bound2),"TCL_probe_P")) {
+					rollback_PW_base(0,ms_lobo,ms_upbo);
 					cst_on = global_cst;
 					return dtl_kernel_error();
 					}
-				if (dtl_abort_request) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
-					cst_on = global_cst;
-					}
-				dtl_abort_check();
-				if (rc = evaluate_frame(crit,E_PSI,i,0,t_result)) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
-					cst_on = global_cst;
-					return rc;
-					}
-				bound2 = t_result[E_MID][0];
 				/* An increase in P can decrease EV and v.v. -> must sort boundaries */
 				if (bound1 < bound2) {
-					t_lobo[i][j] = bound1 - baseline_ev;
-					t_upbo[i][j] = bound2 - baseline_ev;
+					T_CELL(t_lobo,i,j) = bound1 - baseline_ev;
+					T_CELL(t_upbo,i,j) = bound2 - baseline_ev;
 					}
 				else {
-					t_lobo[i][j] = bound2 - baseline_ev;
-					t_upbo[i][j] = bound1 - baseline_ev;
+					T_CELL(t_lobo,i,j) = bound2 - baseline_ev;
+					T_CELL(t_upbo,i,j) = bound1 - baseline_ev;
 					}
 				/* Catch roundoff errors */
-				if (t_lobo[i][j] > -T_EPS)
-					t_lobo[i][j] = 0.0;
-				if (t_upbo[i][j] < +T_EPS)
-					t_upbo[i][j] = 0.0;
-				}
-			/* Clean-up for next variable */
-			if (call(TCL_change_P_constraint(df,ts_nbr,0.0,1.0),"TCL_change_P_constraint")) {
-				rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
-				cst_on = global_cst;
-				return dtl_kernel_error();
-				}
-			if (mode) {
-				/* Restore mhull */
-				m_lobo[k] = ms_lobo[k];
-				m_upbo[k] = ms_upbo[k];
-				if (call(TCL_set_P_mbox(df,m_lobo,m_upbo),"TCL_set_P_mbox")) {
-					rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
-					cst_on = global_cst;
-					return dtl_kernel_error();
-					}
+				if (T_CELL(t_lobo,i,j) > -T_EPS)
+					T_CELL(t_lobo,i,j) = 0.0;
+				if (T_CELL(t_upbo,i,j) < +T_EPS)
+					T_CELL(t_upbo,i,j) = 0.0;
 				}
 			}
 		}
-	rollback_PW_base(ts_nbr,ms_lobo,ms_upbo);
+	rollback_PW_base(0,ms_lobo,ms_upbo);
 	eval_cache_invalidate();
 	cst_on = global_cst;
 	return DTL_OK;
@@ -430,15 +454,14 @@ static rcode dtl_get_PW_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_
  *       1 = Force floating midpoint
  *      +2 = Belief mass output */
 
-rcode DTLAPI DTL_get_P_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode get_P_tornado(int crit, int mode, int stride, int n_nodes, double *t_lobo, double *t_upbo) {
 	rcode rc;
-	int i,j;
 
 	/* Begin single thread semaphore */
-	_smx_begin("TOP");
+	_smx_begin(stride?"TOP":"TOPN");
 	/* Log function call */
 	if (cst_on) {
-		sprintf(msg,"DTL_get_P_tornado(%d,%d)\n",crit,mode);
+		sprintf(msg,"DTL_get_P_tornado%s(%d,%d)\n",stride?"":"_n",crit,mode);
 		cst_log(msg);
 		}
 	/* Check if function can start */
@@ -452,9 +475,11 @@ rcode DTLAPI DTL_get_P_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_u
 		return dtl_error(DTL_CRIT_UNKNOWN);
 	if ((mode < 0) || (mode > 3))
 		return dtl_error(DTL_INPUT_ERROR);
+	if (rc = check_t_size(crit,stride,n_nodes))
+		return dtl_error(rc);
 	mode ^= 0x01; // flip lowest mode bit (compat reasons)
 	/* Get tornado */
-	if (rc = dtl_get_PW_tornado(crit,mode,t_lobo,t_upbo))
+	if (rc = dtl_get_PW_tornado(crit,mode,stride,t_lobo,t_upbo))
 		return dtl_error(rc);
 	if (mode&0x02) {
 		if (rc = dtl_mass_PW_tornado(crit,mode,t_lobo,t_upbo))
@@ -462,20 +487,30 @@ rcode DTLAPI DTL_get_P_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_u
 		}
 	/* Log function result */
 	if (cst_ext)
-		for (i=1; i<=uf->df->n_alts; i++)
-			for (j=1; j<=uf->df->tot_cons[i]; j++) {
-				sprintf(msg,"    P%d.%d.%-2d [%.3lf %.3lf]\n",crit,i,j,t_lobo[i][j],t_upbo[i][j]);
-				cst_log(msg);
-				}
+		log_tornado("P",crit,t_lobo,t_upbo);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
 	}
 
 
-static h_matrix x_lobo,x_upbo;
+rcode DTLAPI DTL_get_P_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
 
-static rcode dtl_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+	return get_P_tornado(crit,mode,MAX_NOPA+1,0,M_BASE(t_lobo),M_BASE(t_upbo));
+	}
+
+
+/* Caller-sized variant: the n_nodes entries of t_lobo and t_upbo hold
+ * the nodes of the criterion in node order, alternative by alternative
+ * (DTL_total_nodes(crit) entries are needed) */
+
+rcode DTLAPI DTL_get_P_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]) {
+
+	return get_P_tornado(crit,mode,0,n_nodes,t_lobo,t_upbo);
+	}
+
+
+static rcode dtl_get_MCP_tornado(int crit, int mode, int stride, double *t_lobo, double *t_upbo) {
 	rcode rc;
 	int i,j,node;
 
@@ -483,7 +518,7 @@ static rcode dtl_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 	if (!crit)
 		return DTL_CRIT_UNKNOWN;
 	/* Get local tornado in criterion */
-	if (rc = dtl_get_PW_tornado(crit,mode,t_lobo,t_upbo))
+	if (rc = dtl_get_PW_tornado(crit,mode,stride,t_lobo,t_upbo))
 		return rc;
 	if (mode&0x02) {
 		if (rc = dtl_mass_PW_tornado(crit,mode,t_lobo,t_upbo))
@@ -503,8 +538,8 @@ static rcode dtl_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 		return DTL_CRIT_UNKNOWN;
 	for (i=1; i<=uf->df->n_alts; i++)
 		for (j=1; j<=uf->df->tot_cons[i]; j++) {
-			t_lobo[i][j] *= W_mid[node];
-			t_upbo[i][j] *= W_mid[node];
+			T_CELL(t_lobo,i,j) *= W_mid[node];
+			T_CELL(t_upbo,i,j) *= W_mid[node];
 			}
 	return DTL_OK;
 	}
@@ -514,15 +549,14 @@ static rcode dtl_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
  *       1 = Force floating midpoint
  *      +2 = Belief mass output */
 
-rcode DTLAPI DTL_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode get_MCP_tornado(int crit, int mode, int stride, int n_nodes, double *t_lobo, double *t_upbo) {
 	rcode rc;
-	int i,j;
 
 	/* Begin single thread semaphore */
-	_smx_begin("TMCP");
+	_smx_begin(stride?"TMCP":"TMCPN");
 	/* Log function call */
 	if (cst_on) {
-		sprintf(msg,"DTL_get_MCP_tornado(%d,%d)\n",crit,mode);
+		sprintf(msg,"DTL_get_MCP_tornado%s(%d,%d)\n",stride?"":"_n",crit,mode);
 		cst_log(msg);
 		}
 	/* Check if function can start */
@@ -536,23 +570,33 @@ rcode DTLAPI DTL_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 	/* Check input parameters */
 	if ((mode < 0) || (mode > 3))
 		return dtl_error(DTL_INPUT_ERROR);
+	if (rc = check_t_size(crit,stride,n_nodes))
+		return dtl_error(rc);
 	mode ^= 0x01; // flip lowest mode bit (compat reasons)
 	/* Get global tornado in criterion */
-	if (rc = dtl_get_MCP_tornado(crit,mode,t_lobo,t_upbo))
+	if (rc = dtl_get_MCP_tornado(crit,mode,stride,t_lobo,t_upbo))
 		return dtl_error(rc);
 	/* Log function result */
 	if (cst_ext)
-		for (i=1; i<=uf->df->n_alts; i++)
-			for (j=1; j<=uf->df->tot_cons[i]; j++) {
-				sprintf(msg,"    P%d.%d.%-2d [%.3lf %.3lf]\n",crit,i,j,t_lobo[i][j],t_upbo[i][j]);
-				cst_log(msg);
-				}
+		log_tornado("P",crit,t_lobo,t_upbo);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
 	}
 
 
+rcode DTLAPI DTL_get_MCP_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+
+	return get_MCP_tornado(crit,mode,MAX_NOPA+1,0,M_BASE(t_lobo),M_BASE(t_upbo));
+	}
+
+
+rcode DTLAPI DTL_get_MCP_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]) {
+
+	return get_MCP_tornado(crit,mode,0,n_nodes,t_lobo,t_upbo);
+	}
+
+
  /************************************************************
   *
   *  Value tornados
@@ -573,7 +617,7 @@ static void rollback_V_base(int vstmt, d_row lobo, d_row upbo) {
 	}
 
 
-static rcode dtl_mass_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode dtl_mass_V_tornado(int crit, int mode, double *t_lobo, double *t_upbo) {
 	rcode rc;
 	int i,j,k,sym,global_cst;
 	double baseline_ev,baseline_mass;
@@ -616,37 +660,37 @@ static rcode dtl_mass_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_
 		for (j=1; j<=df->tot_cons[i]; j++,k++)
 			if (TCL_get_V_index(df,i,j)) { // is a real-cons
 				/* Convert EV into mass in situ */
-				sym = fabs(t_upbo[i][j]+t_lobo[i][j]) < 2.0E-4;
-				if (t_lobo[i][j] < -DTL_EPS) {
-					if (rc = dtl_ev_to_cdf(crit,max(baseline_ev+t_lobo[i][j],0.0),t_lobo[i]+j)) {
+				sym = fabs(T_CELL(t_upbo,i,j)+T_CELL(t_lobo,i,j)) < 2.0E-4;
+				if (T_CELL(t_lobo,i,j) < -DTL_EPS) {
+					if (rc = dtl_ev_to_cdf(crit,max(baseline_ev+T_CELL(t_lobo,i,j),0.0),&T_CELL(t_lobo,i,j))) {
 						if (!mode)
 							rollback_V_base(0,ms_lobo,ms_upbo); // restore
 						cst_on = global_cst;
 						return rc;
 						}
-					t_lobo[i][j] = baseline_mass-t_lobo[i][j];
+					T_CELL(t_lobo,i,j) = baseline_mass-T_CELL(t_lobo,i,j);
 					}
 				else
-					t_lobo[i][j] = 0.0;
-				if (t_upbo[i][j] > DTL_EPS) {
-					if (rc = dtl_ev_to_cdf(crit,min(baseline_ev+t_upbo[i][j],1.0),t_upbo[i]+j)) {
+					T_CELL(t_lobo,i,j) = 0.0;
+				if (T_CELL(t_upbo,i,j) > DTL_EPS) {
+					if (rc = dtl_ev_to_cdf(crit,min(baseline_ev+T_CELL(t_upbo,i,j),1.0),&T_CELL(t_upbo,i,j))) {
 						if (!mode)
 							rollback_V_base(0,ms_lobo,ms_upbo); // restore
 						cst_on = global_cst;
 						return rc;
 						}
-					t_upbo[i][j] = baseline_mass-t_upbo[i][j];
+					T_CELL(t_upbo,i,j) = baseline_mass-T_CELL(t_upbo,i,j);
 					}
 				else
-					t_upbo[i][j] = 0.0;
+					T_CELL(t_upbo,i,j) = 0.0;
 				/* Rebalance to counter the Ericsson effect */
 				if (sym) {
-					t_upbo[i][j] = (t_upbo[i][j]-t_lobo[i][j])/2.0;
-					t_lobo[i][j] = -t_upbo[i][j];
+					T_CELL(t_upbo,i,j) = (T_CELL(t_upbo,i,j)-T_CELL(t_lobo,i,j))/2.0;
+					T_CELL(t_lobo,i,j) = -T_CELL(t_upbo,i,j);
 					}
 				}
 			else
-				t_lobo[i][j] = t_upbo[i][j] = -1.0;
+				T_CELL(t_lobo,i,j) = T_CELL(t_upbo,i,j) = -1.0;
 		}
 	if (!mode)
 		rollback_V_base(0,ms_lobo,ms_upbo); // restore
@@ -656,16 +700,17 @@ static rcode dtl_mass_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_
 	}
 
 
-static rcode dtl_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode dtl_get_V_tornado(int crit, int mode, int stride, double *t_lobo, double *t_upbo) {
 	rcode rc;
-	int i,j,k,ts_nbr,global_cst;
-	double baseline_ev;
+	int i,j,k,global_cst;
+	double baseline_ev,bound;
 	struct stmt_rec stmt;
 	struct d_frame *df;
 
 	if (load_df1(crit))
 		return DTL_CRIT_UNKNOWN;
 	df = uf->df;
+	set_t_rows(df,stride);
 	/* Set parameters */
 	mode &= 0x01;
 	/* Collect starting point */
@@ -692,114 +737,62 @@ static rcode dtl_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_u
 			return dtl_kernel_error();
 			}
 		}
-	/* Insert dummy V-statement */
+	/* Probe statement (what-if, never entered into the base) */
 	stmt.n_terms = 1;
-	stmt.alt[1] = 1;
-	stmt.cons[1] = 1;
-	/* Find first re-node */
-	while (!TCL_get_V_index(df,1,stmt.cons[1]))
-		stmt.cons[1]++;
 	stmt.sign[1] = 1;
-	stmt.lobo = 0.0;
-	stmt.upbo = 1.0;
-	if (call(TCL_add_V_constraint(df,&stmt),"TCL_add_V_constraint")) {
-		rollback_V_base(0,ms_lobo,ms_upbo);
-		cst_on = global_cst;
-		return dtl_kernel_error();
-		}
-	ts_nbr = df->V_base->n_stmts;
 	for (k=1,i=1; i<=df->n_alts; i++) {
+		dtl_progress(i-1,df->n_alts);
+		if (dtl_abort_request) {
+			rollback_V_base(0,ms_lobo,ms_upbo);
+			cst_on = global_cst;
+			}
 		dtl_abort_check();
 		if (rc = evaluate_frame(crit,E_PSI,i,0,t_result)) {
-			rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
+			rollback_V_base(0,ms_lobo,ms_upbo);
 			cst_on = global_cst;
 			return rc;
 			}
 		baseline_ev = t_result[E_MID][0];
 		for (j=1; j<=df->tot_cons[i]; j++,k++) {
 			if (TCL_get_V_index(df,i,j)) {
-				/* Remove midpoint for real consequence */
-				if (mode) {
-					m_lobo[k] = -1.0;
-					m_upbo[k] = -1.0;
-					/* Set mhull */
-					if (call(TCL_set_V_mbox(df,m_lobo,m_upbo),"TCL_set_V_mbox")) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
-						cst_on = global_cst;
-						return dtl_kernel_error();
-						}
-					}
 				if (h_upbo[k]-h_lobo[k] < 5.0*T_EPS)
 					/* Narrow trap */
-					t_lobo[i][j] = t_upbo[i][j] = 0.0;
+					T_CELL(t_lobo,i,j) = T_CELL(t_upbo,i,j) = 0.0;
 				else {
-					/* Enter statement */
+					/* Mode 1: the probes remove the midpoint for this consequence */
 					stmt.alt[1] = i;
 					stmt.cons[1] = j;
+					/* Explore lower boundary */
 					stmt.lobo = max(h_lobo[k],0.0);
 					stmt.upbo = h_lobo[k]+T_EPS;
-					if (call(TCL_replace_V_constraint(df,ts_nbr,&stmt),"TCL_replace_V_constraint")) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
+					if (call(TCL_probe_V(df,&stmt,mode,&bound),"TCL_probe_V")) {
+						rollback_V_base(0,ms_lobo,ms_upbo);
 						cst_on = global_cst;
 						return dtl_kernel_error();
 						}
-					if (dtl_abort_request) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
-						cst_on = global_cst;
-						}
-					dtl_abort_check();
-					if (rc = evaluate_frame(crit,E_PSI,i,0,t_result)) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
-						cst_on = global_cst;
-						return rc;
-						}
-					t_lobo[i][j] = t_result[E_MID][0] - baseline_ev;
-					/* Change statement */
-					if (call(TCL_change_V_constraint(df,ts_nbr,h_upbo[k]-T_EPS,min(h_upbo[k],1.0)),"TCL_change_V_constraint")) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
+					T_CELL(t_lobo,i,j) = bound - baseline_ev;
+					/* Explore upper boundary */
+					stmt.lobo = h_upbo[k]-T_EPS;
+					stmt.upbo = min(h_upbo[k],1.0);
+					if (call(TCL_probe_V(df,&stmt,mode,&bound),"TCL_probe_V")) {
+						rollback_V_base(0,ms_lobo,ms_upbo);
 						cst_on = global_cst;
 						return dtl_kernel_error();
 						}
-					if (dtl_abort_request) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
-						cst_on = global_cst;
-						}
-					dtl_abort_check();
-					if (rc = evaluate_frame(crit,E_PSI,i,0,t_result)) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
-						cst_on = global_cst;
-						return rc;
-						}
-					t_upbo[i][j] = t_result[E_MID][0] - baseline_ev;
+					T_CELL(t_upbo,i,j) = bound - baseline_ev;
 					/* Catch roundoff errors */
-					if (t_lobo[i][j] > -T_EPS)
-						t_lobo[i][j] = 0.0;
-					if (t_upbo[i][j] < +T_EPS)
-						t_upbo[i][j] = 0.0;
-					}
-				/* Prepare for next consequence */
-				if (call(TCL_change_V_constraint(df,ts_nbr,0.0,1.0),"TCL_change_V_constraint")) {
-					rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
-					cst_on = global_cst;
-					return dtl_kernel_error();
-					}
-				if (mode) {
-					/* Restore mhull */
-					m_lobo[k] = ms_lobo[k];
-					m_upbo[k] = ms_upbo[k];
-					if (call(TCL_set_V_mbox(df,m_lobo,m_upbo),"TCL_set_V_mbox")) {
-						rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
-						cst_on = global_cst;
-						return dtl_kernel_error();
-						}
+					if (T_CELL(t_lobo,i,j) > -T_EPS)
+						T_CELL(t_lobo,i,j) = 0.0;
+					if (T_CELL(t_upbo,i,j) < +T_EPS)
+						T_CELL(t_upbo,i,j) = 0.0;
 					}
 				}
 			else {
-				t_lobo[i][j] = t_upbo[i][j] = -1.0;
+				T_CELL(t_lobo,i,j) = T_CELL(t_upbo,i,j) = -1.0;
 				}
 			}
 		}
-	rollback_V_base(ts_nbr,ms_lobo,ms_upbo);
+	rollback_V_base(0,ms_lobo,ms_upbo);
 	eval_cache_invalidate();
 	cst_on = global_cst;
 	return DTL_OK;
@@ -810,15 +803,14 @@ static rcode dtl_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_u
  *       1 = Force floating midpoint
  *      +2 = Belief mass output */
 
-rcode DTLAPI DTL_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode get_V_tornado(int crit, int mode, int stride, int n_nodes, double *t_lobo, double *t_upbo) {
 	rcode rc;
-	int i,j;
 
 	/* Begin single thread semaphore */
-	_smx_begin("TOV");
+	_smx_begin(stride?"TOV":"TOVN");
 	/* Log function call */
 	if (cst_on) {
-		sprintf(msg,"DTL_get_V_tornado(%d,%d)\n",crit,mode);
+		sprintf(msg,"DTL_get_V_tornado%s(%d,%d)\n",stride?"":"_n",crit,mode);
 		cst_log(msg);
 		}
 	/* Check if function can start */
@@ -830,9 +822,11 @@ rcode DTLAPI DTL_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_u
 	/* Check input parameters */
 	if ((mode < 0) || (mode > 3))
 		return dtl_error(DTL_INPUT_ERROR);
+	if (rc = check_t_size(crit,stride,n_nodes))
+		return dtl_error(rc);
 	mode ^= 0x01; // flip lowest mode bit (compat reasons)
 	/* Get tornado */
-	if (rc = dtl_get_V_tornado(crit,mode,t_lobo,t_upbo))
+	if (rc = dtl_get_V_tornado(crit,mode,stride,t_lobo,t_upbo))
 		return dtl_error(rc);
 	if (mode&0x02) {
 		if (rc = dtl_mass_V_tornado(crit,mode,t_lobo,t_upbo))
@@ -840,23 +834,31 @@ rcode DTLAPI DTL_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_u
 		}
 	/* Log function result */
 	if (cst_ext)
-		for (i=1; i<=uf->df->n_alts; i++)
-			for (j=1; j<=uf->df->tot_cons[i]; j++) {
-				sprintf(msg,"    V%d.%d.%-2d [%.3lf %.3lf]\n",crit,i,j,t_lobo[i][j],t_upbo[i][j]);
-				cst_log(msg);
-				}
+		log_tornado("V",crit,t_lobo,t_upbo);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
 	}
 
 
-static rcode dtl_get_MCV_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+rcode DTLAPI DTL_get_V_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+
+	return get_V_tornado(crit,mode,MAX_NOPA+1,0,M_BASE(t_lobo),M_BASE(t_upbo));
+	}
+
+
+rcode DTLAPI DTL_get_V_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]) {
+
+	return get_V_tornado(crit,mode,0,n_nodes,t_lobo,t_upbo);
+	}
+
+
+static rcode dtl_get_MCV_tornado(int crit, int mode, int stride, double *t_lobo, double *t_upbo) {
 	rcode rc;
 	int i,j,node;
 
 	/* Get local tornado in criterion */
-	if (rc = dtl_get_V_tornado(crit,mode,t_lobo,t_upbo))
+	if (rc = dtl_get_V_tornado(crit,mode,stride,t_lobo,t_upbo))
 		return rc;
 	if (mode&0x02) {
 		if (rc = dtl_mass_V_tornado(crit,mode,t_lobo,t_upbo))
@@ -876,10 +878,10 @@ static rcode dtl_get_MCV_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 		return DTL_CRIT_UNKNOWN;
 	for (i=1; i<=uf->df->n_alts; i++)
 		for (j=1; j<=uf->df->tot_cons[i]; j++)
-			if (t_lobo[i][j] > -1.0) {
+			if (T_CELL(t_lobo,i,j) > -1.0) {
 				/* Real node */
-				t_lobo[i][j] *= W_mid[node];
-				t_upbo[i][j] *= W_mid[node];
+				T_CELL(t_lobo,i,j) *= W_mid[node];
+				T_CELL(t_upbo,i,j) *= W_mid[node];
 				}
 	return DTL_OK;
 	}
@@ -889,15 +891,14 @@ static rcode dtl_get_MCV_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
  *       1 = Force floating midpoint
  *      +2 = Belief mass output */
 
-rcode DTLAPI DTL_get_MCV_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+static rcode get_MCV_tornado(int crit, int mode, int stride, int n_nodes, double *t_lobo, double *t_upbo) {
 	rcode rc;
-	int i,j;
 
 	/* Begin single thread semaphore */
-	_smx_begin("TMCV");
+	_smx_begin(stride?"TMCV":"TMCVN");
 	/* Log function call */
 	if (cst_on) {
-		sprintf(msg,"DTL_get_MCV_tornado(%d,%d)\n",crit,mode);
+		sprintf(msg,"DTL_get_MCV_tornado%s(%d,%d)\n",stride?"":"_n",crit,mode);
 		cst_log(msg);
 		}
 	/* Check if function can start */
@@ -911,23 +912,33 @@ rcode DTLAPI DTL_get_MCV_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t
 	/* Check input parameters */
 	if ((mode < 0) || (mode > 3))
 		return dtl_error(DTL_INPUT_ERROR);
+	if (rc = check_t_size(crit,stride,n_nodes))
+		return dtl_error(rc);
 	mode ^= 0x01; // flip lowest mode bit (compat reasons)
 	/* Get global tornado in criterion */
-	if (rc = dtl_get_MCV_tornado(crit,mode,t_lobo,t_upbo))
+	if (rc = dtl_get_MCV_tornado(crit,mode,stride,t_lobo,t_upbo))
 		return dtl_error(rc);
 	/* Log function result */
 	if (cst_ext)
-		for (i=1; i<=uf->df->n_alts; i++)
-			for (j=1; j<=uf->df->tot_cons[i]; j++) {
-				sprintf(msg,"    V%d.%d.%-2d [%.3lf %.3lf]\n",crit,i,j,t_lobo[i][j],t_upbo[i][j]);
-				cst_log(msg);
-				}
+		log_tornado("V",crit,t_lobo,t_upbo);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
 	}
 
 
+rcode DTLAPI DTL_get_MCV_tornado(int crit, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+
+	return get_MCV_tornado(crit,mode,MAX_NOPA+1,0,M_BASE(t_lobo),M_BASE(t_upbo));
+	}
+
+
+rcode DTLAPI DTL_get_MCV_tornado_n(int crit, int mode, int n_nodes, double t_lobo[], double t_upbo[]) {
+
+	return get_MCV_tornado(crit,mode,0,n_nodes,t_lobo,t_upbo);
+	}
+
+
  /*********************************************************
   *
   *  Weight tornado
@@ -941,7 +952,69 @@ static d_row omega_ev;
  * static double omega_ev[2*MAX_CRIT+MAX_ALTS+1]; */
 static e_matrix ev_result;
 
-static rcode dtl_get_W_tornado(int alt, int mode, h_matrix t_lobo, h_matrix t_upbo) {
+/* Frame-sized scratch for the weight frame tornado of one alternative.
+ * The weight tree is alternative 1, i.e. the first w_map[0] entries. */
+
+static double *w_lobo,*w_upbo;
+static int w_size;
+
+static bool w_buffer(int n) {
+
+	if (w_size < n) {
+		if (w_lobo)
+			mem_free((void *)w_lobo);
+		w_lobo = (double *)mem_alloc(2*n*sizeof(double),"double","w_buffer");
+		w_size = w_lobo ? n : 0;
+		if (!w_lobo)
+			return FALSE;
+		}
+	w_upbo = w_lobo+w_size;
+	return TRUE;
+	}
+
+
+/* Scratch for the weight tornados of all alternatives: the criterion
+ * EVs of each alternative (n_alts rows of w_map[0]), the baselines, and
+ * two rows of probe results per worker. The tornado of a single node
+ * uses the output rows. */
+
+static double *wa_ev,*wa_base,*wa_bound,*wa_lobo,*wa_upbo;
+static int wa_size;
+
+static bool wa_buffer(int n_alts, int n_nodes, int n_w) {
+	int n;
+
+	n = 3*n_alts*n_nodes+(2*n_w+1)*n_alts;
+	if (wa_size < n) {
+		if (wa_ev)
+			mem_free((void *)wa_ev);
+		wa_ev = (double *)mem_alloc(n*sizeof(double),"double","wa_buffer");
+		wa_size = wa_ev ? n : 0;
+		if (!wa_ev)
+			return FALSE;
+		}
+	wa_lobo = wa_ev+n_alts*n_nodes;
+	wa_upbo = wa_lobo+n_alts*n_nodes;
+	wa_base = wa_upbo+n_alts*n_nodes;
+	wa_bound = wa_base+n_alts;
+	return TRUE;
+	}
+
+
+void tornado_release() {
+
+	if (w_lobo)
+		mem_free((void *)w_lobo);
+	w_lobo = w_upbo = NULL;
+	w_size = 0;
+	if (wa_ev)
+		mem_free((void *)wa_ev);
+	wa_ev = wa_lobo = wa_upbo = wa_base = wa_bound = NULL;
+	wa_size = 0;
+	}
+
+
+static rcode dtl_get_W_tornado(int alt, int mode, double *t_lobo, double *t_upbo) {
 	rcode rc;
 	int i,j,k;
 
@@ -976,7 +1049,7 @@ static rcode dtl_get_W_tornado(int alt, int mode, h_matrix t_lobo, h_matrix t_up
 	if (call(TCL_set_V_box(uf->df,omega_ev,omega_ev),"TCL_set_V_box"))
 		return dtl_kernel_error();
 
-	if (rc = dtl_get_PW_tornado(0,mode,t_lobo,t_upbo)) {
+	if (rc = dtl_get_PW_tornado(0,mode,0,t_lobo,t_upbo)) {
 		TCL_unset_V_box(uf->df);
 		return rc;
 		}
@@ -992,6 +1065,329 @@ static rcode dtl_get_W_tornado(int alt, int mode, h_matrix t_lobo, h_matrix t_up
 	}
 
 
+ /*********************************************************
+  *
+  *  Weight tornados of all alternatives
+  *
+  *  The V-box of an alternative holds its EVs in the criteria.
+  *  They are formed with one evaluation of each criterion for
+  *  all alternatives. The P probes of the weight frame do not
+  *  depend on the V-box, so each probe is made once and gives
+  *  the EV of every alternative (TCL_probe_P_points). With
+  *  PAR_EVAL, the weight nodes are shared out over workers
+  *  that probe the attached weight frame, which is only read
+  *  from. Each worker writes the cells of its own nodes.
+  *
+  *********************************************************/
+
+struct wa_job {
+	int worker;
+	int n_workers;
+	double *bound; // two rows of n_alts probe results
+	rcode tcl_rc;  // kernel error
+	};
+
+static struct wa_job wa_jobs[MAX_WA_WORKERS];
+static a_result wa_result;
+static struct d_frame *wa_df;
+static int wa_mode,wa_stride;
+static double *wa_tlobo,*wa_tupbo;
+static d_row wa_lo_bound,wa_up_bound;
+static bool wa_narrow[MAX_NODES+1];
+
+
+/* Probe weight node j, the cells of all alternatives */
+
+static void wa_node(struct wa_job *jp, int j) {
+	int i,n_alts,cell;
+	double *bound1,*bound2,t_lo,t_up;
+	struct stmt_rec stmt;
+
+	n_alts = uf->n_alts;
+	if (wa_narrow[j]) {
+		/* Narrow trap */
+		for (i=1; i<=n_alts; i++) {
+			cell = (i-1)*wa_stride+j-1;
+			wa_tlobo[cell] = wa_tupbo[cell] = 0.0;
+			}
+		return;
+		}
+	bound1 = jp->bound;
+	bound2 = jp->bound+n_alts;
+	stmt.n_terms = 1;
+	stmt.sign[1] = 1;
+	stmt.alt[1] = 1;
+	stmt.cons[1] = j;
+	/* Explore lower boundary */
+	stmt.lobo = max(wa_lo_bound[j],0.0);
+	stmt.upbo = min(wa_lo_bound[j]+T_EPS,1.0);
+	if (jp->tcl_rc = TCL_probe_P_points(wa_df,1,&stmt,wa_mode,n_alts,w_map[0],wa_ev,bound1))
+		return;
+	/* Explore upper boundary */
+	stmt.lobo = max(wa_up_bound[j]-T_EPS,0.0);
+	stmt.upbo = min(wa_up_bound[j],1.0);
+	if (jp->tcl_rc = TCL_probe_P_points(wa_df,1,&stmt,wa_mode,n_alts,w_map[0],wa_ev,bound2))
+		return;
+	for (i=1; i<=n_alts; i++) {
+		/* An increase in W can decrease EV and v.v. -> must sort boundaries */
+		if (bound1[i-1] < bound2[i-1]) {
+			t_lo = bound1[i-1] - wa_base[i-1];
+			t_up = bound2[i-1] - wa_base[i-1];
+			}
+		else {
+			t_lo = bound2[i-1] - wa_base[i-1];
+			t_up = bound1[i-1] - wa_base[i-1];
+			}
+		/* Catch roundoff errors */
+		if (t_lo > -T_EPS)
+			t_lo = 0.0;
+		if (t_up < +T_EPS)
+			t_up = 0.0;
+		cell = (i-1)*wa_stride+j-1;
+		wa_tlobo[cell] = t_lo;
+		wa_tupbo[cell] = t_up;
+		}
+	}
+
+
+static void run_wa_job(struct wa_job *jp) {
+	int j;
+
+	for (j=jp->worker+1; j<=w_map[0]; j+=jp->n_workers) {
+		wa_node(jp,j);
+		if (jp->tcl_rc)
+			break;
+		}
+	}
+
+
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+static DWORD WINAPI wa_worker(LPVOID arg) {
+
+	run_wa_job((struct wa_job *)arg);
+	return 0;
+	}
+#else
+static void *wa_worker(void *arg) {
+
+	run_wa_job((struct wa_job *)arg);
+	return NULL;
+	}
+#endif
+#endif
+
+
+/* Weight tornados of all alternatives (w_map initialised), the row of
+ * alternative i at (i-1)*n_nodes. With no output (t_lobo NULL), the
+ * rows are left in wa_lobo/wa_upbo with n_nodes = w_map[0]. The cells
+ * are those of dtl_get_W_tornado for each alternative. */
+
+static rcode dtl_get_W_tornado_all(int mode, int n_nodes, double *t_lobo, double *t_upbo) {
+	rcode rc;
+	int i,j,jj,k,w,n_w,n_alts,w_mode,global_cst;
+	double h_sum;
+	struct d_frame *df;
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+	HANDLE tid[MAX_WA_WORKERS];
+#else
+	pthread_t tid[MAX_WA_WORKERS];
+#endif
+#endif
+
+	n_alts = uf->n_alts;
+#ifdef PAR_EVAL
+	n_w = min(get_n_workers(),w_map[0]);
+#else
+	n_w = 1;
+#endif
+	if (!wa_buffer(n_alts,w_map[0],n_w))
+		return DTL_MEMORY_LEAK;
+	if (!t_lobo) {
+		t_lobo = wa_lobo;
+		t_upbo = wa_upbo;
+		n_nodes = w_map[0];
+		}
+	if (dtl_error_count)
+		return DTL_OUTPUT_ERROR;
+	/* Collect the mass point expected values of all alternatives */
+	for (j=1; j<=w_map[0]; j++) {
+		dtl_progress(j-1,w_map[0]);
+		if ((k = w_map[j]) && !load_df1(k)) {
+			/* Re-wt-node, one evaluation for all alternatives */
+			if (call(TCL_evaluate_all(uf->df,wa_result),"TCL_evaluate_all"))
+				return dtl_kernel_error();
+			for (i=1; i<=n_alts; i++)
+				wa_ev[(i-1)*w_map[0]+j-1] = wa_result[i][E_MID];
+			}
+		else
+			/* Stand-in for no criterion, or im-wt-node */
+			for (i=1; i<=n_alts; i++)
+				wa_ev[(i-1)*w_map[0]+j-1] = k?0.5:0.0;
+		}
+	/* Collect starting point in the weight frame */
+	if (load_df0(0))
+		return DTL_SYS_CORRUPT;
+	df = uf->df;
+	w_mode = mode & 0x01;
+	if (uf->WP_autogen[0])
+		w_mode = 0; // autogen needs floating midpoint
+	dtl_abort_init();
+	if (call(TCL_get_P_hull(df,m_lobo,m_upbo,h_lobo,h_upbo),"TCL_get_P_hull"))
+		return dtl_kernel_error();
+	if (call(TCL_get_P_mbox(df,m_lobo,m_upbo),"TCL_get_P_mbox"))
+		return dtl_kernel_error();
+	if (call(TCL_get_P_mbox(df,ms_lobo,ms_upbo),"TCL_get_P_mbox"))
+		return dtl_kernel_error();
+	/* Lower cst reporting level */
+	global_cst = cst_on;
+	cst_on = cst_ext;
+	if (!w_mode) {
+		/* Mode 0: midpoint removed */
+		for (k=1; k<=df->tot_cons[0]; k++) {
+			m_lobo[k] = -1.0;
+			m_upbo[k] = -1.0;
+			}
+		/* Clear mhull */
+		if (call(TCL_set_P_mbox(df,m_lobo,m_upbo),"TCL_set_P_mbox")) {
+			cst_on = global_cst;
+			return dtl_kernel_error();
+			}
+		}
+	/* Baselines of all alternatives */
+	if (call(TCL_probe_P_points(df,1,NULL,w_mode,n_alts,w_map[0],wa_ev,wa_base),"TCL_probe_P_points")) {
+		rollback_PW_base(0,ms_lobo,ms_upbo);
+		cst_on = global_cst;
+		return dtl_kernel_error();
+		}
+	/* Movability limits of the weight nodes (k = j in the weight tree),
+	 * as in dtl_get_PW_tornado */
+	for (j=1; j<=w_map[0]; j++) {
+		if (w_mode) {
+			/* Mode 1: explicit midpoint kept */
+			h_sum = 0.0;
+			for (jj=1; jj<=w_map[0]; jj++)
+				if ((jj != j) && !TCL_different_parents(df,1,j,jj)) {
+					/* Limit is midpoint if it exists, else hull */
+					if (ms_upbo[jj] >= 0.0)
+						h_sum += ms_upbo[jj];
+					else
+						h_sum += min(h_upbo[jj],1.0);
+					}
+			if (ms_lobo[j] >= 0.0)
+				wa_lo_bound[j] = max(ms_lobo[j],1.0-h_sum);
+			else
+				wa_lo_bound[j] = max(h_lobo[j],1.0-h_sum);
+			h_sum = 0.0;
+			for (jj=1; jj<=w_map[0]; jj++)
+				if ((jj != j) && !TCL_different_parents(df,1,j,jj)) {
+					if (ms_lobo[jj] >= 0.0)
+						h_sum += ms_lobo[jj];
+					else
+						h_sum += max(h_lobo[jj],0.0);
+					}
+			/* Catch roundoff errors */
+			h_sum = min(h_sum,1.0);
+			if (ms_upbo[j] >= 0.0)
+				wa_up_bound[j] = min(ms_upbo[j],1.0-h_sum);
+			else
+				wa_up_bound[j] = min(h_upbo[j],1.0-h_sum);
+			}
+		else {
+			/* Mode 0: midpoint removed */
+			wa_lo_bound[j] = max(h_lobo[j],0.0);
+			wa_up_bound[j] = min(h_upbo[j],1.0);
+			}
+		wa_narrow[j] = wa_up_bound[j]-wa_lo_bound[j] < 5.0*T_EPS;
+		}
+	if (dtl_abort_request) {
+		rollback_PW_base(0,ms_lobo,ms_upbo);
+		cst_on = global_cst;
+		}
+	dtl_abort_check();
+	/* Probe the nodes, the calling thread is worker 0 */
+	wa_df = df;
+	wa_mode = w_mode;
+	wa_stride = n_nodes;
+	wa_tlobo = t_lobo;
+	wa_tupbo = t_upbo;
+	for (w=0; w<n_w; w++) {
+		wa_jobs[w].worker = w;
+		wa_jobs[w].n_workers = n_w;
+		wa_jobs[w].bound = wa_bound+2*w*n_alts;
+		wa_jobs[w].tcl_rc = TCL_OK;
+		}
+#ifdef PAR_EVAL
+	for (w=1; w<n_w; w++)
+#ifdef _MSC_VER
+		if (!(tid[w] = CreateThread(NULL,0,wa_worker,&wa_jobs[w],0,NULL)))
+#else
+		if (pthread_create(&tid[w],NULL,wa_worker,&wa_jobs[w]))
+#endif
+			wa_jobs[w].n_workers = -1; // not started
+#endif
+	run_wa_job(&wa_jobs[0]);
+#ifdef PAR_EVAL
+	for (w=1; w<n_w; w++)
+		if (wa_jobs[w].n_workers < 0) {
+			/* Could not start the thread, do its share here */
+			wa_jobs[w].n_workers = n_w;
+			run_wa_job(&wa_jobs[w]);
+			}
+		else {
+#ifdef _MSC_VER
+			WaitForSingleObject(tid[w],INFINITE);
+			CloseHandle(tid[w]);
+#else
+			pthread_join(tid[w],NULL);
+#endif
+			}
+#endif
+	rollback_PW_base(0,ms_lobo,ms_upbo);
+	cst_on = global_cst;
+	for (w=0; w<n_w; w++)
+		if (wa_jobs[w].tcl_rc) {
+			call(wa_jobs[w].tcl_rc,"TCL_probe_P_points");
+			return dtl_kernel_error();
+			}
+	if (mode&0x02) {
+		/* Belief mass, one alternative at a time with its EV-box */
+		set_t_rows(df,0);
+		for (i=1; i<=n_alts; i++) {
+			dtl_progress(i-1,n_alts);
+			if (load_df0(0))
+				return DTL_SYS_CORRUPT;
+			if (call(TCL_reset_V_base(df),"TCL_reset_V_base"))
+				return dtl_kernel_error();
+			for (j=1; j<=w_map[0]; j++) {
+				omega_ev[j] = wa_ev[(i-1)*w_map[0]+j-1];
+				w_lobo[j-1] = t_lobo[(i-1)*n_nodes+j-1];
+				w_upbo[j-1] = t_upbo[(i-1)*n_nodes+j-1];
+				}
+			for (; j<=df->tot_cons[0]; j++) {
+				/* Dummy alternatives */
+				omega_ev[j] = 0.0;
+				w_lobo[j-1] = w_upbo[j-1] = 0.0;
+				}
+			if (call(TCL_set_V_box(df,omega_ev,omega_ev),"TCL_set_V_box"))
+				return dtl_kernel_error();
+			if (rc = dtl_mass_PW_tornado(-i,mode,w_lobo,w_upbo)) {
+				TCL_unset_V_box(df);
+				return rc;
+				}
+			TCL_unset_V_box(df);
+			for (j=1; j<=w_map[0]; j++) {
+				t_lobo[(i-1)*n_nodes+j-1] = w_lobo[j-1];
+				t_upbo[(i-1)*n_nodes+j-1] = w_upbo[j-1];
+				}
+			}
+		}
+	eval_cache_invalidate();
+	return DTL_OK;
+	}
+
+
 /* Mode: 0 = Midpoint kept (default)
  *       1 = Force floating midpoint
  *      +2 = Belief mass output */
@@ -1025,6 +1421,8 @@ rcode DTLAPI DTL_get_W_tornado(int mode, h_matrix t_lobo, h_matrix t_upbo) {
 	w_map[0] = uf->df->tot_cons[1];
 	for (j=1; j<=w_map[0]; j++)
 		w_map[j] = TCL_get_V_index(uf->df,1,j);
+	if (!w_buffer(uf->df->tot_cons[0]))
+		return dtl_error(DTL_MEMORY_LEAK);
 	/* Get weight tornado for all alternatives */
 	for (j=1; j<=w_map[0]; j++) {
 		t_lobo[0][j] = 0.0;
@@ -1032,15 +1430,9 @@ rcode DTLAPI DTL_get_W_tornado(int mode, h_matrix t_lobo, h_matrix t_upbo) {
 		}
 	cst_global = cst_on;
 	cst_on = FALSE;
-	for (i=1; i<=uf->n_alts; i++) {
-		if (rc = dtl_get_W_tornado(i,mode,x_lobo,x_upbo)) {
-			cst_on = cst_global;
-			return dtl_error(rc);
-			}
-		for (j=1; j<=w_map[0]; j++) {
-			t_lobo[i][j]  = x_lobo[1][j];
-			t_upbo[i][j]  = x_upbo[1][j];
-			}
+	if (rc = dtl_get_W_tornado_all(mode,MAX_NOPA+1,M_BASE(t_lobo),M_BASE(t_upbo))) {
+		cst_on = cst_global;
+		return dtl_error(rc);
 		}
 	cst_on = cst_global;
 	/* Log function result */
@@ -1056,6 +1448,63 @@ rcode DTLAPI DTL_get_W_tornado(int mode, h_matrix t_lobo, h_matrix t_upbo) {
 	}
 
 
+/* Caller-sized variant: row i-1 of the n_alts x n_nodes matrices holds
+ * alternative i (DTL_nbr_of_weights() nodes are needed in each row) */
+
+rcode DTLAPI DTL_get_W_tornado_n(int mode, int n_alts, int n_nodes, double t_lobo[], double t_upbo[]) {
+	rcode rc;
+	int i,j,cst_global;
+
+	/* Begin single thread semaphore */
+	_smx_begin("TOWN");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_get_W_tornado_n(%d,%d,%d)\n",mode,n_alts,n_nodes);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(t_lobo,1);
+	_certify_ptr(t_upbo,2);
+	_dtl_assert(t_lobo!=t_upbo,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (!PM)
+		return dtl_error(DTL_WRONG_FRAME_TYPE);
+	/* Check input parameters */
+	if (load_df0(0))
+		return dtl_error(DTL_SYS_CORRUPT);
+	if ((mode < 0) || (mode > 3))
+		return dtl_error(DTL_INPUT_ERROR);
+	if ((n_alts < uf->n_alts) || (n_nodes < uf->df->tot_cons[1]))
+		return dtl_error(DTL_BUFFER_OVERRUN);
+	mode ^= 0x01; // flip lowest mode bit (compat reasons)
+	/* Initialise weight map vector */
+	w_map[0] = uf->df->tot_cons[1];
+	for (j=1; j<=w_map[0]; j++)
+		w_map[j] = TCL_get_V_index(uf->df,1,j);
+	if (!w_buffer(uf->df->tot_cons[0]))
+		return dtl_error(DTL_MEMORY_LEAK);
+	/* Get weight tornado for all alternatives */
+	cst_global = cst_on;
+	cst_on = FALSE;
+	if (rc = dtl_get_W_tornado_all(mode,n_nodes,t_lobo,t_upbo)) {
+		cst_on = cst_global;
+		return dtl_error(rc);
+		}
+	cst_on = cst_global;
+	/* Log function result */
+	if (cst_ext)
+		for (i=1; i<=uf->n_alts; i++)
+			for (j=1; j<=w_map[0]; j++) {
+				sprintf(msg,"    A%d W%-2d [%.3lf %.3lf]\n",i,j,t_lobo[(i-1)*n_nodes+j-1],t_upbo[(i-1)*n_nodes+j-1]);
+				cst_log(msg);
+				}
+	/* End single thread semaphore */
+	_smx_end();
+	return DTL_OK;
+	}
+
+
 /* Mode: 0 = Midpoint kept (default)
  *       1 = Force floating midpoint
  *      +2 = Belief mass output
@@ -1092,13 +1541,15 @@ rcode DTLAPI DTL_get_W_tornado_alt(int alt, int mode, h_vector t_lobo, h_vector
 	w_map[0] = uf->df->tot_cons[1];
 	for (j=1; j<=w_map[0]; j++)
 		w_map[j] = TCL_get_V_index(uf->df,1,j);
+	if (!w_buffer(uf->df->tot_cons[0]))
+		return dtl_error(DTL_MEMORY_LEAK);
 	if (alt >= 0) {
 		/* Get weight tornado for single alternative */
-		if (rc = dtl_get_W_tornado(alt,mode,x_lobo,x_upbo))
+		if (rc = dtl_get_W_tornado(alt,mode,w_lobo,w_upbo))
 			return dtl_error(rc);
 		for (j=1; j<=w_map[0]; j++) {
-			t_lobo[j] = x_lobo[1][j];
-			t_upbo[j] = x_upbo[1][j];
+			t_lobo[j] = w_lobo[j-1];
+			t_upbo[j] = w_upbo[j-1];
 			}
 		}
 	else {
@@ -1107,13 +1558,13 @@ rcode DTLAPI DTL_get_W_tornado_alt(int alt, int mode, h_vector t_lobo, h_vector
 			return dtl_error(DTL_INPUT_ERROR);
 		cst_global = cst_on;
 		cst_on = FALSE;
+		if (rc = dtl_get_W_tornado_all(mode,0,NULL,NULL)) {
+			cst_on = cst_global;
+			return dtl_error(rc);
+			}
 		for (i=1; i<=uf->n_alts; i++) {
-			if (rc = dtl_get_W_tornado(i,mode,x_lobo,x_upbo)) {
-				cst_on = cst_global;
-				return dtl_error(rc);
-				}
-			t_lobo[i] = x_lobo[1][-alt];
-			t_upbo[i] = x_upbo[1][-alt];
+			t_lobo[i] = wa_lobo[(i-1)*w_map[0]-alt-1];
+			t_upbo[i] = wa_upbo[(i-1)*w_map[0]-alt-1];
 			}
 		cst_on = cst_global;
 		}
@@ -1138,7 +1589,7 @@ rcode DTLAPI DTL_get_W_tornado_alt(int alt, int mode, h_vector t_lobo, h_vector
   *
   *********************************************************/
 
-static rcode dtl_get_cons_influence(int crit, double mult, h_matrix result) {
+static rcode dtl_get_cons_influence(int crit, double mult, int stride, double *result) {
 	int i,j,k;
 	struct d_frame *df;
 
@@ -1146,6 +1597,7 @@ static rcode dtl_get_cons_influence(int crit, double mult, h_matrix result) {
 	if (load_df1(crit))
 		return DTL_CRIT_UNKNOWN;
 	df = uf->df;
+	set_t_rows(df,stride);
 	/* Get omega components */
 	if (call(TCL_get_P_masspoint(df,W_mid,LW_mid),"TCL_get_P_masspoint"))
 		return dtl_kernel_error();
@@ -1154,12 +1606,12 @@ static rcode dtl_get_cons_influence(int crit, double mult, h_matrix result) {
 	for (k=1,i=1; i<=df->n_alts; i++)
 		for (j=1; j<=df->tot_cons[i]; j++,k++) {
 			if (V_mid[k] > -DTL_EPS)
-				result[i][j] = mult*max(W_mid[k],0.0)*max(V_mid[k],0.0); // p*v
+				T_CELL(result,i,j) = mult*max(W_mid[k],0.0)*max(V_mid[k],0.0); // p*v
 			else // im-node
-				result[i][j] = -1.0;
+				T_CELL(result,i,j) = -1.0;
 			/* Log function result */
 			if (cst_ext) {
-				sprintf(msg,"    V%d.%d.%-2d %.3lf\n",crit,i,j,result[i][j]);
+				sprintf(msg,"    V%d.%d.%-2d %.3lf\n",crit,i,j,T_CELL(result,i,j));
 				cst_log(msg);
 				}
 			}
@@ -1172,17 +1624,17 @@ static rcode dtl_get_cons_influence(int crit, double mult, h_matrix result) {
  * Output mode: 0 = local, 1 = global
  * DTL_OUTPUT_ERROR not supported due to lack of information */
 
-rcode DTLAPI DTL_get_cons_influence(int crit, int mode, h_matrix result) {
+static rcode get_cons_influence(int crit, int mode, int stride, int n_nodes, double *result) {
 	rcode rc;
 	int node;
 	double mult;
 	struct d_frame *df;
 
 	/* Begin single thread semaphore */
-	_smx_begin("CINF");
+	_smx_begin(stride?"CINF":"CINFN");
 	/* Log function call */
 	if (cst_on) {
-		sprintf(msg,"DTL_get_cons_influence(%d,%d)\n",crit,mode);
+		sprintf(msg,"DTL_get_cons_influence%s(%d,%d)\n",stride?"":"_n",crit,mode);
 		cst_log(msg);
 		}
 	/* Check if function can start */
@@ -1191,6 +1643,8 @@ rcode DTLAPI DTL_get_cons_influence(int crit, int mode, h_matrix result) {
 		return dtl_error(DTL_FRAME_NOT_LOADED);
 	if ((mode < 0) || (mode > 1))
 		return dtl_error(DTL_INPUT_ERROR);
+	if (rc = check_t_size(crit,stride,n_nodes))
+		return dtl_error(rc);
 	if (PM && mode) {
 		if (load_df0(0))
 			return dtl_error(DTL_SYS_CORRUPT);
@@ -1202,9 +1656,23 @@ rcode DTLAPI DTL_get_cons_influence(int crit, int mode, h_matrix result) {
 		}
 	else // either PS or PM+local
 		mult = 1.0;
-	if (rc = dtl_get_cons_influence(crit,mult,result))
+	if (rc = dtl_get_cons_influence(crit,mult,stride,result))
 		return dtl_error(rc);
 	/* End single thread semaphore */
 	_smx_end();
 	return rc;
 	}
+
+
+rcode DTLAPI DTL_get_cons_influence(int crit, int mode, h_matrix result) {
+
+	return get_cons_influence(crit,mode,MAX_NOPA+1,0,M_BASE(result));
+	}
+
+
+/* Caller-sized variant, result in node order as for the tornados */
+
+rcode DTLAPI DTL_get_cons_influence_n(int crit, int mode, int n_nodes, double result[]) {
+
+	return get_cons_influence(crit,mode,0,n_nodes,result);
+	}
@@ -47,6 +47,7 @@
  *   Functions exported outside DTL
  *   ------------------------------
  *   DTL_add_V_statement
+ *   DTL_add_V_statements
  *   DTL_change_V_statement
  *   DTL_replace_V_statement
  *   DTL_delete_V_statement
@@ -75,11 +76,13 @@
  *   dtl_set_V_check
  *   dtl_set_V_mbox_rels
  *   dtl_nbr_V_midpoints
+ *   dtl_check_V_modality
+ *   vmod_release
  *
  *   Functions internal to module
  *   ----------------------------
  *   dtl_modal_to_mid
- *   dtl_check_V_modality
+ *   vmod_row
  *   print_V_stmt
  *
  */
@@ -97,6 +100,9 @@
 /* Hull caches */
 static d_row vhlobo,vhupbo,V_mid;
 
+/* Statement set buffer */
+static struct stmt_rec stmts[MAX_STMTS+1];
+
 
  /*********************************************************
   *
@@ -232,7 +238,46 @@ rcode DTLAPI DTL_add_V_statement(int crit, struct user_stmt_rec* ustmtp) {
 	/* Add statement */
 	if (call(TCL_add_V_constraint(uf->df,&stmt),"TCL_add_V_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
+	/* End single thread semaphore */
+	_smx_end();
+	return uf->df->V_base->n_stmts;
+	}
+
+
+ /*
+  * Call semantics: Add the user value statements ustmts[1..n_stmts]
+  * to the value base in one operation. The base is loaded and checked
+  * for consistency once for the whole set. In case of inconsistency,
+  * none of the statements are added to the base.
+  */
+
+rcode DTLAPI DTL_add_V_statements(int crit, int n_stmts, struct user_stmt_rec ustmts[]) {
+	int i;
+
+	/* Begin single thread semaphore */
+	_smx_begin("AVSS");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_add_V_statements(%d,%d)\n",crit,n_stmts);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(ustmts,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	/* Check input parameters */
+	if (load_df1(crit))
+		return dtl_error(DTL_CRIT_UNKNOWN);
+	if ((n_stmts < 1) || (n_stmts > MAX_STMTS))
+		return dtl_error(DTL_INPUT_ERROR);
+	for (i=1; i<=n_stmts; i++)
+		if (load_PV_stmt(crit,ustmts+i,stmts+i,'V'))
+			return dtl_error(DTL_STMT_ERROR);
+	/* Add statements */
+	if (call(TCL_add_V_constraints(uf->df,n_stmts,stmts),"TCL_add_V_constraints"))
+		return dtl_kernel_error();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return uf->df->V_base->n_stmts;
@@ -264,7 +309,7 @@ rcode DTLAPI DTL_change_V_statement(int crit, int stmt_number, double lobo, doub
 	/* Change statement */
 	if (call(TCL_change_V_constraint(uf->df,stmt_number,lobo,upbo),"TCL_change_V_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -300,7 +345,7 @@ rcode DTLAPI DTL_replace_V_statement(int crit, int stmt_number, struct user_stmt
 	/* Replace statement */
 	if (call(TCL_replace_V_constraint(uf->df,stmt_number,&stmt),"TCL_replace_V_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -332,7 +377,7 @@ rcode DTLAPI DTL_delete_V_statement(int crit, int stmt_number) {
 	/* Delete statement */
 	if (call(TCL_delete_V_constraint(uf->df,stmt_number),"TCL_delete_V_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return uf->df->V_base->n_stmts;
@@ -382,7 +427,7 @@ rcode DTLAPI DTL_add_V_mid_statement(int crit, struct user_stmt_rec* ustmtp) {
 	/* Set midpoint */
 	if (call(TCL_add_V_mstatement(uf->df,&stmt),"TCL_add_V_mstatement"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -416,7 +461,7 @@ rcode DTLAPI DTL_delete_V_mid_statement(int crit, struct user_stmt_rec* ustmtp)
 	/* Remove midpoint */
 	if (call(TCL_delete_V_mstatement(uf->df,&stmt),"TCL_delete_V_mstatement"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -523,7 +568,7 @@ rcode DTLAPI DTL_set_V_box(int crit, h_matrix lobox, h_matrix upbox) {
 			}
 	if (call(TCL_set_V_box(df,box_lobo,box_upbo),"TCL_set_V_box"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -575,7 +620,7 @@ rcode DTLAPI DTL_set_V_mbox(int crit, h_matrix lobox, h_matrix upbox) {
 	if (call(TCL_set_V_mbox(df,mbox_lobo,mbox_upbo),"TCL_set_V_mbox"))
 		return dtl_kernel_error();
 	uf->V_n_rels[crit] = 0;
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -639,6 +684,7 @@ rcode DTLAPI DTL_set_V_modal(int crit, int mode, h_matrix lobox, h_matrix modalx
 				mbox_lobo[k] = -1.0;
 		if (call(TCL_set_V_mbox(df,mbox_lobo,mbox_lobo),"TCL_set_V_mbox"))
 			return dtl_kernel_error();
+		eval_cache_modified(crit);
 		}
 	/* Next: create new box & mbox */
 	for (k=1,i=1; i<=df->n_alts; i++)
@@ -670,7 +716,7 @@ rcode DTLAPI DTL_set_V_modal(int crit, int mode, h_matrix lobox, h_matrix modalx
 	if (mode&0x02)
 		if (call(TCL_set_V_box(df,box_lobo,box_upbo),"TCL_set_V_box"))
 			return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return mcount;
@@ -703,7 +749,7 @@ rcode DTLAPI DTL_remove_V_mbox(int crit) {
 			}
 	if (call(TCL_set_V_mbox(df,mbox_lobo,mbox_upbo),"TCL_set_V_mbox"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -829,37 +875,105 @@ rcode DTLAPI DTL_get_V_modal(int crit, h_matrix modal) {
  * If Ai>0, Aj=0 -> check one alternative  (for PSI   and DIGAMMA 1 alt)
  * If Ai>0, Aj>0 -> check two alternatives (for DELTA and DIGAMMA 2 alts) */
 
-rcode dtl_check_V_modality(int crit, int Ai, int Aj) {
-	int i,j,k,unmodal=0;
+/* Modality summaries: the number of unmodal values of each alternative
+ * in each criterion. A criterion's row is taken from one hull and is
+ * kept until the bases of the criterion change (the stamps in uf->gen).
+ * Both the checks and the matrix are then sums over the rows. */
+
+struct vmod_rec {
+	struct user_frame *uf;         // frame the rows belong to
+	int n_alts;
+	int n_crit;
+	int stride;
+	unsigned long gen[MAX_CRIT+1]; // stamp of each criterion's row (0 = stale)
+	int size;
+	int *unmodal;
+	};
+
+static struct vmod_rec vmod;
+
+
+void vmod_release() {
+
+	if (vmod.unmodal)
+		mem_free((void *)vmod.unmodal);
+	vmod.unmodal = NULL;
+	vmod.size = 0;
+	vmod.uf = NULL;
+	}
+
+
+/* Get the summary row of crit, refreshing it if stale */
+
+static rcode vmod_row(int crit, int **row) {
+	int c,i,j,k,n;
 	struct d_frame *df;
 
-	/* Check input parameters */
+	/* Make room for the rows of the loaded frame */
+	if ((vmod.uf != uf) || (vmod.n_alts != uf->n_alts) || (vmod.n_crit != uf->n_crit)) {
+		for (c=0; c<=MAX_CRIT; c++)
+			vmod.gen[c] = 0;
+		vmod.uf = NULL;
+		vmod.n_alts = uf->n_alts;
+		vmod.n_crit = uf->n_crit;
+		vmod.stride = vmod.n_alts+1;
+		n = vmod.n_crit*vmod.stride;
+		if (vmod.size < n) {
+			if (vmod.unmodal)
+				mem_free((void *)vmod.unmodal);
+			vmod.unmodal = (int *)mem_alloc(n*sizeof(int),"int","vmod_row");
+			vmod.size = vmod.unmodal ? n : 0;
+			if (!vmod.unmodal)
+				return DTL_MEMORY_LEAK;
+			}
+		vmod.uf = uf;
+		}
+	*row = vmod.unmodal+(crit-1)*vmod.stride;
+	if (vmod.gen[crit] && (vmod.gen[crit] == uf->gen[crit]))
+		return DTL_OK;
 	if (load_df1(crit))
 		return DTL_CRIT_UNKNOWN;
 	df = uf->df;
-	if ((Ai < 0) || (Ai > df->n_alts))
-		return DTL_ALT_UNKNOWN;
-	if ((Aj < 0) || (Aj > df->n_alts))
-		return DTL_ALT_UNKNOWN;
 	/* Collect hull & mid for all values */
 	if (call(TCL_get_V_hull(df,vhlobo,vhupbo),"TCL_get_V_hull"))
 		return dtl_kernel_error();
 	if (call(TCL_get_V_masspoint(df,V_mid),"TCL_get_V_masspoint"))
 		return dtl_kernel_error();
 	/* Check each modal value against its own hull */
-	for (i=1, k=1; i<=df->n_alts; i++)
-		if (!Ai || (i==Ai) || (i==Aj)) {
-			for (j=1; j<=df->tot_cons[i]; j++, k++)
-				if (dtl_mid_to_modal(vhlobo[k],V_mid[k],vhupbo[k],1) == -3.0) {
-					unmodal++;
-					if (cst_ext) {
-						sprintf(msg,"    V%d.%d.%d = [%.3lf %.3lf %.3lf]\n",crit,i,j,vhlobo[k],V_mid[k],vhupbo[k]);
-						cst_log(msg);
-						}
+	for (i=1, k=1; i<=df->n_alts; i++) {
+		(*row)[i] = 0;
+		for (j=1; j<=df->tot_cons[i]; j++, k++)
+			if (dtl_mid_to_modal(vhlobo[k],V_mid[k],vhupbo[k],1) == -3.0) {
+				(*row)[i]++;
+				if (cst_ext) {
+					sprintf(msg,"    V%d.%d.%d = [%.3lf %.3lf %.3lf]\n",crit,i,j,vhlobo[k],V_mid[k],vhupbo[k]);
+					cst_log(msg);
 					}
-			}
-		else // step 1-dim counter
-			k += df->tot_cons[i];
+				}
+		}
+	vmod.gen[crit] = uf->gen[crit];
+	return DTL_OK;
+	}
+
+
+rcode dtl_check_V_modality(int crit, int Ai, int Aj) {
+	rcode rc;
+	int i,unmodal=0;
+	int *row;
+
+	/* Check input parameters */
+	if (check_df1(crit))
+		return DTL_CRIT_UNKNOWN;
+	if ((Ai < 0) || (Ai > uf->n_alts))
+		return DTL_ALT_UNKNOWN;
+	if ((Aj < 0) || (Aj > uf->n_alts))
+		return DTL_ALT_UNKNOWN;
+	if (rc = vmod_row(crit,&row))
+		return rc;
+	/* Sum the unmodal values of the alternatives */
+	for (i=1; i<=uf->n_alts; i++)
+		if (!Ai || (i==Ai) || (i==Aj))
+			unmodal += row[i];
 	/* Log result */
 	if (cst_ext) {
 		if (!Ai)
@@ -925,6 +1039,7 @@ rcode DTLAPI DTL_check_V_modality(int crit, int Ai, int Aj) {
 rcode DTLAPI DTL_get_V_modality_matrix(int crit, ai_matrix modal_mx) {
 	rcode rc;
 	int i,j,k,start,stop;
+	int *row;
 
 	/* Begin single thread semaphore */
 	_smx_begin("VMODMX");
@@ -947,20 +1062,23 @@ rcode DTLAPI DTL_get_V_modality_matrix(int crit, ai_matrix modal_mx) {
 		start = 1;
 		stop = uf->n_crit;
 		}
-	for (k=start; k<=stop; k++)
-		for (i=1; i<=uf->n_alts; i++) {
-			if (rc = dtl_check_V_modality(k,i,0))
-				if (!crit && (rc == DTL_CRIT_UNKNOWN))
-					continue; // shadow criterion
-				else if (rc < DTL_OK)
-					return dtl_error(rc);
-				else // unmodal
-					for (j=0; j<=uf->n_alts; j++) {
-						modal_mx[0][j] = 0; // reset base and GAMMA
-						modal_mx[i][j] = 0; // reset original DELTA
-						modal_mx[j][i] = 0; // reset mirrored DELTA
-						}
-			}
+	for (k=start; k<=stop; k++) {
+		rc = check_df1(k);
+		if (!rc)
+			rc = vmod_row(k,&row);
+		if (rc)
+			if (!crit && (rc == DTL_CRIT_UNKNOWN))
+				continue; // shadow criterion
+			else
+				return dtl_error(rc);
+		for (i=1; i<=uf->n_alts; i++)
+			if (row[i]) // unmodal
+				for (j=0; j<=uf->n_alts; j++) {
+					modal_mx[0][j] = 0; // reset base and GAMMA
+					modal_mx[i][j] = 0; // reset original DELTA
+					modal_mx[j][i] = 0; // reset mirrored DELTA
+					}
+		}
 	/* Log matrix results per alternative if unmodal */
 	if (cst_ext && !modal_mx[0][0]) {
 		cst_log(" Alt T");
@@ -1009,7 +1127,7 @@ rcode DTLAPI DTL_reset_V_base(int crit) {
 	/* Clear base */
 	if (call(TCL_reset_V_base(uf->df),"TCL_reset_V_base"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(crit);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -47,6 +47,7 @@
  *   Functions exported outside DTL
  *   ------------------------------
  *   DTL_add_W_statement
+ *   DTL_add_W_statements
  *   DTL_change_W_statement
  *   DTL_replace_W_statement
  *   DTL_delete_W_statement
@@ -97,6 +98,9 @@ static d_row box_lobo,box_upbo;
 static d_row mbox_lobo,mbox_upbo;
 static d_row hlobo,hupbo,llobo,lupbo,W_mid,LW_mid;
 
+/* Statement set buffer */
+static struct stmt_rec stmts[MAX_STMTS+1];
+
 
  /*********************************************************
   *
@@ -133,7 +137,48 @@ rcode DTLAPI DTL_add_W_statement(struct user_w_stmt_rec* uwstmtp) {
 	/* Add statement */
 	if (call(TCL_add_P_constraint(uf->df,&stmt),"TCL_add_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
+	/* End single thread semaphore */
+	_smx_end();
+	return uf->df->P_base->n_stmts;
+	}
+
+
+ /*
+  * Call semantics: Add the user weight statements uwstmts[1..n_stmts]
+  * to the weight base in one operation. The base is loaded and checked
+  * for consistency once for the whole set. In case of inconsistency,
+  * none of the statements are added to the base.
+  */
+
+rcode DTLAPI DTL_add_W_statements(int n_stmts, struct user_w_stmt_rec uwstmts[]) {
+	int i;
+
+	/* Begin single thread semaphore */
+	_smx_begin("AWSS");
+	/* Log function call */
+	if (cst_on) {
+		sprintf(msg,"DTL_add_W_statements(%d)\n",n_stmts);
+		cst_log(msg);
+		}
+	/* Check if function can start */
+	_certify_ptr(uwstmts,1);
+	if (!frame_loaded)
+		return dtl_error(DTL_FRAME_NOT_LOADED);
+	if (PS)
+		return dtl_error(DTL_WRONG_FRAME_TYPE);
+	/* Check input parameters */
+	if ((n_stmts < 1) || (n_stmts > MAX_STMTS))
+		return dtl_error(DTL_INPUT_ERROR);
+	if (load_df0(0))
+		return dtl_error(DTL_SYS_CORRUPT);
+	for (i=1; i<=n_stmts; i++)
+		if (load_W_stmt(uwstmts+i,stmts+i))
+			return dtl_error(DTL_STMT_ERROR);
+	/* Add statements */
+	if (call(TCL_add_P_constraints(uf->df,n_stmts,stmts),"TCL_add_P_constraints"))
+		return dtl_kernel_error();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return uf->df->P_base->n_stmts;
@@ -167,7 +212,7 @@ rcode DTLAPI DTL_change_W_statement(int stmt_number, double lobo, double upbo) {
 	/* Change statement */
 	if (call(TCL_change_P_constraint(uf->df,stmt_number,lobo,upbo),"TCL_change_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -205,7 +250,7 @@ rcode DTLAPI DTL_replace_W_statement(int stmt_number, struct user_w_stmt_rec* uw
 	/* Replace statement */
 	if (call(TCL_replace_P_constraint(uf->df,stmt_number,&stmt),"TCL_replace_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -239,7 +284,7 @@ rcode DTLAPI DTL_delete_W_statement(int stmt_number) {
 	/* Delete statement */
 	if (call(TCL_delete_P_constraint(uf->df,stmt_number),"TCL_delete_P_constraint"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return uf->df->P_base->n_stmts;
@@ -278,7 +323,7 @@ rcode DTLAPI DTL_add_W_mid_statement(struct user_w_stmt_rec* uwstmtp) {
 	/* Set midpoint */
 	if (call(TCL_add_P_mstatement(uf->df,&stmt),"TCL_add_P_mstatement"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -314,7 +359,7 @@ rcode DTLAPI DTL_delete_W_mid_statement(struct user_w_stmt_rec* uwstmtp) {
 	/* Remove midpoint */
 	if (call(TCL_delete_P_mstatement(uf->df,&stmt),"TCL_delete_P_mstatement"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -394,7 +439,7 @@ rcode DTLAPI DTL_set_W_box(h_vector lobox, h_vector upbox) {
 		}
 	if (call(TCL_set_P_box(df,box_lobo,box_upbo),"TCL_set_P_box"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -438,7 +483,7 @@ rcode DTLAPI DTL_set_W_mbox(h_vector lobox, h_vector upbox) {
 	if (call(TCL_set_P_mbox(df,mbox_lobo,mbox_upbo),"TCL_set_P_mbox"))
 		return dtl_kernel_error();
 	uf->WP_autogen[0] = FALSE;
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -495,7 +540,7 @@ rcode DTLAPI DTL_remove_W_mbox() {
 		}
 	if (call(TCL_set_P_mbox(df,mbox_lobo,mbox_upbo),"TCL_set_P_mbox"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -578,7 +623,7 @@ rcode DTLAPI DTL_reset_W_base() {
 	/* Reset information */
 	if (call(TCL_reset_P_base(uf->df),"TCL_reset_P_base"))
 		return dtl_kernel_error();
-	eval_cache_invalidate();
+	eval_cache_modified(0);
 	/* End single thread semaphore */
 	_smx_end();
 	return DTL_OK;
@@ -108,6 +108,10 @@
 
 #define MAX_CDF 100
 typedef double c_vector[MAX_CDF+1];
+typedef c_vector c_matrix[MAX_ALTS+1];
+/* Cdf level grids */
+#define CDF_FIXED    0x00 // even grid over the MC scale
+#define CDF_ADAPTIVE 0x01 // grid within the EV range of the alternative
 
 #define P_MAX_CRIT 12
 #define P_MAX_ALTS 10
@@ -152,6 +156,7 @@ rcode DTLAPI SML_set_V_base(int crit, bool rev, int renorm, h_matrix lobox, h_ma
 rcode DTLAPI SML_set_V_base2(int crit, bool rev, int renorm, h_matrix lobox, h_matrix mbox, h_matrix upbox, int *inc_var);
 rcode DTLAPI SML_get_V_hull(int crit, h_matrix lobo, h_matrix mid, h_matrix upbo);
 rcode DTLAPI SML_set_W_correlations(cr_matrix corr_mx);
+rcode DTLAPI SML_set_W_correlation_pairs(int n_pairs, int node1[], int node2[], double corr[]);
 // basic evaluation
 rcode DTLAPI SML_evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e_result);
 // belief mass functions
@@ -162,6 +167,8 @@ rcode DTLAPI SML_get_support_mass(double belief_level, double *lobo, double *upb
 rcode DTLAPI SML_get_support_lower(double belief_level, double *lobo, double *upbo);
 rcode DTLAPI SML_get_support_upper(double belief_level, double *lobo, double *upbo);
 rcode DTLAPI SML_evaluate_cdf(int crit, int Ai, c_vector level, c_vector cdf);
+rcode DTLAPI SML_evaluate_cdf2(int crit, int Ai, int mode, c_vector level, c_vector cdf);
+rcode DTLAPI SML_evaluate_cdf_all(int crit, int mode, c_matrix level, c_matrix cdf);
 // compound evaluations
 rcode DTLAPI SML_compare_alternatives(int crit, int method, double belief_level, ar_col lo_value, ar_col up_value);
 rcode DTLAPI SML_evaluate_mid(int Ai, int mode, cr_col o_result, ci_col o_rank);
@@ -59,6 +59,7 @@
  *   SML_set_P_base/2
  *   SML_set_V_base/2
  *   SML_set_W_correlations (experimental)
+ *   SML_set_W_correlation_pairs (experimental)
  *   SML_get_V_hull
  *   SML_evaluate_frame
  *   SML_get_mass_range
@@ -67,7 +68,8 @@
  *   SML_get_support_mass
  *   SML_get_support_lower
  *   SML_get_support_upper
- *   SML_evaluate_cdf
+ *   SML_evaluate_cdf/2
+ *   SML_evaluate_cdf_all
  *   SML_compare_alternatives
  *   SML_evaluate_mid
  *   SML_evaluate_omega/1/2
@@ -95,12 +97,15 @@
  *   ----------------------------
  *   sml_error_check
  *   sml_error_code
+ *   sml_room
  *   sml_new_flat_frame
  *   sml_new_tree_frame
  *   sml_get_frame_type
+ *   sml_correlate_pair
  *   sml_scale_type
  *   sml_get_mass_point
  *   sml_get_support_mass
+ *   sml_evaluate_cdf
  *   sml_evaluate_omega
  *   sml_get_PV_tornado
  *
@@ -202,9 +207,11 @@ static int sml_emethod;   // evaluation method
 #define SM2 (sml_type[0]==SM2_FRAME)
 #define NSM (sml_type[0]==NSM_FRAME)
 
-static int sml_type[MAX_FRAMES+1];
-static int sml_n_sh[MAX_FRAMES+1];
-static int sml_n_cr[MAX_FRAMES+1];
+/* Per-frame tables, entry 0 is the loaded frame. They grow with the
+ * frame numbers in use, like the DTL frame registry. */
+static int *sml_type = NULL;
+static int *sml_n_sh,*sml_n_cr;
+static int sml_max = 0;
 static int sml_renorm;
 #ifdef ERR_TEST
 static int sml_err_test=FALSE;
@@ -309,9 +316,40 @@ rcode DTLAPI ucall(rcode func) {
   *
   ********************************************************/
 
+/* Make room in the per-frame tables for frame number ufnbr */
+
+static bool sml_room(int ufnbr) {
+	int i,size,*block;
+
+	if (ufnbr <= sml_max)
+		return TRUE;
+	if (ufnbr > MAX_FRAME_NBR)
+		return FALSE;
+	for (size=max(2*sml_max,MAX_FRAMES); size<ufnbr; size*=2) ;
+	size = min(size,MAX_FRAME_NBR);
+	block = (int *)mem_alloc(3*(size+1)*sizeof(int),"int","sml_room");
+	if (!block)
+		return FALSE;
+	for (i=0; i<=size; i++)
+		if (sml_type && (i <= sml_max)) {
+			block[i] = sml_type[i];
+			block[size+1+i] = sml_n_sh[i];
+			block[2*(size+1)+i] = sml_n_cr[i];
+			}
+		else
+			block[i] = block[size+1+i] = block[2*(size+1)+i] = 0;
+	if (sml_type)
+		mem_free((void *)sml_type);
+	sml_type = block;
+	sml_n_sh = block+size+1;
+	sml_n_cr = block+2*(size+1);
+	sml_max = size;
+	return TRUE;
+	}
+
+
 rcode DTLAPI SML_init2(int mode) {
 	rcode rc;
-	int i;
 
 	/* Check if function can start */
 	if (sml_active)
@@ -330,13 +368,10 @@ rcode DTLAPI SML_init2(int mode) {
 	if (rc = CAR_init(0,0))
 		return rc;
 	/* Post processing */
+	if (!sml_room(MAX_FRAMES))
+		return SML_SYS_CORRUPT;
 	sml_active = TRUE;
 	sml_vsource = mode&0x01;
-	for (i=0; i<=MAX_FRAMES; i++) {
-		sml_type[i] = 0;
-		sml_n_sh[i] = 0;
-		sml_n_cr[i] = 0;
-		}
 #ifdef ERR_TEST
 	sml_err_test = (mode&0x02)>>1;
 	/* Log function exit only for logging of err_test */
@@ -369,6 +404,9 @@ rcode DTLAPI SML_exit() {
 	/* Reset internal flags */
 	sml_active = FALSE;
 	sml_vsource = FALSE;
+	mem_free((void *)sml_type);
+	sml_type = NULL;
+	sml_max = 0;
 #ifdef ERR_TEST
 	sml_err_test = FALSE;
 #endif
@@ -421,6 +459,8 @@ static rcode sml_new_flat_frame(rcode (DTLAPI *func)(int,int,int), int ufnbr, in
 	/* Check input parameter */
 	if (n_crit < 2) // plug PS loophole
 		return SML_INPUT_ERROR;
+	if (!sml_room(ufnbr))
+		return SML_FRAME_UNKNOWN;
 	/* Create frame */
 	if (rc = (*func)(ufnbr,n_crit,n_alts))
 		return rc;
@@ -451,6 +491,8 @@ static rcode sml_new_tree_frame(rcode (DTLAPI *func)(int,int,int,ta_tree),
 	/* Check input parameter */
 	if (n_wtnodes < 2) // PS loophole
 		return SML_INPUT_ERROR;
+	if (!sml_room(ufnbr))
+		return SML_FRAME_UNKNOWN;
 	/* Create tree frame */
 	if (rc = (*func)(ufnbr,n_alts,n_wtnodes,wtree))
 		return rc;
@@ -519,6 +561,8 @@ rcode DTLAPI SML_new_SM_tree_frame(int ufnbr, int type, int n_alts, int n_sh,
 		return SML_INPUT_ERROR;
 	if (n_wtnodes < 2) // no tree
 		return SML_INPUT_ERROR;
+	if (!sml_room(ufnbr))
+		return SML_FRAME_UNKNOWN;
 	/* Create tree frame */
 	if (type == SM1_FRAME) { // mirrored criteria
 		if (rc = DTL_new_SM_tree_frame(ufnbr,SM_MODE,n_alts,n_sh,n_wtnodes,wt_tree))
@@ -558,6 +602,8 @@ rcode DTLAPI SML_read_frame(int ufnbr, int type, int n_sh, char *fn, char *folde
 	if ((type == NSM_FRAME) && (n_sh != 1))
 		// an NSM_FRAME has only one sh (does not model it)
 		return SML_INPUT_ERROR;
+	if (!sml_room(ufnbr))
+		return SML_FRAME_UNKNOWN;
 	/* Call DTL read function */
 	if (DTL_error2(rc = DTL_read_frame(ufnbr,fn,folder,FALSE)))
 		return rc;
@@ -604,7 +650,7 @@ rcode DTLAPI SML_load_frame(int ufnbr) {
 	/* Check if function can start */
 	if (!sml_active)
 		return SML_STATE_ERROR;
-	if ((ufnbr < 0) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 0) || (ufnbr > sml_max))
 		return SML_FRAME_UNKNOWN;
 	if (!sml_type[ufnbr])
 		return SML_FRAME_UNKNOWN;
@@ -654,7 +700,7 @@ rcode DTLAPI SML_dispose_frame(int ufnbr) {
 	if (!sml_active)
 		return SML_STATE_ERROR;
 	/* Check input parameter */
-	if ((ufnbr < 0) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 0) || (ufnbr > sml_max))
 		return SML_FRAME_UNKNOWN;
 	if (!sml_type[ufnbr])
 		return SML_FRAME_UNKNOWN;
@@ -675,7 +721,7 @@ rcode DTLAPI SML_frame_type(int ufnbr) {
 	if (!sml_active)
 		return SML_STATE_ERROR;
 	/* Check input parameter (ufnbr 0 is current frame) */
-	if ((ufnbr < 0) || (ufnbr > MAX_FRAMES))
+	if ((ufnbr < 0) || (ufnbr > sml_max))
 		return SML_FRAME_UNKNOWN;
 	/* Return frame type */
 	return sml_get_frame_type(ufnbr);
@@ -912,7 +958,11 @@ rcode DTLAPI SML_get_V_hull(int crit, h_matrix lobo, h_matrix mid, h_matrix upbo
   *  their total weight influence on the MC problem.
   *
   *  The pairwise correlations reside in the upper
-  *  right triangle of the input matrix corr_mx.
+  *  right triangle of the input matrix corr_mx. For
+  *  a few pairs at a time, the sparse variant takes
+  *  a list of (node1,node2,corr) entries instead and
+  *  only sets midpoints in the sibling groups that
+  *  the pairs belong to, other midpoints are kept.
   *
   *  NOTE: There is nothing to prevent an API user
   *  to call this twice, but the function is provided
@@ -923,7 +973,48 @@ rcode DTLAPI SML_get_V_hull(int crit, h_matrix lobo, h_matrix mid, h_matrix upbo
   *
   *******************************************************/
 
-static h_vector rn_lobo,rn_mid,rn_upbo;
+static h_vector rn_lobo,rn_mid,rn_upbo,rn_mbox;
+static bool rn_touched[MAX_NOPA+1];
+
+/* Move the common part of correlation corr out of the pair (i,i2) and
+ * renormalise their sibling group, marking the group as touched */
+
+static rcode sml_correlate_pair(int i, int i2, double corr) {
+	int tnode,lnode;
+	double com_lo,com_mid,com_up,renorm;
+
+	if (dtl_W_node_parents(i,i2))
+		return SML_INPUT_ERROR; // different parents
+	if (!rn_mid[i] || !rn_mid[i2])
+		return SML_INPUT_ERROR; // zero weights not allowed, no ratio possible
+	if (corr * max(rn_mid[i],rn_mid[i2])/min(rn_mid[i],rn_mid[i2]) > 2.0)
+		return SML_INPUT_ERROR; // too big difference, rogue user, should be closer to 1.0
+	/* Calculate common correlation weight limits */
+	com_lo  = corr * (rn_lobo[i]+rn_lobo[i2])/2.0;
+	com_mid = corr * (rn_mid[i] +rn_mid[i2]) /2.0;
+	com_up  = corr * (rn_upbo[i]+rn_upbo[i2])/2.0;
+	/* Split common correlation between the pair */
+	rn_lobo[i] = (1.0-corr)*rn_lobo[i] + com_lo /2.0;
+	rn_mid[i]  = (1.0-corr)*rn_mid[i]  + com_mid/2.0;
+	rn_upbo[i] = (1.0-corr)*rn_upbo[i] + com_up /2.0;
+	rn_lobo[i2]= (1.0-corr)*rn_lobo[i2]+ com_lo /2.0;
+	rn_mid[i2] = (1.0-corr)*rn_mid[i2] + com_mid/2.0;
+	rn_upbo[i2]= (1.0-corr)*rn_upbo[i2]+ com_up /2.0;
+	/* Renormalise for all nodes with same parent */
+	renorm = 1.0-com_mid;
+	/* Seek first sibling node */
+	for (tnode=lnode=i; tnode; tnode=uf->df->prev[1][tnode])
+		lnode=tnode;
+	/* Renormalise all siblings (lnode is the leftmost one) */
+	for (tnode=lnode; tnode; tnode=uf->df->next[1][tnode]) {
+		rn_lobo[tnode] /= renorm;
+		rn_mid[tnode]  /= renorm;
+		rn_upbo[tnode]  = min(rn_upbo[tnode]/renorm,1.0); // overflow protection
+		rn_touched[tnode] = TRUE;
+		}
+	return SML_OK;
+	}
+
 
 // MS VC erroneously detects "illegal variable use"
 #ifdef _MSC_VER
@@ -934,8 +1025,7 @@ static h_vector rn_lobo,rn_mid,rn_upbo;
 rcode DTLAPI SML_set_W_correlations(cr_matrix corr_mx) {
 	rcode rc;
 	int i,i2,j;
-	int n_found,max_nodes,tnode,lnode;
-	double com_lo,com_mid,com_up,renorm;
+	int n_found,max_nodes;
 
 	/* Load MC uf pointer and get current weights */
 	if (rc = DTL_get_W_hull(0,rn_lobo,rn_mid,rn_upbo))
@@ -964,34 +1054,8 @@ rcode DTLAPI SML_set_W_correlations(cr_matrix corr_mx) {
 			if (corr_mx[i2][j])
 				return SML_INPUT_ERROR;
 		/* Have found a correlation pair (i,i2) */
-		if (dtl_W_node_parents(i,i2))
-			return SML_INPUT_ERROR; // different parents
-		if (!rn_mid[i] || !rn_mid[i2])
-			return SML_INPUT_ERROR; // zero weights not allowed, no ratio possible
-		if (corr_mx[i][i2] * max(rn_mid[i],rn_mid[i2])/min(rn_mid[i],rn_mid[i2]) > 2.0)
-			return SML_INPUT_ERROR; // too big difference, rogue user, should be closer to 1.0
-		/* Calculate common correlation weight limits */
-		com_lo  = corr_mx[i][i2] * (rn_lobo[i]+rn_lobo[i2])/2.0;
-		com_mid = corr_mx[i][i2] * (rn_mid[i] +rn_mid[i2]) /2.0;
-		com_up  = corr_mx[i][i2] * (rn_upbo[i]+rn_upbo[i2])/2.0;
-		/* Split common correlation between the pair */
-		rn_lobo[i] = (1.0-corr_mx[i][i2])*rn_lobo[i] + com_lo /2.0;
-		rn_mid[i]  = (1.0-corr_mx[i][i2])*rn_mid[i]  + com_mid/2.0;
-		rn_upbo[i] = (1.0-corr_mx[i][i2])*rn_upbo[i] + com_up /2.0;
-		rn_lobo[i2]= (1.0-corr_mx[i][i2])*rn_lobo[i2]+ com_lo /2.0;
-		rn_mid[i2] = (1.0-corr_mx[i][i2])*rn_mid[i2] + com_mid/2.0;
-		rn_upbo[i2]= (1.0-corr_mx[i][i2])*rn_upbo[i2]+ com_up /2.0;
-		/* Renormalise for all nodes with same parent */
-		renorm = 1.0-com_mid;
-		/* Seek first sibling node */
-		for (tnode=i; tnode; tnode=uf->df->prev[1][tnode])
-			lnode=tnode; // i>0 -> will do at least one loop backwards
-		/* Renormalise all siblings (lnode is the leftmost one) */
-		for (tnode=lnode; tnode; tnode=uf->df->next[1][tnode]) {
-			rn_lobo[tnode] /= renorm;
-			rn_mid[tnode]  /= renorm;
-			rn_upbo[tnode]  = min(rn_upbo[tnode]/renorm,1.0); // overflow protection
-			}
+		if (rc = sml_correlate_pair(i,i2,corr_mx[i][i2]))
+			return rc;
 		}
 	/* All ok -> update renormalised weights
 	 * NOTE: weights without a declared midpoint
@@ -1006,13 +1070,68 @@ rcode DTLAPI SML_set_W_correlations(cr_matrix corr_mx) {
 #endif
 
 
+/* Sparse correlations: n_pairs entries (node1[k],node2[k],corr[k]).
+ * A node may be in at most one pair. The pairs are applied in node
+ * order, as the matrix scan above does. */
+
+rcode DTLAPI SML_set_W_correlation_pairs(int n_pairs, int node1[], int node2[], double corr[]) {
+	rcode rc;
+	int i,j,k,max_nodes;
+	int pair[MAX_NOPA+1];
+
+	/* Check if function can start */
+	_certify_ptr(node1,301);
+	_certify_ptr(node2,302);
+	_certify_ptr(corr,303);
+	if (!sml_active)
+		return SML_STATE_ERROR;
+	/* Load MC uf pointer and get current weights */
+	if (rc = DTL_get_W_hull(0,rn_lobo,rn_mid,rn_upbo))
+		return rc;
+	if ((max_nodes = DTL_nbr_of_weights()) < DTL_OK)
+		return max_nodes;
+	/* Check input parameters, pair[i] = entry with i as its lower node */
+	if ((n_pairs < 1) || (n_pairs > max_nodes/2))
+		return SML_INPUT_ERROR;
+	for (i=1; i<=max_nodes; i++) {
+		pair[i] = -1;
+		rn_touched[i] = FALSE;
+		}
+	for (k=0; k<n_pairs; k++) {
+		i = min(node1[k],node2[k]);
+		j = max(node1[k],node2[k]);
+		if ((i < 1) || (j > max_nodes) || (i == j))
+			return SML_INPUT_ERROR;
+		if (rn_touched[i] || rn_touched[j])
+			return SML_INPUT_ERROR; // not a pure correlation pair
+		rn_touched[i] = rn_touched[j] = TRUE;
+		if (corr[k])
+			pair[i] = k;
+		}
+	for (i=1; i<=max_nodes; i++)
+		rn_touched[i] = FALSE;
+	/* Apply the pairs */
+	for (i=1; i<=max_nodes; i++)
+		if ((k = pair[i]) >= 0)
+			if (rc = sml_correlate_pair(i,max(node1[k],node2[k]),corr[k]))
+				return rc;
+	/* All ok -> update renormalised weights,
+	 * midpoints only in the touched groups */
+	for (i=1; i<=max_nodes; i++)
+		rn_mbox[i] = rn_touched[i] ? rn_mid[i] : -2.0;
+	if (rc = DTL_set_W_mbox1(rn_mbox))
+		return rc;
+	return DTL_set_W_box(rn_lobo,rn_upbo);
+	}
+
+
  /********************************************************
   *
   *  SML basic evaluations (incl. belief mass functions)
   *
   ********************************************************/
 
-static e_matrix x_result,c_result; // intermediate
+static e_matrix c_result; // intermediate
 
 static int sml_scale_type(int method, int Aj) {
 	int e_method;
@@ -1038,22 +1157,13 @@ rcode DTLAPI SML_evaluate_frame(int crit, int method, int Ai, int Aj, e_matrix e
 		}
 #endif
 	/* Check if function can start */
-	_init_assert();
-	_dtl_assert(e_result!=x_result,301);
 	if (!sml_active)
 		return SML_STATE_ERROR;
 	sml_emethod = NO_EMETHOD;
-	/* Call underlying DTL function */
-	if (rc = DTL_evaluate_full(crit,method,Ai,Aj,x_result))
-		return rc;
 	/* Autoscale conversion parameter */
 	sml_scale = sml_scale_type(method,Aj); // absolute or relative scale
-	/* Autoscale output conversion */
-	if (rc = DTL_get_AV_user_intervals(max(crit,0),sml_scale,MAX_RESULTSTEPS,
-			x_result[E_MIN],x_result[E_MAX],e_result[E_MIN],e_result[E_MAX]))
-		return rc;
-	if (rc = DTL_get_AV_user_vector(max(crit,0),sml_scale,MAX_RESULTSTEPS,
-			x_result[E_MID],e_result[E_MID]))
+	/* Call underlying DTL function with autoscale output */
+	if (rc = DTL_evaluate_full_AV(crit,method,Ai,Aj,sml_scale,e_result))
 		return rc;
 	sml_emethod = method&EMETHOD_MASK;
 	sml_ecrit = crit;
@@ -1153,30 +1263,90 @@ rcode DTLAPI SML_get_support_upper(double belief_level, double *lobo, double *up
 	}
 
 
-rcode DTLAPI SML_evaluate_cdf(int crit, int Ai, c_vector level, c_vector cdf) {
+/* The cdf of alternative Ai at MAX_CDF+1 levels. The fixed grid spans
+ * the MC scale. The adaptive grid keeps the scale end points but puts
+ * all other points within the EV range of Ai, where the cdf changes. */
+
+static c_vector level01; // intermediate
+
+static rcode sml_evaluate_cdf(int crit, int Ai, int mode, c_vector level, c_vector cdf) {
 	rcode rc;
 	int i;
 	double lvl,step,v_min,v_max;
 
+	/* Call SML function */
+	if (rc = SML_evaluate_frame(crit,E_PSI,Ai,0,c_result))
+		return rc;
+	/* Lay out the levels along the MC scale */
+	if (rc = DTL_get_AV_MC_scale(&v_min,&v_max))
+		return rc;
+	if ((mode & CDF_ADAPTIVE) && (c_result[E_MAX][0]-c_result[E_MIN][0] > SML_EPS*(v_max-v_min))) {
+		step = (c_result[E_MAX][0]-c_result[E_MIN][0])/(double)(MAX_CDF-2);
+		level[0] = v_min;
+		for (i=1, lvl=c_result[E_MIN][0]; i<MAX_CDF; i++, lvl+=step)
+			level[i] = min(max(lvl,v_min),v_max);
+		level[MAX_CDF-1] = min(c_result[E_MAX][0],v_max); // catch round-off errors
+		level[MAX_CDF] = v_max;
+		}
+	else {
+		step = (v_max-v_min)/(double)MAX_CDF;
+		for (i=0, lvl=v_min; i<=MAX_CDF; i++, lvl+=step)
+			level[i] = lvl;
+		level[MAX_CDF] = v_max; // catch round-off errors
+		}
+	/* Autoscale input conversion */
+	if (rc = DTL_get_AV_norm_vector(max(crit,0),sml_scale,MAX_CDF+1,level,level01))
+		return rc;
+	/* Collect the cdf in one call */
+	return DTL_get_mass_below_n(crit,MAX_CDF+1,level01,cdf);
+	}
+
+
+rcode DTLAPI SML_evaluate_cdf2(int crit, int Ai, int mode, c_vector level, c_vector cdf) {
+	rcode rc;
+
 	/* Check if function can start */
 	_init_assert();
 	_certify_ptr(level,301);
 	_certify_ptr(cdf,302);
 	_dtl_assert(level!=cdf,301);
-	/* Call SML function */
-	if (rc = SML_evaluate_frame(crit,E_PSI,Ai,0,c_result))
-		return rc;
-	/* Loop through MC scale and collect cdf */
-	if (rc = DTL_get_AV_MC_scale(&v_min,&v_max))
+	/* Check input parameter */
+	if (mode & ~CDF_ADAPTIVE)
+		return SML_INPUT_ERROR;
+	/* Call SML pattern function */
+	if (rc = sml_evaluate_cdf(crit,Ai,mode,level,cdf))
 		return rc;
-	step = (v_max-v_min)/(double)MAX_CDF;
-	for (i=0, lvl=v_min; i<=MAX_CDF; i++, lvl+=step) {
-		if (i==MAX_CDF)
-			lvl = v_max; // catch round-off errors
-		if (rc = SML_get_mass_below(lvl,cdf+i))
+	return SML_EC(SML_OK);
+	}
+
+
+rcode DTLAPI SML_evaluate_cdf(int crit, int Ai, c_vector level, c_vector cdf) {
+
+	return SML_evaluate_cdf2(crit,Ai,CDF_FIXED,level,cdf);
+	}
+
+
+/* The cdfs of all alternatives, one evaluation and one cdf call each */
+
+rcode DTLAPI SML_evaluate_cdf_all(int crit, int mode, c_matrix level, c_matrix cdf) {
+	rcode rc;
+	int i,n_alts;
+
+	/* Check if function can start */
+	_init_assert();
+	_certify_ptr(level,301);
+	_certify_ptr(cdf,302);
+	_dtl_assert(level!=cdf,301);
+	if (!sml_active)
+		return SML_STATE_ERROR;
+	/* Check input parameter */
+	if (mode & ~CDF_ADAPTIVE)
+		return SML_INPUT_ERROR;
+	if ((n_alts = DTL_nbr_of_alts()) < SML_OK)
+		return n_alts;
+	for (i=1; i<=n_alts; i++)
+		if (rc = sml_evaluate_cdf(crit,i,mode,level[i],cdf[i]))
 			return rc;
-		level[i] = lvl;
-		}
 	return SML_EC(SML_OK);
 	}
 
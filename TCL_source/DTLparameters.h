@@ -56,6 +56,11 @@
 
 #define noBIGFOOT
 
+/* Allowing the criteria of a PM frame to be evaluated in parallel.
+ * The TCL scratch areas become thread-local (pthreads on Unix). */
+
+#define noPAR_EVAL
+
 
  /*********************************************************
   *
@@ -87,6 +92,17 @@
 
 #endif
 
+/* Thread-local TCL scratch areas */
+#ifdef PAR_EVAL
+#ifdef _MSC_VER
+#define TCL_TLS __declspec(thread)
+#else
+#define TCL_TLS __thread
+#endif
+#else
+#define TCL_TLS
+#endif
+
 /* Max size of frame name */
 #define FNSIZE 128
 
@@ -88,8 +88,11 @@ struct stmt_rec {
 	double upbo;
 	};
 
-/* Max number of user statements */
+/* Max number of user statements in one call. The base stores grow
+ * up to MAX_P_STMTS and MAX_V_STMTS. */
 #define MAX_STMTS 301
+#define MAX_P_STMTS 100001
+#define MAX_V_STMTS 100001
 
 /* Solver data types */
 #define MAX_ROWS 2*MAX_STMTS+MAX_COPA
@@ -111,18 +114,26 @@ typedef t_row t_matrix[MAX_ALTS+1];
 struct base {
 	int watermark;
 	int n_stmts;
-	struct stmt_rec stmt[MAX_STMTS+1];
-	d_row lo_midbox;
-	d_row up_midbox;
-	d_row lo_im_midbox;
-	d_row up_im_midbox;
+	int max_stmts;          // room in stmt
+	struct stmt_rec *stmt;  // statements 1..n_stmts
+	/* Rows sized to the frame (tot_cons[0]+1 entries) */
+	double *lo_midbox;
+	double *up_midbox;
+	double *lo_im_midbox;
+	double *up_im_midbox;
 	bool box;
-	d_row box_lobo;
-	d_row box_upbo;
-	d_row im_box_lobo;
-	d_row im_box_upbo;
+	double *box_lobo;
+	double *box_upbo;
+	double *im_box_lobo;
+	double *im_box_upbo;
+	/* Sharing between a frame and its forks (copy-on-write) */
+	int n_users;
+	struct d_frame *home; // frame whose arena holds the base, NULL=own chunk
 	};
 
+struct tcl_ctx; /* TCL internal */
+struct tree_topo; /* TCL internal */
+
 struct d_frame {
 	int watermark;
 	char name[FNSIZE+6];
@@ -132,13 +143,44 @@ struct d_frame {
 	int n_cons[MAX_ALTS+1];   /* Real cons */
 	int im_cons[MAX_ALTS+1];  /* Intermediate cons */
 	int tot_cons[MAX_ALTS+1]; /* Both types of cons */
-	t_matrix next;
-	t_matrix prev;
-	t_matrix down;
-	t_matrix up;
+	/* Tree pointers, row i sized to the alternative (tot_cons[i]+1).
+	 * They are in the topology, shared by all frames of the same shape. */
+	int **next;
+	int **prev;
+	int **down;
+	int **up;
+	struct tree_topo *topo;
 	/* Bases */
 	struct base *P_base;
 	struct base *V_base;
+	/* Working state */
+	struct tcl_ctx *ctx;
+	/* Arena: the bases and the context are carved from the frame's own
+	 * chunk, so the frame is released in one go */
+	char *arena;
+	char *arena_end;
+	/* Own base slots in the arena, NULL until carved. A fork uses the
+	 * bases of its origin until it writes to them. */
+	struct base *P_own;
+	struct base *V_own;
+	};
+
+
+/* Performance counters, since the last reset. Updated atomically
+ * under PAR_EVAL, so parallel workers do not lose counts. */
+struct tcl_perf {
+	unsigned long load_P;     // P-base loads
+	double load_P_time;       // seconds in them
+	unsigned long load_V;     // V-base loads
+	double load_V_time;
+	unsigned long load_V_inc; // incremental V-base updates
+	double load_V_inc_time;
+	unsigned long attach;     // TCL_attach_frame calls
+	unsigned long eval_P;     // eval_P_max/min calls
+	unsigned long sort_elems; // elements sorted by sort_dom2
+	unsigned long vx_calls;   // adjust_vx calls
+	unsigned long vx_paths;   // vertex paths enumerated
+	unsigned long vx_bails;   // calls leaving the mass point as is
 	};
 
 
@@ -164,6 +206,11 @@ typedef struct link_rec link_set[2*MAX_STMTS+1];
 #define DIGAMMA 4
 #define MAX_EMETHOD DIGAMMA
 
+/* DIGAMMA's int bitmap holds alts 1..DIGAMMA_BITS, larger
+ * frames use alternative sets (a_set[i] != 0 for members) */
+#define DIGAMMA_BITS 32
+typedef int a_set[MAX_ALTS+1];
+
 
 /*** Library calls ***/
 
@@ -171,15 +218,22 @@ typedef struct link_rec link_set[2*MAX_STMTS+1];
 rcode TCL_create_flat_frame(struct d_frame **dfp, int n_alts, int n_cons[]);
 rcode TCL_create_tree_frame(struct d_frame **dfp, int n_alts, int tot_cons[], 
 				t_matrix next, t_matrix down);
+rcode TCL_fork_frame(struct d_frame *df, struct d_frame **dfp);
 rcode TCL_dispose_frame(struct d_frame *df);
 rcode TCL_attach_frame(struct d_frame *df);
 rcode TCL_detach_frame(struct d_frame *df);
+rcode TCL_bind_frame(struct d_frame *df);
+void TCL_unbind_frame();
+rcode TCL_get_base_image(struct d_frame *df, bool V, struct base **base, double **rows, int *n_rows);
+rcode TCL_set_base_image(struct d_frame *df, bool V, int n_stmts, struct stmt_rec *stmts, 
+				bool box, double *rows, int n_rows);
 int TCL_pure_tree(struct d_frame *df, int alt);
 int TCL_different_parents(struct d_frame *df, int alt, int node1, int node2);
 int TCL_nbr_of_siblings(struct d_frame *df, int alt, int node);
 
 /*** P-base procedures ***/
 rcode TCL_add_P_constraint(struct d_frame *df, struct stmt_rec *P_stmt);
+rcode TCL_add_P_constraints(struct d_frame *df, int n_stmts, struct stmt_rec P_stmts[]);
 rcode TCL_replace_P_constraint(struct d_frame *df, int stmt_nbr, struct stmt_rec *P_stmt);
 rcode TCL_change_P_constraint(struct d_frame *df, int stmt_nbr, double lobo, double upbo);
 rcode TCL_delete_P_constraint(struct d_frame *df, int stmt_nbr);
@@ -197,6 +251,7 @@ rcode TCL_reset_P_base(struct d_frame *df);
 
 /*** V-base procedures ***/
 rcode TCL_add_V_constraint(struct d_frame *df, struct stmt_rec *V_stmt);
+rcode TCL_add_V_constraints(struct d_frame *df, int n_stmts, struct stmt_rec V_stmts[]);
 rcode TCL_replace_V_constraint(struct d_frame *df, int stmt_nbr, struct stmt_rec *V_stmt);
 rcode TCL_change_V_constraint(struct d_frame *df, int stmt_nbr, double lobo, double upbo);
 rcode TCL_delete_V_constraint(struct d_frame *df, int stmt_nbr);
@@ -215,10 +270,23 @@ rcode TCL_reset_V_base(struct d_frame *df);
 /*** Evaluation procedures ***/
 rcode TCL_evaluate(struct d_frame *df, int Ai, int Aj, int eval_method, a_result result);
 rcode TCL_evaluate_omega(struct d_frame *df, int Ai, double *result);
+rcode TCL_evaluate_omega_all(struct d_frame *df, a_row result);
+rcode TCL_probe_P(struct d_frame *df, struct stmt_rec *P_stmt, bool free_mid, double *result);
+rcode TCL_probe_V(struct d_frame *df, struct stmt_rec *V_stmt, bool free_mid, double *result);
+rcode TCL_probe_P_points(struct d_frame *df, int Ai, struct stmt_rec *P_stmt, bool free_mid, 
+				int n_sets, int v_stride, double V_pts[], double result[]);
+rcode TCL_evaluate_all(struct d_frame *df, a_result result);
+rcode TCL_evaluate_digamma(struct d_frame *df, int n_sets, int Ai[], a_set alts[], 
+				double lo_value[], double mid_value[], double up_value[]);
+rcode TCL_evaluate_V_boxes(struct d_frame *df, int n_boxes, int b_stride, 
+				double tbox_lobo[], double tbox_upbo[], int e_stride, 
+				double lo_value[], double mid_value[], double up_value[]);
 
 /*** Security levels ***/
 rcode TCL_security_level(struct d_frame *df, double sec_level, 
 				a_vector strong, a_vector marked, a_vector weak);
+rcode TCL_security_sweep(struct d_frame *df, int n_levels, double sec_level[], 
+				a_vector strong[], a_vector marked[], a_vector weak[]);
 
 /*** Optimisation ***/
 rcode TCL_get_P_max(struct d_frame *df, int alt, int snode, 
@@ -232,10 +300,18 @@ rcode TCL_get_mc_moments(struct d_frame *df, int snode, d_row Vx_rm1, d_row Vx_c
 			d_row Vx_cm3, double *rm1, double *cm2, double *cm3);
 rcode TCL_get_P_sd(struct d_frame *df, int inx, double *sd);
 rcode TCL_get_V_sd(struct d_frame *df, int inx, int im, double *sd);
+void TCL_sample_seed(unsigned long seed);
+double TCL_sample_td(double lobo, double top, double upbo);
+rcode TCL_get_EV_samples(struct d_frame *df, int n_samples, a_row coeff, double sample[]);
+rcode TCL_get_W_samples(struct d_frame *df, int snode, int n_samples, int stride, double sample[]);
 
 /*** Error procedure ***/
 char *TCL_get_errtxt(rcode rc);
 
+/*** Performance counters ***/
+void TCL_get_perf(struct tcl_perf *perf);
+void TCL_reset_perf();
+
 /*** Memory management (common to TCL and DTL) ***/
 void *mem_alloc(size_t size, char *type, char *source);
 rcode mem_free(void* mem_ptr);
@@ -58,9 +58,14 @@
  *
  *   Functions internal to module
  *   ----------------------------
+ *   sub_end
  *   calc_EV
+ *   eval_P1_sweep
+ *   eval_P1_flat
  *   eval_P1_max
  *   eval_P1_min
+ *   ixset_flat_max
+ *   ixset_flat_min
  *
  */
 
@@ -71,168 +76,174 @@
   *
   *********************************************************/
 
-static d_row local_p_lobo,local_p_upbo,local_v,p_max;
-static d_row im_local_v;
-static d_row im_V_pt;
-static i_row order;
+static TCL_TLS d_row local_p_lobo,local_p_upbo,local_v,p_max;
+static TCL_TLS d_row im_local_v;
+static TCL_TLS d_row im_V_pt;
+static TCL_TLS i_row order;
+
+/* The evaluations below sweep the compiled tree (kid_lo/kid_hi/kid_inx)
+ * instead of recursing through tdown/tnext. All nodes below snode lie in
+ * snode+1..sub_end(), so a downward scan over that range meets each im-node
+ * group before the group of its parent. Local data is indexed by position. */
+
+static int sub_end(int alt, int snode) {
+
+	if (!snode)
+		return tot_alt_inx[alt]-tot_alt_inx[alt-1];
+	if (tdown[alt][snode])
+		return i2end[at2i(alt,snode)]-tot_alt_inx[alt-1];
+	return snode;
+	}
+
 
 static double calc_EV(int alt, int snode, d_row V_pt, d_row im_V_pt, d_row P_pt, d_row im_P_pt) {
-	int inx,tnode;
+	int k,tnode;
 	double EV;
 
 	/* Calculate EV from local tree node data */
 	EV = 0.0;
-	/* Sum all nodes on this level */
-	for (tnode=tdown[alt][snode]; tnode; tnode=tnext[alt][tnode]) {
-		/* Create local v-order */
-		if (tdown[alt][tnode]) {
-			/* Im-node */
-			inx = at2i(alt,tnode);
-			im_V_pt[inx] = calc_EV(alt,tnode,V_pt,im_V_pt,P_pt,im_P_pt);
-			EV += im_P_pt[inx] * im_V_pt[inx];
-			}
-		else {
+	for (tnode=sub_end(alt,snode); tnode>=snode; tnode--) {
+		if (kid_lo[alt][tnode] == kid_hi[alt][tnode])
 			/* Re-node */
-			inx = at2r(alt,tnode);
-			EV += P_pt[inx] * V_pt[inx];
-			}
+			continue;
+		/* Sum all nodes on this level */
+		EV = 0.0;
+		for (k=kid_lo[alt][tnode]; k<kid_hi[alt][tnode]; k++)
+			if (tdown[alt][kid_node[alt][k]])
+				/* Im-node */
+				EV += im_P_pt[kid_inx[alt][k]] * im_V_pt[kid_inx[alt][k]];
+			else
+				/* Re-node */
+				EV += P_pt[kid_inx[alt][k]] * V_pt[kid_inx[alt][k]];
+		if (tnode > snode)
+			im_V_pt[at2i(alt,tnode)] = EV;
 		}
 	return EV;
 	}
 
 
-static double eval_P1_max(int alt, int snode, int k_start, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
-	int inx,i,j,k,tnode;
+static double eval_P1_sweep(int alt, int snode, d_row V_pt, d_row P_pt, d_row im_P_pt, 
+		bool positive, bool maxorder) {
+	int inx,j,k,k_start,tnode;
 	double pmin,pmass,add_on,EV;
 
-	/* Collect all nodes on this level */
-	for (k=k_start, tnode=tdown[alt][snode]; tnode; tnode=tnext[alt][tnode], k++) {
-		/* Create local v-order */
-		if (tdown[alt][tnode]) {
-			/* Im-node */
-			inx = at2i(alt,tnode);
-			local_p_lobo[k] = im_L_hull_lobo[inx];
-			local_p_upbo[k] = im_L_hull_upbo[inx];
-			local_v[k] = eval_P1_max(alt,tnode,k+1,V_pt,P_pt,im_P_pt,positive);
-			if (!positive)
-				local_v[k] = -local_v[k];
-			}
-		else {
-			/* Re-node */
-			inx = at2r(alt,tnode);
-			local_p_lobo[k] = L_hull_lobo[inx];
-			local_p_upbo[k] = L_hull_upbo[inx];
-			local_v[k] = V_pt[inx];
-			}
-		}
-	for (i=k_start; i<k; i++)
-		order[i] = i;
-	sort_dom2(order,local_v,k_start,k-1,TRUE);
 	EV = 0.0;
-	pmin = 0.0;
-	for (j=k_start; j<k; j++)
-		pmin += local_p_lobo[j];
-	pmass = 1.0 - pmin;
-	/* Pick max in max-order. */
-	for (j=k_start; j<k; j++) {
-		add_on = min(local_p_upbo[order[j]]-local_p_lobo[order[j]],pmass);
-		p_max[order[j]] = local_p_lobo[order[j]] + add_on;
-		if (!positive)
-			p_max[order[j]] = -p_max[order[j]];
-		pmass -= add_on;
-		EV += p_max[order[j]] * local_v[order[j]];
-		}
-	/* Update all nodes on this level */
-	for (k=k_start, tnode=tdown[alt][snode]; tnode; tnode=tnext[alt][tnode], k++) {
-		/* Update global nodes */
-		if (tdown[alt][tnode]) {
-			/* Im-node */
-			inx = at2i(alt,tnode);
-			im_P_pt[inx] = p_max[k];
-			}
-		else {
+	for (tnode=sub_end(alt,snode); tnode>=snode; tnode--) {
+		k_start = kid_lo[alt][tnode];
+		k = kid_hi[alt][tnode];
+		if (k_start == k)
 			/* Re-node */
-			inx = at2r(alt,tnode);
-			P_pt[inx] = p_max[k];
+			continue;
+		/* Collect all nodes on this level */
+		for (j=k_start; j<k; j++) {
+			/* Create local v-order */
+			inx = kid_inx[alt][j];
+			if (tdown[alt][kid_node[alt][j]]) {
+				/* Im-node, evaluated earlier in the sweep */
+				local_p_lobo[j] = im_L_hull_lobo[inx];
+				local_p_upbo[j] = im_L_hull_upbo[inx];
+				local_v[j] = im_local_v[inx];
+				if (!positive)
+					local_v[j] = -local_v[j];
+				}
+			else {
+				/* Re-node */
+				local_p_lobo[j] = L_hull_lobo[inx];
+				local_p_upbo[j] = L_hull_upbo[inx];
+				local_v[j] = V_pt[inx];
+				}
+			order[j] = j;
+			}
+		sort_dom2(order,local_v,k_start,k-1,maxorder);
+		EV = 0.0;
+		pmin = 0.0;
+		for (j=k_start; j<k; j++)
+			pmin += local_p_lobo[j];
+		pmass = 1.0 - pmin;
+		/* Pick max in max-order (or min-order) */
+		for (j=k_start; j<k; j++) {
+			add_on = min(local_p_upbo[order[j]]-local_p_lobo[order[j]],pmass);
+			p_max[order[j]] = local_p_lobo[order[j]] + add_on;
+			if (!positive)
+				p_max[order[j]] = -p_max[order[j]];
+			pmass -= add_on;
+			EV += p_max[order[j]] * local_v[order[j]];
 			}
+		/* Update all nodes on this level */
+		for (j=k_start; j<k; j++)
+			if (tdown[alt][kid_node[alt][j]])
+				/* Im-node */
+				im_P_pt[kid_inx[alt][j]] = p_max[j];
+			else
+				/* Re-node */
+				P_pt[kid_inx[alt][j]] = p_max[j];
+		/* Keep the level EV for the parent level */
+		if (tnode > snode)
+			im_local_v[at2i(alt,tnode)] = EV;
 		}
 	return EV;
 	}
 
 
-static double eval_P1_min(int alt, int snode, int k_start, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
-	int inx,i,j,k,tnode;
+/* The sweep for a flat alternative. Its only level is the B2 range
+ * alt_inx[alt-1]+1..alt_inx[alt], which is ordered and filled in place. */
+
+static double eval_P1_flat(int alt, d_row V_pt, d_row P_pt, bool maxorder) {
+	int j,j_start,j_end;
 	double pmin,pmass,add_on,EV;
 
-	/* Collect all nodes on this level */
-	for (k=k_start, tnode=tdown[alt][snode]; tnode; tnode=tnext[alt][tnode], k++) {
-		/* Create local v-order */
-		if (tdown[alt][tnode]) {
-			/* Im-node */
-			inx = at2i(alt,tnode);
-			local_p_lobo[k] = im_L_hull_lobo[inx];
-			local_p_upbo[k] = im_L_hull_upbo[inx];
-			local_v[k] = eval_P1_min(alt,tnode,k+1,V_pt,P_pt,im_P_pt,positive);
-			if (!positive)
-				local_v[k] = -local_v[k];
-			}
-		else {
-			/* Re-node */
-			inx = at2r(alt,tnode);
-			local_p_lobo[k] = L_hull_lobo[inx];
-			local_p_upbo[k] = L_hull_upbo[inx];
-			local_v[k] = V_pt[inx];
-			}
-		}
-	for (i=k_start; i<k; i++)
-		order[i] = i;
-	sort_dom2(order,local_v,k_start,k-1,FALSE);
-	EV = 0.0;
+	j_start = alt_inx[alt-1]+1;
+	j_end = alt_inx[alt];
 	pmin = 0.0;
-	for (j=k_start; j<k; j++)
-		pmin += local_p_lobo[j];
+	for (j=j_start; j<=j_end; j++) {
+		pmin += L_hull_lobo[j];
+		order[j] = j;
+		}
+	sort_dom2(order,V_pt,j_start,j_end,maxorder);
 	pmass = 1.0 - pmin;
-	/* Pick max in min-order. */
-	for (j=k_start; j<k; j++) {
-		add_on = min(local_p_upbo[order[j]]-local_p_lobo[order[j]],pmass);
-		p_max[order[j]] = local_p_lobo[order[j]] + add_on;
-		if (!positive)
-			p_max[order[j]] = -p_max[order[j]];
+	EV = 0.0;
+	for (j=j_start; j<=j_end; j++) {
+		add_on = min(L_hull_upbo[order[j]]-L_hull_lobo[order[j]],pmass);
+		P_pt[order[j]] = L_hull_lobo[order[j]] + add_on;
 		pmass -= add_on;
-		EV += p_max[order[j]] * local_v[order[j]];
-		}
-	/* Update all nodes on this level */
-	for (k=k_start, tnode=tdown[alt][snode]; tnode; tnode=tnext[alt][tnode], k++) {
-		/* Update global nodes */
-		if (tdown[alt][tnode]) {
-			/* Im-node */
-			inx = at2i(alt,tnode);
-			im_P_pt[inx] = p_max[k];
-			}
-		else {
-			/* Re-node */
-			inx = at2r(alt,tnode);
-			P_pt[inx] = p_max[k];
-			}
+		EV += P_pt[order[j]] * V_pt[order[j]];
 		}
 	return EV;
 	}
 
 
-double eval_P_max(int alt, int snode, int k_start, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
+static double eval_P1_max(int alt, int snode, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
+
+	if (flat_frame && !snode)
+		return eval_P1_flat(alt,V_pt,P_pt,TRUE);
+	return eval_P1_sweep(alt,snode,V_pt,P_pt,im_P_pt,positive,TRUE);
+	}
+
+
+static double eval_P1_min(int alt, int snode, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
+
+	if (flat_frame && !snode)
+		return eval_P1_flat(alt,V_pt,P_pt,FALSE);
+	return eval_P1_sweep(alt,snode,V_pt,P_pt,im_P_pt,positive,FALSE);
+	}
+
+
+double eval_P_max(int alt, int snode, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
 	double EV;
 
-	EV = eval_P1_max(alt,snode,k_start,V_pt,P_pt,im_P_pt,TRUE);
+	perf_add(eval_P,1);
+	EV = eval_P1_max(alt,snode,V_pt,P_pt,im_P_pt,TRUE);
 	if (!positive)
 		EV = -EV;
 	return EV;
 	}
 
 
-double eval_P_min(int alt, int snode, int k_start, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
+double eval_P_min(int alt, int snode, d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive) {
 	double EV;
 
-	EV = eval_P1_min(alt,snode,k_start,V_pt,P_pt,im_P_pt,TRUE);
+	perf_add(eval_P,1);
+	EV = eval_P1_min(alt,snode,V_pt,P_pt,im_P_pt,TRUE);
 	if (!positive)
 		EV = -EV;
 	return EV;
@@ -251,8 +262,9 @@ rcode TCL_get_P_max(struct d_frame *df, int alt, int snode,
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
-	*maxval = eval_P_max(alt,snode,1,V_pt,P_pt,im_P_pt,positive);
+	*maxval = eval_P_max(alt,snode,V_pt,P_pt,im_P_pt,positive);
 	return TCL_OK;
 	}
 
@@ -269,8 +281,9 @@ rcode TCL_get_P_min(struct d_frame *df, int alt, int snode,
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
-	*minval = eval_P_min(alt,snode,1,V_pt,P_pt,im_P_pt,positive);
+	*minval = eval_P_min(alt,snode,V_pt,P_pt,im_P_pt,positive);
 	return TCL_OK;
 	}
 
@@ -281,10 +294,44 @@ rcode TCL_get_P_min(struct d_frame *df, int alt, int snode,
   *
   *********************************************************/
 
+/* Index sets over the B2 range of a flat alternative */
+
+static double ixset_flat_max(int alt, i_row ixset) {
+	int inx;
+	double LP_sum,LP_csum;
+
+	LP_sum = 0.0;
+	LP_csum = 1.0;
+	for (inx=alt_inx[alt-1]+1; inx<=alt_inx[alt]; inx++)
+		if (ixset[inx])
+			LP_sum += L_hull_upbo[inx];
+		else
+			LP_csum -= L_hull_lobo[inx];
+	return min(LP_sum,LP_csum);
+	}
+
+
+static double ixset_flat_min(int alt, i_row ixset) {
+	int inx;
+	double LP_sum,LP_csum;
+
+	LP_sum = 0.0;
+	LP_csum = 1.0;
+	for (inx=alt_inx[alt-1]+1; inx<=alt_inx[alt]; inx++)
+		if (ixset[inx])
+			LP_sum += L_hull_lobo[inx];
+		else
+			LP_csum -= L_hull_upbo[inx];
+	return max(LP_sum,LP_csum);
+	}
+
+
 double ixset_P_max(int alt, int snode, i_row ixset) {
 	int inx,tnode;
 	double LP_sum,LP_csum,sprob;
 
+	if (flat_frame && !snode)
+		return ixset_flat_max(alt,ixset);
 	/* Collect the maximum probability for the index set
 	   and the minimum probability for the complementary set */
 	LP_sum = 0.0;
@@ -317,6 +364,8 @@ double ixset_P_min(int alt, int snode, i_row ixset) {
 	int inx,tnode;
 	double LP_sum,LP_csum,sprob;
 
+	if (flat_frame && !snode)
+		return ixset_flat_min(alt,ixset);
 	/* Collect the minimum probability for the index set
 	   and the maximum probability for the complementary set */
 	LP_sum = 0.0;
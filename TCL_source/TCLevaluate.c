@@ -48,6 +48,13 @@
  *   ------------------------------
  *   TCL_evaluate
  *   TCL_evaluate_omega
+ *   TCL_evaluate_omega_all
+ *   TCL_probe_P
+ *   TCL_probe_V
+ *   TCL_probe_P_points
+ *   TCL_evaluate_all
+ *   TCL_evaluate_digamma
+ *   TCL_evaluate_V_boxes
  *
  *   Functions outside module, inside TCL
  *   ------------------------------------
@@ -57,12 +64,15 @@
  *   ----------------------------
  *   mm_cmp
  *   mm_cmp_rev
+ *   omega_mid
  *   omega
  *   calc_omega
+ *   calc_table
  *   calc_psi
  *   calc_delta
  *   calc_gamma
  *   calc_digamma
+ *   calc_digamma_set
  *
  */
 
@@ -86,7 +96,7 @@
   *
   *********************************************************/
 
-static double *mm;
+static TCL_TLS double *mm;
 
 static int mm_cmp(const void *k1, const void *k2) {
 
@@ -112,6 +122,7 @@ static int mm_cmp_rev(const void *k1, const void *k2) {
 
 void sort_dom2(i_row lin_order, d_row maxmin, int start, int stop, bool rev) {
 
+	perf_add(sort_elems,stop-start+1);
 	mm = maxmin;
 	qsort(lin_order+start,stop-start+1,sizeof(int),(rev?mm_cmp_rev:mm_cmp));
 	}
@@ -123,17 +134,16 @@ void sort_dom2(i_row lin_order, d_row maxmin, int start, int stop, bool rev) {
   *
   *********************************************************/
 
-static d_row V_lobo,V_upbo;
-static d_row P_point,im_P_point;
-static d_row P_mid,V_mid;
+static TCL_TLS d_row V_lobo,V_upbo;
+static TCL_TLS d_row P_point,im_P_point;
+static TCL_TLS d_row P_mid,V_mid;
 
-static double omega(int Ai) {
+/* Omega of Ai at the mass points in P_mid and V_mid */
+
+static double omega_mid(int Ai) {
 	int i,Ai_begin,Ai_end;
 	double omega;
 
-	/* Evaluate Ai */
-	mpoint_P(P_mid);
-	mpoint_V(V_mid);
 	Ai_begin = get_V_start(Ai);
 	Ai_end = get_V_end(Ai);
 	omega = 0.0;
@@ -144,31 +154,65 @@ static double omega(int Ai) {
 	}
 
 
+static double omega(int Ai) {
+
+	/* Evaluate Ai */
+	mpoint_P(P_mid);
+	mpoint_V(V_mid);
+	return omega_mid(Ai);
+	}
+
+
 static void calc_omega(int Ai, a_result result) {
 
 	result[Ai][E_MIN] = result[Ai][E_MID] = result[Ai][E_MAX] = omega(Ai);
 	}
 
 
+/* The min, mid and max EV of an alternative do not depend on what it
+ * is compared to. They are calculated once for all alternatives and kept
+ * in the frame context until the P- or V-base is reloaded. Delta, gamma,
+ * digamma and psi are then formed from the table entries. */
+
+static TCL_TLS double *E_lo,*E_mid,*E_up;
+
+static void calc_table(struct d_frame *df) {
+	int Ai;
+	struct tcl_ctx *cx;
+
+	cx = df->ctx;
+	E_lo = cx->E_lo;
+	E_mid = cx->E_mid;
+	E_up = cx->E_up;
+	if (cx->E_ok)
+		return;
+	fhull_V(V_lobo,V_upbo);
+	mpoint_P(P_mid);
+	mpoint_V(V_mid);
+	for (Ai=1; Ai<=df->n_alts; Ai++) {
+		E_lo[Ai] = eval_P_min(Ai,0,V_lobo,P_point,im_P_point,TRUE);
+		E_mid[Ai] = omega_mid(Ai);
+		E_up[Ai] = eval_P_max(Ai,0,V_upbo,P_point,im_P_point,TRUE);
+		}
+	cx->E_ok = TRUE;
+	}
+
+
 static void calc_psi(int Ai, a_result result) {
 
 	/* Evaluate Ai */
-	fhull_V(V_lobo,V_upbo);
-	result[Ai][E_MIN] = eval_P_min(Ai,0,1,V_lobo,P_point,im_P_point,TRUE);
-	result[Ai][E_MID] = omega(Ai);
-	result[Ai][E_MAX] = eval_P_max(Ai,0,1,V_upbo,P_point,im_P_point,TRUE);
+	result[Ai][E_MIN] = E_lo[Ai];
+	result[Ai][E_MID] = E_mid[Ai];
+	result[Ai][E_MAX] = E_up[Ai];
 	}
 
 
 static void calc_delta(int Ai, int Aj, a_result result) {
 
 	/* Compare Ai to Aj */
-	fhull_V(V_lobo,V_upbo);
-	result[Ai][E_MIN]  = eval_P_min(Ai,0,1,V_lobo,P_point,im_P_point,TRUE);
-	result[Ai][E_MIN] -= eval_P_max(Aj,0,1,V_upbo,P_point,im_P_point,TRUE);
-	result[Ai][E_MID]  = omega(Ai)-omega(Aj);
-	result[Ai][E_MAX]  = eval_P_max(Ai,0,1,V_upbo,P_point,im_P_point,TRUE);
-	result[Ai][E_MAX] -= eval_P_min(Aj,0,1,V_lobo,P_point,im_P_point,TRUE);
+	result[Ai][E_MIN] = E_lo[Ai]-E_up[Aj];
+	result[Ai][E_MID] = E_mid[Ai]-E_mid[Aj];
+	result[Ai][E_MAX] = E_up[Ai]-E_lo[Aj];
 	}
 
 
@@ -178,42 +222,66 @@ static void calc_gamma(struct d_frame *df, int Ai, a_result result) {
 
 	/* Compare Ai to all other alternatives */
 	scale = df->n_alts - 1.0;
-	fhull_V(V_lobo,V_upbo);
-	result[Ai][E_MIN] = eval_P_min(Ai,0,1,V_lobo,P_point,im_P_point,TRUE);
-	result[Ai][E_MID] = omega(Ai);
-	result[Ai][E_MAX] = eval_P_max(Ai,0,1,V_upbo,P_point,im_P_point,TRUE);
+	calc_psi(Ai,result);
 	for (Aj=1; Aj<=df->n_alts; Aj++)
 		if (Aj != Ai) {
-			result[Ai][E_MIN] -= eval_P_max(Aj,0,1,V_upbo,P_point,im_P_point,TRUE)/scale;
-			result[Ai][E_MID] -= omega(Aj)/scale;
-			result[Ai][E_MAX] -= eval_P_min(Aj,0,1,V_lobo,P_point,im_P_point,TRUE)/scale;
+			result[Ai][E_MIN] -= E_up[Aj]/scale;
+			result[Ai][E_MID] -= E_mid[Aj]/scale;
+			result[Ai][E_MAX] -= E_lo[Aj]/scale;
 			}
 	}
 
 
 static void calc_digamma(struct d_frame *df, int Ai, int alts, a_result result) {
+	int Aj,n_active,n_bits;
+	double scale;
+
+	/* Find nbr of active alts (only the low alts fit in the bitmap) */
+	n_bits = min(df->n_alts,DIGAMMA_BITS);
+	for (n_active=0, Aj=1; Aj<=n_bits; Aj++)
+		if ((Aj!=Ai) && (alts&(0x01<<(Aj-1))))
+			n_active++;
+	scale = n_active;
+	/* Compare Ai to subset of other alternatives */
+	calc_psi(Ai,result);
+#ifdef DIGAMMA_PSI
+	if (!n_active) // if called with empty alts, will return psi
+		return;
+#endif
+	for (Aj=1; Aj<=n_bits; Aj++)
+		if ((Aj!=Ai) && (alts&(0x01<<(Aj-1)))) {
+			result[Ai][E_MIN] -= E_up[Aj]/scale;
+			result[Ai][E_MID] -= E_mid[Aj]/scale;
+			result[Ai][E_MAX] -= E_lo[Aj]/scale;
+			}
+	}
+
+
+/* Digamma for an alternative set instead of a bitmap */
+
+static void calc_digamma_set(struct d_frame *df, int Ai, a_set alts, 
+		double *lo_value, double *mid_value, double *up_value) {
 	int Aj,n_active;
 	double scale;
 
 	/* Find nbr of active alts */
 	for (n_active=0, Aj=1; Aj<=df->n_alts; Aj++)
-		if ((Aj!=Ai) && (alts&(0x01<<(Aj-1))))
+		if ((Aj!=Ai) && alts[Aj])
 			n_active++;
 	scale = n_active;
-	fhull_V(V_lobo,V_upbo);
 	/* Compare Ai to subset of other alternatives */
-	result[Ai][E_MIN] = eval_P_min(Ai,0,1,V_lobo,P_point,im_P_point,TRUE);
-	result[Ai][E_MID] = omega(Ai);
-	result[Ai][E_MAX] = eval_P_max(Ai,0,1,V_upbo,P_point,im_P_point,TRUE);
+	*lo_value = E_lo[Ai];
+	*mid_value = E_mid[Ai];
+	*up_value = E_up[Ai];
 #ifdef DIGAMMA_PSI
-	if (!n_active) // if called with empty alts, will return psi
+	if (!n_active) // empty set will return psi
 		return;
 #endif
 	for (Aj=1; Aj<=df->n_alts; Aj++)
-		if ((Aj!=Ai) && (alts&(0x01<<(Aj-1)))) {
-			result[Ai][E_MIN] -= eval_P_max(Aj,0,1,V_upbo,P_point,im_P_point,TRUE)/scale;
-			result[Ai][E_MID] -= omega(Aj)/scale;
-			result[Ai][E_MAX] -= eval_P_min(Aj,0,1,V_lobo,P_point,im_P_point,TRUE)/scale;
+		if ((Aj!=Ai) && alts[Aj]) {
+			*lo_value -= E_up[Aj]/scale;
+			*mid_value -= E_mid[Aj]/scale;
+			*up_value -= E_lo[Aj]/scale;
 			}
 	}
 
@@ -236,6 +304,7 @@ rcode TCL_evaluate(struct d_frame *df, int Ai, int Aj, int eval_method, a_result
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 	if ((Ai < 1) || (Ai > df->n_alts))
 		return TCL_INPUT_ERROR;
 	if (eval_method == DELTA) {
@@ -247,10 +316,13 @@ rcode TCL_evaluate(struct d_frame *df, int Ai, int Aj, int eval_method, a_result
 			return TCL_INPUT_ERROR;
 
 	/* OMEGA evaluation */
-	if (eval_method == OMEGA)
+	if (eval_method == OMEGA) {
 		calc_omega(Ai,result);
+		return TCL_OK;
+		}
+	calc_table(df);
 	/* PSI evaluation */
-	else if (eval_method == PSI)
+	if (eval_method == PSI)
 		calc_psi(Ai,result);
 	/* DELTA evaluation (Aj is an int) */
 	else if (eval_method == DELTA)
@@ -261,11 +333,11 @@ rcode TCL_evaluate(struct d_frame *df, int Ai, int Aj, int eval_method, a_result
 	/* DIGAMMA evaluation (Aj is a bitmask) */
 	else if (eval_method == DIGAMMA) {
 		/* Not ok to compare with self */
-		if (0x01<<(Ai-1) & Aj)
+		if ((Ai <= DIGAMMA_BITS) && (0x01<<(Ai-1) & Aj))
 			return TCL_INPUT_ERROR;
 #ifndef DIGAMMA_PSI
 		/* Not ok to compare with nothing */
-		if (!((0x01<<df->n_alts)-1 & Aj))
+		if (!((df->n_alts<DIGAMMA_BITS?(0x01<<df->n_alts)-1:~0) & Aj))
 			return TCL_INPUT_ERROR;
 #endif
 		calc_digamma(df,Ai,Aj,result);
@@ -285,9 +357,227 @@ rcode TCL_evaluate_omega(struct d_frame *df, int Ai, double *result) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 	if ((Ai < 1) || (Ai > df->n_alts))
 		return TCL_INPUT_ERROR;
 	/* Get omega EV */
 	*result = omega(Ai);
 	return TCL_OK;
 	}
+
+
+/* Omega for all alternatives in one call. The mass points are formed
+ * once and shared, result[Ai] is omega(Ai) as in TCL_evaluate_omega. */
+
+rcode TCL_evaluate_omega_all(struct d_frame *df, a_row result) {
+	int Ai;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	/* Get omega EV of each alternative */
+	mpoint_P(P_mid);
+	mpoint_V(V_mid);
+	for (Ai=1; Ai<=df->n_alts; Ai++)
+		result[Ai] = omega_mid(Ai);
+	return TCL_OK;
+	}
+
+
+/* What-if omega: the mass point EV of the statement's alternative as if
+ * the statement had been added to the P- or V-base (and with the node's
+ * midbox removed if free_mid). Nothing in the frame is changed, so no
+ * reload is needed afterwards and probes do not depend on each other. */
+
+rcode TCL_probe_P(struct d_frame *df, struct stmt_rec *P_stmt, bool free_mid, double *result) {
+	rcode rc;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	/* Get the alternative's probed mass point */
+	if (rc = probe_P(df,P_stmt,free_mid,P_mid))
+		return rc;
+	mpoint_V(V_mid);
+	*result = omega_mid(P_stmt->alt[1]);
+	return TCL_OK;
+	}
+
+
+rcode TCL_probe_V(struct d_frame *df, struct stmt_rec *V_stmt, bool free_mid, double *result) {
+	rcode rc;
+	int var;
+	double mp;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	/* Get the node's probed mass point */
+	if (rc = probe_V(df,V_stmt,free_mid,&var,&mp))
+		return rc;
+	mpoint_P(P_mid);
+	mpoint_V(V_mid);
+	V_mid[var] = mp;
+	*result = omega_mid(V_stmt->alt[1]);
+	return TCL_OK;
+	}
+
+
+/* What-if omega of Ai as in TCL_probe_P, but for n_sets V mass points at
+ * once. The P mass point is probed once (or, with no statement, is that
+ * of the base) and the V-base is not used. Set k (k=0..n_sets-1) holds
+ * the V mass point of node f of Ai at V_pts[k*v_stride+f-1] and its omega
+ * is delivered in result[k]. Nothing in the frame is changed. */
+
+rcode TCL_probe_P_points(struct d_frame *df, int Ai, struct stmt_rec *P_stmt, bool free_mid, 
+				int n_sets, int v_stride, double V_pts[], double result[]) {
+	rcode rc;
+	int i,k;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	if ((Ai < 1) || (Ai > df->n_alts) || (n_sets < 1) || (v_stride < tot_alt_inx[Ai]))
+		return TCL_INPUT_ERROR;
+	if (P_stmt && (P_stmt->alt[1] != Ai))
+		return TCL_INPUT_ERROR;
+	/* Get the alternative's (probed) mass point */
+	if (P_stmt) {
+		if (rc = probe_P(df,P_stmt,free_mid,P_mid))
+			return rc;
+		}
+	else
+		mpoint_P(P_mid);
+	/* Omega at each set of V mass points */
+	for (k=0; k<n_sets; k++) {
+		for (i=get_V_start(Ai); i<=get_V_end(Ai); i++)
+			V_mid[i] = V_pts[k*v_stride+r2f[i]-1];
+		result[k] = omega_mid(Ai);
+		}
+	return TCL_OK;
+	}
+
+
+/* Psi for all alternatives in one call (the table itself) */
+
+rcode TCL_evaluate_all(struct d_frame *df, a_result result) {
+	int Ai;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	/* Get min, mid and max EV */
+	calc_table(df);
+	for (Ai=1; Ai<=df->n_alts; Ai++)
+		calc_psi(Ai,result);
+	return TCL_OK;
+	}
+
+
+/* Digamma for n_sets pairs of Ai[k] and alts[k] (k=1..n_sets) in one
+ * call. All sets are formed from the same table of EV ranges. */
+
+rcode TCL_evaluate_digamma(struct d_frame *df, int n_sets, int Ai[], a_set alts[], 
+				double lo_value[], double mid_value[], double up_value[]) {
+	int k;
+#ifndef DIGAMMA_PSI
+	int Aj;
+#endif
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	if (n_sets < 1)
+		return TCL_INPUT_ERROR;
+	for (k=1; k<=n_sets; k++) {
+		if ((Ai[k] < 1) || (Ai[k] > df->n_alts))
+			return TCL_INPUT_ERROR;
+		/* Not ok to compare with self */
+		if (alts[k][Ai[k]])
+			return TCL_INPUT_ERROR;
+#ifndef DIGAMMA_PSI
+		/* Not ok to compare with nothing */
+		for (Aj=1; Aj<=df->n_alts; Aj++)
+			if (alts[k][Aj])
+				break;
+		if (Aj > df->n_alts)
+			return TCL_INPUT_ERROR;
+#endif
+		}
+	/* Get min, mid and max EV */
+	calc_table(df);
+	for (k=1; k<=n_sets; k++)
+		calc_digamma_set(df,Ai[k],alts[k],lo_value+k,mid_value+k,up_value+k);
+	return TCL_OK;
+	}
+
+
+/* Min, mid and max EV of all alternatives under each of n_boxes V-boxes
+ * in one call. Box k (k=1..n_boxes) of node i is at tbox_lobo/upbo
+ * [(k-1)*b_stride+i-1] and the result of Ai at [(k-1)*e_stride+Ai-1].
+ * The boxes are not loaded: the P hull and mass point are used as they
+ * are, the statements are entered once, and only the V hull and mass
+ * point are formed for each box. The base and its box are left as they
+ * were. A box that would not load (as in TCL_set_V_box) is an error. */
+
+rcode TCL_evaluate_V_boxes(struct d_frame *df, int n_boxes, int b_stride, 
+				double tbox_lobo[], double tbox_upbo[], int e_stride, 
+				double lo_value[], double mid_value[], double up_value[]) {
+	rcode rc;
+	int Ai,k,e;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	if ((n_boxes < 1) || (b_stride < tot_vars) || (e_stride < df->n_alts))
+		return TCL_INPUT_ERROR;
+	if (rc = stmt_V(df))
+		return rc;
+	mpoint_P(P_mid);
+	for (k=0; k<n_boxes; k++) {
+		if (rc = box_V(df,tbox_lobo+k*b_stride,tbox_upbo+k*b_stride,V_lobo,V_upbo,V_mid))
+			return rc;
+		for (Ai=1; Ai<=df->n_alts; Ai++) {
+			e = k*e_stride+Ai-1;
+			lo_value[e] = eval_P_min(Ai,0,V_lobo,P_point,im_P_point,TRUE);
+			mid_value[e] = omega_mid(Ai);
+			up_value[e] = eval_P_max(Ai,0,V_upbo,P_point,im_P_point,TRUE);
+			}
+		}
+	return TCL_OK;
+	}
@@ -48,29 +48,55 @@
  *   ------------------------------
  *   TCL_create_flat_frame
  *   TCL_create_tree_frame
+ *   TCL_fork_frame
  *   TCL_dispose_frame
  *   TCL_attach_frame
  *   TCL_detach_frame
+ *   TCL_bind_frame
+ *   TCL_unbind_frame
+ *   TCL_get_base_image
+ *   TCL_set_base_image
  *   TCL_get_real_index
  *   TCL_get_tot_index
  *   TCL_pure_tree
  *   TCL_different_parents
  *   TCL_nbr_of_siblings
+ *   TCL_get_perf
+ *   TCL_reset_perf
  *
  *   Functions outside module, inside TCL
  *   ------------------------------------
- *   NONE
+ *   use_frame
+ *   own_base
+ *   release_base
+ *   tcl_clock
+ *   perf_count (PAR_EVAL)
+ *   perf_time (PAR_EVAL)
  *
  *   Functions internal to module
  *   ----------------------------
  *   tree_end
  *   lonely_im_child
  *   init_global_tree
+ *   alloc_rows
+ *   ctx_size
+ *   create_ctx
+ *   copy_ctx
+ *   new_topo
+ *   set_topo
+ *   intern_topo
+ *   release_topo
+ *   alloc_frame
+ *   bases_in_use
  *   pure_node
  *
  */
 
 #include "TCLinternal.h"
+#if defined(PAR_EVAL) && defined(_MSC_VER)
+#define NOMINMAX
+#include <windows.h>
+#endif
 
 
  /*********************************************************
@@ -79,15 +105,22 @@
   *
   *********************************************************/
 
-t_matrix t2f,t2r,t2i,r2t,i2t;
-tn_row f2r,f2i,r2f,i2f,i2end;
-int n_alts;
-int alt_inx[MAX_ALTS+1];
-int n_vars;
-int im_alt_inx[MAX_ALTS+1];
-int im_vars;
-int tot_alt_inx[MAX_ALTS+1];
-int tot_vars;
+/* The storage is in each frame's context (struct tcl_ctx),
+ * these point into the context of the frame in use. */
+
+TCL_TLS int **t2f,**t2r,**t2i,**r2t,**i2t;
+TCL_TLS int *f2r,*f2i,*r2f,*i2f,*i2end;
+TCL_TLS int **kid_lo,**kid_hi,**kid_node,**kid_inx;
+TCL_TLS int n_alts;
+TCL_TLS int *alt_inx;
+TCL_TLS int n_vars;
+TCL_TLS int *im_alt_inx;
+TCL_TLS int im_vars;
+TCL_TLS int *tot_alt_inx;
+TCL_TLS int tot_vars;
+TCL_TLS bool flat_frame;
+
+static TCL_TLS struct tcl_ctx *cur_ctx = NULL;
 
 
  /*********************************************************
@@ -146,6 +179,7 @@ static bool lonely_im_child(struct d_frame *df, int alt, int snode) {
 static rcode init_global_tree(struct d_frame *df) {
 	int h,i,j,k1,k2,f1,f2;
 
+	df->ctx->tree_ok = FALSE;
 	n_alts = df->n_alts;
 	alt_inx[0] = 0;
 	im_alt_inx[0] = 0;
@@ -158,6 +192,7 @@ static rcode init_global_tree(struct d_frame *df) {
 	n_vars = alt_inx[n_alts];
 	im_vars = im_alt_inx[n_alts];
 	tot_vars = n_vars + im_vars;
+	flat_frame = !im_vars;
 	/* Map tree up */
 	f1 = f2 = 1;
 	for (h=1,i=1; i<=df->n_alts; i++)	{
@@ -188,16 +223,372 @@ static rcode init_global_tree(struct d_frame *df) {
 		if (tree_end(df,i,0) != df->tot_cons[i])
 			return TCL_TREE_ERROR;
 		}
+	/* Compile the trees into child groups. The parents are taken in
+	 * preorder, so the im-nodes below a node follow it in the scan and
+	 * each group of siblings is one range of positions k. */
+	for (i=1; i<=df->n_alts; i++) {
+		for (k1=1,j=0; j<=df->tot_cons[i]; j++) {
+			kid_lo[i][j] = k1;
+			for (h=df->down[i][j]; h; h=df->next[i][h]) {
+				kid_node[i][k1] = h;
+				kid_inx[i][k1++] = (df->down[i][h] ? at2i(i,h) : at2r(i,h));
+				}
+			kid_hi[i][j] = k1;
+			}
+		}
+	/* Keep scalars with the context */
+	df->ctx->n_alts = n_alts;
+	df->ctx->n_vars = n_vars;
+	df->ctx->im_vars = im_vars;
+	df->ctx->tot_vars = tot_vars;
+	df->ctx->flat = flat_frame;
+	df->ctx->tree_ok = TRUE;
 	return TCL_OK;
 	}
 
 
+ /*********************************************************
+  *
+  *  Frame context
+  *
+  *********************************************************/
+
+/* Set up n_maps tables of per-alternative rows, each row sized to the
+ * alternative (tot_cons[i]+1 entries, alt 0 gets one). The row pointers
+ * are taken from rows and the entries from cell. Returns next free cell. */
+
+static int *alloc_rows(struct d_frame *df, int n_maps, int **rows, int *cell) {
+	int i,k;
+
+	for (k=0; k<n_maps; k++)
+		for (i=0; i<=df->n_alts; i++) {
+			*rows++ = cell;
+			cell += (i ? df->tot_cons[i]+1 : 1);
+			}
+	return cell;
+	}
+
+
+/* The context is one piece with all its rows sized to the frame.
+ * Layout: struct, row pointers, double rows, int rows. */
+
+static size_t ctx_size(int n_alts, int tot_cons[]) {
+	int i,n_tot,n_cells;
+
+	/* Nbr of entries in the frame */
+	n_tot = tot_cons[0]+1;
+	for (n_cells=1,i=1; i<=n_alts; i++)
+		n_cells += tot_cons[i]+1;
+	return sizeof(struct tcl_ctx) + 9*(n_alts+1)*sizeof(int *) +
+			((P_ROWS+V_ROWS+2)*n_tot+6*(n_alts+1))*sizeof(double) + (6*n_tot+9*n_cells+n_alts+1)*sizeof(int);
+	}
+
+
+/* The context is carved from the frame arena the first time the
+ * frame is attached. The piece is reserved when the frame is made. */
+
+static rcode create_ctx(struct d_frame *df) {
+	int i,n_tot,**rows;
+	double *row;
+	int *cell;
+
+	n_tot = df->tot_cons[0]+1;
+	df->ctx = (struct tcl_ctx *)mem_carve(&(df->arena),df->arena_end,ctx_size(df->n_alts,df->tot_cons));
+	if (!df->ctx)
+		return TCL_OUT_OF_MEMORY;
+	/* Carve out the rows */
+	rows = (int **)(df->ctx+1);
+	row = (double *)(rows+9*(df->n_alts+1));
+	set_P_rows(&(df->ctx->P),row,n_tot);
+	row += P_ROWS*n_tot;
+	set_V_rows(&(df->ctx->V),row,n_tot);
+	row += V_ROWS*n_tot;
+	df->ctx->E_lo = row;
+	df->ctx->E_mid = row+(df->n_alts+1);
+	df->ctx->E_up = row+2*(df->n_alts+1);
+	row += 3*(df->n_alts+1);
+	df->ctx->M_rm1 = row;
+	df->ctx->M_cm2 = row+(df->n_alts+1);
+	df->ctx->M_cm3 = row+2*(df->n_alts+1);
+	row += 3*(df->n_alts+1);
+	df->ctx->P_sd = row;
+	df->ctx->V_sd = row+n_tot;
+	for (i=0; i<2*n_tot; i++)
+		row[i] = 0.0;
+	row += 2*n_tot;
+	cell = (int *)row;
+	df->ctx->f2r = cell;
+	df->ctx->f2i = cell+n_tot;
+	df->ctx->r2f = cell+2*n_tot;
+	df->ctx->i2f = cell+3*n_tot;
+	df->ctx->i2end = cell+4*n_tot;
+	df->ctx->V.stmt_head = cell+5*n_tot;
+	cell += 6*n_tot;
+	df->ctx->M_ok = cell;
+	for (i=0; i<=df->n_alts; i++)
+		df->ctx->M_ok[i] = FALSE;
+	cell += df->n_alts+1;
+	df->ctx->t2f = rows;
+	df->ctx->t2r = rows+(df->n_alts+1);
+	df->ctx->t2i = rows+2*(df->n_alts+1);
+	df->ctx->r2t = rows+3*(df->n_alts+1);
+	df->ctx->i2t = rows+4*(df->n_alts+1);
+	df->ctx->kid_lo = rows+5*(df->n_alts+1);
+	df->ctx->kid_hi = rows+6*(df->n_alts+1);
+	df->ctx->kid_node = rows+7*(df->n_alts+1);
+	df->ctx->kid_inx = rows+8*(df->n_alts+1);
+	alloc_rows(df,9,rows,cell);
+	df->ctx->watermark = C_MARK;
+	df->ctx->tree_ok = FALSE;
+	df->ctx->P_ok = FALSE;
+	df->ctx->V_ok = FALSE;
+	df->ctx->E_ok = FALSE;
+	df->ctx->V.stmt_next = NULL;
+	df->ctx->V.n_room = 0;
+	df->ctx->V.ix_ok = FALSE;
+	return TCL_OK;
+	}
+
+
+/* Give a fork a warm copy of the context of its origin. Both are laid
+ * out alike, so apart from the row pointers that create_ctx has set up
+ * the state moves in one piece. */
+
+static rcode copy_ctx(struct d_frame *df, struct d_frame *from) {
+	rcode rc;
+	size_t head,size;
+	struct tcl_ctx *cx,*fx;
+
+	if (rc = create_ctx(df))
+		return rc;
+	cx = df->ctx;
+	fx = from->ctx;
+	cx->tree_ok = fx->tree_ok;
+	cx->P_ok = fx->P_ok;
+	cx->V_ok = fx->V_ok;
+	cx->E_ok = fx->E_ok;
+	cx->n_alts = fx->n_alts;
+	cx->n_vars = fx->n_vars;
+	cx->im_vars = fx->im_vars;
+	cx->tot_vars = fx->tot_vars;
+	cx->flat = fx->flat;
+	memcpy(cx->alt_inx,fx->alt_inx,sizeof(cx->alt_inx));
+	memcpy(cx->im_alt_inx,fx->im_alt_inx,sizeof(cx->im_alt_inx));
+	memcpy(cx->tot_alt_inx,fx->tot_alt_inx,sizeof(cx->tot_alt_inx));
+	head = sizeof(struct tcl_ctx)+9*(df->n_alts+1)*sizeof(int *);
+	size = ctx_size(df->n_alts,df->tot_cons);
+	memcpy((char *)cx+head,(char *)fx+head,size-head);
+	return TCL_OK;
+	}
+
+
+/* Bind the globals to the context of df. Cheap if already bound.
+ * A frame that was never attached has no context and binds nothing. */
+
+void use_frame(struct d_frame *df) {
+	struct tcl_ctx *cx;
+
+	cx = df->ctx;
+	if ((cx == NULL) || (cx == cur_ctx))
+		return;
+	t2f = cx->t2f;
+	t2r = cx->t2r;
+	t2i = cx->t2i;
+	r2t = cx->r2t;
+	i2t = cx->i2t;
+	f2r = cx->f2r;
+	f2i = cx->f2i;
+	r2f = cx->r2f;
+	i2f = cx->i2f;
+	i2end = cx->i2end;
+	kid_lo = cx->kid_lo;
+	kid_hi = cx->kid_hi;
+	kid_node = cx->kid_node;
+	kid_inx = cx->kid_inx;
+	n_alts = cx->n_alts;
+	alt_inx = cx->alt_inx;
+	n_vars = cx->n_vars;
+	im_alt_inx = cx->im_alt_inx;
+	im_vars = cx->im_vars;
+	tot_alt_inx = cx->tot_alt_inx;
+	tot_vars = cx->tot_vars;
+	flat_frame = cx->flat;
+	bind_P(df);
+	bind_V(df);
+	cur_ctx = cx;
+	}
+
+
+ /*********************************************************
+  *
+  *  Interned tree topology
+  *
+  *  The four link tables of a frame are kept in a topology,
+  *  one chunk with the rows sized to the alternatives. When
+  *  a frame has been created, its topology is looked up among
+  *  those in use and an identical one (same alternatives and
+  *  links) is shared instead, so that the criterion frames of
+  *  a PM frame usually hold one copy between them. Forks use
+  *  the topology of their origin. A topology is released by
+  *  the last frame using it. As with memory allocation, the
+  *  list is not synchronised: frames are created and disposed
+  *  of by one thread at a time.
+  *
+  *********************************************************/
+
+/* Layout: struct, row pointers, tot_cons, cells of next/prev/down/up */
+
+struct tree_topo {
+	int watermark;
+	int n_users;
+	bool interned;          // in topo_list
+	unsigned long hash;
+	int n_alts;
+	int n_cells;            // cells per table
+	int *tot_cons;
+	int **rows;
+	struct tree_topo *link; // next in topo_list
+	};
+
+static struct tree_topo *topo_list = NULL;
+
+
+/* Topology with zeroed links for a new frame, not yet interned */
+
+static struct tree_topo *new_topo(struct d_frame *df) {
+	int i,n_cells;
+	struct tree_topo *T;
+
+	for (n_cells=1,i=1; i<=df->n_alts; i++)
+		n_cells += df->tot_cons[i]+1;
+	T = (struct tree_topo *)mem_alloc(sizeof(struct tree_topo) + 4*(df->n_alts+1)*sizeof(int *) + 
+			(df->n_alts+1+4*n_cells)*sizeof(int),"struct tree_topo","new_topo");
+	if (!T)
+		return NULL;
+	T->watermark = T_MARK;
+	T->n_users = 1;
+	T->interned = FALSE;
+	T->hash = 0;
+	T->n_alts = df->n_alts;
+	T->n_cells = n_cells;
+	T->rows = (int **)(T+1);
+	T->tot_cons = (int *)(T->rows+4*(df->n_alts+1));
+	T->tot_cons[0] = 0;
+	for (i=1; i<=df->n_alts; i++)
+		T->tot_cons[i] = df->tot_cons[i];
+	T->link = NULL;
+	memset(T->tot_cons+df->n_alts+1,0,4*n_cells*sizeof(int));
+	alloc_rows(df,4,T->rows,T->tot_cons+df->n_alts+1);
+	return T;
+	}
+
+
+static void set_topo(struct d_frame *df, struct tree_topo *T) {
+
+	df->topo = T;
+	df->next = T->rows;
+	df->prev = T->rows+(T->n_alts+1);
+	df->down = T->rows+2*(T->n_alts+1);
+	df->up = T->rows+3*(T->n_alts+1);
+	}
+
+
+/* The links of df are complete. Share an identical topology if
+ * there is one, else enter that of df into the list. */
+
+static void intern_topo(struct d_frame *df) {
+	int k,n;
+	int *cell;
+	unsigned long h;
+	struct tree_topo *T,*U;
+
+	T = df->topo;
+	n = T->n_alts+1+4*T->n_cells;
+	cell = T->tot_cons;
+	for (h=T->n_alts,k=1; k<n; k++)
+		h = h*31+(unsigned)cell[k];
+	T->hash = h;
+	for (U=topo_list; U; U=U->link)
+		if ((U->hash == h) && (U->n_alts == T->n_alts) && (U->n_cells == T->n_cells) && 
+				!memcmp(U->tot_cons,T->tot_cons,n*sizeof(int))) {
+			/* Use the one in the list */
+			U->n_users++;
+			set_topo(df,U);
+			mem_free((void *)T);
+			return;
+			}
+	T->interned = TRUE;
+	T->link = topo_list;
+	topo_list = T;
+	}
+
+
+/* Drop one use of a topology */
+
+static void release_topo(struct tree_topo *T) {
+	struct tree_topo **Up;
+
+	if (--T->n_users > 0)
+		return;
+	if (T->interned)
+		for (Up=&topo_list; *Up; Up=&((*Up)->link))
+			if (*Up == T) {
+				*Up = T->link;
+				break;
+				}
+	T->watermark = 0;
+	mem_free((void *)T);
+	}
+
+
  /*********************************************************
   *
   *  Create or destruct data frame
   *
   *********************************************************/
 
+/* Allocate a frame as one chunk. The chunk after the struct is the
+ * frame arena, holding the P-base, the V-base, and the context (in
+ * that order). The tree rows are in topology T if given (a fork), or
+ * else in a new topology that is interned when the links are set. */
+
+static struct d_frame *alloc_frame(int n_alts, int tot_cons[], struct tree_topo *T, char *source) {
+	int i;
+	struct d_frame *df;
+	size_t size,a_size;
+
+	size = MEM_ALIGN(sizeof(struct d_frame));
+	a_size = MEM_ALIGN(P_BASE_SIZE(tot_cons[0]+1)) + MEM_ALIGN(V_BASE_SIZE(tot_cons[0]+1)) + 
+			MEM_ALIGN(ctx_size(n_alts,tot_cons));
+	df = (struct d_frame *)mem_alloc(size+a_size,"struct d_frame",source);
+	if (!df)
+		return NULL;
+	df->arena = (char *)df+size;
+	df->arena_end = df->arena+a_size;
+	df->P_own = NULL;
+	df->V_own = NULL;
+	df->n_alts = n_alts;
+	for (i=1; i<=n_alts; i++)
+		df->tot_cons[i] = tot_cons[i];
+	if (T)
+		T->n_users++;
+	else if (!(T = new_topo(df))) {
+		mem_free((void *)df);
+		return NULL;
+		}
+	set_topo(df,T);
+	return df;
+	}
+
+
+/* A disposed frame is kept as long as forks use its bases */
+
+static bool bases_in_use(struct d_frame *df) {
+
+	return (df->P_own && df->P_own->n_users) || (df->V_own && df->V_own->n_users);
+	}
+
+
 /* Flat frame */
 
 rcode TCL_create_flat_frame(struct d_frame **dfp, int n_alts, int n_cons[]) {
@@ -221,7 +612,7 @@ rcode TCL_create_flat_frame(struct d_frame **dfp, int n_alts, int n_cons[]) {
 		return TCL_TOO_MANY_CONS;
 
 	/* Allocate a decision frame */
-	*dfp = (struct d_frame *)mem_alloc(sizeof(struct d_frame),"struct d_frame","TCL_create_flat_frame");
+	*dfp = alloc_frame(n_alts,n_cons,NULL,"TCL_create_flat_frame");
 	if (!*dfp)
 		return TCL_OUT_OF_MEMORY;
 	(*dfp)->watermark = D_MARK;
@@ -247,7 +638,9 @@ rcode TCL_create_flat_frame(struct d_frame **dfp, int n_alts, int n_cons[]) {
 			(*dfp)->prev[i][j] = j-1;
 			}
 		}
+	intern_topo(*dfp);
 	(*dfp)->attached = FALSE;
+	(*dfp)->ctx = NULL;
 
 	/* Allocate bases in memory */
 	if (rc = create_P(*dfp))
@@ -301,7 +694,7 @@ rcode TCL_create_tree_frame(struct d_frame **dfp, int n_alts, int tot_cons[],
 	tot_cons[0] = re_cons[0] + im_cons[0];
 
 	/* Allocate a data frame */
-	*dfp = (struct d_frame *)mem_alloc(sizeof(struct d_frame),"struct d_frame","TCL_create_tree_frame");
+	*dfp = alloc_frame(n_alts,tot_cons,NULL,"TCL_create_tree_frame");
 	if (!*dfp)
 		return TCL_OUT_OF_MEMORY;
 	(*dfp)->watermark = D_MARK;
@@ -340,11 +733,14 @@ rcode TCL_create_tree_frame(struct d_frame **dfp, int n_alts, int tot_cons[],
 		/* Im-node must have >1 children (except implicit node 0) */
 		if (lonely_im_child(*dfp,i,0)) {
 			(*dfp)->watermark = 0;
+			release_topo((*dfp)->topo);
 			mem_free((void *)(*dfp));
 			return TCL_TREE_ERROR;
 			}
 		}
+	intern_topo(*dfp);
 	(*dfp)->attached = FALSE;
+	(*dfp)->ctx = NULL;
 
 	/* Create bases */
 	if (rc = create_P(*dfp))
@@ -355,6 +751,52 @@ rcode TCL_create_tree_frame(struct d_frame **dfp, int n_alts, int tot_cons[],
 	}
 
 
+/* Fork a frame. The fork shares the bases with df until one of them
+ * writes to a base, its topology, and its context starts as a copy of
+ * that of df. */
+
+rcode TCL_fork_frame(struct d_frame *df, struct d_frame **dfp) {
+	rcode rc;
+	int i;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if ((df->P_base->watermark != P_MARK) || (df->V_base->watermark != V_MARK))
+		return TCL_CORRUPTED;
+
+	/* Allocate a data frame of the same shape */
+	*dfp = alloc_frame(df->n_alts,df->tot_cons,df->topo,"TCL_fork_frame");
+	if (!*dfp)
+		return TCL_OUT_OF_MEMORY;
+	(*dfp)->watermark = D_MARK;
+	strcpy((*dfp)->name,df->name);
+	(*dfp)->tree = df->tree;
+	(*dfp)->n_alts = df->n_alts;
+	for (i=0; i<=MAX_ALTS; i++) {
+		(*dfp)->n_cons[i] = df->n_cons[i];
+		(*dfp)->im_cons[i] = df->im_cons[i];
+		(*dfp)->tot_cons[i] = df->tot_cons[i];
+		}
+	(*dfp)->attached = FALSE;
+	(*dfp)->ctx = NULL;
+
+	/* Share the bases */
+	(*dfp)->P_base = df->P_base;
+	(*dfp)->V_base = df->V_base;
+	df->P_base->n_users++;
+	df->V_base->n_users++;
+	if (df->ctx && (df->ctx->watermark == C_MARK))
+		if (rc = copy_ctx(*dfp,df)) {
+			TCL_dispose_frame(*dfp);
+			return rc;
+			}
+	return TCL_OK;
+	}
+
+
 /* Delete frame */
 
 rcode TCL_dispose_frame(struct d_frame *df) {
@@ -365,14 +807,111 @@ rcode TCL_dispose_frame(struct d_frame *df) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
-	/* Release base memory */
+	/* Invalidate bases */
 	rc  = dispose_P(df);
 	rc2 = dispose_V(df);
 	if (rc+rc2)
 		return max(rc,rc2);
+	/* Invalidate context */
+	if (df->ctx) {
+		if (df->ctx == cur_ctx)
+			cur_ctx = NULL;
+		free_V_index(df);
+		df->ctx->watermark = 0;
+		}
 	df->watermark = 0;
-	/* Release own memory */
+	release_topo(df->topo);
+	df->topo = NULL;
+	/* Release own memory, including the arena, unless
+	 * it is still in use by forks (then the last one does) */
+	if (bases_in_use(df))
+		return TCL_OK;
 	return mem_free((void *)df);
+	}
+
+
+ /*********************************************************
+  *
+  *  Copy-on-write bases
+  *
+  *  A base is shared by a frame and its forks as long as none
+  *  of them writes to it. The first write gives the writer a
+  *  copy of its own, in its arena slot if that slot is free,
+  *  otherwise (the slot holds a base still used by forks) in
+  *  a chunk of its own.
+  *
+  *********************************************************/
+
+/* Make the base of df private before writing to it */
+
+rcode own_base(struct d_frame *df, bool V) {
+	rcode rc;
+	int n;
+	size_t size;
+	struct base *B,*C,**own;
+
+	B = V?df->V_base:df->P_base;
+	if (B->n_users == 1)
+		return TCL_OK;
+	n = df->tot_cons[0]+1;
+	size = V?V_BASE_SIZE(n):P_BASE_SIZE(n);
+	own = V?&(df->V_own):&(df->P_own);
+	if (!*own) {
+		/* First write to a fork */
+		*own = (struct base *)mem_carve(&(df->arena),df->arena_end,size);
+		if (!*own)
+			return TCL_OUT_OF_MEMORY;
+		(*own)->n_users = 0;
+		}
+	if ((*own)->n_users)
+		C = (struct base *)mem_alloc(size,"struct base","own_base");
+	else
+		C = *own;
+	if (!C)
+		return TCL_OUT_OF_MEMORY;
+	memcpy(C,B,size);
+	if (V)
+		set_V_base_rows(C,n);
+	else
+		set_P_base_rows(C,n);
+	/* The copy gets a statement chunk of its own */
+	C->stmt = NULL;
+	C->max_stmts = 0;
+	if (rc = V?grow_V(C,B->n_stmts):grow_P(C,B->n_stmts)) {
+		if (C != *own)
+			mem_free((void *)C);
+		return rc;
+		}
+	if (B->n_stmts)
+		memcpy(C->stmt+1,B->stmt+1,B->n_stmts*sizeof(struct stmt_rec));
+	C->n_users = 1;
+	C->home = (C == *own)?df:NULL;
+	release_base(B);
+	if (V)
+		df->V_base = C;
+	else
+		df->P_base = C;
+	return TCL_OK;
+	}
+
+
+/* Drop one use of a base. The last user releases its memory, which
+ * for a base in the arena of a disposed frame is that frame. */
+
+void release_base(struct base *B) {
+	struct d_frame *home;
+
+	if (--B->n_users > 0)
+		return;
+	/* The statements are in a chunk of their own */
+	if (B->stmt)
+		mem_free((void *)B->stmt);
+	B->watermark = 0;
+	home = B->home;
+	if (!home)
+		mem_free((void *)B);
+	else if ((home->watermark != D_MARK) && !bases_in_use(home))
+		mem_free((void *)home);
 	}
 
 
@@ -382,7 +921,8 @@ rcode TCL_dispose_frame(struct d_frame *df) {
   *
   *********************************************************/
 
-/* Load frame and bases */
+/* Load frame and bases. A frame that has been attached before keeps
+ * its context, so only the parts invalidated since then are reloaded. */
 
 rcode TCL_attach_frame(struct d_frame *df) {
 	rcode rc;
@@ -394,18 +934,31 @@ rcode TCL_attach_frame(struct d_frame *df) {
 		return TCL_CORRUPTED;
 	if (df->attached)
 		return TCL_ATTACHED;
-	/* Load all internal data structures */
-	if (rc = init_global_tree(df))
-		return rc;
-	if (rc = load_P(df))
-		return rc;
-	if (rc = load_V(df))
-		return rc;
+	perf_add(attach,1);
+	if (!df->ctx)
+		if (rc = create_ctx(df))
+			return rc;
+	if (df->ctx->watermark != C_MARK)
+		return TCL_CORRUPTED;
+	use_frame(df);
+	/* Load stale internal data structures */
+	if (!df->ctx->tree_ok) {
+		df->ctx->P_ok = FALSE;
+		df->ctx->V_ok = FALSE;
+		if (rc = init_global_tree(df))
+			return rc;
+		}
+	if (!df->ctx->P_ok)
+		if (rc = load_P(df))
+			return rc;
+	if (!df->ctx->V_ok)
+		if (rc = load_V(df))
+			return rc;
 	df->attached = TRUE;
 	return TCL_OK;
 	}
 
-/* Unload frame */
+/* Unload frame (the context stays warm) */
 
 rcode TCL_detach_frame(struct d_frame *df) {
 
@@ -420,6 +973,99 @@ rcode TCL_detach_frame(struct d_frame *df) {
 	}
 
 
+/* Bind the frame in this thread, e.g. when the caller switches to a
+ * frame that was attached earlier without calling into it since. */
+
+rcode TCL_bind_frame(struct d_frame *df) {
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	use_frame(df);
+	return TCL_OK;
+	}
+
+
+/* Forget the frame bound in this thread. A thread that has used frames
+ * which another thread may dispose of calls this when it is done with
+ * them, so that a later frame at the same address is bound afresh. */
+
+void TCL_unbind_frame() {
+
+	cur_ctx = NULL;
+	}
+
+
+ /*********************************************************
+  *
+  *  Base images
+  *
+  *  A base consists of its statements and one block of rows
+  *  sized to the frame (8 rows for P, 4 rows for V). Images
+  *  move a base in and out of a frame as two flat sections,
+  *  which is what the binary file format stores.
+  *
+  *********************************************************/
+
+rcode TCL_get_base_image(struct d_frame *df, bool V, struct base **base, double **rows, int *n_rows) {
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	*base = V?df->V_base:df->P_base;
+	if ((*base)->watermark != (V?V_MARK:P_MARK))
+		return TCL_CORRUPTED;
+	*rows = (double *)(*base+1);
+	*n_rows = (V?4:8)*(df->tot_cons[0]+1);
+	return TCL_OK;
+	}
+
+
+/* Replace a base in a detached frame with an image, stmts holds
+ * the n_stmts statements contiguously. Consistency is checked when
+ * the frame is attached. */
+
+rcode TCL_set_base_image(struct d_frame *df, bool V, int n_stmts, struct stmt_rec *stmts, 
+			bool box, double *rows, int n_rows) {
+	rcode rc;
+	struct base *B;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (df->attached)
+		return TCL_ATTACHED;
+	if ((n_stmts < 0) || (n_stmts > (V?MAX_V_STMTS:MAX_P_STMTS)))
+		return TCL_TOO_MANY_STMTS;
+	if (n_rows != (V?4:8)*(df->tot_cons[0]+1))
+		return TCL_INPUT_ERROR;
+	if (rc = own_base(df,V))
+		return rc;
+	B = V?df->V_base:df->P_base;
+	if (B->watermark != (V?V_MARK:P_MARK))
+		return TCL_CORRUPTED;
+	if (rc = V?grow_V(B,n_stmts):grow_P(B,n_stmts))
+		return rc;
+
+	/* Copy the sections into the base */
+	memcpy(&(B->stmt[1]),stmts,n_stmts*sizeof(struct stmt_rec));
+	B->n_stmts = n_stmts;
+	B->box = box;
+	memcpy(B+1,rows,n_rows*sizeof(double));
+	if (V)
+		cool_V(df);
+	else
+		cool_P(df);
+	return TCL_OK;
+	}
+
+
  /*********************************************************
   *
   *  Index conversion functions between indexing types
@@ -553,3 +1199,79 @@ int TCL_nbr_of_siblings(struct d_frame *df, int alt, int node) {
 		n_nodes++;
 	return -n_nodes;
 	}
+
+
+
+ /*********************************************************
+  *
+  *  Performance counters
+  *
+  *********************************************************/
+
+struct tcl_perf tcl_perf;
+
+
+/* Monotonic clock in seconds */
+
+double tcl_clock() {
+#ifdef _MSC_VER
+	return (double)clock()/(double)CLOCKS_PER_SEC;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (double)ts.tv_sec+1.0E-9*(double)ts.tv_nsec;
+#endif
+	}
+
+
+#ifdef PAR_EVAL
+
+/* Atomic counter updates, a double is added by compare-and-swap */
+
+void perf_count(unsigned long *cnt, unsigned long n) {
+
+#ifdef _MSC_VER
+	InterlockedExchangeAdd((volatile LONG *)cnt,(LONG)n);
+#else
+	__atomic_add_fetch(cnt,n,__ATOMIC_RELAXED);
+#endif
+	}
+
+
+void perf_time(double *acc, double t) {
+#ifdef _MSC_VER
+	LONG64 old,sum;
+	double d;
+
+	do {
+		old = InterlockedCompareExchange64((volatile LONG64 *)acc,0,0);
+		memcpy(&d,&old,sizeof(double));
+		d += t;
+		memcpy(&sum,&d,sizeof(double));
+		} while (InterlockedCompareExchange64((volatile LONG64 *)acc,sum,old) != old);
+#else
+	double old,sum;
+
+	__atomic_load(acc,&old,__ATOMIC_RELAXED);
+	do
+		sum = old+t;
+	while (!__atomic_compare_exchange(acc,&old,&sum,FALSE,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+#endif
+	}
+
+#endif
+
+
+/* Only read between evaluations, when no worker is running */
+
+void TCL_get_perf(struct tcl_perf *perf) {
+
+	*perf = tcl_perf;
+	}
+
+
+void TCL_reset_perf() {
+
+	memset(&tcl_perf,0,sizeof(struct tcl_perf));
+	}
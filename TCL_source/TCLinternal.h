@@ -76,14 +76,145 @@
 #define D_MARK 0xC572
 #define P_MARK 0x6A1E
 #define V_MARK 0x94BD
+#define C_MARK 0x3B5D
+#define T_MARK 0x5D8F
 
 /* Max folder name */
 #define FOLDER_SIZE 224
 
+/* Per-frame context. Holds the working state that init_global_tree, load_P
+ * and load_V build for a frame. It stays with the frame when detached, so a
+ * frame that is attached again (e.g. a criterion switch in a PM frame) only
+ * has its pointers rebound unless the base was changed in the meantime.
+ * The rows are sized to the frame (tot_vars+1 entries) in create_ctx. */
+
+#define P_ROWS 28
+#define V_ROWS 7
+
+struct P_state {
+	double *box_lobo;
+	double *box_upbo;
+	double *im_box_lobo;
+	double *im_box_upbo;
+	double *hull_lobo;
+	double *hull_upbo;
+	double *im_hull_lobo;
+	double *im_hull_upbo;
+	double *L_hull_lobo;
+	double *L_hull_upbo;
+	double *im_L_hull_lobo;
+	double *im_L_hull_upbo;
+	double *mass_point;
+	double *im_mass_point;
+	double *L_mass_point;
+	double *im_L_mass_point;
+	double *mbox_lobo;
+	double *mbox_upbo;
+	double *im_mbox_lobo;
+	double *im_mbox_upbo;
+	double *mhull_lobo;
+	double *mhull_upbo;
+	double *im_mhull_lobo;
+	double *im_mhull_upbo;
+	double *L_mhull_lobo;
+	double *L_mhull_upbo;
+	double *im_L_mhull_lobo;
+	double *im_L_mhull_upbo;
+	};
+
+struct V_state {
+	double *box_lobo;
+	double *box_upbo;
+	double *hull_lobo;
+	double *hull_upbo;
+	double *mbox_lobo;
+	double *mbox_upbo;
+	double *mass_point;
+	/* Statement index: the statements on node j are stmt_head[j],
+	 * stmt_next[stmt_head[j]], ... (0 ends). Valid if ix_ok. */
+	int *stmt_head;
+	int *stmt_next;
+	int n_room; // entries in stmt_next
+	bool ix_ok;
+	};
+
+struct tcl_ctx {
+	int watermark;
+	bool tree_ok; /* index maps valid */
+	bool P_ok;    /* P_state valid */
+	bool V_ok;    /* V_state valid */
+	/* Index maps, row i of the A-maps sized to alternative i */
+	int **t2f,**t2r,**t2i,**r2t,**i2t;
+	int *f2r,*f2i,*r2f,*i2f,*i2end;
+	/* Compiled trees: the children of node t in alt a are at positions
+	 * kid_lo[a][t]..kid_hi[a][t]-1 with A1 node and B2 index per position */
+	int **kid_lo,**kid_hi,**kid_node,**kid_inx;
+	int n_alts;
+	int alt_inx[MAX_ALTS+1];
+	int n_vars;
+	int im_alt_inx[MAX_ALTS+1];
+	int im_vars;
+	int tot_alt_inx[MAX_ALTS+1];
+	int tot_vars;
+	/* No im-nodes, each alternative is one group of re-nodes */
+	bool flat;
+	/* Base states */
+	struct P_state P;
+	struct V_state V;
+	/* EV table of all alternatives (n_alts+1 entries) */
+	bool E_ok;
+	double *E_lo,*E_mid,*E_up;
+	/* NEMO moments of all alternatives (n_alts+1 entries), valid per
+	 * alternative, and the node sd's from their calculation (tot_vars+1) */
+	int *M_ok;
+	double *M_rm1,*M_cm2,*M_cm3;
+	double *P_sd,*V_sd;
+	};
+
+/* Base changed while detached -> the context must be reloaded
+ * (an attached frame is reloaded by the caller right away) */
+#define cool_P(df) do { if ((df)->ctx && !(df)->attached) (df)->ctx->P_ok = (df)->ctx->E_ok = FALSE; } while (0)
+#define cool_V(df) do { if ((df)->ctx && !(df)->attached) (df)->ctx->V_ok = (df)->ctx->E_ok = FALSE; } while (0)
+
+/* TCLmemory.c */
+#define MEM_ALIGN(size) (((size)+sizeof(double)-1) & ~(sizeof(double)-1))
+void *mem_carve(char **arena, char *arena_end, size_t size);
+
+/* Bases are carved from the frame arena, rows sized to the frame (n entries).
+ * The statements have a chunk of their own. */
+#define P_BASE_SIZE(n) (sizeof(struct base)+8*(n)*sizeof(double))
+#define V_BASE_SIZE(n) (sizeof(struct base)+4*(n)*sizeof(double))
+#define STMTS_STEP 32 // initial room in a statement chunk
+
+/* TCLframe.c */
+void use_frame(struct d_frame *df);
+rcode own_base(struct d_frame *df, bool V);
+void release_base(struct base *B);
+double tcl_clock();
+extern struct tcl_perf tcl_perf;
+/* The counters are bumped by the evaluation workers as well */
+#ifdef PAR_EVAL
+void perf_count(unsigned long *cnt, unsigned long n);
+void perf_time(double *acc, double t);
+#define perf_add(f,n) perf_count(&(tcl_perf.f),(unsigned long)(n))
+#define perf_clock(f,t0) perf_time(&(tcl_perf.f),tcl_clock()-(t0))
+#else
+#define perf_add(f,n) (tcl_perf.f += (n))
+#define perf_clock(f,t0) (tcl_perf.f += tcl_clock()-(t0))
+#endif
+
 /* TCLpbase.c */
+void bind_P(struct d_frame *df);
+void set_P_rows(struct P_state *ps, double *row, int n);
+void set_P_base_rows(struct base *P, int n);
 rcode create_P(struct d_frame *df);
 rcode dispose_P(struct d_frame *df);
+rcode grow_P(struct base *P, int n);
 rcode load_P(struct d_frame *df);
+rcode load_P_alt(struct d_frame *df, int alt);
+rcode load_P_mid(struct d_frame *df, int alt);
+bool undo_P_alt(struct d_frame *df, int alt);
+rcode probe_P(struct d_frame *df, struct stmt_rec *stmt, bool free_mid, d_row masspt);
 int get_P_index(int alt, int cons);
 int get_P_im_index(int alt, int cons);
 void hull_P(d_row hlobo, d_row hupbo);
@@ -93,15 +224,23 @@ void l_cpoint_P(d_row mid);
 void mpoint_P(d_row masspt);
 int get_P_max(d_row objective, d_row maxpoint);
 int get_TP_max(d_row objective, d_row im_objective, d_row maxpoint, d_row im_maxpoint);
-double eval_P_max(int alt, int snode, int k_start, 
+double eval_P_max(int alt, int snode, 
 				d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive);
-double eval_P_min(int alt, int snode, int k_start, 
+double eval_P_min(int alt, int snode, 
 				d_row V_pt, d_row P_pt, d_row im_P_pt, bool positive);
 
 /* TCLvbase.c */
+void bind_V(struct d_frame *df);
+void set_V_rows(struct V_state *vs, double *row, int n);
+void set_V_base_rows(struct base *V, int n);
 rcode create_V(struct d_frame *df);
 rcode dispose_V(struct d_frame *df);
 rcode load_V(struct d_frame *df);
+rcode grow_V(struct base *V, int n);
+rcode add_V(struct d_frame *df, int first);
+rcode touch_V(struct d_frame *df, int stmt_nbr, struct stmt_rec *old_stmt, bool deleted);
+void free_V_index(struct d_frame *df);
+rcode mid_V(struct d_frame *df, int alt, int var);
 int get_V_index(int alt, int cons);
 int get_V_start(int alt);
 int get_V_end(int alt);
@@ -111,6 +250,13 @@ void hull_V(d_row lobo, d_row upbo);
 void fhull_V(d_row lobo, d_row upbo);
 void cpoint_V(d_row mid);
 void mpoint_V(d_row masspt);
+rcode probe_V(struct d_frame *df, struct stmt_rec *stmt, bool free_mid, int *var, double *masspt);
+rcode stmt_V(struct d_frame *df);
+rcode box_V(struct d_frame *df, double *tbox_lobo, double *tbox_upbo, 
+				d_row lobo, d_row upbo, d_row masspt);
+
+/* TCLmoments.c */
+void cool_moments(struct d_frame *df, int alt);
 
 /* TCLevaluate.c */
 void sort_dom2(i_row lin_order, d_row maxmin, int start, int stop, bool rev);
@@ -119,16 +265,18 @@ void sort_dom2(i_row lin_order, d_row maxmin, int start, int stop, bool rev);
 double ixset_P_max(int alt, int snode, i_row ixset);
 double ixset_P_min(int alt, int snode, i_row ixset);
 
-/* Globals */
-extern t_matrix t2f,t2r,t2i,r2t,i2t;
-extern tn_row f2r,f2i,r2f,i2f,i2end;
-extern int n_alts;
-extern int alt_inx[];
-extern int n_vars;
-extern int im_alt_inx[];
-extern int im_vars;
-extern int tot_alt_inx[];
-extern int tot_vars;
+/* Globals, bound to the context of the frame in use */
+extern TCL_TLS int **t2f,**t2r,**t2i,**r2t,**i2t;
+extern TCL_TLS int *f2r,*f2i,*r2f,*i2f,*i2end;
+extern TCL_TLS int **kid_lo,**kid_hi,**kid_node,**kid_inx;
+extern TCL_TLS int n_alts;
+extern TCL_TLS int *alt_inx;
+extern TCL_TLS int n_vars;
+extern TCL_TLS int *im_alt_inx;
+extern TCL_TLS int im_vars;
+extern TCL_TLS int *tot_alt_inx;
+extern TCL_TLS int tot_vars;
+extern TCL_TLS bool flat_frame;
 
 /* Index conversions between modes A1(t), A2(r&i), B1(f), B2(r&i) */
 
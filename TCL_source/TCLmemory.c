@@ -53,7 +53,7 @@
  *
  *   Functions outside module, inside TCL
  *   ------------------------------------
- *   NONE
+ *   mem_carve
  *
  *   Functions internal to module
  *   ----------------------------
@@ -64,16 +64,28 @@
 #include "TCLinternal.h"
 #include <malloc.h>
 
-#define MAX_CHUNKS 10000
+/* Each chunk is preceded by a header that links it into the list of
+ * allocated chunks. Freeing unlinks the header directly, so there is
+ * no search and no fixed limit on the number of chunks. The header is
+ * padded to keep the user part double aligned. */
+
+#define M_MARK 0x5E3A
 
 struct mem_chunk {
-	void *ptr;
+	struct mem_chunk *next;
+	struct mem_chunk *prev;
 	size_t size;
 	char *type;
 	char *source;
+	int watermark;
 	};
 
-static struct mem_chunk mem_tab[MAX_CHUNKS];
+union mem_header {
+	struct mem_chunk chunk;
+	double align;
+	};
+
+static struct mem_chunk *mem_list = NULL;
 static int n_chunks = 0;
 
 
@@ -84,50 +96,75 @@ static int n_chunks = 0;
   *********************************************************/
 
 void *mem_alloc(size_t size, char *type, char *source) {
-	void *mem_ptr;
+	union mem_header *hdr;
 
-	/* Check input parameters */
-	if (n_chunks >= MAX_CHUNKS)
-		return NULL;
 	/* Get memory chunk */
-	mem_ptr = malloc(size);
-	if (!mem_ptr)
+	hdr = (union mem_header *)malloc(sizeof(union mem_header)+size);
+	if (!hdr)
 		return NULL;
 	/* Fill entries */
-	mem_tab[n_chunks].ptr = mem_ptr;
-	mem_tab[n_chunks].size = size;
-	mem_tab[n_chunks].type = type;
-	mem_tab[n_chunks++].source = source;
-	return mem_ptr;
+	hdr->chunk.size = size;
+	hdr->chunk.type = type;
+	hdr->chunk.source = source;
+	hdr->chunk.watermark = M_MARK;
+	/* Link in first */
+	hdr->chunk.prev = NULL;
+	hdr->chunk.next = mem_list;
+	if (mem_list)
+		mem_list->prev = &(hdr->chunk);
+	mem_list = &(hdr->chunk);
+	n_chunks++;
+	return (void *)(hdr+1);
 	}
 
 
 rcode mem_free(void* mem_ptr) {
-	int i;
+	struct mem_chunk *chunk;
 
 	/* Check input parameters */
-	for (i=0; i<n_chunks; i++)
-		if (mem_ptr == mem_tab[i].ptr)
-			break;
-	if (i == n_chunks)
+	if (!mem_ptr)
 		return TCL_INPUT_ERROR;
-	/* Move last entry up to fill hole */
-	mem_tab[i].ptr = mem_tab[--n_chunks].ptr;
-	mem_tab[i].size = mem_tab[n_chunks].size;
-	mem_tab[i].type = mem_tab[n_chunks].type;
-	mem_tab[i].source = mem_tab[n_chunks].source;
-	free(mem_ptr);
+	chunk = &(((union mem_header *)mem_ptr-1)->chunk);
+	if (chunk->watermark != M_MARK)
+		return TCL_INPUT_ERROR;
+	/* Unlink */
+	if (chunk->prev)
+		chunk->prev->next = chunk->next;
+	else
+		mem_list = chunk->next;
+	if (chunk->next)
+		chunk->next->prev = chunk->prev;
+	n_chunks--;
+	/* Prevent double free */
+	chunk->watermark = 0;
+	free((void *)chunk);
 	return TCL_OK;
 	}
 
 
+/* Carve a double aligned piece out of an arena, i.e. a chunk that is
+ * allocated once and released as a whole (such as a frame with its
+ * bases and context). Returns NULL if the arena is exhausted. */
+
+void *mem_carve(char **arena, char *arena_end, size_t size) {
+	char *mem_ptr;
+
+	mem_ptr = *arena;
+	size = MEM_ALIGN(size);
+	if (mem_ptr+size > arena_end)
+		return NULL;
+	*arena = mem_ptr+size;
+	return (void *)mem_ptr;
+	}
+
+
 void mem_map() {
-	int i;
+	struct mem_chunk *chunk;
 
 	/* Print all allocated memory chunks */
-	for (i=0; i<n_chunks; i++)
-		fprintf(stderr,"0x%p  %s  size: %ld  source: %s\n",mem_tab[i].ptr,
-					 mem_tab[i].type,(long)mem_tab[i].size,mem_tab[i].source);
+	for (chunk=mem_list; chunk; chunk=chunk->next)
+		fprintf(stderr,"0x%p  %s  size: %ld  source: %s\n",(void *)((union mem_header *)chunk+1),
+					 chunk->type,(long)chunk->size,chunk->source);
 	}
 
 
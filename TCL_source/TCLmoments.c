@@ -53,14 +53,19 @@
  *   TCL_get_mc_moments
  *   TCL_get_P_sd
  *   TCL_get_V_sd
+ *   TCL_sample_seed (in TCLsample.c)
+ *   TCL_sample_td (in TCLsample.c)
+ *   TCL_get_EV_samples (in TCLsample.c)
+ *   TCL_get_W_samples (in TCLsample.c)
  *
  *   Functions outside module, inside TCL
  *   ------------------------------------
- *   NONE
+ *   cool_moments
  *
  *   Functions internal to module
  *   ----------------------------
  *   calc_nemo_Pnode
+ *   Vnode_mean
  *   calc_nemo_Vnode
  *   mult_moments
  *   calc_nemo_tree
@@ -106,28 +111,35 @@ static void calc_nemo_Pnode(double lobo, double mid, double upbo,
 #define V_MID_SNAP_HALF // use mean semi-literally, i.e. snap halfway
 #endif
 
+static double Vnode_mean(double lobo, double mid, double upbo) {
+	double mean;
+
+#ifdef V_MID_SNAP
+	/* Snap to geometrically compliant triangle ('M' in BRS).
+	 * Note: this entails that unphysical midpoints have no influence. */
+	mean = max(mid,(2.0*lobo+upbo)/3.0);
+	mean = min(mean,(lobo+2.0*upbo)/3.0);
+#ifdef V_MID_SNAP_HALF
+	mean += (mid-mean)/2.0;
+#endif
+#else
+	/* Non-snap: triangle top point can extend to be at 2 times the base. This
+	 * entails that the variance can be up to 3 times a std physical triangle. */
+	mean = mid;
+#endif
+	return mean;
+	}
+
+
 static void calc_nemo_Vnode(double lobo, double mid, double upbo, double *var, double *tcm) {
 	double t,q;
-	double mean,mode;
+	double mode;
 
 	/* Employing a triangular distribution */
 	t = upbo-lobo;
 	if (t > EPS) {
 		/* Mid interpreted as mean -> convert to mode */
-#ifdef V_MID_SNAP
-		/* Snap to geometrically compliant triangle ('M' in BRS).
-		 * Note: this entails that unphysical midpoints have no influence. */
-		mean = max(mid,(2.0*lobo+upbo)/3.0);
-		mean = min(mean,(lobo+2.0*upbo)/3.0);
-#ifdef V_MID_SNAP_HALF
-		mean += (mid-mean)/2.0;
-#endif
-#else
-		/* Non-snap: triangle top point can extend to be at 2 times the base. This
-		 * entails that the variance can be up to 3 times a std physical triangle. */
-		mean = mid;
-#endif
-		mode = 3.0*mean-lobo-upbo;
+		mode = 3.0*Vnode_mean(lobo,mid,upbo)-lobo-upbo;
 		q = (mode-lobo)/t;
 		*var = t*t*(1.0-q+q*q)/18.0;
 		*tcm = t*t*t*(2.0-3.0*q-3.0*q*q+2.0*q*q*q)/270.0;
@@ -165,92 +177,124 @@ static void mult_moments(double Pmean, double Pvar, double Pcov,
   *
   *********************************************************/
 
-static d_row P_lobo,P_mid,P_upbo,V_lobo,V_mid,V_upbo,P_sd,V_sd;
-// note: covar matrix entries used selectively in the recursion
-static double covar[MAX_NODES+1][MAX_NODES+1];
+static TCL_TLS d_row P_lobo,P_mid,P_upbo,V_lobo,V_mid,V_upbo;
+// node sd's, bound to the frame context since the moments are cached there
+static TCL_TLS double *P_sd,*V_sd;
+// note: the separable covariance of sibling i and j is -PV_covar[i]*PV_covar[j]
+static TCL_TLS d_row PV_covar,kid_covar;
+static TCL_TLS d_row sub_mean,sub_var,sub_tcm;
+
+/* Sweep the compiled tree bottom-up (see TCLevalp.c). The moments of each
+ * im-node level are kept in sub_mean/sub_var/sub_tcm for the parent level. */
 
 static void calc_nemo_tree(struct d_frame *df, int alt, int snode, double *tot_mean,
 		double *tot_var, double *tot_tcm) {
-	int tnode,t2node,inx,inx1,inx2,n_nodes;
-	double P_var,P_cov,V_mean,V_var,V_tcm;
+	int tnode,k,k2,k_start,k_end,inx,n_nodes;
+	double P_var,P_cov,V_var,V_tcm;
 	double PV_mean,PV_var,PV_cov,PV_tcm;
-	double node_cov,lambda,lobo_s;
+	double node_cov,lambda,lobo_s,mean,var,tcm;
 
-	/* Calculate lambda scaling */
-	lambda = lobo_s = 0.0;
-	for (tnode=df->down[alt][snode]; tnode; tnode=df->next[alt][tnode]) {
-		inx = at2f(alt,tnode);
-		lambda += P_upbo[inx]-P_lobo[inx];
-		lobo_s += P_lobo[inx];
-		}
-	if (lobo_s < 1.0-EPS)
-		lambda /= (1.0-lobo_s);
-	else // 0-div-by-0 -> l'Hospital -> converges to 1
-		lambda = 1.0;
-	/* Calculate moments from local tree node data */
 	*tot_mean = 0.0;
 	*tot_var  = 0.0;
 	*tot_tcm  = 0.0;
-	/* Sum all nodes at this level */
-	for (tnode=df->down[alt][snode]; tnode; tnode=df->next[alt][tnode]) {
-		inx = at2f(alt,tnode);
-		if (df->down[alt][tnode])	{
-			/* Im-node */
-			calc_nemo_Pnode(P_lobo[inx],P_mid[inx],P_upbo[inx],lambda,&P_var,&P_cov);
-			calc_nemo_tree(df,alt,tnode,&V_mean,&V_var,&V_tcm);
-			mult_moments(P_mid[inx],P_var,P_cov,V_mean,V_var,V_tcm,
-					&PV_mean,&PV_var,&PV_cov,&PV_tcm);
-			}
-		else {
+	if (snode && !df->down[alt][snode])
+		return;
+	tnode = snode ? i2end[at2i(alt,snode)]-tot_alt_inx[alt-1] : df->tot_cons[alt];
+	for (; tnode>=snode; tnode--) {
+		k_start = kid_lo[alt][tnode];
+		k_end = kid_hi[alt][tnode];
+		if (k_start == k_end)
 			/* Re-node */
-			calc_nemo_Pnode(P_lobo[inx],P_mid[inx],P_upbo[inx],lambda,&P_var,&P_cov);
-			calc_nemo_Vnode(V_lobo[inx],V_mid[inx],V_upbo[inx],&V_var,&V_tcm);
-			mult_moments(P_mid[inx],P_var,P_cov,V_mid[inx],V_var,V_tcm,
-					&PV_mean,&PV_var,&PV_cov,&PV_tcm);
+			continue;
+		/* Calculate lambda scaling */
+		lambda = lobo_s = 0.0;
+		for (k=k_start; k<k_end; k++) {
+			inx = at2f(alt,kid_node[alt][k]);
+			lambda += P_upbo[inx]-P_lobo[inx];
+			lobo_s += P_lobo[inx];
 			}
-		*tot_mean += PV_mean;
-		*tot_var  += PV_var;
-		*tot_tcm  += PV_tcm;
-		covar[inx][0] = PV_cov; // store separable covariance in column 0
-		P_sd[inx] = sqrt(P_var);
-		V_sd[inx] = sqrt(V_var);
-		}
-	/* Generate separable covariance matrix (upper right triangle, above diagonal)
-	 * The lower left triangle is a mirror image, so the sum is doubled later. */
-	for (tnode=df->down[alt][snode]; tnode; tnode=df->next[alt][tnode]) {
-		inx1 = at2f(alt,tnode);
-		for (t2node=df->next[alt][tnode]; t2node; t2node=df->next[alt][t2node]) {
-			inx2 = at2f(alt,t2node);
-			covar[inx1][inx2] = -covar[inx1][0];
+		if (lobo_s < 1.0-EPS)
+			lambda /= (1.0-lobo_s);
+		else // 0-div-by-0 -> l'Hospital -> converges to 1
+			lambda = 1.0;
+		/* Calculate moments from local tree node data */
+		mean = 0.0;
+		var  = 0.0;
+		tcm  = 0.0;
+		/* Sum all nodes at this level */
+		for (k=k_start; k<k_end; k++) {
+			inx = at2f(alt,kid_node[alt][k]);
+			if (df->down[alt][kid_node[alt][k]])	{
+				/* Im-node, level below already calculated */
+				calc_nemo_Pnode(P_lobo[inx],P_mid[inx],P_upbo[inx],lambda,&P_var,&P_cov);
+				V_var = sub_var[inx];
+				mult_moments(P_mid[inx],P_var,P_cov,sub_mean[inx],sub_var[inx],sub_tcm[inx],
+						&PV_mean,&PV_var,&PV_cov,&PV_tcm);
+				}
+			else {
+				/* Re-node */
+				calc_nemo_Pnode(P_lobo[inx],P_mid[inx],P_upbo[inx],lambda,&P_var,&P_cov);
+				calc_nemo_Vnode(V_lobo[inx],V_mid[inx],V_upbo[inx],&V_var,&V_tcm);
+				mult_moments(P_mid[inx],P_var,P_cov,V_mid[inx],V_var,V_tcm,
+						&PV_mean,&PV_var,&PV_cov,&PV_tcm);
+				}
+			mean += PV_mean;
+			var  += PV_var;
+			tcm  += PV_tcm;
+			kid_covar[k] = PV_cov;
+			P_sd[inx] = sqrt(P_var);
+			V_sd[inx] = sqrt(V_var);
 			}
-		for (t2node=df->down[alt][snode]; t2node!=tnode; t2node=df->next[alt][t2node]) {
-			inx2 = at2f(alt,t2node);
-			covar[inx2][inx1] *= covar[inx1][0];
+		/* Calculate variance from separable covariance (sum over sibling pairs,
+		 * i.e. the upper right triangle of the covariance matrix) */
+		n_nodes = k_end-k_start;
+		node_cov = 0.0;
+		for (k=k_start; k<k_end; k++)
+			for (k2=k+1; k2<k_end; k2++)
+				node_cov += -kid_covar[k]*kid_covar[k2];
+		var += 2.0*node_cov; // upper + lower triangle
+		tcm /= (double)n_nodes;
+		if (var < EPS) // catch roundoff errors
+			var = 0.0;
+		if (tcm < EPS) // catch roundoff errors
+			tcm = 0.0;
+		if (tnode > snode) {
+			/* Keep for the parent level */
+			inx = at2f(alt,tnode);
+			sub_mean[inx] = mean;
+			sub_var[inx] = var;
+			sub_tcm[inx] = tcm;
 			}
-		}
-	/* Calculate variance from separable covariance (sum of upper right triangle entries) */
-	n_nodes = 0;
-	node_cov = 0.0;
-	for (tnode=df->down[alt][snode]; tnode; tnode=df->next[alt][tnode]) {
-		inx1 = at2f(alt,tnode);
-		for (t2node=df->next[alt][tnode]; t2node; t2node=df->next[alt][t2node]) {
-			inx2 = at2f(alt,t2node);
-			node_cov += covar[inx1][inx2];
+		else {
+			*tot_mean = mean;
+			*tot_var  = var;
+			*tot_tcm  = tcm;
 			}
-		n_nodes++;
 		}
-	*tot_var += 2.0*node_cov; // upper + lower triangle
-	*tot_tcm /= (double)n_nodes;
-	if (*tot_var < EPS) // catch roundoff errors
-		*tot_var = 0.0;
-	if (*tot_tcm < EPS) // catch roundoff errors
-		*tot_tcm = 0.0;
+	}
+
+
+/* The moments of an alternative only depend on its own part of the
+ * bases. They are kept in the frame context and recalculated for the
+ * alternatives that have been cooled since the last call. */
+
+void cool_moments(struct d_frame *df, int alt) {
+	int Ai;
+
+	if (!df->ctx)
+		return;
+	if (alt)
+		df->ctx->M_ok[alt] = FALSE;
+	else
+		for (Ai=1; Ai<=df->n_alts; Ai++)
+			df->ctx->M_ok[Ai] = FALSE;
 	}
 
 
 rcode TCL_get_moments(struct d_frame *df, a_row rm1, a_row cm2, a_row cm3) {
 	int Ai;
-	double A_mean,A_var,A_tcm;
+	bool loaded;
+	struct tcl_ctx *cx;
 
 	/* Check input parameters */
 	if (df == NULL)
@@ -259,18 +303,29 @@ rcode TCL_get_moments(struct d_frame *df, a_row rm1, a_row cm2, a_row cm3) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
+	cx = df->ctx;
+	P_sd = cx->P_sd;
+	V_sd = cx->V_sd;
 
-	/* Pick up start vectors */
-	l_hull_P(P_lobo,P_upbo);
-	l_cpoint_P(P_mid);
-	hull_V(V_lobo,V_upbo);
-	cpoint_V(V_mid);
-	/* Calculate moments for each alternative */
+	/* Calculate moments for each cooled alternative */
+	loaded = FALSE;
 	for (Ai=1; Ai<=df->n_alts; Ai++) {
-		calc_nemo_tree(df,Ai,0,&A_mean,&A_var,&A_tcm);
-		rm1[Ai] = A_mean;
-		cm2[Ai] = A_var;
-		cm3[Ai] = A_tcm;
+		if (!cx->M_ok[Ai]) {
+			if (!loaded) {
+				/* Pick up start vectors */
+				l_hull_P(P_lobo,P_upbo);
+				l_cpoint_P(P_mid);
+				hull_V(V_lobo,V_upbo);
+				cpoint_V(V_mid);
+				loaded = TRUE;
+				}
+			calc_nemo_tree(df,Ai,0,cx->M_rm1+Ai,cx->M_cm2+Ai,cx->M_cm3+Ai);
+			cx->M_ok[Ai] = TRUE;
+			}
+		rm1[Ai] = cx->M_rm1[Ai];
+		cm2[Ai] = cx->M_cm2[Ai];
+		cm3[Ai] = cx->M_cm3[Ai];
 		}
 	return TCL_OK;
 	}
@@ -329,22 +384,10 @@ static void calc_nemo_mc_tree(struct d_frame *df, int snode, d_row Vx_rm1, d_row
 		*tot_mean += PV_mean;
 		*tot_var += PV_var;
 		*tot_tcm += PV_tcm;
-		covar[inx][0] = PV_cov; // store separable covariance in column 0
+		PV_covar[inx] = PV_cov; // store separable covariance
 		P_sd[inx] = sqrt(P_var);
 		}
-	/* Generate separable covariance matrix (upper right triangle, above diagonal) */
-	for (tnode=df->down[1][snode]; tnode; tnode=df->next[1][tnode]) {
-		inx1 = at2f(1,tnode);
-		for (t2node=df->next[1][tnode]; t2node; t2node=df->next[1][t2node]) {
-			inx2 = at2f(1,t2node);
-			covar[inx1][inx2] = -covar[inx1][0];
-			}
-		for (t2node=df->down[1][snode]; t2node!=tnode; t2node=df->next[1][t2node]) {
-			inx2 = at2f(1,t2node);
-			covar[inx2][inx1] *= covar[inx1][0];
-			}
-		}
-	/* Calculate variance from separable covariance (sum of upper right triangle entries).
+	/* Calculate variance from separable covariance (sum over sibling pairs).
 	 * Symmetric along the diagonal -> calculate sum of upper right and double it. */
 	n_nodes = 0;
 	node_cov = 0.0;
@@ -352,7 +395,7 @@ static void calc_nemo_mc_tree(struct d_frame *df, int snode, d_row Vx_rm1, d_row
 		inx1 = at2f(1,tnode);
 		for (t2node=df->next[1][tnode]; t2node; t2node=df->next[1][t2node]) {
 			inx2 = at2f(1,t2node);
-			node_cov += covar[inx1][inx2];
+			node_cov += -PV_covar[inx1]*PV_covar[inx2];
 			}
 		n_nodes++;
 		}
@@ -375,8 +418,12 @@ rcode TCL_get_mc_moments(struct d_frame *df, int snode, d_row Vx_rm1, d_row Vx_c
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
+	P_sd = df->ctx->P_sd;
+	V_sd = df->ctx->V_sd;
 
-	/* Pick up start vectors only for W since V is supplied in the call. */
+	/* Pick up start vectors only for W since V is supplied in the call.
+	 * The criteria moments are cached in their frames (TCL_get_moments). */
 	l_hull_P(P_lobo,P_upbo);
 	l_cpoint_P(P_mid);
 	/* Calculate moments for MC */
@@ -400,10 +447,11 @@ rcode TCL_get_P_sd(struct d_frame *df, int inx, double *sd) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 	if ((inx < 1) || (inx > df->tot_cons[0]))
 		return TCL_INPUT_ERROR;
 	/* Deliver standard deviation for re+im-nodes */
-	*sd = P_sd[inx];
+	*sd = df->ctx->P_sd[inx];
 	return TCL_OK;
 	}
 
@@ -420,12 +468,16 @@ rcode TCL_get_V_sd(struct d_frame *df, int inx, int im, double *sd) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 	if ((inx < 1) || (inx > df->tot_cons[0]))
 		return TCL_INPUT_ERROR;
 	/* Deliver standard deviation for re(+im)-nodes */
 	if (f2r[inx] || im)
-		*sd = V_sd[inx]; // re-node or im-flag
+		*sd = df->ctx->V_sd[inx]; // re-node or im-flag
 	else
 		*sd = -1.0; // im-node and no im-flag
 	return TCL_OK;
 	}
+
+
+#include "TCLsample.c"
@@ -50,9 +50,16 @@
  *
  *   Functions outside module, inside TCL
  *   ------------------------------------
+ *   bind_P
+ *   set_P_rows
+ *   set_P_base_rows
  *   create_P
  *   dispose_P
+ *   grow_P
  *   load_P
+ *   load_P_alt
+ *   load_P_mid
+ *   undo_P_alt
  *   get_P_index
  *   get_P_im_index
  *   l_hull_P
@@ -60,17 +67,27 @@
  *   l_cpoint_P
  *   cpoint_P
  *   mpoint_P (but no l_mpoint_P)
+ *   probe_P
  *
  *   Functions internal to module
  *   ----------------------------
+ *   bind_P_state
  *   check_norm
  *   loc_2_glob
  *   calc_tree_hull
  *   calc_tree_mhull
+ *   calc_flat_hull
+ *   box_P_stmt
+ *   load_P_tail
+ *   load_P_mtail
+ *   load_P_base
+ *   copy_P_alt
  *   renorm_mp
  *   save_mp
  *   check_mp
+ *   lo_fraction
  *   N_DoF_mp
+ *   flat_mp
  *
  */
 
@@ -83,38 +100,120 @@
   *
   *********************************************************/
 
-/* Local data structures */
-static d_row box_lobo;
-static d_row box_upbo;
-static d_row im_box_lobo;
-static d_row im_box_upbo;
-static d_row hull_lobo;
-static d_row hull_upbo;
-static d_row im_hull_lobo;
-static d_row im_hull_upbo;
-static d_row L_hull_lobo;
-static d_row L_hull_upbo;
-static d_row im_L_hull_lobo;
-static d_row im_L_hull_upbo;
-static d_row mass_point;
-static d_row im_mass_point;
-static d_row L_mass_point;
-static d_row im_L_mass_point;
-static d_row mbox_lobo;
-static d_row mbox_upbo;
-static d_row im_mbox_lobo;
-static d_row im_mbox_upbo;
-static d_row mhull_lobo;
-static d_row mhull_upbo;
-static d_row im_mhull_lobo;
-static d_row im_mhull_upbo;
-static d_row L_mhull_lobo;
-static d_row L_mhull_upbo;
-static d_row im_L_mhull_lobo;
-static d_row im_L_mhull_upbo;
-
-/* Forward declarations */
-static t_matrix tnext,tprev,tdown,tup;
+/* Local data structures (stored in the frame context) */
+static TCL_TLS double *box_lobo;
+static TCL_TLS double *box_upbo;
+static TCL_TLS double *im_box_lobo;
+static TCL_TLS double *im_box_upbo;
+static TCL_TLS double *hull_lobo;
+static TCL_TLS double *hull_upbo;
+static TCL_TLS double *im_hull_lobo;
+static TCL_TLS double *im_hull_upbo;
+static TCL_TLS double *L_hull_lobo;
+static TCL_TLS double *L_hull_upbo;
+static TCL_TLS double *im_L_hull_lobo;
+static TCL_TLS double *im_L_hull_upbo;
+static TCL_TLS double *mass_point;
+static TCL_TLS double *im_mass_point;
+static TCL_TLS double *L_mass_point;
+static TCL_TLS double *im_L_mass_point;
+static TCL_TLS double *mbox_lobo;
+static TCL_TLS double *mbox_upbo;
+static TCL_TLS double *im_mbox_lobo;
+static TCL_TLS double *im_mbox_upbo;
+static TCL_TLS double *mhull_lobo;
+static TCL_TLS double *mhull_upbo;
+static TCL_TLS double *im_mhull_lobo;
+static TCL_TLS double *im_mhull_upbo;
+static TCL_TLS double *L_mhull_lobo;
+static TCL_TLS double *L_mhull_upbo;
+static TCL_TLS double *im_L_mhull_lobo;
+static TCL_TLS double *im_L_mhull_upbo;
+
+/* Tree structure of the frame in use */
+static TCL_TLS int **tnext,**tprev,**tdown,**tup;
+
+
+/* Point the rows of ps into a block of P_ROWS*n doubles */
+
+void set_P_rows(struct P_state *ps, double *row, int n) {
+
+	ps->box_lobo = row; row += n;
+	ps->box_upbo = row; row += n;
+	ps->im_box_lobo = row; row += n;
+	ps->im_box_upbo = row; row += n;
+	ps->hull_lobo = row; row += n;
+	ps->hull_upbo = row; row += n;
+	ps->im_hull_lobo = row; row += n;
+	ps->im_hull_upbo = row; row += n;
+	ps->L_hull_lobo = row; row += n;
+	ps->L_hull_upbo = row; row += n;
+	ps->im_L_hull_lobo = row; row += n;
+	ps->im_L_hull_upbo = row; row += n;
+	ps->mass_point = row; row += n;
+	ps->im_mass_point = row; row += n;
+	ps->L_mass_point = row; row += n;
+	ps->im_L_mass_point = row; row += n;
+	ps->mbox_lobo = row; row += n;
+	ps->mbox_upbo = row; row += n;
+	ps->im_mbox_lobo = row; row += n;
+	ps->im_mbox_upbo = row; row += n;
+	ps->mhull_lobo = row; row += n;
+	ps->mhull_upbo = row; row += n;
+	ps->im_mhull_lobo = row; row += n;
+	ps->im_mhull_upbo = row; row += n;
+	ps->L_mhull_lobo = row; row += n;
+	ps->L_mhull_upbo = row; row += n;
+	ps->im_L_mhull_lobo = row; row += n;
+	ps->im_L_mhull_upbo = row;
+	}
+
+
+/* Bind local data structures to a P-state */
+
+static void bind_P_state(struct P_state *ps) {
+
+	box_lobo = ps->box_lobo;
+	box_upbo = ps->box_upbo;
+	im_box_lobo = ps->im_box_lobo;
+	im_box_upbo = ps->im_box_upbo;
+	hull_lobo = ps->hull_lobo;
+	hull_upbo = ps->hull_upbo;
+	im_hull_lobo = ps->im_hull_lobo;
+	im_hull_upbo = ps->im_hull_upbo;
+	L_hull_lobo = ps->L_hull_lobo;
+	L_hull_upbo = ps->L_hull_upbo;
+	im_L_hull_lobo = ps->im_L_hull_lobo;
+	im_L_hull_upbo = ps->im_L_hull_upbo;
+	mass_point = ps->mass_point;
+	im_mass_point = ps->im_mass_point;
+	L_mass_point = ps->L_mass_point;
+	im_L_mass_point = ps->im_L_mass_point;
+	mbox_lobo = ps->mbox_lobo;
+	mbox_upbo = ps->mbox_upbo;
+	im_mbox_lobo = ps->im_mbox_lobo;
+	im_mbox_upbo = ps->im_mbox_upbo;
+	mhull_lobo = ps->mhull_lobo;
+	mhull_upbo = ps->mhull_upbo;
+	im_mhull_lobo = ps->im_mhull_lobo;
+	im_mhull_upbo = ps->im_mhull_upbo;
+	L_mhull_lobo = ps->L_mhull_lobo;
+	L_mhull_upbo = ps->L_mhull_upbo;
+	im_L_mhull_lobo = ps->im_L_mhull_lobo;
+	im_L_mhull_upbo = ps->im_L_mhull_upbo;
+	}
+
+
+/* Bind local data structures to the context of df */
+
+void bind_P(struct d_frame *df) {
+
+	bind_P_state(&(df->ctx->P));
+	tnext = df->next;
+	tprev = df->prev;
+	tdown = df->down;
+	tup = df->up;
+	}
 
 
  /*********************************************************
@@ -123,18 +222,42 @@ static t_matrix tnext,tprev,tdown,tup;
   *
   *********************************************************/
 
+/* Point the rows of a base to its own block (n entries per row) */
+
+void set_P_base_rows(struct base *P, int n) {
+	double *row;
+
+	row = (double *)(P+1);
+	P->lo_midbox = row;
+	P->up_midbox = row+n;
+	P->lo_im_midbox = row+2*n;
+	P->up_im_midbox = row+3*n;
+	P->box_lobo = row+4*n;
+	P->box_upbo = row+5*n;
+	P->im_box_lobo = row+6*n;
+	P->im_box_upbo = row+7*n;
+	}
+
+
 rcode create_P(struct d_frame *df) {
-	int i;
+	int i,n;
 
-	/* Get new memory chunk */
-	df->P_base = (struct base *)mem_alloc(sizeof(struct base),"struct base","create_P");
+	/* Get memory from the frame arena, rows sized to the frame */
+	n = df->tot_cons[0]+1;
+	df->P_base = (struct base *)mem_carve(&(df->arena),df->arena_end,P_BASE_SIZE(n));
 	if (!df->P_base)
 		return TCL_OUT_OF_MEMORY;
+	set_P_base_rows(df->P_base,n);
+	df->P_own = df->P_base;
+	df->P_base->n_users = 1;
+	df->P_base->home = df;
 	/* Pre-fill entries */
 	df->P_base->watermark = P_MARK;
 	df->P_base->n_stmts = 0;
+	df->P_base->max_stmts = 0;
+	df->P_base->stmt = NULL; // chunk made on first statement
 	df->P_base->box = FALSE;
-	for (i=0; i<=MAX_CONS; i++) {
+	for (i=0; i<n; i++) {
 		df->P_base->lo_midbox[i] = -1.0;
 		df->P_base->up_midbox[i] = -1.0;
 		df->P_base->lo_im_midbox[i] = -1.0;
@@ -149,9 +272,34 @@ rcode dispose_P(struct d_frame *df) {
 	/* Check input parameters */
 	if (df->P_base->watermark != P_MARK)
 		return TCL_CORRUPTED;
-	/* Prevent accidental reuse */
-	df->P_base->watermark = 0;
-	return mem_free((void *)df->P_base);
+	/* Release, the last user prevents accidental reuse */
+	release_base(df->P_base);
+	return TCL_OK;
+	}
+
+
+/* Make room for n statements in P, the chunk doubles as it grows */
+
+rcode grow_P(struct base *P, int n) {
+	int size;
+	struct stmt_rec *stmt;
+
+	if (n <= P->max_stmts)
+		return TCL_OK;
+	if (n > MAX_P_STMTS)
+		return TCL_TOO_MANY_STMTS;
+	for (size=max(2*P->max_stmts,STMTS_STEP); size<n; size*=2) ;
+	size = min(size,MAX_P_STMTS);
+	stmt = (struct stmt_rec *)mem_alloc((size+1)*sizeof(struct stmt_rec),"struct stmt_rec","grow_P");
+	if (!stmt)
+		return TCL_OUT_OF_MEMORY;
+	if (P->stmt) {
+		memcpy(stmt+1,P->stmt+1,P->n_stmts*sizeof(struct stmt_rec));
+		mem_free((void *)P->stmt);
+		}
+	P->stmt = stmt;
+	P->max_stmts = size;
+	return TCL_OK;
 	}
 
 
@@ -291,6 +439,38 @@ static rcode calc_tree_mhull(int alt, int snode, double p_lobo, double p_upbo) {
 	}
 
 
+/* Hull of a flat alternative. Its re-nodes are one sibling group at
+ * alt_inx[alt-1]+1..alt_inx[alt], so the hull is formed in two passes
+ * over that range without the tree walk. The local and global hulls
+ * coincide. Used for both the box (hull) and the midbox (mhull). */
+
+static rcode calc_flat_hull(int alt, double *lobo, double *upbo,
+		double *L_lobo, double *L_upbo, double *g_lobo, double *g_upbo) {
+	int j,j_end;
+	double pmin=0.0,pmax=0.0;
+
+	j_end = alt_inx[alt];
+	/* Step 1: Calculate min and max prob for the alternative */
+	for (j=alt_inx[alt-1]+1; j<=j_end; j++) {
+		pmin += lobo[j];
+		pmax += upbo[j];
+		}
+	/* Step 2: Check consistency */
+	if ((pmin > 1.0+EPS) || (pmax < 1.0-EPS))
+		return TCL_INCONSISTENT;
+	pmin = min(pmin,1.0);
+	pmax = max(pmax,1.0);
+	/* Step 3: Calculate hull */
+	for (j=alt_inx[alt-1]+1; j<=j_end; j++) {
+		L_lobo[j] = max(lobo[j],upbo[j]+1.0-pmax);
+		L_upbo[j] = min(upbo[j],lobo[j]+1.0-pmin);
+		g_lobo[j] = L_lobo[j];
+		g_upbo[j] = L_upbo[j];
+		}
+	return TCL_OK;
+	}
+
+
  /*********************************************************
   *
   *  Mass point handling
@@ -365,6 +545,21 @@ static void renorm_mp(int alt, int snode) {
    it is impossible to know whether the decision-maker has an N or N-1 DoF model
    in his/her head -> function adjust_vx combines it with an N-1 DoF model. */
 
+/* Weight of the lower midpoint bounds in a level summing to pmin..pmax */
+
+static double lo_fraction(double pmin, double pmax) {
+
+	if (pmin >= 1.0)
+		return 1.0;
+	else if (pmax <= 1.0)
+		return 0.0;
+	else if (pmax > pmin+EPS)
+		return (pmax-1.0) / (pmax-pmin);
+	else
+		return 0.5;
+	}
+
+
 static void N_DoF_mp(int alt, int snode, double norm) {
 	int tnode,inx;
 	double pmin,pmax,lofrac,upfrac;
@@ -375,20 +570,8 @@ static void N_DoF_mp(int alt, int snode, double norm) {
 		pmin += (tdown[alt][tnode]?im_L_mhull_lobo[at2i(alt,tnode)]:L_mhull_lobo[at2r(alt,tnode)]);
 		pmax += (tdown[alt][tnode]?im_L_mhull_upbo[at2i(alt,tnode)]:L_mhull_upbo[at2r(alt,tnode)]);
 		}
-	if (pmin >= 1.0) {
-		lofrac = 1.0;
-		upfrac = 0.0;
-		}
-	else if (pmax <= 1.0) {
-		lofrac = 0.0;
-		upfrac = 1.0;
-		}
-	else if (pmax > pmin+EPS) {
-		lofrac = (pmax-1.0) / (pmax-pmin);
-		upfrac = 1.0 - lofrac;
-		}
-	else
-		lofrac = upfrac = 0.5;
+	lofrac = lo_fraction(pmin,pmax);
+	upfrac = 1.0 - lofrac;
 
 	/* Distribute over current level */
 	for (tnode=tdown[alt][snode]; tnode; tnode=tnext[alt][tnode])
@@ -419,14 +602,181 @@ static void N_DoF_mp(int alt, int snode, double norm) {
 	}
 
 
+/* N_DoF_mp for a flat alternative (one level, norm 1) */
+
+static void flat_mp(int alt) {
+	int j,j_start,j_end;
+	double pmin,pmax,lofrac,upfrac;
+
+	j_start = alt_inx[alt-1]+1;
+	j_end = alt_inx[alt];
+	pmin = pmax = 0.0;
+	for (j=j_start; j<=j_end; j++) {
+		pmin += L_mhull_lobo[j];
+		pmax += L_mhull_upbo[j];
+		}
+	lofrac = lo_fraction(pmin,pmax);
+	upfrac = 1.0 - lofrac;
+	for (j=j_start; j<=j_end; j++)
+		L_mass_point[j] = lofrac * L_mhull_lobo[j] + upfrac * L_mhull_upbo[j];
+	adjust_vx(alt,0,lofrac);
+	for (j=j_start; j<=j_end; j++)
+		mass_point[j] = L_mass_point[j];
+	}
+
+
  /*********************************************************
   *
   *  Load and verify P-base
   *
   *********************************************************/
 
-rcode load_P(struct d_frame *df) {
-	int i,j,alt,tcons,var_nbr;
+/* Saved part of one alternative, see load_P_alt */
+static TCL_TLS struct P_state P_save;
+static TCL_TLS double P_save_rows[P_ROWS*(MAX_NODES+1)];
+static TCL_TLS struct tcl_ctx *save_ctx = NULL;
+static TCL_TLS int save_alt = 0;
+
+/* Scratch copy of one alternative, see probe_P */
+static TCL_TLS struct P_state P_probe;
+static TCL_TLS double P_probe_rows[P_ROWS*(MAX_NODES+1)];
+
+
+/* Enter one statement into the box */
+
+static rcode box_P_stmt(struct d_frame *df, struct stmt_rec *stmt) {
+	int alt,tcons,var_nbr;
+
+	if (stmt->n_terms != 1)
+		return TCL_INPUT_ERROR;
+	if (stmt->lobo < 0.0)
+		return TCL_INPUT_ERROR;
+	if (stmt->upbo < stmt->lobo)
+		return TCL_INPUT_ERROR;
+	if (stmt->upbo > 1.0)
+		return TCL_INPUT_ERROR;
+	alt = stmt->alt[1];
+	tcons = stmt->cons[1];
+	if ((alt < 1) || (alt > n_alts) || (tcons < 1) || (tcons > df->tot_cons[alt]))
+		return TCL_INPUT_ERROR;
+	if (stmt->sign[1] != 1)
+		return TCL_INPUT_ERROR;
+	if (t2r[alt][tcons]) {
+		/* Real consequence */
+		var_nbr = at2r(alt,tcons);
+		box_lobo[var_nbr] = max(box_lobo[var_nbr],stmt->lobo);
+		box_upbo[var_nbr] = min(box_upbo[var_nbr],stmt->upbo);
+		if (box_upbo[var_nbr]-box_lobo[var_nbr] < 0.0) // -EPS ??
+			return TCL_INCONSISTENT;
+#ifdef NO_ZERO_INTERVALS
+		if (box_upbo[var_nbr]-box_lobo[var_nbr] < MIN_WIDTH)
+			return TCL_TOO_NARROW_STMT;
+#endif
+		}
+	else {
+		/* Intermediate consequence */
+		var_nbr = at2i(alt,tcons);
+		im_box_lobo[var_nbr] = max(im_box_lobo[var_nbr],stmt->lobo);
+		im_box_upbo[var_nbr] = min(im_box_upbo[var_nbr],stmt->upbo);
+		if (im_box_upbo[var_nbr]-im_box_lobo[var_nbr] < 0.0)
+			return TCL_INCONSISTENT;
+#ifdef NO_ZERO_INTERVALS
+		if (im_box_upbo[var_nbr]-im_box_lobo[var_nbr] < MIN_WIDTH)
+			return TCL_TOO_NARROW_STMT;
+#endif
+		}
+	return TCL_OK;
+	}
+
+
+/* The midbox part of stages 2 and 3 for one alternative, from its hull
+ * as it stands. The midbox entries m_free/im_free (0 = none) are left out. */
+
+static rcode load_P_mtail(struct base *P, int alt, int m_free, int im_free) {
+	int j;
+
+	/* Load real (end node) midbox */
+	for (j=alt_inx[alt-1]+1; j<=alt_inx[alt]; j++) {
+		if ((P->lo_midbox[j] >= 0.0) && (j != m_free)) {
+			/* Check midbox consistency */
+			if ((P->lo_midbox[j] < L_hull_lobo[j]-EPS) ||
+					(P->up_midbox[j] > L_hull_upbo[j]+EPS) ||
+					(P->lo_midbox[j] > P->up_midbox[j])) {
+				return TCL_INCONSISTENT;
+				}
+			mbox_lobo[j] = P->lo_midbox[j];
+			mbox_upbo[j] = P->up_midbox[j];
+			}
+		else /* No midbox for this variable, use hull */ {
+			mbox_lobo[j] = L_hull_lobo[j];
+			mbox_upbo[j] = L_hull_upbo[j];
+			}
+		}
+	/* Load intermediate midbox */
+	for (j=im_alt_inx[alt-1]+1; j<=im_alt_inx[alt]; j++) {
+		if ((P->lo_im_midbox[j] >= 0.0) && (j != im_free)) {
+			/* Check midpoint consistency */
+			if ((P->lo_im_midbox[j] < im_L_hull_lobo[j]-EPS) ||
+					(P->up_im_midbox[j] > im_L_hull_upbo[j]+EPS) ||
+					(P->lo_im_midbox[j] > P->up_im_midbox[j])) {
+				return TCL_INCONSISTENT;
+				}
+			im_mbox_lobo[j] = P->lo_im_midbox[j];
+			im_mbox_upbo[j] = P->up_im_midbox[j];
+			}
+		else /* No midbox for this variable, use hull */ {
+			im_mbox_lobo[j] = im_L_hull_lobo[j];
+			im_mbox_upbo[j] = im_L_hull_upbo[j];
+			}
+		}
+
+	/* Calculate tree mhull */
+	if (flat_frame) {
+		if (calc_flat_hull(alt,mbox_lobo,mbox_upbo,L_mhull_lobo,L_mhull_upbo,mhull_lobo,mhull_upbo))
+			return TCL_INCONSISTENT;
+		}
+	else if (calc_tree_mhull(alt,0,1.0,1.0))
+		return TCL_INCONSISTENT;
+
+	/* Stage 3: Mass point distribution (all input is local) */
+
+	/* Distibute mass point */
+	if (flat_frame)
+		flat_mp(alt);
+	else
+		N_DoF_mp(alt,0,1.0);
+	/* Check global normalisation */
+	if (check_norm(alt))
+		return TCL_INCONSISTENT;
+	return TCL_OK;
+	}
+
+
+/* Stages 2 and 3 for one alternative. Uses only the alternative's own
+ * part of the box, so each alternative can be (re)loaded separately.
+ * The midbox entries m_free/im_free (0 = none) are left out. */
+
+static rcode load_P_tail(struct base *P, int alt, int m_free, int im_free) {
+
+	/* Stage 2: Consistency checks and hull formation.
+		 Local input transformed into local (and global) hull. */
+
+	/* Calculate tree hull (flat frames in one pass) */
+	if (flat_frame) {
+		if (calc_flat_hull(alt,box_lobo,box_upbo,L_hull_lobo,L_hull_upbo,hull_lobo,hull_upbo))
+			return TCL_INCONSISTENT;
+		}
+	else if (calc_tree_hull(alt,0,1.0,1.0))
+		return TCL_INCONSISTENT;
+
+	/* Midbox, mhull and mass point */
+	return load_P_mtail(P,alt,m_free,im_free);
+	}
+
+
+static rcode load_P_base(struct d_frame *df) {
+	rcode rc;
+	int i;
 	struct base *P;
 
 	/* Stage 1: Box formation. Local data only. */
@@ -435,6 +785,11 @@ rcode load_P(struct d_frame *df) {
 	if (df->P_base->watermark != P_MARK)
 		return TCL_CORRUPTED;
 	P = df->P_base;
+	use_frame(df);
+	df->ctx->P_ok = FALSE;
+	df->ctx->E_ok = FALSE;
+	cool_moments(df,0);
+	save_alt = 0;
 	if (P->box) {
 		/* User supplied ranges */
 		memcpy(box_lobo,P->box_lobo,(n_vars+1)*sizeof(double));
@@ -453,118 +808,249 @@ rcode load_P(struct d_frame *df) {
 			im_box_upbo[i] = 1.0;
 			}
 		}
-	/* Copy df data into local store */
-	for (i=1; i<=n_alts; i++)
-		for (j=0; j<=df->tot_cons[i]; j++) {
-			tnext[i][j] = df->next[i][j];
-			tprev[i][j] = df->prev[i][j];
-			tdown[i][j] = df->down[i][j];
-			tup[i][j] = df->up[i][j];
-			}
 	/* Check input parameters for each statement */
-	for (i=1; i<=P->n_stmts; i++) {
-		if (P->stmt[i].n_terms != 1)
-			return TCL_INPUT_ERROR;
-		if (P->stmt[i].lobo < 0.0)
-			return TCL_INPUT_ERROR;
-		if (P->stmt[i].upbo < P->stmt[i].lobo)
-			return TCL_INPUT_ERROR;
-		if (P->stmt[i].upbo > 1.0)
-			return TCL_INPUT_ERROR;
-		alt = P->stmt[i].alt[1];
-		tcons = P->stmt[i].cons[1];
-		if ((alt < 1) || (alt > n_alts) || (tcons < 1) || (tcons > df->tot_cons[alt]))
-			return TCL_INPUT_ERROR;
-		if (P->stmt[i].sign[1] != 1)
-			return TCL_INPUT_ERROR;
-		if (t2r[alt][tcons]) {
-			/* Real consequence */
-			var_nbr = at2r(alt,tcons);
-			box_lobo[var_nbr] = max(box_lobo[var_nbr],P->stmt[i].lobo);
-			box_upbo[var_nbr] = min(box_upbo[var_nbr],P->stmt[i].upbo);
-			if (box_upbo[var_nbr]-box_lobo[var_nbr] < 0.0) // -EPS ??
-				return TCL_INCONSISTENT;
-#ifdef NO_ZERO_INTERVALS
-			if (box_upbo[var_nbr]-box_lobo[var_nbr] < MIN_WIDTH)
-				return TCL_TOO_NARROW_STMT;
-#endif
-			}
-		else {
-			/* Intermediate consequence */
-			var_nbr = at2i(alt,tcons);
-			im_box_lobo[var_nbr] = max(im_box_lobo[var_nbr],P->stmt[i].lobo);
-			im_box_upbo[var_nbr] = min(im_box_upbo[var_nbr],P->stmt[i].upbo);
-			if (im_box_upbo[var_nbr]-im_box_lobo[var_nbr] < 0.0)
-				return TCL_INCONSISTENT;
-#ifdef NO_ZERO_INTERVALS
-			if (im_box_upbo[var_nbr]-im_box_lobo[var_nbr] < MIN_WIDTH)
-				return TCL_TOO_NARROW_STMT;
-#endif
-			}
-		}
+	for (i=1; i<=P->n_stmts; i++)
+		if (rc = box_P_stmt(df,P->stmt+i))
+			return rc;
 
-	/* Stage 2: Consistency checks and hull formation.
-		 Local input transformed into local (and global) hull. */
-
-	/* Calculate tree hull for each alternative */
+	/* Stages 2-3 for each alternative */
 	for (i=1; i<=n_alts; i++)
-		if (calc_tree_hull(i,0,1.0,1.0))
+		if (load_P_tail(P,i,0,0))
 			return TCL_INCONSISTENT;
 
-	/* Load midbox */
-	for (i=1; i<=n_alts; i++) {
-		/* Load real (end node) midbox */
-		for (j=alt_inx[i-1]+1; j<=alt_inx[i]; j++) {
-			if (P->lo_midbox[j] >= 0.0) {
-				/* Check midbox consistency */
-				if ((P->lo_midbox[j] < L_hull_lobo[j]-EPS) ||
-						(P->up_midbox[j] > L_hull_upbo[j]+EPS) ||
-						(P->lo_midbox[j] > P->up_midbox[j])) {
-					return TCL_INCONSISTENT;
-					}
-				mbox_lobo[j] = P->lo_midbox[j];
-				mbox_upbo[j] = P->up_midbox[j];
-				}
-			else /* No midbox for this variable, use hull */ {
-				mbox_lobo[j] = L_hull_lobo[j];
-				mbox_upbo[j] = L_hull_upbo[j];
-				}
+	df->ctx->P_ok = TRUE;
+	return TCL_OK;
+	}
+
+
+rcode load_P(struct d_frame *df) {
+	rcode rc;
+	double t0;
+
+	t0 = tcl_clock();
+	rc = load_P_base(df);
+	perf_add(load_P,1);
+	perf_clock(load_P_time,t0);
+	return rc;
+	}
+
+
+ /*********************************************************
+  *
+  *  Incremental reload of one alternative
+  *
+  *********************************************************/
+
+/* A P-statement only involves the subtree of one alternative. If the
+ * context is valid, only that alternative's part of it is recalculated.
+ * The old part is saved first so that a failed reload is undone by a
+ * copy back instead of by another load_P. Returns TCL_OK or an error. */
+
+
+static void copy_P_alt(struct P_state *to, struct P_state *from, int alt) {
+	int r1,rn,i1,in;
+
+	/* Real and intermediate ranges of the alternative */
+	r1 = alt_inx[alt-1]+1;
+	rn = (alt_inx[alt]-alt_inx[alt-1])*sizeof(double);
+	i1 = im_alt_inx[alt-1]+1;
+	in = (im_alt_inx[alt]-im_alt_inx[alt-1])*sizeof(double);
+	memcpy(to->box_lobo+r1,from->box_lobo+r1,rn);
+	memcpy(to->box_upbo+r1,from->box_upbo+r1,rn);
+	memcpy(to->hull_lobo+r1,from->hull_lobo+r1,rn);
+	memcpy(to->hull_upbo+r1,from->hull_upbo+r1,rn);
+	memcpy(to->L_hull_lobo+r1,from->L_hull_lobo+r1,rn);
+	memcpy(to->L_hull_upbo+r1,from->L_hull_upbo+r1,rn);
+	memcpy(to->mass_point+r1,from->mass_point+r1,rn);
+	memcpy(to->L_mass_point+r1,from->L_mass_point+r1,rn);
+	memcpy(to->mbox_lobo+r1,from->mbox_lobo+r1,rn);
+	memcpy(to->mbox_upbo+r1,from->mbox_upbo+r1,rn);
+	memcpy(to->mhull_lobo+r1,from->mhull_lobo+r1,rn);
+	memcpy(to->mhull_upbo+r1,from->mhull_upbo+r1,rn);
+	memcpy(to->L_mhull_lobo+r1,from->L_mhull_lobo+r1,rn);
+	memcpy(to->L_mhull_upbo+r1,from->L_mhull_upbo+r1,rn);
+	if (!in)
+		return;
+	memcpy(to->im_box_lobo+i1,from->im_box_lobo+i1,in);
+	memcpy(to->im_box_upbo+i1,from->im_box_upbo+i1,in);
+	memcpy(to->im_hull_lobo+i1,from->im_hull_lobo+i1,in);
+	memcpy(to->im_hull_upbo+i1,from->im_hull_upbo+i1,in);
+	memcpy(to->im_L_hull_lobo+i1,from->im_L_hull_lobo+i1,in);
+	memcpy(to->im_L_hull_upbo+i1,from->im_L_hull_upbo+i1,in);
+	memcpy(to->im_mass_point+i1,from->im_mass_point+i1,in);
+	memcpy(to->im_L_mass_point+i1,from->im_L_mass_point+i1,in);
+	memcpy(to->im_mbox_lobo+i1,from->im_mbox_lobo+i1,in);
+	memcpy(to->im_mbox_upbo+i1,from->im_mbox_upbo+i1,in);
+	memcpy(to->im_mhull_lobo+i1,from->im_mhull_lobo+i1,in);
+	memcpy(to->im_mhull_upbo+i1,from->im_mhull_upbo+i1,in);
+	memcpy(to->im_L_mhull_lobo+i1,from->im_L_mhull_lobo+i1,in);
+	memcpy(to->im_L_mhull_upbo+i1,from->im_L_mhull_upbo+i1,in);
+	}
+
+
+rcode load_P_alt(struct d_frame *df, int alt) {
+	rcode rc;
+	int i,r1,i1;
+	struct base *P;
+
+	/* Check input parameters */
+	if (df->P_base->watermark != P_MARK)
+		return TCL_CORRUPTED;
+	save_alt = 0;
+	if (!df->ctx || !df->ctx->P_ok || (alt < 1) || (alt > df->n_alts))
+		/* Nothing valid to build on */
+		return load_P(df);
+	P = df->P_base;
+	use_frame(df);
+	/* Save the alternative's part for undo_P_alt */
+	if (!P_save.box_lobo)
+		set_P_rows(&P_save,P_save_rows,MAX_NODES+1);
+	copy_P_alt(&P_save,&(df->ctx->P),alt);
+	save_ctx = df->ctx;
+	save_alt = alt;
+	df->ctx->P_ok = FALSE;
+	df->ctx->E_ok = FALSE;
+	cool_moments(df,alt);
+
+	/* Stage 1: Box formation for this alternative only */
+	r1 = alt_inx[alt-1]+1;
+	i1 = im_alt_inx[alt-1]+1;
+	if (P->box) {
+		/* User supplied ranges */
+		memcpy(box_lobo+r1,P->box_lobo+r1,(alt_inx[alt]-r1+1)*sizeof(double));
+		memcpy(box_upbo+r1,P->box_upbo+r1,(alt_inx[alt]-r1+1)*sizeof(double));
+		memcpy(im_box_lobo+i1,P->im_box_lobo+i1,(im_alt_inx[alt]-i1+1)*sizeof(double));
+		memcpy(im_box_upbo+i1,P->im_box_upbo+i1,(im_alt_inx[alt]-i1+1)*sizeof(double));
+		}
+	else {
+		/* Init ranges to [0.0,1.0] */
+		for (i=r1; i<=alt_inx[alt]; i++) {
+			box_lobo[i] = 0.0;
+			box_upbo[i] = 1.0;
 			}
-		/* Load intermediate midbox */
-		for (j=im_alt_inx[i-1]+1; j<=im_alt_inx[i]; j++) {
-			if (P->lo_im_midbox[j] >= 0.0) {
-				/* Check midpoint consistency */
-				if ((P->lo_im_midbox[j] < im_L_hull_lobo[j]-EPS) ||
-						(P->up_im_midbox[j] > im_L_hull_upbo[j]+EPS) ||
-						(P->lo_im_midbox[j] > P->up_im_midbox[j])) {
-					return TCL_INCONSISTENT;
-					}
-				im_mbox_lobo[j] = P->lo_im_midbox[j];
-				im_mbox_upbo[j] = P->up_im_midbox[j];
-				}
-			else /* No midbox for this variable, use hull */ {
-				im_mbox_lobo[j] = im_L_hull_lobo[j];
-				im_mbox_upbo[j] = im_L_hull_upbo[j];
-				}
+		for (i=i1; i<=im_alt_inx[alt]; i++) {
+			im_box_lobo[i] = 0.0;
+			im_box_upbo[i] = 1.0;
 			}
 		}
+	/* The statements of other alternatives are already checked */
+	for (i=1; i<=P->n_stmts; i++)
+		if (P->stmt[i].alt[1] == alt)
+			if (rc = box_P_stmt(df,P->stmt+i))
+				return rc;
+
+	/* Stages 2-3 */
+	if (load_P_tail(P,alt,0,0))
+		return TCL_INCONSISTENT;
 
-	/* Calculate tree mhull for each alternative */
-	for (i=1; i<=n_alts; i++)
-		if (calc_tree_mhull(i,0,1.0,1.0))
-			return TCL_INCONSISTENT;
+	df->ctx->P_ok = TRUE;
+	return TCL_OK;
+	}
 
-	/* Stage 3: Mass point distribution (all input is local) */
 
-	/* Distibute mass point */
-	for (i=1; i<=n_alts; i++) {
-		N_DoF_mp(i,0,1.0);
-		/* Check global normalisation */
-		if (check_norm(i))
-			return TCL_INCONSISTENT;
+/* Reload after a change of midboxes only, of one alternative or of all
+ * if alt is 0. Boxes and hulls cannot change, so stage 1 and the hull
+ * part of stage 2 are skipped and only the midbox, mhull and mass point
+ * are recalculated. A failed reload of one alternative is undone as for
+ * load_P_alt. */
+
+rcode load_P_mid(struct d_frame *df, int alt) {
+	int i,first,last;
+	struct base *P;
+
+	/* Check input parameters */
+	if (df->P_base->watermark != P_MARK)
+		return TCL_CORRUPTED;
+	save_alt = 0;
+	if (!df->ctx || !df->ctx->P_ok || (alt < 0) || (alt > df->n_alts))
+		/* Nothing valid to build on */
+		return load_P(df);
+	P = df->P_base;
+	use_frame(df);
+	if (alt) {
+		/* Save the alternative's part for undo_P_alt */
+		if (!P_save.box_lobo)
+			set_P_rows(&P_save,P_save_rows,MAX_NODES+1);
+		copy_P_alt(&P_save,&(df->ctx->P),alt);
+		save_ctx = df->ctx;
+		save_alt = alt;
 		}
+	df->ctx->P_ok = FALSE;
+	df->ctx->E_ok = FALSE;
+	cool_moments(df,alt);
+
+	/* Midbox part of stages 2-3 */
+	first = alt ? alt : 1;
+	last = alt ? alt : n_alts;
+	for (i=first; i<=last; i++)
+		if (load_P_mtail(P,i,0,0))
+			return TCL_INCONSISTENT;
 
-	return TCL_OK;
+	df->ctx->P_ok = TRUE;
+	return TCL_OK;
+	}
+
+
+/* Undo a failed load_P_alt or load_P_mid. The base must first be
+ * restored by the caller to what it was before the call. Returns FALSE
+ * if there was no saved part to go back to, then a full load_P is
+ * required. */
+
+bool undo_P_alt(struct d_frame *df, int alt) {
+
+	if (!save_alt || (save_alt != alt) || (save_ctx != df->ctx))
+		return FALSE;
+	use_frame(df);
+	copy_P_alt(&(df->ctx->P),&P_save,alt);
+	save_alt = 0;
+	df->ctx->P_ok = TRUE;
+	cool_moments(df,alt);
+	return TRUE;
+	}
+
+
+ /*********************************************************
+  *
+  *  What-if probe of one alternative
+  *
+  *********************************************************/
+
+/* Mass point of an alternative as if stmt had been added to the base,
+ * and with the node's midbox left out if free_mid. The alternative is
+ * recalculated in a scratch state, the base and context are only read
+ * from. Delivers the alternative's part of the internal (B2) mass point
+ * in masspt. Returns TCL_OK or the error that load_P_alt would give. */
+
+rcode probe_P(struct d_frame *df, struct stmt_rec *stmt, bool free_mid, d_row masspt) {
+	rcode rc;
+	int j,alt,m_free,im_free;
+
+	alt = stmt->alt[1];
+	if ((alt < 1) || (alt > n_alts))
+		return TCL_INPUT_ERROR;
+	/* Copy the alternative's part of the context */
+	if (!P_probe.box_lobo)
+		set_P_rows(&P_probe,P_probe_rows,MAX_NODES+1);
+	copy_P_alt(&P_probe,&(df->ctx->P),alt);
+	bind_P_state(&P_probe);
+	/* The box already holds the base statements, add the probe */
+	m_free = im_free = 0;
+	if (!(rc = box_P_stmt(df,stmt))) {
+		if (free_mid) {
+			if (t2r[alt][stmt->cons[1]])
+				m_free = at2r(alt,stmt->cons[1]);
+			else
+				im_free = at2i(alt,stmt->cons[1]);
+			}
+		if (load_P_tail(df->P_base,alt,m_free,im_free))
+			rc = TCL_INCONSISTENT;
+		else
+			for (j=alt_inx[alt-1]+1; j<=alt_inx[alt]; j++)
+				masspt[j] = mass_point[j];
+		}
+	/* Back to the context */
+	bind_P_state(&(df->ctx->P));
+	return rc;
 	}
 
 
@@ -48,6 +48,7 @@
  *   ------------------------------
  *   TCL_reset_P_base
  *   TCL_add_P_constraint
+ *   TCL_add_P_constraints
  *   TCL_replace_P_constraint
  *   TCL_change_P_constraint
  *   TCL_delete_P_constraint
@@ -68,11 +69,23 @@
  *
  *   Functions internal to module
  *   ----------------------------
- *   NONE
+ *   restore_P
  *
  */
 
 #include "TCLinternal.h"
+
+
+/* Restore the loaded state after a failed reload. The base itself must
+ * already be restored. Detaches the frame if that cannot be done. */
+
+static void restore_P(struct d_frame *df, int alt) {
+
+	if (!undo_P_alt(df,alt))
+		if (load_P(df))
+			df->attached = FALSE;
+	}
+
 
 rcode TCL_reset_P_base(struct d_frame *df) {
 	rcode rc;
@@ -84,6 +97,9 @@ rcode TCL_reset_P_base(struct d_frame *df) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 
 	/* Remove constraint set from base */
@@ -101,6 +117,7 @@ rcode TCL_reset_P_base(struct d_frame *df) {
 			P->up_im_midbox[f2i[i]] = -1.0;
 			}
 
+	cool_P(df);
 	rc = TCL_OK;
 	if (df->attached) {
 		rc = load_P(df);
@@ -116,7 +133,7 @@ rcode TCL_reset_P_base(struct d_frame *df) {
   *********************************************************/
 
 rcode TCL_add_P_constraint(struct d_frame *df, struct stmt_rec *P_stmt) {
-	rcode rc,rc2;
+	rcode rc;
 	struct base *P;
 
 	/* Check input parameters */
@@ -124,9 +141,11 @@ rcode TCL_add_P_constraint(struct d_frame *df, struct stmt_rec *P_stmt) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
-	if (P->n_stmts >= MAX_STMTS)
-		return TCL_TOO_MANY_STMTS;
+	if (rc = grow_P(P,P->n_stmts+1))
+		return rc;
 
 	/* Add the constraint last to the base */
 	P->n_stmts++;
@@ -134,22 +153,72 @@ rcode TCL_add_P_constraint(struct d_frame *df, struct stmt_rec *P_stmt) {
 
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to load new base */
-		rc = load_P(df);
+		/* Try to load new base (only the alternative is affected) */
+		rc = load_P_alt(df,P_stmt->alt[1]);
 		if (rc) {
 			/* Failed to load, inconsistent */
 			P->n_stmts--;
-			rc2 = load_P(df);
-			if (rc2)
-				df->attached = FALSE;
+			restore_P(df,P_stmt->alt[1]);
+			}
+		}
+	else
+		cool_P(df);
+	return rc;
+	}
+
+
+/* Add P_stmts[1..n_stmts] as one transaction: the base is loaded once
+ * and if it is inconsistent then none of the constraints are added. */
+
+rcode TCL_add_P_constraints(struct d_frame *df, int n_stmts, struct stmt_rec P_stmts[]) {
+	rcode rc;
+	int i,alt;
+	struct base *P;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (n_stmts < 0)
+		return TCL_INPUT_ERROR;
+	if (rc = own_base(df,FALSE))
+		return rc;
+	P = df->P_base;
+	if (rc = grow_P(P,P->n_stmts+n_stmts))
+		return rc;
+	if (!n_stmts)
+		return TCL_OK;
+
+	/* Add the constraints last to the base */
+	memcpy(&(P->stmt[P->n_stmts+1]),&(P_stmts[1]),n_stmts*sizeof(struct stmt_rec));
+	P->n_stmts += n_stmts;
+	/* Same alternative throughout -> incremental load */
+	alt = P_stmts[1].alt[1];
+	for (i=2; i<=n_stmts; i++)
+		if (P_stmts[i].alt[1] != alt) {
+			alt = 0;
+			break;
+			}
+
+	rc = TCL_OK;
+	if (df->attached) {
+		/* Try to load new base */
+		rc = alt?load_P_alt(df,alt):load_P(df);
+		if (rc) {
+			/* Failed to load, inconsistent */
+			P->n_stmts -= n_stmts;
+			restore_P(df,alt);
 			}
 		}
+	else
+		cool_P(df);
 	return rc;
 	}
 
 
 rcode TCL_replace_P_constraint(struct d_frame *df, int stmt_nbr, struct stmt_rec *P_stmt) {
-	rcode rc,rc2;
+	rcode rc;
 	struct stmt_rec tmp;
 	struct base *P;
 
@@ -160,6 +229,9 @@ rcode TCL_replace_P_constraint(struct d_frame *df, int stmt_nbr, struct stmt_rec
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 	if ((stmt_nbr < 1) || (stmt_nbr > P->n_stmts))
 		return TCL_INPUT_ERROR;
@@ -171,20 +243,22 @@ rcode TCL_replace_P_constraint(struct d_frame *df, int stmt_nbr, struct stmt_rec
 	memcpy(&(P->stmt[stmt_nbr]),P_stmt,sizeof(struct stmt_rec));
 
 	/* Try to load new base */
-	rc = load_P(df);
+	if (tmp.alt[1] == P_stmt->alt[1])
+		/* Same alternative, the others are not affected */
+		rc = load_P_alt(df,tmp.alt[1]);
+	else
+		rc = load_P(df);
 	if (rc) {
 		/* Failed to load, inconsistent */
 		memcpy(&(P->stmt[stmt_nbr]),&tmp,sizeof(struct stmt_rec));
-		rc2 = load_P(df);
-		if (rc2)
-			df->attached = FALSE;
+		restore_P(df,tmp.alt[1]);
 		}
 	return rc;
 	}
 
 
 rcode TCL_change_P_constraint(struct d_frame *df, int stmt_nbr, double lobo, double upbo) {
-	rcode rc,rc2;
+	rcode rc;
 	struct stmt_rec tmp;
 	struct base *P;
 
@@ -195,6 +269,9 @@ rcode TCL_change_P_constraint(struct d_frame *df, int stmt_nbr, double lobo, dou
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 	if ((stmt_nbr < 1) || (stmt_nbr > P->n_stmts))
 		return TCL_INPUT_ERROR;
@@ -205,22 +282,19 @@ rcode TCL_change_P_constraint(struct d_frame *df, int stmt_nbr, double lobo, dou
 	P->stmt[stmt_nbr].lobo = lobo;
 	P->stmt[stmt_nbr].upbo = upbo;
 
-	/* Try to load new base */
-	rc = load_P(df);
+	/* Try to load new base (only the alternative is affected) */
+	rc = load_P_alt(df,tmp.alt[1]);
 	if (rc) {
 		/* Failed to load, inconsistent */
 		memcpy(&(P->stmt[stmt_nbr]),&tmp,sizeof(struct stmt_rec));
-		rc2 = load_P(df);
-		if (rc2)
-			df->attached = FALSE;
+		restore_P(df,tmp.alt[1]);
 		}
 	return rc;
 	}
 
 
 rcode TCL_delete_P_constraint(struct d_frame *df, int stmt_nbr) {
-	rcode rc,rc2;
-	int i;
+	rcode rc;
 	struct stmt_rec tmp;
 	struct base *P;
 
@@ -230,38 +304,38 @@ rcode TCL_delete_P_constraint(struct d_frame *df, int stmt_nbr) {
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
 
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 	if ((stmt_nbr < 1) || (stmt_nbr > P->n_stmts))
 		return TCL_INPUT_ERROR;
 
 	/* Move constraints up */
 	memcpy(&tmp,&(P->stmt[stmt_nbr]),sizeof(struct stmt_rec));
-	for (i=stmt_nbr; i<P->n_stmts; i++)
-		memcpy(&(P->stmt[i]),&(P->stmt[i+1]),sizeof(struct stmt_rec));
+	memmove(&(P->stmt[stmt_nbr]),&(P->stmt[stmt_nbr+1]),(P->n_stmts-stmt_nbr)*sizeof(struct stmt_rec));
 	P->n_stmts--;
 
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to attach new base */
-		rc = load_P(df);
+		/* Try to attach new base (only the alternative is affected) */
+		rc = load_P_alt(df,tmp.alt[1]);
 		if (rc) {
 			/* Failed to load, inconsistent -> restore */
-			for (i=P->n_stmts; i>=stmt_nbr; i--)
-				memcpy(&(P->stmt[i+1]),&(P->stmt[i]),sizeof(struct stmt_rec));
+			memmove(&(P->stmt[stmt_nbr+1]),&(P->stmt[stmt_nbr]),(P->n_stmts-stmt_nbr+1)*sizeof(struct stmt_rec));
 			memcpy(&(P->stmt[stmt_nbr]),&tmp,sizeof(struct stmt_rec));
 			P->n_stmts++;
-			rc2 = load_P(df);
-			if (rc2)
-				df->attached = FALSE;
+			restore_P(df,tmp.alt[1]);
 			}
 		}
+	else
+		cool_P(df);
 
 	return rc;
 	}
 
 
 rcode TCL_add_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
-	rcode rc,rc2;
+	rcode rc;
 	int index;
 	struct base *P;
 	double save_lo, save_up;
@@ -271,6 +345,9 @@ rcode TCL_add_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 
 	if ((P_stmt->lobo < 0.0) || (P_stmt->lobo > 1.0) || 
@@ -295,10 +372,11 @@ rcode TCL_add_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
 		P->up_midbox[index] = P_stmt->upbo;
 		}
 
+	cool_P(df);
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to load new base */
-		rc = load_P(df);
+		/* Try to load new base, only the midbox changed */
+		rc = load_P_mid(df,P_stmt->alt[1]);
 		if (rc) {
 			/* Failed to load <- inconsistent */
 			if (df->down[P_stmt->alt[1]][P_stmt->cons[1]]) {
@@ -311,9 +389,7 @@ rcode TCL_add_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
 				P->lo_midbox[index] = save_lo;
 				P->up_midbox[index] = save_up;
 				}
-			rc2 = load_P(df);
-			if (rc2)
-				df->attached = FALSE;
+			restore_P(df,P_stmt->alt[1]);
 			}
 		}
 	return rc;
@@ -321,7 +397,7 @@ rcode TCL_add_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
 
 
 rcode TCL_delete_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
-	rcode rc,rc2;
+	rcode rc;
 	int index;
 	struct base *P;
 	double save_lo, save_up;
@@ -331,6 +407,9 @@ rcode TCL_delete_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 
 	if (df->down[P_stmt->alt[1]][P_stmt->cons[1]])	{
@@ -354,10 +433,11 @@ rcode TCL_delete_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
 		P->up_midbox[index] = -1.0;
 		}
 
+	cool_P(df);
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to load new base */
-		rc = load_P(df);
+		/* Try to load new base, only the midbox changed */
+		rc = load_P_mid(df,P_stmt->alt[1]);
 		if (rc) {
 			/* Failed to load, inconsistent */
 			if (df->down[P_stmt->alt[1]][P_stmt->cons[1]]) {
@@ -370,9 +450,7 @@ rcode TCL_delete_P_mstatement(struct d_frame *df, struct stmt_rec *P_stmt) {
 				P->lo_midbox[index] = save_lo;
 				P->up_midbox[index] = save_up;
 				}
-			rc2 = load_P(df);
-			if (rc2)
-				df->attached = FALSE;
+			restore_P(df,P_stmt->alt[1]);
 			}
 		}
 	return rc;
@@ -395,12 +473,15 @@ int TCL_set_P_box(struct d_frame *df, d_row tbox_lobo, d_row tbox_upbo) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
 	for (i=1; i<=tot_vars; i++)
 		if ((tbox_lobo[i] < 0.0) || (tbox_lobo[i] > 1.0) || 
 				(tbox_upbo[i] < 0.0) || (tbox_upbo[i] > 1.0))
 			return TCL_INPUT_ERROR;
 
 	/* Split and add the box to the base */
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 	for (i=1; i<=tot_vars; i++)
 		if (f2r[i])	{
@@ -413,6 +494,7 @@ int TCL_set_P_box(struct d_frame *df, d_row tbox_lobo, d_row tbox_upbo) {
 			}
 	P->box = TRUE;
 
+	cool_P(df);
 	rc = TCL_OK;
 	if (df->attached) {
 		/* Try to load new base */
@@ -438,12 +520,15 @@ rcode TCL_unset_P_box(struct d_frame *df) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 	if (!P->box)
 		return TCL_OK;
 
 	/* Remove the intervals from the base */
 	P->box = FALSE;
+	cool_P(df);
 	rc = TCL_OK;
 	if (df->attached) {
 		/* Try to load original base */
@@ -456,7 +541,7 @@ rcode TCL_unset_P_box(struct d_frame *df) {
 	}
 
 
-static d_row save_lobo,save_upbo;
+static TCL_TLS d_row save_lobo,save_upbo;
 
 rcode TCL_set_P_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 	rcode rc,rc2;
@@ -468,6 +553,7 @@ rcode TCL_set_P_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
 	for (i=1; i<=tot_vars; i++)
 			/* Check within range [0,1], empty (-1) or unoccupied (-2) */
 		if (((tmbox_lobo[i] < 0.0) || (tmbox_lobo[i] > 1.0) || 
@@ -475,6 +561,8 @@ rcode TCL_set_P_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 				(tmbox_lobo[i] != -1.0) && (tmbox_lobo[i] != -2.0))
 			return TCL_INPUT_ERROR;
 
+	if (rc = own_base(df,FALSE))
+		return rc;
 	P = df->P_base;
 
 	/* Split and add the box to the base */
@@ -496,10 +584,11 @@ rcode TCL_set_P_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 				}
 			}
 
+	cool_P(df);
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to load new base */
-		rc = load_P(df);
+		/* Try to load new base, only the midboxes changed */
+		rc = load_P_mid(df,0);
 		if (rc) {
 			/* Failed to load, inconsistent */
 			for (i=1; i<=tot_vars; i++)
@@ -537,6 +626,7 @@ rcode TCL_get_P_box(struct d_frame *df, d_row lo_box, d_row up_box) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
 	/* If box=TRUE  then return combined stmt + box */
 	/* If box=FALSE then return [0,1] i.e. w/o stmts */
@@ -573,6 +663,7 @@ rcode TCL_get_P_mbox(struct d_frame *df, d_row lo_mid, d_row up_mid) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
 	P = df->P_base;
 	for (i=1; i<=df->tot_cons[0]; i++)
@@ -595,6 +686,7 @@ int TCL_get_P_index(struct d_frame *df, int alt, int node) {
 		return 0;
 	if (df->watermark != D_MARK)
 		return 0;
+	use_frame(df);
 	/* Return B2 index */
 	return get_P_index(alt,node);
 	}
@@ -611,6 +703,7 @@ rcode TCL_get_P_hull(struct d_frame *df, d_row hlobo, d_row hupbo, d_row llobo,
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 	/* Return orthogonal hull */
 	hull_P(hlobo,hupbo);
 	l_hull_P(llobo,lupbo);
@@ -629,6 +722,7 @@ rcode TCL_get_P_masspoint(struct d_frame *df, d_row P_mid, d_row P_lmid) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
 	cpoint_P(P_mid);
 	l_cpoint_P(P_lmid);
@@ -0,0 +1,375 @@
+/*
+ *
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/ 
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/  
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/          
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/          
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/   
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ *
+ *
+ *                     UNEDA Tree Core Layer (TCL)
+ *                     --------------------------- 
+ *
+ *    +----- o o o -----------------------------------------------+
+ *    |    o       o             Prof. Mats Danielson             |
+ *    |   o  STHLM  o            DECIDE Research Group            |
+ *    |   o         o   Dept. of Computer and Systems Sciences    |
+ *    |   o   UNI   o            Stockholm University             |
+ *    |    o       o     PO Box 1203, SE-164 25 Kista, SWEDEN     |
+ *    +----- o o o -----------------------------------------------+
+ *
+ *                Copyright (c) 2012-2025 Mats Danielson
+ *                     Email: mats.danielson@su.se
+ *
+ */
+
+/*
+ *   File: TCLsample.c
+ *
+ *   Purpose: draw Monte Carlo samples of alternative values from
+ *            the same per-node distributions as the NEMO calculus
+ *
+ *   P-nodes under a parent are drawn jointly from a bounded Dirichlet
+ *   (concentration lambda as in calc_nemo_tree, means at the local
+ *   centre point), rejecting draws outside the local hull. V-nodes are
+ *   drawn from the triangular distribution of calc_nemo_Vnode.
+ *
+ *   Included from TCLmoments.c, shares its local data areas.
+ *
+ *
+ *   Functions exported outside TCL
+ *   ------------------------------
+ *   TCL_sample_seed
+ *   TCL_sample_td
+ *   TCL_get_EV_samples
+ *   TCL_get_W_samples
+ *
+ *   Functions outside module, inside TCL
+ *   ------------------------------------
+ *   NONE
+ *
+ *   Functions internal to module
+ *   ----------------------------
+ *   xrand
+ *   urand
+ *   nrand
+ *   grand
+ *   draw_P_group
+ *   draw_tree
+ *   draw_W_tree
+ *
+ */
+
+
+ /*********************************************************
+  *
+  *  Random generators
+  *
+  *  xorshift128 (Marsaglia 2003) on 32-bit words, one state
+  *  per thread so that workers can draw in parallel. An
+  *  unsigned long is at least 32 bits, mask for 64-bit.
+  *
+  *********************************************************/
+
+#define RND_MASK 0xFFFFFFFFUL
+#define MAX_P_TRIES 64 // rejections before falling back to the centre point
+
+static TCL_TLS unsigned long rnd_x = 123456789UL;
+static TCL_TLS unsigned long rnd_y = 362436069UL;
+static TCL_TLS unsigned long rnd_z = 521288629UL;
+static TCL_TLS unsigned long rnd_w = 88675123UL;
+
+
+static unsigned long xrand() {
+	unsigned long t;
+
+	t = (rnd_x^(rnd_x<<11)) & RND_MASK;
+	rnd_x = rnd_y;
+	rnd_y = rnd_z;
+	rnd_z = rnd_w;
+	rnd_w = (rnd_w^(rnd_w>>19)^(t^(t>>8))) & RND_MASK;
+	return rnd_w;
+	}
+
+
+void TCL_sample_seed(unsigned long seed) {
+	int i;
+
+	/* Spread the seed over the state by an LCG, state must not be all zero */
+	seed &= RND_MASK;
+	rnd_x = seed = (69069UL*seed+1UL) & RND_MASK;
+	rnd_y = seed = (69069UL*seed+1UL) & RND_MASK;
+	rnd_z = seed = (69069UL*seed+1UL) & RND_MASK;
+	rnd_w = seed = (69069UL*seed+1UL) & RND_MASK;
+	if (!(rnd_x|rnd_y|rnd_z|rnd_w))
+		rnd_w = 88675123UL;
+	/* Warm up */
+	for (i=0; i<16; i++)
+		xrand();
+	}
+
+
+/* Uniform (0,1), never exactly 0 or 1 */
+
+static double urand() {
+
+	return ((double)xrand()+0.5)/4294967296.0;
+	}
+
+
+/* Standard normal by the polar method */
+
+static double nrand() {
+	double u,v,s;
+
+	do {
+		u = 2.0*urand()-1.0;
+		v = 2.0*urand()-1.0;
+		s = u*u+v*v;
+		} while ((s >= 1.0) || (s == 0.0));
+	return u*sqrt(-2.0*log(s)/s);
+	}
+
+
+/* Gamma(a,1) by Marsaglia-Tsang, boosted for a < 1 */
+
+static double grand(double a) {
+	double d,c,x,v,u;
+
+	if (a < 1.0)
+		return grand(a+1.0)*pow(urand(),1.0/a);
+	d = a-1.0/3.0;
+	c = 1.0/sqrt(9.0*d);
+	for (;;) {
+		do {
+			x = nrand();
+			v = 1.0+c*x;
+			} while (v <= 0.0);
+		v = v*v*v;
+		u = urand();
+		if (u < 1.0-0.0331*x*x*x*x)
+			return d*v;
+		if (log(u) < 0.5*x*x+d*(1.0-v+log(v)))
+			return d*v;
+		}
+	}
+
+
+/* Triangular distribution on [lobo,upbo] with mode top */
+
+double TCL_sample_td(double lobo, double top, double upbo) {
+	double t,u;
+
+	t = upbo-lobo;
+	if (t < EPS)
+		return (lobo+upbo)/2.0;
+	top = min(max(top,lobo),upbo);
+	u = urand();
+	if (u*t < top-lobo)
+		return lobo+sqrt(u*t*(top-lobo));
+	else
+		return upbo-sqrt((1.0-u)*t*(upbo-top));
+	}
+
+
+ /*********************************************************
+  *
+  *  Draw one tree sample, node by node
+  *
+  *********************************************************/
+
+static TCL_TLS d_row P_draw,sub_val;
+
+/* Draw the local probabilities of the children k_start..k_end-1 of a node
+ * into P_draw. The mean of each child is its local centre point. */
+
+static void draw_P_group(int alt, int k_start, int k_end) {
+	int k,inx,tries;
+	double lambda,lobo_s,free,g,g_sum;
+	bool ok;
+
+	lambda = lobo_s = 0.0;
+	for (k=k_start; k<k_end; k++) {
+		inx = at2f(alt,kid_node[alt][k]);
+		lambda += P_upbo[inx]-P_lobo[inx];
+		lobo_s += P_lobo[inx];
+		}
+	free = 1.0-lobo_s;
+	if ((free < EPS) || (lambda < EPS)) {
+		/* No free mass, a point */
+		for (k=k_start; k<k_end; k++) {
+			inx = at2f(alt,kid_node[alt][k]);
+			P_draw[inx] = P_mid[inx];
+			}
+		return;
+		}
+	lambda /= free;
+	for (tries=0; tries<MAX_P_TRIES; tries++) {
+		g_sum = 0.0;
+		for (k=k_start; k<k_end; k++) {
+			inx = at2f(alt,kid_node[alt][k]);
+			g = lambda*(P_mid[inx]-P_lobo[inx])/free;
+			P_draw[inx] = g>EPS ? grand(g) : 0.0;
+			g_sum += P_draw[inx];
+			}
+		if (g_sum <= 0.0)
+			continue;
+		ok = TRUE;
+		for (k=k_start; k<k_end; k++) {
+			inx = at2f(alt,kid_node[alt][k]);
+			P_draw[inx] = P_lobo[inx]+free*P_draw[inx]/g_sum;
+			if (P_draw[inx] > P_upbo[inx]+EPS)
+				ok = FALSE;
+			}
+		if (ok)
+			return;
+		}
+	/* Hull too tight for rejection, use the centre point */
+	for (k=k_start; k<k_end; k++) {
+		inx = at2f(alt,kid_node[alt][k]);
+		P_draw[inx] = P_mid[inx];
+		}
+	}
+
+
+/* Bottom-up sweep as in calc_nemo_tree, drawing instead of summing moments */
+
+static double draw_tree(struct d_frame *df, int alt) {
+	int tnode,k,k_start,k_end,inx;
+	double val,v;
+
+	val = 0.0;
+	for (tnode=df->tot_cons[alt]; tnode>=0; tnode--) {
+		k_start = kid_lo[alt][tnode];
+		k_end = kid_hi[alt][tnode];
+		if (k_start == k_end)
+			/* Re-node */
+			continue;
+		draw_P_group(alt,k_start,k_end);
+		val = 0.0;
+		for (k=k_start; k<k_end; k++) {
+			inx = at2f(alt,kid_node[alt][k]);
+			if (df->down[alt][kid_node[alt][k]])
+				/* Im-node, level below already drawn */
+				v = sub_val[inx];
+			else
+				/* Re-node, same triangle as calc_nemo_Vnode */
+				v = TCL_sample_td(V_lobo[inx],3.0*Vnode_mean(V_lobo[inx],V_mid[inx],V_upbo[inx])
+						-V_lobo[inx]-V_upbo[inx],V_upbo[inx]);
+			val += P_draw[inx]*v;
+			}
+		if (tnode)
+			/* Keep for the parent level */
+			sub_val[at2f(alt,tnode)] = val;
+		}
+	return val;
+	}
+
+
+/* Draw n_samples of the linear combination sum(coeff[Ai]*EV(Ai)). Draws are
+ * independent between alternatives, as in the moment calculus. */
+
+rcode TCL_get_EV_samples(struct d_frame *df, int n_samples, a_row coeff, double sample[]) {
+	int s,Ai;
+	double val;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	if (n_samples < 1)
+		return TCL_INPUT_ERROR;
+	use_frame(df);
+
+	/* Pick up start vectors */
+	l_hull_P(P_lobo,P_upbo);
+	l_cpoint_P(P_mid);
+	hull_V(V_lobo,V_upbo);
+	cpoint_V(V_mid);
+	/* Draw */
+	for (s=0; s<n_samples; s++) {
+		val = 0.0;
+		for (Ai=1; Ai<=df->n_alts; Ai++)
+			if (coeff[Ai] != 0.0)
+				val += coeff[Ai]*draw_tree(df,Ai);
+		sample[s] = val;
+		}
+	return TCL_OK;
+	}
+
+
+/* Top-down through the MC tree: the product of the drawn
+ * local weights along the path ends up at each criterion */
+
+static void draw_W_tree(struct d_frame *df, int snode, double path, int stride, double w_row[]) {
+	int k,k_start,k_end,tnode,inx,inxr;
+
+	k_start = kid_lo[1][snode];
+	k_end = kid_hi[1][snode];
+	draw_P_group(1,k_start,k_end);
+	for (k=k_start; k<k_end; k++) {
+		tnode = kid_node[1][k];
+		inx = at2f(1,tnode);
+		if (df->down[1][tnode])
+			/* Im-node */
+			draw_W_tree(df,tnode,path*P_draw[inx],stride,w_row);
+		else {
+			/* Re-node = criterion */
+			inxr = at2r(1,tnode);
+			if (inxr < stride)
+				w_row[inxr] = path*P_draw[inx];
+			}
+		}
+	}
+
+
+/* Draw n_samples weight vectors below snode, sample s in
+ * sample[s*stride..s*stride+stride-1] indexed by criterion */
+
+rcode TCL_get_W_samples(struct d_frame *df, int snode, int n_samples, int stride, double sample[]) {
+	int s,i;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	if ((n_samples < 1) || (stride < 2))
+		return TCL_INPUT_ERROR;
+	if ((snode < 0) || (snode > df->tot_cons[1]))
+		return TCL_INPUT_ERROR;
+	if (snode && !df->down[1][snode])
+		return TCL_INPUT_ERROR;
+	use_frame(df);
+
+	/* Pick up start vectors only for W */
+	l_hull_P(P_lobo,P_upbo);
+	l_cpoint_P(P_mid);
+	/* Draw */
+	for (s=0; s<n_samples; s++) {
+		for (i=0; i<stride; i++)
+			sample[s*stride+i] = 0.0;
+		draw_W_tree(df,snode,1.0,stride,sample+s*stride);
+		}
+	return TCL_OK;
+	}
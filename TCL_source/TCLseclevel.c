@@ -47,6 +47,7 @@
  *   Functions exported outside TCL
  *   ------------------------------
  *   TCL_security_level
+ *   TCL_security_sweep
  *
  *   Functions outside module, inside TCL
  *   ------------------------------------
@@ -54,15 +55,15 @@
  *
  *   Functions internal to module
  *   ----------------------------
- *   NONE
+ *   grow_ixset
  *
  */
 
 
 #include "TCLinternal.h"
 
-static d_row P_lobo,P_upbo,V_lobo,V_upbo;
-static i_row strong_ixset,marked_ixset,weak_ixset;
+static TCL_TLS d_row P_lobo,P_upbo,V_lobo,V_upbo;
+static TCL_TLS i_row strong_ixset,marked_ixset,weak_ixset;
 
 rcode TCL_security_level(struct d_frame *df, double sec_level, 
 					a_vector strong, a_vector marked, a_vector weak) {
@@ -75,6 +76,7 @@ rcode TCL_security_level(struct d_frame *df, double sec_level,
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 	if ((sec_level < 0.0) || (sec_level > 1.0))
 		return TCL_INPUT_ERROR;
 
@@ -109,3 +111,104 @@ rcode TCL_security_level(struct d_frame *df, double sec_level,
 		}
 	return TCL_OK;
 	}
+
+
+ /*********************************************************
+  *
+  *  Security level sweep
+  *
+  *  Evaluates an ascending sequence of thresholds in one go.
+  *  The index sets only grow with the threshold, so the V
+  *  bounds of each alternative are sorted once and the sets
+  *  are extended between consecutive levels. The P hulls are
+  *  only recalculated for sets that did change.
+  *
+  *********************************************************/
+
+static TCL_TLS d_row V_mid;
+static TCL_TLS i_row strong_order,marked_order,weak_order;
+
+/* Add the nodes with keys below the level to the index set,
+ * next is the first position in order not yet in the set */
+
+static bool grow_ixset(i_row ixset, i_row order, d_row key, int *next, int stop, double sec_level) {
+	bool grown;
+
+	grown = FALSE;
+	while ((*next <= stop) && (key[order[*next]] < sec_level-EPS)) {
+		ixset[order[*next]] = TRUE;
+		(*next)++;
+		grown = TRUE;
+		}
+	return grown;
+	}
+
+
+rcode TCL_security_sweep(struct d_frame *df, int n_levels, double sec_level[], 
+					a_vector strong[], a_vector marked[], a_vector weak[]) {
+	int Ai,Ai_begin,Ai_end,i,k;
+	int strong_next,marked_next,weak_next;
+	double P_strong=0.0,P_marked=0.0,P_weak=0.0;
+
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (!df->attached)
+		return TCL_DETACHED;
+	use_frame(df);
+	if (n_levels < 1)
+		return TCL_INPUT_ERROR;
+	/* Levels must be within [0,1] and in ascending order */
+	for (k=1; k<=n_levels; k++) {
+		if ((sec_level[k] < 0.0) || (sec_level[k] > 1.0))
+			return TCL_INPUT_ERROR;
+		if ((k > 1) && (sec_level[k] < sec_level[k-1]))
+			return TCL_INPUT_ERROR;
+		}
+
+	hull_V(V_lobo,V_upbo);
+	for (Ai=1; Ai<=df->n_alts; Ai++) {
+		Ai_begin = get_V_start(Ai);
+		Ai_end = get_V_end(Ai);
+		/* Sort the thresholds of the cons once per alternative */
+		for (i=Ai_begin; i<=Ai_end; i++) {
+			V_mid[i] = (V_upbo[i]+V_lobo[i])/2.0;
+			strong_ixset[i] = FALSE;
+			marked_ixset[i] = FALSE;
+			weak_ixset[i] = FALSE;
+			strong_order[i] = i;
+			marked_order[i] = i;
+			weak_order[i] = i;
+			}
+		sort_dom2(strong_order,V_upbo,Ai_begin,Ai_end,FALSE);
+		sort_dom2(marked_order,V_mid,Ai_begin,Ai_end,FALSE);
+		sort_dom2(weak_order,V_lobo,Ai_begin,Ai_end,FALSE);
+		strong_next = Ai_begin;
+		marked_next = Ai_begin;
+		weak_next = Ai_begin;
+		for (k=1; k<=n_levels; k++) {
+			/* Same measures as in TCL_security_level, but only
+			 * for index sets that have grown since the last level */
+			if (grow_ixset(strong_ixset,strong_order,V_upbo,&strong_next,Ai_end,sec_level[k]) || (k == 1)) {
+				P_strong = ixset_P_min(Ai,0,strong_ixset);
+				if (P_strong < -EPS)
+					return TCL_INCONSISTENT;
+				}
+			if (grow_ixset(marked_ixset,marked_order,V_mid,&marked_next,Ai_end,sec_level[k]) || (k == 1)) {
+				P_marked  = ixset_P_min(Ai,0,marked_ixset);
+				P_marked += ixset_P_max(Ai,0,marked_ixset);
+				P_marked /= 2.0;
+				}
+			if (grow_ixset(weak_ixset,weak_order,V_lobo,&weak_next,Ai_end,sec_level[k]) || (k == 1)) {
+				P_weak = ixset_P_max(Ai,0,weak_ixset);
+				if (P_weak < -EPS)
+					return TCL_INCONSISTENT;
+				}
+			strong[k][Ai] = P_strong;
+			marked[k][Ai] = P_marked;
+			weak[k][Ai] = P_weak;
+			}
+		}
+	return TCL_OK;
+	}
@@ -50,9 +50,17 @@
  *
  *   Functions outside module, inside TCL
  *   ------------------------------------
+ *   bind_V
+ *   set_V_rows
+ *   set_V_base_rows
  *   create_V
  *   dispose_V
  *   load_V
+ *   grow_V
+ *   add_V
+ *   touch_V
+ *   free_V_index
+ *   mid_V
  *   get_V_start
  *   get_V_end
  *   get_V_index
@@ -60,10 +68,22 @@
  *   fhull_V
  *   cpoint_V
  *   mpoint_V
+ *   probe_V
+ *   stmt_V
+ *   box_V
  *
  *   Functions internal to module
  *   ----------------------------
  *   calc_V_hull
+ *   calc_V_node
+ *   cool_V_alts
+ *   load_V_base
+ *   check_V_stmt
+ *   narrow_V
+ *   renew_V
+ *   room_V_index
+ *   link_V
+ *   unlink_V
  *
  */
 
@@ -76,16 +96,54 @@
   *
   *********************************************************/
 
-/* Local structures */
-static d_row box_lobo;
-static d_row box_upbo;
-static d_row hull_lobo;
-static d_row hull_upbo;
-static d_row mbox_lobo;
-static d_row mbox_upbo;
-static d_row mass_point;
+/* Local structures (stored in the frame context) */
+static TCL_TLS double *box_lobo;
+static TCL_TLS double *box_upbo;
+static TCL_TLS double *hull_lobo;
+static TCL_TLS double *hull_upbo;
+static TCL_TLS double *mbox_lobo;
+static TCL_TLS double *mbox_upbo;
+static TCL_TLS double *mass_point;
 
 static rcode calc_V_hull(struct base *V);
+static rcode calc_V_node(struct base *V, int j);
+static rcode check_V_stmt(struct d_frame *df, struct stmt_rec *stmt, int *var);
+static rcode narrow_V(int var, struct stmt_rec *stmt);
+static rcode room_V_index(struct V_state *vs, int n);
+static void link_V(struct V_state *vs, int var, int i);
+
+/* Scratch copy of the loaded hull and mass point, see cool_V_alts */
+static TCL_TLS d_row old_lobo,old_upbo,old_mid;
+
+
+/* Point the rows of vs into a block of V_ROWS*n doubles */
+
+void set_V_rows(struct V_state *vs, double *row, int n) {
+
+	vs->box_lobo = row; row += n;
+	vs->box_upbo = row; row += n;
+	vs->hull_lobo = row; row += n;
+	vs->hull_upbo = row; row += n;
+	vs->mbox_lobo = row; row += n;
+	vs->mbox_upbo = row; row += n;
+	vs->mass_point = row;
+	}
+
+
+/* Bind local structures to the context of df */
+
+void bind_V(struct d_frame *df) {
+	struct V_state *vs;
+
+	vs = &(df->ctx->V);
+	box_lobo = vs->box_lobo;
+	box_upbo = vs->box_upbo;
+	hull_lobo = vs->hull_lobo;
+	hull_upbo = vs->hull_upbo;
+	mbox_lobo = vs->mbox_lobo;
+	mbox_upbo = vs->mbox_upbo;
+	mass_point = vs->mass_point;
+	}
 
 
  /*********************************************************
@@ -94,18 +152,42 @@ static rcode calc_V_hull(struct base *V);
   *
   *********************************************************/
 
+/* Point the rows of a base to its own block (no im-rows in V) */
+
+void set_V_base_rows(struct base *V, int n) {
+	double *row;
+
+	row = (double *)(V+1);
+	V->lo_midbox = row;
+	V->up_midbox = row+n;
+	V->box_lobo = row+2*n;
+	V->box_upbo = row+3*n;
+	V->lo_im_midbox = NULL;
+	V->up_im_midbox = NULL;
+	V->im_box_lobo = NULL;
+	V->im_box_upbo = NULL;
+	}
+
+
 rcode create_V(struct d_frame *df) {
-	int i;
+	int i,n;
 
-	/* Get new memory chunk */
-	df->V_base = (struct base *)mem_alloc(sizeof(struct base),"struct base","create_V");
+	/* Get new memory chunk, rows sized to the frame (no im-rows in V) */
+	n = df->tot_cons[0]+1;
+	df->V_base = (struct base *)mem_carve(&(df->arena),df->arena_end,V_BASE_SIZE(n));
 	if (!df->V_base)
 		return TCL_OUT_OF_MEMORY;
+	set_V_base_rows(df->V_base,n);
+	df->V_own = df->V_base;
+	df->V_base->n_users = 1;
+	df->V_base->home = df;
 	/* Pre-fill entries */
 	df->V_base->watermark = V_MARK;
 	df->V_base->n_stmts = 0;
+	df->V_base->max_stmts = 0;
+	df->V_base->stmt = NULL; // chunk made on first statement
 	df->V_base->box = FALSE;
-	for (i=0; i<=MAX_CONS; i++) {
+	for (i=0; i<n; i++) {
 		df->V_base->lo_midbox[i] = -1.0;
 		df->V_base->up_midbox[i] = -1.0;
 		}
@@ -118,9 +200,9 @@ rcode dispose_V(struct d_frame *df) {
 	/* Check input parameters */
 	if (df->V_base->watermark != V_MARK)
 		return TCL_CORRUPTED;
-	/* Prevent accidental reuse */
-	df->V_base->watermark = 0;
-	return mem_free((void *)df->V_base);
+	/* Release, the last user prevents accidental reuse */
+	release_base(df->V_base);
+	return TCL_OK;
 	}
 
 
@@ -130,15 +212,46 @@ rcode dispose_V(struct d_frame *df) {
   *
   *********************************************************/
 
-rcode load_V(struct d_frame *df) {
+/* Only the alternatives whose hull or mass point changed need new moments */
+
+static void cool_V_alts(struct d_frame *df, bool was_ok) {
+	int alt,j;
+
+	for (alt=1; alt<=n_alts; alt++)
+		for (j=alt_inx[alt-1]+1; j<=alt_inx[alt]; j++)
+			if (!was_ok || (hull_lobo[j] != old_lobo[j]) ||
+					(hull_upbo[j] != old_upbo[j]) || (mass_point[j] != old_mid[j])) {
+				cool_moments(df,alt);
+				break;
+				}
+	}
+
+
+static rcode load_V_base(struct d_frame *df) {
 	rcode rc;
-	int i,alt,cons,tcons,var_nbr;
+	int i,var_nbr;
+	bool was_ok;
 	struct base *V;
 
 	/* Check input parameters */
 	if (df->V_base->watermark != V_MARK)
 		return TCL_CORRUPTED;
 	V = df->V_base;
+	use_frame(df);
+	/* Keep the current state to compare with */
+	was_ok = df->ctx->V_ok;
+	if (was_ok) {
+		memcpy(old_lobo,hull_lobo,(n_vars+1)*sizeof(double));
+		memcpy(old_upbo,hull_upbo,(n_vars+1)*sizeof(double));
+		memcpy(old_mid,mass_point,(n_vars+1)*sizeof(double));
+		}
+	df->ctx->V_ok = FALSE;
+	df->ctx->E_ok = FALSE;
+	df->ctx->V.ix_ok = FALSE;
+	if (rc = room_V_index(&(df->ctx->V),V->n_stmts))
+		return rc;
+	for (i=1; i<=n_vars; i++)
+		df->ctx->V.stmt_head[i] = 0;
 	if (V->box) {
 		/* User supplied ranges */
 		memcpy(box_lobo,V->box_lobo,(n_vars+1)*sizeof(double));
@@ -151,79 +264,345 @@ rcode load_V(struct d_frame *df) {
 			box_upbo[i] = 1.0;
 			}
 		}
-	/* Check input parameters for each statement */
+	/* Check and enter each statement into the box */
 	for (i=1; i<=V->n_stmts; i++) {
-		if (V->stmt[i].n_terms != 1)
-			return TCL_INPUT_ERROR;
-		if (V->stmt[i].lobo < 0.0)
-			return TCL_INPUT_ERROR;
-		if (V->stmt[i].upbo < V->stmt[i].lobo)
-			return TCL_INPUT_ERROR;
-		if (V->stmt[i].upbo > 1.0)
-			return TCL_INPUT_ERROR;
-		alt = V->stmt[i].alt[1];
-		tcons = V->stmt[i].cons[1];
-		if ((alt < 1) || (alt > n_alts))
-			return TCL_INPUT_ERROR;
-		if ((tcons < 1) || (tcons > df->tot_cons[alt]))
-			return TCL_INPUT_ERROR;
-		if (V->stmt[i].sign[1] != 1)
-			return TCL_INPUT_ERROR;
-		cons = t2r[alt][V->stmt[i].cons[1]];
-		/* Im-node not allowed */
-		if (!cons)
-			return TCL_ILLEGAL_NODE;
-		/* Enter into box */
-		var_nbr = alt_inx[alt-1] + cons;
-		box_lobo[var_nbr] = max(box_lobo[var_nbr],V->stmt[i].lobo);
-		box_upbo[var_nbr] = min(box_upbo[var_nbr],V->stmt[i].upbo);
-		if (box_lobo[var_nbr] > box_upbo[var_nbr])
-			return TCL_INCONSISTENT;
-#ifdef NO_ZERO_INTERVALS
-		if (box_upbo[var_nbr]-box_lobo[var_nbr] < MIN_WIDTH)
-			return TCL_TOO_NARROW_STMT;
-#endif
+		if (rc = check_V_stmt(df,V->stmt+i,&var_nbr))
+			return rc;
+		if (rc = narrow_V(var_nbr,V->stmt+i))
+			return rc;
+		link_V(&(df->ctx->V),var_nbr,i);
 		}
 	rc = calc_V_hull(V);
+	if (!rc)
+		df->ctx->V_ok = df->ctx->V.ix_ok = TRUE;
+	cool_V_alts(df,was_ok && !rc);
+	return rc;
+	}
+
+
+rcode load_V(struct d_frame *df) {
+	rcode rc;
+	double t0;
+
+	t0 = tcl_clock();
+	rc = load_V_base(df);
+	perf_add(load_V,1);
+	perf_clock(load_V_time,t0);
 	return rc;
 	}
 
 
 static rcode calc_V_hull(struct base *V) {
-	int i,j;
+	rcode rc;
+	int j;
+
+	/* There are no dependencies between value nodes */
+	for (j=1; j<=n_vars; j++)
+		if (rc = calc_V_node(V,j))
+			return rc;
+	return TCL_OK;
+	}
+
+
+/* Hull, midbox and mass point of value node j from its box */
+
+static rcode calc_V_node(struct base *V, int j) {
 
 	/* 1. Initialize hull_upbo & hull_lobo */
-	for (j=1; j<=n_vars; j++) {
-		hull_upbo[j] = box_upbo[j];
-		hull_lobo[j] = box_lobo[j];
-		if (hull_lobo[j] > hull_upbo[j])
+	hull_upbo[j] = box_upbo[j];
+	hull_lobo[j] = box_lobo[j];
+	if (hull_lobo[j] > hull_upbo[j])
+		return TCL_INCONSISTENT;
+	/* 2. Check midbox consistency */
+	if (V->lo_midbox[j] >= 0.0) {
+		if ((V->lo_midbox[j] < hull_lobo[j]-EPS) ||
+				(V->up_midbox[j] > hull_upbo[j]+EPS) ||
+				(V->lo_midbox[j] > V->up_midbox[j]))
 			return TCL_INCONSISTENT;
+		mbox_lobo[j] = V->lo_midbox[j];
+		mbox_upbo[j] = V->up_midbox[j];
+		}
+	else /* No midbox for this variable, use hull */ {
+		mbox_lobo[j] = hull_lobo[j];
+		mbox_upbo[j] = hull_upbo[j];
 		}
+	/* 3. Allocate mass point (symmetric trapezoid/triangle) */
+	mass_point[j] = (mbox_lobo[j] + mbox_upbo[j]) / 2.0;
+	return TCL_OK;
+	}
 
-	/* 2. Check midbox consistency */
-	for (i=1; i<=n_alts; i++)
-		for (j=alt_inx[i-1]+1; j<=alt_inx[i]; j++)
-			if (V->lo_midbox[j] >= 0.0) {
-				if ((V->lo_midbox[j] < hull_lobo[j]-EPS) ||
-						(V->up_midbox[j] > hull_upbo[j]+EPS) ||
-						(V->lo_midbox[j] > V->up_midbox[j]))
-					return TCL_INCONSISTENT;
-				mbox_lobo[j] = V->lo_midbox[j];
-				mbox_upbo[j] = V->up_midbox[j];
-				}
-			else /* No midbox for this variable, use hull */ {
-				mbox_lobo[j] = hull_lobo[j];
-				mbox_upbo[j] = hull_upbo[j];
-				}
-	/* 3. Allocate mass point */
-	for (j=1; j<=n_vars; j++) {
-		/* Symmetric trapezoid/triangle */
-		mass_point[j] = (mbox_lobo[j] + mbox_upbo[j]) / 2.0;
+
+ /*********************************************************
+  *
+  *  Statement store and node-wise loading
+  *
+  *  A V-statement bounds one value node, so the box of a
+  *  node is the tightest of the bounds on it and no other
+  *  node is affected. An attached frame keeps the boxes in
+  *  its context. New statements narrow the boxes of their
+  *  own nodes and a changed or deleted statement renews the
+  *  box of its node from the statements on it. Only those
+  *  nodes get a new hull and mass point, and only their
+  *  alternatives lose their moments. Anything that fails
+  *  is left to a full load_V to find and report.
+  *
+  *  The context indexes the statements by node, so that a
+  *  box is renewed from the statements on its node only.
+  *
+  *********************************************************/
+
+/* Make room for n statements in V, the chunk doubles as it grows */
+
+rcode grow_V(struct base *V, int n) {
+	int size;
+	struct stmt_rec *stmt;
+
+	if (n <= V->max_stmts)
+		return TCL_OK;
+	if (n > MAX_V_STMTS)
+		return TCL_TOO_MANY_STMTS;
+	for (size=max(2*V->max_stmts,STMTS_STEP); size<n; size*=2) ;
+	size = min(size,MAX_V_STMTS);
+	stmt = (struct stmt_rec *)mem_alloc((size+1)*sizeof(struct stmt_rec),"struct stmt_rec","grow_V");
+	if (!stmt)
+		return TCL_OUT_OF_MEMORY;
+	if (V->stmt) {
+		memcpy(stmt+1,V->stmt+1,V->n_stmts*sizeof(struct stmt_rec));
+		mem_free((void *)V->stmt);
+		}
+	V->stmt = stmt;
+	V->max_stmts = size;
+	return TCL_OK;
+	}
+
+
+/* Check a statement and find its value node */
+
+static rcode check_V_stmt(struct d_frame *df, struct stmt_rec *stmt, int *var) {
+	int alt,cons;
+
+	if (stmt->n_terms != 1)
+		return TCL_INPUT_ERROR;
+	if (stmt->lobo < 0.0)
+		return TCL_INPUT_ERROR;
+	if (stmt->upbo < stmt->lobo)
+		return TCL_INPUT_ERROR;
+	if (stmt->upbo > 1.0)
+		return TCL_INPUT_ERROR;
+	alt = stmt->alt[1];
+	if ((alt < 1) || (alt > n_alts))
+		return TCL_INPUT_ERROR;
+	if ((stmt->cons[1] < 1) || (stmt->cons[1] > df->tot_cons[alt]))
+		return TCL_INPUT_ERROR;
+	if (stmt->sign[1] != 1)
+		return TCL_INPUT_ERROR;
+	cons = t2r[alt][stmt->cons[1]];
+	/* Im-node not allowed */
+	if (!cons)
+		return TCL_ILLEGAL_NODE;
+	*var = alt_inx[alt-1] + cons;
+	return TCL_OK;
+	}
+
+
+/* Enter a statement into the box of its node */
+
+static rcode narrow_V(int var, struct stmt_rec *stmt) {
+
+	box_lobo[var] = max(box_lobo[var],stmt->lobo);
+	box_upbo[var] = min(box_upbo[var],stmt->upbo);
+	if (box_lobo[var] > box_upbo[var])
+		return TCL_INCONSISTENT;
+#ifdef NO_ZERO_INTERVALS
+	if (box_upbo[var]-box_lobo[var] < MIN_WIDTH)
+		return TCL_TOO_NARROW_STMT;
+#endif
+	return TCL_OK;
+	}
+
+
+/* New hull and mass point of node var in alt after its box has changed */
+
+static rcode renew_V(struct d_frame *df, int alt, int var) {
+	rcode rc;
+	double lobo,upbo,mid;
+
+	lobo = hull_lobo[var];
+	upbo = hull_upbo[var];
+	mid = mass_point[var];
+	if (rc = calc_V_node(df->V_base,var))
+		return rc;
+	if ((hull_lobo[var] != lobo) || (hull_upbo[var] != upbo) || (mass_point[var] != mid))
+		cool_moments(df,alt);
+	return TCL_OK;
+	}
+
+
+/* Make room for n statements in the index, it doubles as it grows */
+
+static rcode room_V_index(struct V_state *vs, int n) {
+	int size,*next;
+
+	if (n < vs->n_room)
+		return TCL_OK;
+	for (size=max(2*vs->n_room,STMTS_STEP); size<=n; size*=2) ;
+	next = (int *)mem_alloc(size*sizeof(int),"int","room_V_index");
+	if (!next)
+		return TCL_OUT_OF_MEMORY;
+	if (vs->stmt_next) {
+		memcpy(next,vs->stmt_next,vs->n_room*sizeof(int));
+		mem_free((void *)vs->stmt_next);
 		}
+	vs->stmt_next = next;
+	vs->n_room = size;
+	return TCL_OK;
+	}
+
+
+/* Enter statement i first on node var */
+
+static void link_V(struct V_state *vs, int var, int i) {
+
+	vs->stmt_next[i] = vs->stmt_head[var];
+	vs->stmt_head[var] = i;
+	}
+
+
+/* Take statement i off node var */
+
+static void unlink_V(struct V_state *vs, int var, int i) {
+	int *p;
+
+	for (p=vs->stmt_head+var; *p; p=vs->stmt_next+*p)
+		if (*p == i) {
+			*p = vs->stmt_next[i];
+			return;
+			}
+	}
+
+
+void free_V_index(struct d_frame *df) {
+
+	if (df->ctx->V.stmt_next)
+		mem_free((void *)df->ctx->V.stmt_next);
+	df->ctx->V.stmt_next = NULL;
+	df->ctx->V.n_room = 0;
+	df->ctx->V.ix_ok = FALSE;
+	}
+
+
+/* Load the statements first..n_stmts that have just been added */
+
+rcode add_V(struct d_frame *df, int first) {
+	rcode rc;
+	int i,var;
+	double t0;
+	struct base *V;
+
+	if (!df->ctx->V_ok || !df->ctx->V.ix_ok)
+		return load_V(df);
+	t0 = tcl_clock();
+	V = df->V_base;
+	use_frame(df);
+	df->ctx->E_ok = FALSE;
+	rc = room_V_index(&(df->ctx->V),V->n_stmts);
+	for (i=first; !rc && (i<=V->n_stmts); i++)
+		if (!(rc = check_V_stmt(df,V->stmt+i,&var)))
+			if (!(rc = narrow_V(var,V->stmt+i))) {
+				link_V(&(df->ctx->V),var,i);
+				rc = renew_V(df,V->stmt[i].alt[1],var);
+				}
+	perf_add(load_V_inc,1);
+	perf_clock(load_V_inc_time,t0);
+	if (rc)
+		return load_V(df);
+	return TCL_OK;
+	}
+
+
+/* Load the base after statement stmt_nbr, formerly old_stmt, was
+ * changed in place or deleted. Their nodes are renewed from the
+ * statements on them. A delete renumbers the statements above. */
+
+rcode touch_V(struct d_frame *df, int stmt_nbr, struct stmt_rec *old_stmt, bool deleted) {
+	rcode rc;
+	int i,k,n,node[2],alt[2];
+	double t0;
+	struct base *V;
+	struct V_state *vs;
+
+	if (!df->ctx->V_ok || !df->ctx->V.ix_ok)
+		return load_V(df);
+	t0 = tcl_clock();
+	V = df->V_base;
+	vs = &(df->ctx->V);
+	use_frame(df);
+	df->ctx->E_ok = FALSE;
+	/* The old statement was loaded, so it is legal */
+	n = 0;
+	if (!check_V_stmt(df,old_stmt,node)) {
+		alt[n++] = old_stmt->alt[1];
+		unlink_V(vs,node[0],stmt_nbr);
+		}
+	rc = TCL_OK;
+	if (deleted) {
+		for (i=1; i<=n_vars; i++)
+			if (vs->stmt_head[i] > stmt_nbr)
+				vs->stmt_head[i]--;
+		for (i=1; i<=V->n_stmts+1; i++)
+			if (vs->stmt_next[i] > stmt_nbr)
+				vs->stmt_next[i]--;
+		memmove(vs->stmt_next+stmt_nbr,vs->stmt_next+stmt_nbr+1,(V->n_stmts-stmt_nbr+1)*sizeof(int));
+		}
+	else if (!(rc = check_V_stmt(df,V->stmt+stmt_nbr,node+n))) {
+		link_V(vs,node[n],stmt_nbr);
+		if (!n || (node[1] != node[0]))
+			alt[n++] = V->stmt[stmt_nbr].alt[1];
+		}
+	/* Renew the boxes from the statements on the nodes */
+	for (k=0; !rc && (k<n); k++) {
+		box_lobo[node[k]] = V->box ? V->box_lobo[node[k]] : 0.0;
+		box_upbo[node[k]] = V->box ? V->box_upbo[node[k]] : 1.0;
+		for (i=vs->stmt_head[node[k]]; !rc && i; i=vs->stmt_next[i])
+			rc = narrow_V(node[k],V->stmt+i);
+		if (!rc)
+			rc = renew_V(df,alt[k],node[k]);
+		}
+	perf_add(load_V_inc,1);
+	perf_clock(load_V_inc_time,t0);
+	if (rc)
+		return load_V(df);
 	return TCL_OK;
 	}
 
 
+/* Load the base after a change of midboxes only, of node var in alt or
+ * of all nodes if alt is 0. The boxes and hulls stay as they are. */
+
+rcode mid_V(struct d_frame *df, int alt, int var) {
+	rcode rc;
+	int a,j;
+	double t0;
+
+	if (!df->ctx->V_ok)
+		return load_V(df);
+	t0 = tcl_clock();
+	use_frame(df);
+	df->ctx->E_ok = FALSE;
+	if (alt)
+		rc = renew_V(df,alt,var);
+	else
+		for (rc=TCL_OK, a=1; !rc && (a<=n_alts); a++)
+			for (j=alt_inx[a-1]+1; !rc && (j<=alt_inx[a]); j++)
+				rc = renew_V(df,a,j);
+	perf_add(load_V_inc,1);
+	perf_clock(load_V_inc_time,t0);
+	if (rc)
+		return load_V(df);
+	return TCL_OK;
+	}
+
+
  /*********************************************************
   *
   *  Access operations for evaluation
@@ -324,3 +703,118 @@ void mpoint_V(d_row masspt) {
 	for (i=1; i<=n_vars; i++)
 		masspt[i] = mass_point[i];
 	}
+
+
+/* Mass point of one value node as if stmt had been added to the base,
+ * and with its midbox left out if free_mid. There are no dependencies
+ * between value nodes, so no other node is affected. The base and the
+ * context are only read from. Returns TCL_OK or the load_V error. */
+
+rcode probe_V(struct d_frame *df, struct stmt_rec *stmt, bool free_mid, int *var, double *masspt) {
+	rcode rc;
+	int var_nbr;
+	double lobo,upbo;
+	struct base *V;
+
+	V = df->V_base;
+	/* Check input parameters as in load_V */
+	if (rc = check_V_stmt(df,stmt,&var_nbr))
+		return rc;
+	/* Enter into a copy of the box (which is also the hull) */
+	lobo = max(box_lobo[var_nbr],stmt->lobo);
+	upbo = min(box_upbo[var_nbr],stmt->upbo);
+	if (lobo > upbo)
+		return TCL_INCONSISTENT;
+#ifdef NO_ZERO_INTERVALS
+	if (upbo-lobo < MIN_WIDTH)
+		return TCL_TOO_NARROW_STMT;
+#endif
+	/* Check midbox consistency */
+	if (!free_mid && (V->lo_midbox[var_nbr] >= 0.0)) {
+		if ((V->lo_midbox[var_nbr] < lobo-EPS) ||
+				(V->up_midbox[var_nbr] > upbo+EPS))
+			return TCL_INCONSISTENT;
+		lobo = V->lo_midbox[var_nbr];
+		upbo = V->up_midbox[var_nbr];
+		}
+	/* Symmetric trapezoid/triangle */
+	*var = var_nbr;
+	*masspt = (lobo + upbo) / 2.0;
+	return TCL_OK;
+	}
+
+
+ /*********************************************************
+  *
+  *  Hulls for a box without loading
+  *
+  *********************************************************/
+
+/* Statement part of the node boxes, from [0,1] as in load_V */
+static TCL_TLS d_row sbox_lobo,sbox_upbo;
+static TCL_TLS i_row sbox_on;
+
+rcode stmt_V(struct d_frame *df) {
+	rcode rc;
+	int i,var_nbr;
+	struct base *V;
+
+	V = df->V_base;
+	for (i=1; i<=n_vars; i++) {
+		sbox_lobo[i] = 0.0;
+		sbox_upbo[i] = 1.0;
+		sbox_on[i] = FALSE;
+		}
+	for (i=1; i<=V->n_stmts; i++) {
+		if (rc = check_V_stmt(df,V->stmt+i,&var_nbr))
+			return rc;
+		sbox_lobo[var_nbr] = max(sbox_lobo[var_nbr],V->stmt[i].lobo);
+		sbox_upbo[var_nbr] = min(sbox_upbo[var_nbr],V->stmt[i].upbo);
+		sbox_on[var_nbr] = TRUE;
+		}
+	return TCL_OK;
+	}
+
+
+/* Hull and mass point of all value nodes as if the box tbox had been
+ * set, from the statement boxes of the last stmt_V. Node i of the box is
+ * at tbox_lobo[i-1] (B1 indexing). Entering the statements into the box
+ * one at a time, as load_V does, ends in the same box and fails if and
+ * only if this does. The base and the context are only read from. */
+
+rcode box_V(struct d_frame *df, double *tbox_lobo, double *tbox_upbo, 
+				d_row lobo, d_row upbo, d_row masspt) {
+	int i,j;
+	double mlobo,mupbo;
+	struct base *V;
+
+	V = df->V_base;
+	for (i=1; i<=tot_vars; i++)
+		if ((tbox_lobo[i-1] < 0.0) || (tbox_lobo[i-1] > 1.0) || 
+				(tbox_upbo[i-1] < 0.0) || (tbox_upbo[i-1] > 1.0))
+			return TCL_INPUT_ERROR;
+	for (i=1; i<=tot_vars; i++)
+		if (j = f2r[i]) {
+			lobo[j] = max(tbox_lobo[i-1],sbox_lobo[j]);
+			upbo[j] = min(tbox_upbo[i-1],sbox_upbo[j]);
+			if (lobo[j] > upbo[j])
+				return TCL_INCONSISTENT;
+#ifdef NO_ZERO_INTERVALS
+			if (sbox_on[j] && (upbo[j]-lobo[j] < MIN_WIDTH))
+				return TCL_TOO_NARROW_STMT;
+#endif
+			/* Midbox consistency as in calc_V_node */
+			mlobo = lobo[j];
+			mupbo = upbo[j];
+			if (V->lo_midbox[j] >= 0.0) {
+				if ((V->lo_midbox[j] < lobo[j]-EPS) ||
+						(V->up_midbox[j] > upbo[j]+EPS) ||
+						(V->lo_midbox[j] > V->up_midbox[j]))
+					return TCL_INCONSISTENT;
+				mlobo = V->lo_midbox[j];
+				mupbo = V->up_midbox[j];
+				}
+			masspt[j] = (mlobo + mupbo) / 2.0;
+			}
+	return TCL_OK;
+	}
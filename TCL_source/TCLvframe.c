@@ -48,6 +48,7 @@
  *   ------------------------------
  *   TCL_reset_V_base
  *   TCL_add_V_constraint
+ *   TCL_add_V_constraints
  *   TCL_replace_V_constraint
  *   TCL_change_V_constraint
  *   TCL_delete_V_constraint
@@ -84,6 +85,9 @@ rcode TCL_reset_V_base(struct d_frame *df) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 
 	/* Remove constraint set from base */
@@ -97,6 +101,7 @@ rcode TCL_reset_V_base(struct d_frame *df) {
 			V->up_midbox[f2r[i]] = -1.0;
 			}
 
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached)
 		rc = load_V(df);
@@ -119,21 +124,67 @@ rcode TCL_add_V_constraint(struct d_frame *df, struct stmt_rec *V_stmt) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
-	if (V->n_stmts >= MAX_STMTS)
-		return TCL_TOO_MANY_STMTS;
+	if (rc = grow_V(V,V->n_stmts+1))
+		return rc;
 
 	/* Add the constraint last to the base */
 	V->n_stmts++;
 	memcpy(&(V->stmt[V->n_stmts]),V_stmt,sizeof(struct stmt_rec));
 
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached) {
 		/* Try to load new value base */
-		rc = load_V(df);
+		rc = add_V(df,V->n_stmts);
 		if (rc) {
 			/* Failed to load, inconsistent */
 			V->n_stmts--;
+			rc2 = load_V(df);
+			if (rc2)
+				df->attached = FALSE;
+			}
+		}
+	return rc;
+	}
+
+
+/* Add V_stmts[1..n_stmts] as one transaction: the base is loaded once
+ * and if it is inconsistent then none of the constraints are added. */
+
+rcode TCL_add_V_constraints(struct d_frame *df, int n_stmts, struct stmt_rec V_stmts[]) {
+	rcode rc,rc2;
+	struct base *V;
+
+	/* Check input parameters */
+	if (df == NULL)
+		return TCL_CORRUPTED;
+	if (df->watermark != D_MARK)
+		return TCL_CORRUPTED;
+	if (n_stmts < 0)
+		return TCL_INPUT_ERROR;
+	if (rc = own_base(df,TRUE))
+		return rc;
+	V = df->V_base;
+	if (rc = grow_V(V,V->n_stmts+n_stmts))
+		return rc;
+	if (!n_stmts)
+		return TCL_OK;
+
+	/* Add the constraints last to the base */
+	memcpy(&(V->stmt[V->n_stmts+1]),&(V_stmts[1]),n_stmts*sizeof(struct stmt_rec));
+	V->n_stmts += n_stmts;
+
+	cool_V(df);
+	rc = TCL_OK;
+	if (df->attached) {
+		/* Try to load new value base */
+		rc = add_V(df,V->n_stmts-n_stmts+1);
+		if (rc) {
+			/* Failed to load, inconsistent */
+			V->n_stmts -= n_stmts;
 			rc2 = load_V(df);
 			if (rc2)
 				df->attached = FALSE;
@@ -155,6 +206,9 @@ rcode TCL_replace_V_constraint(struct d_frame *df, int stmt_nbr, struct stmt_rec
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 	if ((stmt_nbr < 1) || (stmt_nbr > V->n_stmts))
 		return TCL_INPUT_ERROR;
@@ -164,7 +218,7 @@ rcode TCL_replace_V_constraint(struct d_frame *df, int stmt_nbr, struct stmt_rec
 	memcpy(&(V->stmt[stmt_nbr]),V_stmt,sizeof(struct stmt_rec));
 
 	/* Try to load new base */
-	rc = load_V(df);
+	rc = touch_V(df,stmt_nbr,&tmp,FALSE);
 	if (rc) {
 		/* Failed to load, inconsistent */
 		memcpy(&(V->stmt[stmt_nbr]),&tmp,sizeof(struct stmt_rec));
@@ -188,6 +242,9 @@ rcode TCL_change_V_constraint(struct d_frame *df, int stmt_nbr, double lobo, dou
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 	if ((stmt_nbr < 1) || (stmt_nbr > V->n_stmts))
 		return TCL_INPUT_ERROR;
@@ -199,7 +256,7 @@ rcode TCL_change_V_constraint(struct d_frame *df, int stmt_nbr, double lobo, dou
 	V->stmt[stmt_nbr].upbo = upbo;
 
 	/* Try to load new base */
-	rc = load_V(df);
+	rc = touch_V(df,stmt_nbr,&tmp,FALSE);
 	if (rc) {
 		/* Failed to load, inconsistent */
 		memcpy(&(V->stmt[stmt_nbr]),&tmp,sizeof(struct stmt_rec));
@@ -213,7 +270,6 @@ rcode TCL_change_V_constraint(struct d_frame *df, int stmt_nbr, double lobo, dou
 
 rcode TCL_delete_V_constraint(struct d_frame *df, int stmt_nbr) {
 	rcode rc,rc2;
-	int i;
 	struct stmt_rec tmp;
 	struct base *V;
 
@@ -222,24 +278,25 @@ rcode TCL_delete_V_constraint(struct d_frame *df, int stmt_nbr) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 	if ((stmt_nbr < 1) || (stmt_nbr > V->n_stmts))
 		return TCL_INPUT_ERROR;
 
 	/* Move constraints up */
 	memcpy(&tmp,&(V->stmt[stmt_nbr]),sizeof(struct stmt_rec));
-	for (i=stmt_nbr; i<V->n_stmts; i++)
-		memcpy(&(V->stmt[i]),&(V->stmt[i+1]),sizeof(struct stmt_rec));
+	memmove(&(V->stmt[stmt_nbr]),&(V->stmt[stmt_nbr+1]),(V->n_stmts-stmt_nbr)*sizeof(struct stmt_rec));
 	V->n_stmts--;
 
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached) {
 		/* Try to attach new base */
-		rc = load_V(df);
+		rc = touch_V(df,stmt_nbr,&tmp,TRUE);
 		if (rc) {
 			/* Failed to load, inconsistent -> restore */
-			for (i=V->n_stmts; i>=stmt_nbr; i--)
-				memcpy(&(V->stmt[i+1]),&(V->stmt[i]),sizeof(struct stmt_rec));
+			memmove(&(V->stmt[stmt_nbr+1]),&(V->stmt[stmt_nbr]),(V->n_stmts-stmt_nbr+1)*sizeof(struct stmt_rec));
 			memcpy(&(V->stmt[stmt_nbr]),&tmp,sizeof(struct stmt_rec));
 			V->n_stmts++;
 			rc2 = load_V(df);
@@ -262,6 +319,9 @@ rcode TCL_add_V_mstatement(struct d_frame *df, struct stmt_rec *V_stmt) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 
 	if ((index = get_V_index(V_stmt->alt[1],V_stmt->cons[1])) == 0)
@@ -274,10 +334,11 @@ rcode TCL_add_V_mstatement(struct d_frame *df, struct stmt_rec *V_stmt) {
 	V->lo_midbox[index] = V_stmt->lobo;
 	V->up_midbox[index] = V_stmt->upbo;
 
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to load new base */
-		rc = load_V(df);
+		/* Try to load new base, only the midbox changed */
+		rc = mid_V(df,V_stmt->alt[1],index);
 		if (rc) {
 			/* Failed to load, inconsistent */
 			V->lo_midbox[index] = save_lo;
@@ -302,6 +363,9 @@ rcode TCL_delete_V_mstatement(struct d_frame *df, struct stmt_rec *V_stmt) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 
 	if ((index = get_V_index(V_stmt->alt[1],V_stmt->cons[1])) == 0)
@@ -313,10 +377,11 @@ rcode TCL_delete_V_mstatement(struct d_frame *df, struct stmt_rec *V_stmt) {
 	V->lo_midbox[index] = -1.0;
 	V->up_midbox[index] = -1.0;
 
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to load new base */
-		rc = load_V(df);
+		/* Try to load new base, only the midbox changed */
+		rc = mid_V(df,V_stmt->alt[1],index);
 		if (rc) {
 			/* Failed to load, inconsistent */
 			V->lo_midbox[index] = save_lo;
@@ -346,12 +411,15 @@ rcode TCL_set_V_box(struct d_frame *df, d_row tbox_lobo, d_row tbox_upbo) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
 	for (i=1; i<=tot_vars; i++)
 		if ((tbox_lobo[i] < 0.0) || (tbox_lobo[i] > 1.0) || 
 				(tbox_upbo[i] < 0.0) || (tbox_upbo[i] > 1.0))
 			return TCL_INPUT_ERROR;
 
 	/* Add the box to the base */
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 	for (i=1; i<=tot_vars; i++)
 		if (f2r[i])	{
@@ -360,6 +428,7 @@ rcode TCL_set_V_box(struct d_frame *df, d_row tbox_lobo, d_row tbox_upbo) {
 			}
 	V->box = TRUE;
 
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached) {
 		/* Try to load the new base */
@@ -385,12 +454,15 @@ rcode TCL_unset_V_box(struct d_frame *df) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 	if (!V->box)
 		return TCL_OK;
 
 	/* Remove the intervals from the base */
 	V->box = FALSE;
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached) {
 		/* Try to load original base */
@@ -403,7 +475,7 @@ rcode TCL_unset_V_box(struct d_frame *df) {
 	}
 
 
-static d_row save_lobo,save_upbo;
+static TCL_TLS d_row save_lobo,save_upbo;
 
 rcode TCL_set_V_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 	rcode rc,rc2;
@@ -415,6 +487,7 @@ rcode TCL_set_V_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 		return TCL_CORRUPTED;
 	if (df->watermark != D_MARK)
 		return TCL_CORRUPTED;
+	use_frame(df);
 	for (i=1; i<=tot_vars; i++)
 		if (f2r[i])
 			/* Check within range [0,1], empty (-1) or unoccupied (-2) */
@@ -423,6 +496,8 @@ rcode TCL_set_V_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 					(tmbox_lobo[i] != -1.0) && (tmbox_lobo[i] != -2.0))
 				return TCL_INPUT_ERROR;
 
+	if (rc = own_base(df,TRUE))
+		return rc;
 	V = df->V_base;
 
 	/* Add the box to the base */
@@ -436,10 +511,11 @@ rcode TCL_set_V_mbox(struct d_frame *df, d_row tmbox_lobo, d_row tmbox_upbo) {
 				}
 			}
 
+	cool_V(df);
 	rc = TCL_OK;
 	if (df->attached) {
-		/* Try to load new base */
-		rc = load_V(df);
+		/* Try to load new base, only the midboxes changed */
+		rc = mid_V(df,0,0);
 		if (rc) {
 			/* Failed to load <- inconsistent */
 			for (i=1; i<=tot_vars; i++)
@@ -473,6 +549,7 @@ rcode TCL_get_V_box(struct d_frame *df, d_row lo_box, d_row up_box) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
 	/* If box=TRUE  then return combined stmt + box */
 	/* If box=FALSE then return [0,1] i.e. w/o stmts */
@@ -507,6 +584,7 @@ rcode TCL_get_V_mbox(struct d_frame *df, d_row lo_mid, d_row up_mid) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
 	V = df->V_base;
 	for (i=1; i<=df->tot_cons[0]; i++)
@@ -529,6 +607,7 @@ int TCL_get_V_index(struct d_frame *df, int alt, int node) {
 		return 0;
 	if (df->watermark != D_MARK)
 		return 0;
+	use_frame(df);
 	/* Return B2 index */
 	return get_V_index(alt,node);
 	}
@@ -545,6 +624,7 @@ rcode TCL_get_V_hull(struct d_frame *df, d_row lobo, d_row upbo) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 	/* Return hull boundaries */
 	hull_V(lobo,upbo);
 	return TCL_OK;
@@ -562,6 +642,7 @@ rcode TCL_get_V_masspoint(struct d_frame *df, d_row V_mid) {
 		return TCL_CORRUPTED;
 	if (!df->attached)
 		return TCL_DETACHED;
+	use_frame(df);
 
 	cpoint_V(V_mid); // B1 indexing
 	return TCL_OK;
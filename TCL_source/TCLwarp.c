@@ -61,9 +61,14 @@
  *   f1_T
  *   ijar_warp_T
  *   ijar_warp_sum2
+ *   tilt_mean
+ *   tilt_var
+ *   warp_tilt
  *
  */
 
+#define WARP_TILT // tilted approximation where the vertex algorithm gives up
+
 #ifdef TDL_COMPAT
 #define VX_MAXDIM 12   // max nbr of prob vars
 #define VX_CUTOFFDIM 8 // where cutoff starts
@@ -73,14 +78,24 @@
 #define VX_CUTOFFDIM 26 // where cutoff starts
 #define VX_MAXVER 65536 // max nbr of vertices inside hyper-pyramide (=2^(VX_MAXDIM-1))
 #endif
-double sigma[VX_MAXVER+1];
-double delta[VX_MAXVER+1];
-double s_pow[VX_MAXVER+1];
-int upnodes[VX_MAXVER+1];
-int s_path[VX_MAXDIM+1][VX_MAXVER+1];
-int s_count;
-double mp_lobo[VX_MAXDIM+1];
-double mp_upbo[VX_MAXDIM+1];
+TCL_TLS double sigma[VX_MAXVER+1];
+TCL_TLS double delta[VX_MAXVER+1];
+TCL_TLS double s_pow[VX_MAXVER+1];
+TCL_TLS int upnodes[VX_MAXVER+1];
+TCL_TLS int s_path[VX_MAXDIM+1][VX_MAXVER+1];
+TCL_TLS int s_count;
+#ifdef WARP_TILT
+#if MAX_NOPA > VX_MAXDIM
+#define VX_MAXNODE MAX_NOPA // max nbr of siblings
+#else
+#define VX_MAXNODE VX_MAXDIM
+#endif
+#define TILT_LOOPS 60
+#else
+#define VX_MAXNODE VX_MAXDIM
+#endif
+TCL_TLS double mp_lobo[VX_MAXNODE+1];
+TCL_TLS double mp_upbo[VX_MAXNODE+1];
 
 
 static int f1_T(double value, double target, int cur, int stop, int path[], int active[]) {
@@ -163,26 +178,126 @@ static double ijar_warp_sum2() {
 	}
 
 
+#ifdef WARP_TILT
+
+/* Tilted (maximum entropy) approximation of the warp mass point. Given their
+   sum, independent uniform variables are close to exponentially tilted ones,
+   and the closer the more of them there are. The tilt theta is found from the
+   sum constraint, O(dim) per iteration, which bounds the cost for any node. */
+
+/* Mean above lobo of the tilted uniform on [lobo,lobo+w] */
+
+static double tilt_mean(double theta, double w) {
+	double z;
+
+	z = theta*w;
+	if (fabs(z) < 1.0E-4)
+		return w*(0.5+z/12.0);
+	return w/(1.0-exp(-z))-1.0/theta;
+	}
+
+
+/* Its variance = derivative of tilt_mean wrt theta */
+
+static double tilt_var(double theta, double w) {
+	double z,s;
+
+	z = theta*w;
+	if (fabs(z) < 1.0E-3)
+		return w*w/12.0;
+	s = 2.0*sinh(z/2.0);
+	return 1.0/(theta*theta)-w*w/(s*s);
+	}
+
+
+/* Safeguarded Newton for the tilt that makes the active dimensions sum
+   to target. Returns FALSE if target is at or outside the range. */
+
+static bool warp_tilt(int mp_dim, int active[], double target, double *theta) {
+	int j,k;
+	double t,f,df,t_lo,t_up,w_sum;
+	bool lo_ok,up_ok;
+
+	w_sum = 0.0;
+	for (j=1; j<=mp_dim; j++)
+		if (active[j]) {
+			target -= mp_lobo[j];
+			w_sum += mp_upbo[j]-mp_lobo[j];
+			}
+	if ((target < EPS) || (target > w_sum-EPS))
+		return FALSE;
+	t = t_lo = t_up = 0.0;
+	lo_ok = up_ok = FALSE;
+	for (k=0; k<TILT_LOOPS; k++) {
+		f = -target;
+		df = 0.0;
+		for (j=1; j<=mp_dim; j++)
+			if (active[j]) {
+				f += tilt_mean(t,mp_upbo[j]-mp_lobo[j]);
+				df += tilt_var(t,mp_upbo[j]-mp_lobo[j]);
+				}
+		if (fabs(f) < EPS*EPS)
+			break;
+		/* Keep a bracket, f is increasing in t */
+		if (f > 0.0) {
+			t_up = t;
+			up_ok = TRUE;
+			}
+		else {
+			t_lo = t;
+			lo_ok = TRUE;
+			}
+		if (df > 0.0)
+			t -= f/df;
+		if ((df <= 0.0) || (lo_ok && (t <= t_lo)) || (up_ok && (t >= t_up))) {
+			/* Step outside bracket -> bisect or widen */
+			if (lo_ok && up_ok)
+				t = (t_lo+t_up)/2.0;
+			else if (lo_ok)
+				t = 2.0*t_lo+1.0;
+			else
+				t = 2.0*t_up-1.0;
+			}
+		}
+	*theta = t;
+	return TRUE;
+	}
+
+#endif
+
+
 /* Adjust mp according to vertex algorithm if dimension permits.
-   The algorithm explodes in dimensionality and can only run in small cases. */
+   The algorithm explodes in dimensionality and can only run in small cases.
+   Under WARP_TILT, larger nodes get the tilted approximation instead. */
 
 static void adjust_vx(int alt, int snode, double lofrac) {
-	int j,last,act_dim,sd_path[VX_MAXDIM+1],active[VX_MAXDIM+1];
-	double target,mp_factor,sum2;
+	int j,last,act_dim,sd_path[VX_MAXDIM+1],active[VX_MAXNODE+1];
+	double target,mp_factor,sum2,theta,mp;
 	int tnode,mp_dim;
+	bool tilt;
 
+	perf_add(vx_calls,1);
 	for (tnode=tdown[alt][snode],j=1; tnode; tnode=tnext[alt][tnode],j++) {
-		if (j > VX_MAXDIM)
+		if (j > VX_MAXNODE) {
 			/* mp_factor = 0 */
+			perf_add(vx_bails,1);
 			return;
+			}
 		mp_lobo[j] = (tdown[alt][tnode]?im_L_mhull_lobo[at2i(alt,tnode)]:L_mhull_lobo[at2r(alt,tnode)]);
 		mp_upbo[j] = (tdown[alt][tnode]?im_L_mhull_upbo[at2i(alt,tnode)]:L_mhull_upbo[at2r(alt,tnode)]);
 		}
 	mp_dim = j-1;
+#ifdef WARP_TILT
+	/* No fade-out, the vertices are replaced by the tilt when too many */
+	mp_factor = 1.0;
+	tilt = (mp_dim > VX_MAXDIM);
+#else
 	if (mp_dim <= VX_CUTOFFDIM)
 		mp_factor = 1.0;
 	else
 		mp_factor = (double)(VX_MAXDIM+1-mp_dim)/(double)(VX_MAXDIM+1-VX_CUTOFFDIM);
+	tilt = FALSE;
+#endif
 #ifndef TDL_COMPAT
 	mp_factor /= 2.0; // max half of mp is from this algorithm
 #endif
@@ -200,31 +315,59 @@ static void adjust_vx(int alt, int snode, double lofrac) {
 			act_dim--;
 			}
 		}
-	if (act_dim < 2)
+	if (act_dim < 2) {
 		/* Cannot change anything */
+		perf_add(vx_bails,1);
 		return;
-	/* Initialise invariants */
-	s_count = 0;
-	f1_T(0.0,target,0,last,sd_path,active);
-	if (!s_count || s_count>=VX_MAXVER)
-		/* No or too long path */
-		return;
-	sum2 = ijar_warp_sum2();
+		}
+	if (!tilt) {
+		/* Initialise invariants */
+		s_count = 0;
+		f1_T(0.0,target,0,last,sd_path,active);
+		perf_add(vx_paths,s_count);
+#ifdef WARP_TILT
+		tilt = (s_count >= VX_MAXVER);
+		}
+	if (tilt) {
+		if (!warp_tilt(mp_dim,active,target,&theta)) {
+			/* Target outside range */
+			perf_add(vx_bails,1);
+			return;
+			}
+		sum2 = 0.0;
+		}
+	else {
+#endif
+		if (!s_count || s_count>=VX_MAXVER) {
+			/* No or too long path */
+			perf_add(vx_bails,1);
+			return;
+			}
+		sum2 = ijar_warp_sum2();
 #ifdef TDL_COMPAT
-	if (sum2 < EPS)
+		if (sum2 < EPS) {
 #else // depends on depth
-	if (sum2 < EPS/100.0)
+		if (sum2 < EPS/100.0) {
 #endif
-		/* No normaliser */
-		return;
+			/* No normaliser */
+			perf_add(vx_bails,1);
+			return;
+			}
+		}
 	for (tnode=tdown[alt][snode],j=1; tnode; tnode=tnext[alt][tnode],j++)
 		if (active[j]) {
 			/* Non-collapsed dimension */
+#ifdef WARP_TILT
+			if (tilt)
+				mp = mp_lobo[j]+tilt_mean(theta,mp_upbo[j]-mp_lobo[j]);
+			else
+#endif
+				mp = ijar_warp_T(j,act_dim,target,sum2);
 			if (tdown[alt][tnode])
 				im_L_mass_point[at2i(alt,tnode)] = (1.0-mp_factor) * im_L_mass_point[at2i(alt,tnode)] +
-					mp_factor * ijar_warp_T(j,act_dim,target,sum2);
+					mp_factor * mp;
 			else
 				L_mass_point[at2r(alt,tnode)] = (1.0-mp_factor) * L_mass_point[at2r(alt,tnode)] +
-					mp_factor * ijar_warp_T(j,act_dim,target,sum2);
+					mp_factor * mp;
 			}
 	}
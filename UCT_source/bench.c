@@ -0,0 +1,455 @@
+/*
+ *
+ *        _/       _/   _/       _/    _/_/_/_/_/   _/_/_/          _/
+ *       _/       _/   _/_/     _/    _/           _/    _/       _/  _/
+ *      _/       _/   _/ _/    _/    _/           _/      _/    _/    _/
+ *     _/       _/   _/  _/   _/    _/_/_/_/     _/      _/   _/      _/ 
+ *    _/       _/   _/   _/  _/    _/           _/      _/   _/_/_/_/_/  
+ *   _/       _/   _/    _/ _/    _/           _/      _/   _/      _/          
+ *   _/     _/    _/     _/_/    _/           _/     _/    _/      _/          
+ *    _/_/_/     _/       _/    _/_/_/_/_/   _/_/_/_/     _/      _/   
+ *
+ *
+ *   UNEDA - The Universal Engine for Decision Analysis
+ *
+ *   Copyright (c) 2012-2025  Prof. Mats Danielson, Stockholm University
+ *
+ *   Website: https://people.dsv.su.se/~mad/UNEDA
+ *   GitHub:  https://github.com/uneda-cda/UNEDA
+ *
+ *   Licensed under CC BY 4.0: https://creativecommons.org/licenses/by/4.0/.
+ *   Provided "as is", without warranty of any kind, express or implied.
+ *   Reuse and modifications are encouraged, with proper attribution.
+ *
+ */
+
+/*
+ *   File: bench.c
+ *
+ *   Purpose: non-interactive benchmark mode for UCT - UNEDA core tester
+ *
+ *   Invoked as 'uct -b [alts depth fanout density midbox reps seed]'.
+ *   Generates random flat (depth 1) or tree frames and times the core
+ *   calls on them. Output is tab separated, one record per line:
+ *
+ *   CFG <key> <value>                        run configuration
+ *   BMK <phase> <calls> <total ms> <us/call> timing per phase
+ *   PRF <counter> <value>                    TCL performance counters
+ *
+ */
+
+#include "uct.h"
+
+#define BMK_NAME "bmk"
+
+/* Phases timed */
+#define B_CREATE  0
+#define B_STMTS   1
+#define B_DELTA   2
+#define B_GAMMA   3
+#define B_PSI     4
+#define B_DIGAMMA 5
+#define B_OMEGA   6
+#define B_MOMENTS 7
+#define B_SECLVL  8
+#define B_SAVE    9
+#define B_LOAD    10
+#define B_DISPOSE 11
+#define N_PHASES  12
+
+static char *phase_name[N_PHASES] = {"create","stmts","delta","gamma","psi","digamma",
+				"omega","moments","seclevel","save","load","dispose"};
+
+static double b_secs[N_PHASES];
+static long b_calls[N_PHASES];
+static double b_start;
+
+static t_matrix tnext,tdown;
+static int n_nodes[MAX_ALTS+1];
+/* Random masspoint, local probabilities and leaf values */
+static double P_pt[MAX_ALTS+1][MAX_NOPA+1];
+static double V_pt[MAX_ALTS+1][MAX_NOPA+1];
+static a_result cube0,cube1;
+static a_vector strong,marked,weak;
+static a_row rm1,cm2,cm3;
+static char b_folder[40];
+
+
+/* Monotonic clock in seconds */
+
+static double bench_clock() {
+#ifdef _MSC_VER
+	return (double)clock()/(double)CLOCKS_PER_SEC;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (double)ts.tv_sec+1.0E-9*(double)ts.tv_nsec;
+#endif
+	}
+
+
+static void b_begin() {
+
+	b_start = bench_clock();
+	}
+
+
+static void b_end(int phase, long calls) {
+
+	b_secs[phase] += bench_clock()-b_start;
+	b_calls[phase] += calls;
+	}
+
+
+/* Fill a complete tree below a node, same numbering as fill_tree in file.c.
+ * Returns the number of nodes used. */
+
+static int bench_tree(t_row ftnext, t_row ftdown, int cnstart, int depth, int fanout) {
+	int i,cn,step;
+
+	for (cn=cnstart,i=1; i<=fanout; i++) {
+		if (depth > 1) {
+			ftdown[cn] = cn+1;
+			step = bench_tree(ftnext,ftdown,cn+1,depth-1,fanout);
+			}
+		else {
+			ftdown[cn] = 0;
+			step = 0;
+			}
+		ftnext[cn] = (i<fanout ? cn+step+1 : 0);
+		cn += step+1;
+		}
+	return cn-cnstart;
+	}
+
+
+/* Draw a random point with each sibling set summing to one */
+
+static void bench_point(int n_alts, int depth) {
+	int i,j,k,s;
+	double sum;
+
+	for (i=1; i<=n_alts; i++) {
+		for (j=1; j<=n_nodes[i]; j++) {
+			P_pt[i][j] = drandom(0.1,1.0);
+			V_pt[i][j] = drandom(0.0,1.0);
+			}
+		/* Sibling sets start at node 1 and at each first child */
+		for (s=0; s<=n_nodes[i]; s++) {
+			if (s && ((depth < 2) || !tdown[i][s]))
+				continue;
+			k = (s ? tdown[i][s] : 1);
+			for (sum=0.0,j=k; j; j=(depth<2 ? (j<n_nodes[i] ? j+1 : 0) : tnext[i][j]))
+				sum += P_pt[i][j];
+			for (j=k; j; j=(depth<2 ? (j<n_nodes[i] ? j+1 : 0) : tnext[i][j]))
+				P_pt[i][j] /= sum;
+			}
+		}
+	}
+
+
+/* Create, attach and fill a random frame. Returns 0 if ok. */
+
+static int bench_frame(int n_alts, int depth, int fanout, double density, double midbox,
+				int *n_P, int *n_V) {
+	int i,j;
+	double w;
+	struct stmt_rec stmt;
+
+	b_begin();
+	if (depth > 1) {
+		for (i=1; i<=n_alts; i++)
+			n_nodes[i] = bench_tree(tnext[i],tdown[i],1,depth,fanout);
+		if (call(TCL_create_tree_frame(&(uf->df),n_alts,n_nodes,tnext,tdown)))
+			return -1;
+		}
+	else {
+		for (i=1; i<=n_alts; i++)
+			n_nodes[i] = fanout;
+		if (call(TCL_create_flat_frame(&(uf->df),n_alts,n_nodes)))
+			return -1;
+		}
+	strcpy(uf->df->name,uf->frame_name);
+	if (call(TCL_attach_frame(uf->df))) {
+		TCL_dispose_frame(uf->df);
+		return -1;
+		}
+	b_end(B_CREATE,1L);
+
+	/* Intervals around a feasible point are always consistent */
+	bench_point(n_alts,depth);
+	b_begin();
+	stmt.n_terms = 1;
+	stmt.sign[1] = 1;
+	*n_P = *n_V = 0;
+	for (i=1; i<=n_alts; i++)
+		for (j=1; j<=n_nodes[i]; j++) {
+			stmt.alt[1] = i;
+			stmt.cons[1] = j;
+			if ((*n_P < MAX_STMTS) && (xrandom() < density)) {
+				w = drandom(0.01,0.2);
+				stmt.lobo = max(P_pt[i][j]-w,0.0);
+				stmt.upbo = min(P_pt[i][j]+w,1.0);
+				if (call(TCL_add_P_constraint(uf->df,&stmt)))
+					return -2;
+				(*n_P)++;
+				}
+			if (xrandom() < midbox) {
+				stmt.lobo = stmt.upbo = P_pt[i][j];
+				if (call(TCL_add_P_mstatement(uf->df,&stmt)))
+					return -2;
+				}
+			/* Values only at real nodes */
+			if ((depth > 1) && tdown[i][j])
+				continue;
+			if ((*n_V < MAX_STMTS) && (xrandom() < density)) {
+				w = drandom(0.01,0.2);
+				stmt.lobo = max(V_pt[i][j]-w,0.0);
+				stmt.upbo = min(V_pt[i][j]+w,1.0);
+				if (call(TCL_add_V_constraint(uf->df,&stmt)))
+					return -2;
+				(*n_V)++;
+				}
+			if (xrandom() < midbox) {
+				stmt.lobo = stmt.upbo = V_pt[i][j];
+				if (call(TCL_add_V_mstatement(uf->df,&stmt)))
+					return -2;
+				}
+			}
+	b_end(B_STMTS,(long)(*n_P+*n_V));
+	return 0;
+	}
+
+
+/* Time all evaluation rules on the attached frame. Returns 0 if ok. */
+
+static int bench_eval(int n_alts) {
+	int Ai,Aj,mask;
+
+	b_begin();
+	for (Ai=1; Ai<n_alts; Ai++)
+		for (Aj=Ai+1; Aj<=n_alts; Aj++)
+			if (call(TCL_evaluate(uf->df,Ai,Aj,DELTA,cube0)))
+				return -1;
+	b_end(B_DELTA,(long)n_alts*(n_alts-1)/2);
+	b_begin();
+	for (Ai=1; Ai<=n_alts; Ai++)
+		if (call(TCL_evaluate(uf->df,Ai,0,GAMMA,cube1)))
+			return -1;
+	b_end(B_GAMMA,(long)n_alts);
+	b_begin();
+	for (Ai=1; Ai<=n_alts; Ai++)
+		if (call(TCL_evaluate(uf->df,Ai,0,PSI,cube1)))
+			return -1;
+	b_end(B_PSI,(long)n_alts);
+	/* DIGAMMA against all other alternatives that fit the bitmask */
+	mask = (n_alts<DIGAMMA_BITS ? (0x01<<n_alts)-1 : ~0);
+	b_begin();
+	for (Ai=1; Ai<=n_alts; Ai++)
+		if (call(TCL_evaluate(uf->df,Ai,(Ai<=DIGAMMA_BITS ? mask&~(0x01<<(Ai-1)) : mask),
+						DIGAMMA,cube1)))
+			return -1;
+	b_end(B_DIGAMMA,(long)n_alts);
+	b_begin();
+	for (Ai=1; Ai<=n_alts; Ai++)
+		if (call(TCL_evaluate_omega(uf->df,Ai,cube1[Ai]+E_MID)))
+			return -1;
+	b_end(B_OMEGA,(long)n_alts);
+	b_begin();
+	if (call(TCL_get_moments(uf->df,rm1,cm2,cm3)))
+		return -1;
+	b_end(B_MOMENTS,1L);
+	b_begin();
+	if (call(TCL_security_level(uf->df,0.5,strong,marked,weak)))
+		return -1;
+	b_end(B_SECLVL,1L);
+	return 0;
+	}
+
+
+/* Frame file name in the scratch folder. Returns TRUE if it exists. */
+
+static bool bench_fn(char *fn, char *ext) {
+	FILE *fp;
+
+	strcpy(fn,b_folder);
+	strcat(fn,uf->frame_name);
+	strcat(fn,ext);
+	if (fp = fopen(fn,"r")) {
+		fclose(fp);
+		return TRUE;
+		}
+	return FALSE;
+	}
+
+
+/* The save and reload are timed on a scratch file in the temp folder
+ * under a name that is not in use, so no file of the user is touched. */
+
+static void bench_scratch() {
+	int i;
+	char *tmp,fn[64];
+
+	if (!(tmp = getenv("TMPDIR")))
+		if (!(tmp = getenv("TEMP")))
+			tmp = getenv("TMP");
+	if (tmp && tmp[0] && (strlen(tmp) < sizeof(b_folder)-1)) {
+		strcpy(b_folder,tmp);
+		if ((tmp[strlen(tmp)-1] != '/') && (tmp[strlen(tmp)-1] != '\\'))
+			strcat(b_folder,"/");
+		}
+	else
+#ifdef UNIX
+		strcpy(b_folder,"/tmp/");
+#else
+		strcpy(b_folder,HOME_FOLDER);
+#endif
+	for (i=0; i<10000; i++) {
+		sprintf(uf->frame_name,"%s%d",BMK_NAME,i);
+		if (!bench_fn(fn,".ddt") && !bench_fn(fn,".bkp"))
+			break;
+		}
+	}
+
+
+/* Time a save and a reload of the frame. Returns 0 if ok. */
+
+static int bench_file() {
+	int rc;
+	char fn[64];
+
+	rc = -1;
+	b_begin();
+	if (!call(write_ufile(uf->frame_name,b_folder,uf))) {
+		b_end(B_SAVE,1L);
+		TCL_dispose_frame(uf->df);
+		uf->df = NULL;
+		b_begin();
+		if (call(read_ufile(uf->frame_name,b_folder,uf))) {
+			if (uf->df)
+				TCL_dispose_frame(uf->df);
+			uf->df = NULL;
+			}
+		else {
+			b_end(B_LOAD,1L);
+			rc = 0;
+			}
+		}
+	/* Remove the scratch files, also after a failure */
+	if (bench_fn(fn,".ddt"))
+		remove(fn);
+	if (bench_fn(fn,".bkp"))
+		remove(fn);
+	return rc;
+	}
+
+
+/* Benchmark entry point. Returns the exit code. */
+
+int bench_uct(int argc, char *argv[]) {
+	int i,rep,rc,n_alts,depth,fanout,reps,n_P,n_V,s_nodes,r_nodes;
+	long seed,t_P,t_V;
+	double density,midbox,ms;
+	struct tcl_perf perf;
+
+	n_alts = (argc>0 ? atoi(argv[0]) : 10);
+	depth = (argc>1 ? atoi(argv[1]) : 1);
+	fanout = (argc>2 ? atoi(argv[2]) : 5);
+	density = (argc>3 ? atof(argv[3]) : 0.5);
+	midbox = (argc>4 ? atof(argv[4]) : 0.25);
+	reps = (argc>5 ? atoi(argv[5]) : 5);
+	seed = (argc>6 ? atol(argv[6]) : 1L);
+
+	/* Check sizes against the configuration */
+	for (s_nodes=0,r_nodes=1,i=1; (i<=depth) && (s_nodes<=MAX_NOPA); i++) {
+		r_nodes *= fanout;
+		s_nodes += r_nodes;
+		}
+	if ((n_alts < 2) || (n_alts > MAX_ALTS) || (depth < 1) || (fanout < 1) ||
+			((depth > 1) && (fanout < 2)) || (s_nodes > MAX_NOPA) || (r_nodes > MAX_COPA) ||
+			(n_alts*s_nodes > MAX_NODES) || (n_alts*r_nodes > MAX_CONS) || (reps < 1)) {
+		fprintf(stderr,"usage: uct -b [alts depth fanout density midbox reps seed]\n");
+		fprintf(stderr,"limits: alts 2..%d, per alt %d nodes %d cons, total %d nodes %d cons\n",
+						MAX_ALTS,MAX_NOPA,MAX_COPA,MAX_NODES,MAX_CONS);
+		return 1;
+		}
+
+	seed_random(seed);
+	bench_scratch();
+	for (i=1; i<=n_alts; i++)
+		sprintf(uf->alt_name[i],"A%d",i);
+	uf->multilevel = (depth > 1);
+	uf->n_crit = 1;
+	uf->v_lo = v_min = 0.0;
+	uf->v_up = v_max = 1.0;
+	v_mm = 1.0;
+	for (i=0; i<N_PHASES; i++) {
+		b_secs[i] = 0.0;
+		b_calls[i] = 0L;
+		}
+	TCL_reset_perf();
+
+	rc = 0;
+	t_P = t_V = 0L;
+	for (rep=1; rep<=reps; rep++) {
+		if (rc = bench_frame(n_alts,depth,fanout,density,midbox,&n_P,&n_V)) {
+			if (rc < -1)
+				TCL_dispose_frame(uf->df);
+			break;
+			}
+		t_P += n_P;
+		t_V += n_V;
+		if ((rc = bench_eval(n_alts)) || (rc = bench_file())) {
+			if (uf->df)
+				TCL_dispose_frame(uf->df);
+			break;
+			}
+		b_begin();
+		TCL_dispose_frame(uf->df);
+		b_end(B_DISPOSE,1L);
+		uf->df = NULL;
+		}
+	uf->df = NULL;
+	if (rc) {
+		fprintf(stderr,"benchmark aborted in repetition %d\n",rep);
+		return 2;
+		}
+
+	printf("CFG\tversion\t%d.%d.%d\n",DTL_MAIN,DTL_FUNC,DTL_TECH);
+#ifdef BIGFOOT
+	printf("CFG\tbuild\tBIGFOOT\n");
+#else
+	printf("CFG\tbuild\tdefault\n");
+#endif
+	printf("CFG\tkind\t%s\n",depth>1?"tree":"flat");
+	printf("CFG\talts\t%d\n",n_alts);
+	printf("CFG\tdepth\t%d\n",depth);
+	printf("CFG\tfanout\t%d\n",fanout);
+	printf("CFG\tnodes\t%d\n",n_alts*s_nodes);
+	printf("CFG\tdensity\t%.3lf\n",density);
+	printf("CFG\tmidbox\t%.3lf\n",midbox);
+	printf("CFG\treps\t%d\n",reps);
+	printf("CFG\tseed\t%ld\n",seed);
+	printf("CFG\tP_stmts\t%.1lf\n",(double)t_P/(double)reps);
+	printf("CFG\tV_stmts\t%.1lf\n",(double)t_V/(double)reps);
+	for (i=0; i<N_PHASES; i++) {
+		ms = 1000.0*b_secs[i];
+		printf("BMK\t%s\t%ld\t%.3lf\t%.3lf\n",phase_name[i],b_calls[i],ms,
+						b_calls[i] ? 1000.0*ms/(double)b_calls[i] : 0.0);
+		}
+	TCL_get_perf(&perf);
+	printf("PRF\tload_P\t%lu\n",perf.load_P);
+	printf("PRF\tload_P_ms\t%.3lf\n",1000.0*perf.load_P_time);
+	printf("PRF\tload_V\t%lu\n",perf.load_V);
+	printf("PRF\tload_V_ms\t%.3lf\n",1000.0*perf.load_V_time);
+	printf("PRF\tload_V_inc\t%lu\n",perf.load_V_inc);
+	printf("PRF\tload_V_inc_ms\t%.3lf\n",1000.0*perf.load_V_inc_time);
+	printf("PRF\tattach\t%lu\n",perf.attach);
+	printf("PRF\teval_P\t%lu\n",perf.eval_P);
+	printf("PRF\tsort_elems\t%lu\n",perf.sort_elems);
+	printf("PRF\tvx_calls\t%lu\n",perf.vx_calls);
+	printf("PRF\tvx_paths\t%lu\n",perf.vx_paths);
+	printf("PRF\tvx_bails\t%lu\n",perf.vx_bails);
+	return 0;
+	}
@@ -50,6 +50,14 @@ void init_random() {
 	}
 
 
+void seed_random(long seed) {
+
+	/* Repeatable sequences for benchmarking */
+	srand((unsigned int)seed);
+	iseed = (seed%IM > 0 ? seed%IM : 1L);
+	}
+
+
 double xrandom() {
 	long k;
 	double rnd;
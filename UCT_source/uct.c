@@ -255,9 +255,9 @@ static a_result cube1;
 static d_row P_min,P_mid,P_max,V_min,V_mid,V_max;
 static a_row rm1,cm2;
 
-int main() {
+int main(int argc, char *argv[]) {
 	char cmd[CMD_SIZE];
-	int len;
+	int len,rc;
 #ifdef BATCH_MODE
 	FILE *fp,*zp;
 	char f_name[80],batseq[24];
@@ -275,6 +275,13 @@ int main() {
 	init_uct();
 	init_random();
 
+	/* Non-interactive benchmark mode */
+	if ((argc > 1) && !strcmp(argv[1],"-b")) {
+		rc = bench_uct(argc-2,argv+2);
+		mem_free(uf);
+		exit(rc);
+		}
+
 	/* Display welcome banner */
 	welcome();
 
@@ -135,8 +135,12 @@ int read_ufile(char *fn, char *folder, struct user_frame *uf);
 int write_ufile(char *fn, char *folder, struct user_frame *uf);
 int backup_ufile(char *fn, char *folder);
 
+/* from bench.c */
+int bench_uct(int argc, char *argv[]);
+
 /* from random.c */
 void init_random();
+void seed_random(long seed);
 double xrandom();
 double drandom(double lobo, double upbo);
 int irandom(int lobo, int upbo);